@@ -388,6 +388,10 @@ bool late_init(EmuEnvState &state) {
     if (state.mem.use_page_table && state.kernel.cpu_backend == CPUBackend::Unicorn)
         LOG_CRITICAL("Unicorn backend is not supported with a page table");
 
+    // the hashless texture cache polls the pages written by the JIT instead of protecting them
+    if (state.cfg.software_write_tracking && state.kernel.cpu_backend == CPUBackend::Dynarmic)
+        enable_write_tracking(state.mem);
+
     const ResumeAudioThread resume_thread = [&state](SceUID thread_id) {
         const auto thread = lock_and_find(thread_id, state.kernel.threads, state.kernel.mutex);
         const std::lock_guard<std::mutex> lock(thread->mutex);
@@ -21,6 +21,7 @@
 
 #include <SDL_audio.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -84,6 +85,9 @@ class AudioAdapter {
 private:
     // buffer used to mix audio
     std::vector<uint8_t> temp_buffer;
+    // copy of the output ports, only updated by the callback when they have changed
+    std::vector<AudioOutPortPtr> ports;
+    uint32_t ports_version = 0;
 
 protected:
     AudioState &state;
@@ -115,6 +119,8 @@ struct AudioState {
     std::mutex mutex;
     int next_port_id = 1;
     AudioOutPortPtrs out_ports;
+    // must be incremented every time out_ports is modified, with mutex held
+    std::atomic<uint32_t> out_ports_version = 0;
     AudioInPort in_port;
     ResumeAudioThread resume_thread;
     std::string audio_backend;
@@ -24,6 +24,7 @@
 
 #include <kernel/thread/thread_state.h>
 
+#include <util/audio_mix.h>
 #include <util/log.h>
 #include <util/log_to_file.h>
 
@@ -61,7 +62,9 @@ static void mix_out_port(uint8_t *stream, uint8_t *temp_buffer, int len, float g
     const int bytes_got = SDL_AudioStreamGet(port.stream.get(), temp_buffer, bytes_to_get);
     lock.unlock();
     if (bytes_got > 0) {
-        SDL_MixAudioFormat(stream, temp_buffer, AUDIO_S16LSB, bytes_got, static_cast<int>(port.volume * global_volume * SDL_MIX_MAXVOLUME));
+        // the streams output stereo S16 frames
+        util::mix_stereo_s16(reinterpret_cast<int16_t *>(stream), reinterpret_cast<const int16_t *>(temp_buffer),
+            bytes_got / (2 * sizeof(int16_t)), port.volume * global_volume);
     }
 }
 
@@ -69,15 +72,19 @@ void AudioAdapter::audio_callback(uint8_t *stream, int len_bytes) {
     tracy::SetThreadName("Host audio thread"); // Tracy - Declare belonging of this function to the audio thread
     ZoneScopedC(0xF6C2FF); // Tracy - Track function scope with color thistle
 
-    std::vector<AudioOutPortPtr> ports;
-    {
-        // Read from shared state.
+    if (ports_version != state.out_ports_version.load(std::memory_order_acquire)) {
+        // Read from shared state, only when a port was opened or released.
         const std::lock_guard<std::mutex> lock(state.mutex);
-        ports.reserve(state.out_ports.size());
+        ports.clear();
         for (const auto &[_, port] : state.out_ports) {
             ports.push_back(port);
         }
+        ports_version = state.out_ports_version;
     }
+
+    if (temp_buffer.size() < static_cast<size_t>(len_bytes))
+        temp_buffer.resize(len_bytes);
+
     std::memset(stream, state.spec.silence, len_bytes);
 
     for (const AudioOutPortPtr &port : ports) {
@@ -104,6 +111,7 @@ void AudioState::set_backend(const std::string &adapter_name) {
 
     // first delete all ports then delete the backend
     out_ports.clear();
+    out_ports_version++;
     adapter.reset();
     if (adapter_name == "SDL") {
         adapter = std::make_unique<SDLAudioAdapter>(*this);
@@ -0,0 +1,228 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <audio/state.h>
+#include <util/audio_mix.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// not a multiple of the vector sizes so the last frames are mixed one by one
+constexpr uint32_t FRAMES = 1027;
+
+constexpr float MATRIX[2][2] = { { 0.7f, 0.2f }, { -0.4f, 0.9f } };
+
+// what the mixing functions are expected to do, one frame at a time
+void reference_mix_f32(float *dest, const float *src, uint32_t frames, const float matrix[2][2]) {
+    for (uint32_t i = 0; i < frames; i++) {
+        const float left = dest[i * 2] + (src[i * 2] * matrix[0][0] + src[i * 2 + 1] * matrix[1][0]);
+        const float right = dest[i * 2 + 1] + (src[i * 2] * matrix[0][1] + src[i * 2 + 1] * matrix[1][1]);
+        dest[i * 2] = std::clamp(left, -1.0f, 1.0f);
+        dest[i * 2 + 1] = std::clamp(right, -1.0f, 1.0f);
+    }
+}
+
+void reference_mix_s16(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]) {
+    const auto saturate = [](float value) {
+        return static_cast<int16_t>(std::clamp<long>(std::lrint(value), INT16_MIN, INT16_MAX));
+    };
+
+    for (uint32_t i = 0; i < frames; i++) {
+        const float left = src[i * 2];
+        const float right = src[i * 2 + 1];
+        const float mixed_left = dest[i * 2] + (left * matrix[0][0] + right * matrix[1][0]);
+        const float mixed_right = dest[i * 2 + 1] + (left * matrix[0][1] + right * matrix[1][1]);
+        dest[i * 2] = saturate(mixed_left);
+        dest[i * 2 + 1] = saturate(mixed_right);
+    }
+}
+
+std::vector<float> make_noise_f32(uint32_t frames, float amplitude, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> distribution(-amplitude, amplitude);
+    std::vector<float> samples(frames * 2);
+    for (float &sample : samples)
+        sample = distribution(random);
+
+    return samples;
+}
+
+std::vector<int16_t> make_noise_s16(uint32_t frames, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> distribution(INT16_MIN, INT16_MAX);
+    std::vector<int16_t> samples(frames * 2);
+    for (int16_t &sample : samples)
+        sample = static_cast<int16_t>(distribution(random));
+
+    return samples;
+}
+
+// An adapter without any device, the test calls the audio callback itself
+class TestAudioAdapter : public AudioAdapter {
+public:
+    explicit TestAudioAdapter(AudioState &audio_state)
+        : AudioAdapter(audio_state) {}
+
+    bool init() override { return true; }
+};
+
+} // namespace
+
+TEST(audio_mix, f32_matches_reference) {
+    const std::vector<float> src = make_noise_f32(FRAMES, 1.0f, 1);
+    std::vector<float> dest = make_noise_f32(FRAMES, 0.5f, 2);
+    std::vector<float> expected = dest;
+
+    util::mix_stereo_f32(dest.data(), src.data(), FRAMES, MATRIX);
+    reference_mix_f32(expected.data(), src.data(), FRAMES, MATRIX);
+
+    for (size_t i = 0; i < dest.size(); i++)
+        ASSERT_EQ(dest[i], expected[i]) << i;
+}
+
+TEST(audio_mix, f32_saturates) {
+    std::vector<float> src(FRAMES * 2, 0.75f);
+    std::vector<float> dest(FRAMES * 2, 0.5f);
+    util::mix_stereo_f32(dest.data(), src.data(), FRAMES, 1.0f);
+    for (float sample : dest)
+        ASSERT_EQ(sample, 1.0f);
+
+    util::mix_stereo_f32(dest.data(), src.data(), FRAMES, -4.0f);
+    for (float sample : dest)
+        ASSERT_EQ(sample, -1.0f);
+}
+
+TEST(audio_mix, s16_matches_reference) {
+    const std::vector<int16_t> src = make_noise_s16(FRAMES, 3);
+    std::vector<int16_t> dest = make_noise_s16(FRAMES, 4);
+    std::vector<int16_t> expected = dest;
+
+    // full scale noise, a lot of the samples saturate
+    util::mix_stereo_s16(dest.data(), src.data(), FRAMES, MATRIX);
+    reference_mix_s16(expected.data(), src.data(), FRAMES, MATRIX);
+    ASSERT_EQ(dest, expected);
+
+    // a single gain is a diagonal matrix
+    const float gain[2][2] = { { 0.33f, 0.0f }, { 0.0f, 0.33f } };
+    util::mix_stereo_s16(dest.data(), src.data(), FRAMES, 0.33f);
+    reference_mix_s16(expected.data(), src.data(), FRAMES, gain);
+    ASSERT_EQ(dest, expected);
+}
+
+TEST(audio_mix, s16_gain_and_saturation) {
+    std::vector<int16_t> src(FRAMES * 2, 20000);
+    std::vector<int16_t> dest(FRAMES * 2, 0);
+
+    util::mix_stereo_s16(dest.data(), src.data(), FRAMES, 0.5f);
+    for (int16_t sample : dest)
+        ASSERT_EQ(sample, 10000);
+
+    util::mix_stereo_s16(dest.data(), src.data(), FRAMES, 2.0f);
+    for (int16_t sample : dest)
+        ASSERT_EQ(sample, INT16_MAX);
+
+    util::mix_stereo_s16(dest.data(), src.data(), FRAMES, -4.0f);
+    for (int16_t sample : dest)
+        ASSERT_EQ(sample, INT16_MIN);
+}
+
+TEST(audio_callback, mixes_the_open_ports) {
+    AudioState state;
+    state.spec = { .freq = 48000, .nb_samples = 256, .silence = 0 };
+    state.global_volume = 1.0f;
+    state.adapter = std::make_unique<TestAudioAdapter>(state);
+
+    const auto open_port = [&](int port_id, int16_t value, float volume) {
+        AudioOutPortPtr port = state.open_port(2, 48000, state.spec.nb_samples);
+        ASSERT_NE(port, nullptr);
+        port->volume = volume;
+
+        const std::vector<int16_t> samples(state.spec.nb_samples * 2 * 4, value);
+        SDL_AudioStreamPut(port->stream.get(), samples.data(), samples.size() * sizeof(int16_t));
+
+        const std::lock_guard<std::mutex> lock(state.mutex);
+        state.out_ports.emplace(port_id, port);
+        state.out_ports_version++;
+    };
+
+    open_port(1, 1000, 1.0f);
+    open_port(2, 3000, 0.5f);
+
+    std::vector<int16_t> stream(state.spec.nb_samples * 2);
+    const int len_bytes = static_cast<int>(stream.size() * sizeof(int16_t));
+    state.adapter->audio_callback(reinterpret_cast<uint8_t *>(stream.data()), len_bytes);
+    for (int16_t sample : stream)
+        ASSERT_EQ(sample, 2500);
+
+    // the callback must notice the released port
+    {
+        const std::lock_guard<std::mutex> lock(state.mutex);
+        state.out_ports.erase(2);
+        state.out_ports_version++;
+    }
+
+    state.adapter->audio_callback(reinterpret_cast<uint8_t *>(stream.data()), len_bytes);
+    for (int16_t sample : stream)
+        ASSERT_EQ(sample, 1000);
+
+    // the ports must be released before the adapter
+    state.out_ports.clear();
+    state.out_ports_version++;
+    state.adapter->audio_callback(reinterpret_cast<uint8_t *>(stream.data()), len_bytes);
+    for (int16_t sample : stream)
+        ASSERT_EQ(sample, 0);
+}
+
+TEST(audio_mix_benchmark, stereo_mixing) {
+    // one minute of 48 kHz audio, mixed one host audio buffer at a time
+    constexpr uint32_t BLOCK_FRAMES = 512;
+    constexpr uint32_t BLOCKS = 48000 * 60 / BLOCK_FRAMES;
+
+    const auto measure = [](const char *name, const std::function<void(uint32_t)> &mix) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t block = 0; block < BLOCKS; block++)
+            mix(block);
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << name << ": 60 s of audio in " << ms << " ms" << std::endl;
+    };
+
+    const std::vector<float> src_f32 = make_noise_f32(BLOCK_FRAMES, 0.5f, 5);
+    std::vector<float> dest_f32(BLOCK_FRAMES * 2);
+    measure("f32 reference", [&](uint32_t) { reference_mix_f32(dest_f32.data(), src_f32.data(), BLOCK_FRAMES, MATRIX); });
+    measure("f32", [&](uint32_t) { util::mix_stereo_f32(dest_f32.data(), src_f32.data(), BLOCK_FRAMES, MATRIX); });
+
+    const std::vector<int16_t> src_s16 = make_noise_s16(BLOCK_FRAMES, 6);
+    std::vector<int16_t> dest_s16(BLOCK_FRAMES * 2);
+    measure("s16 reference", [&](uint32_t) { reference_mix_s16(dest_s16.data(), src_s16.data(), BLOCK_FRAMES, MATRIX); });
+    measure("s16", [&](uint32_t) { util::mix_stereo_s16(dest_s16.data(), src_s16.data(), BLOCK_FRAMES, MATRIX); });
+
+    // keep the results alive
+    ASSERT_TRUE(std::isfinite(dest_f32[0]));
+    ASSERT_GE(dest_s16[0], INT16_MIN);
+}
@@ -17,9 +17,14 @@
 
 #pragma once
 
+#include <array>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
+#include <vector>
 
 struct AVFrame;
 struct AVPacket;
@@ -80,6 +85,15 @@ struct DecoderState {
     virtual ~DecoderState();
 };
 
+// Host threads used by a video decoder
+enum class DecoderThreading {
+    None,
+    // Parts of a frame are decoded at the same time, without delay
+    Slice,
+    // Several frames are decoded at the same time, each thread delays the output by a frame
+    Frame,
+};
+
 struct H264DecoderOptions {
     uint32_t pts_upper;
     uint32_t pts_lower;
@@ -89,6 +103,9 @@ struct H264DecoderOptions {
 
 struct H264DecoderState : public DecoderState {
     AVCodecParserContext *parser{};
+    AVFrame *frame{};
+    // the access unit with its padding, reused for every packet
+    std::vector<uint8_t> au_frame;
 
     uint32_t width_in = 0;
     uint32_t height_in = 0;
@@ -117,7 +134,7 @@ struct H264DecoderState : public DecoderState {
     void get_pts(uint32_t &upper, uint32_t &lower);
     void set_output_format(bool is_yuv_p3);
 
-    H264DecoderState(uint32_t width, uint32_t height);
+    H264DecoderState(uint32_t width, uint32_t height, DecoderThreading threading = DecoderThreading::Slice);
     ~H264DecoderState() override;
 };
 
@@ -199,6 +216,8 @@ struct ADPCMHistory {
 struct PCMDecoderState : public DecoderState {
 private:
     std::vector<std::uint8_t> final_result;
+    // HE-ADPCM samples before the conversion, kept to not allocate on every send
+    std::vector<std::int16_t> transformed;
     float dest_frequency;
     SwrContext *swr_mono_to_stereo = nullptr;
     SwrContext *swr_stereo = nullptr;
@@ -241,13 +260,54 @@ struct AacDecoderState : public DecoderState {
     ~AacDecoderState() override;
 };
 
+struct PlayerVideoFrame {
+    std::vector<uint8_t> data;
+    uint64_t timestamp = 0;
+};
+
+struct PlayerAudioFrame {
+    std::vector<int16_t> data;
+    uint32_t channels = 0;
+    uint32_t sample_rate = 0;
+    uint32_t sample_count = 0;
+};
+
+// Frames decoded ahead, in fixed slots whose buffers are reused by the next frames
+template <typename Frame, size_t Size>
+struct PlayerFrameQueue {
+    std::array<Frame, Size> slots;
+    size_t head = 0;
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+    bool full() const { return count == Size; }
+    Frame &front() { return slots[head]; }
+    // Slot of the next frame, filled before it is pushed
+    Frame &next() { return slots[(head + count) % Size]; }
+    void push() { count++; }
+    void pop() {
+        head = (head + 1) % Size;
+        count--;
+    }
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+};
+
+// The frames are demuxed and decoded ahead by a decode thread, the receive functions only take the next one
 struct PlayerState {
+    static constexpr size_t VIDEO_QUEUE_SIZE = 4;
+    static constexpr size_t AUDIO_QUEUE_SIZE = 16;
+
     std::string video_playing;
     std::queue<std::string> videos_queue;
 
     AVFormatContext *format{};
     AVCodecContext *video_context{};
     AVCodecContext *audio_context{};
+    SwrContext *swr{};
+    AVFrame *frame{};
     int32_t video_stream_id = -1;
     int32_t audio_stream_id = -1;
 
@@ -256,23 +316,48 @@ struct PlayerState {
 
     uint64_t time_of_last_frame = 0;
     uint64_t framerate_microseconds = 0;
+    uint32_t video_width = 0;
+    uint32_t video_height = 0;
 
     uint64_t last_timestamp = 0;
     uint32_t last_channels = 0;
     uint32_t last_sample_rate = 0;
     uint32_t last_sample_count = 0;
 
+    // Held while demuxing and decoding, and to change the video
+    std::mutex decoder_mutex;
+    // Protects the frame queues and the decoding state, taken after decoder_mutex
+    std::mutex frames_mutex;
+    std::condition_variable decode_cond;
+    std::condition_variable ready_cond;
+    std::thread decode_thread;
+    bool stopping = false;
+    bool decoding = false;
+    bool video_ended = false;
+    bool audio_ended = false;
+    PlayerFrameQueue<PlayerVideoFrame, VIDEO_QUEUE_SIZE> video_frames;
+    PlayerFrameQueue<PlayerAudioFrame, AUDIO_QUEUE_SIZE> audio_frames;
+    // Last received frames, valid until the next receive
+    PlayerVideoFrame video_frame;
+    PlayerAudioFrame audio_frame;
+
     DecoderSize get_size();
     uint64_t get_framerate_microseconds();
 
     void pop_video();
     void free_video();
     void switch_video(const std::string &path);
+    bool next_video();
 
     bool next_packet(int32_t stream_id);
-
-    std::vector<int16_t> receive_audio();
-    std::vector<uint8_t> receive_video();
+    bool decode_frame(int32_t stream_id, AVCodecContext *context);
+    bool decode_video_frame(PlayerVideoFrame &video);
+    bool decode_audio_frame(PlayerAudioFrame &audio);
+    void decode_loop();
+
+    // Empty once the video has ended
+    const std::vector<int16_t> &receive_audio();
+    const std::vector<uint8_t> &receive_video();
 
     void queue(const std::string &path);
 
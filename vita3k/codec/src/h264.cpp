@@ -24,32 +24,85 @@ extern "C" {
 }
 
 #include <cassert>
+#include <cstring>
+
+/*
+U and V interleave for the p2 (NV12) output
+the rows are short and the loop is bound by memory, so the vector width of the baseline instruction set is enough:
+1 program compiled for aarch64: NEON
+2 program compiled for x86-64: SSE2
+3 anything else: one byte at a time
+*/
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+
+static void interleave_uv(uint8_t *dest, const uint8_t *src_u, const uint8_t *src_v, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x2_t uv = { { vld1q_u8(src_u + i), vld1q_u8(src_v + i) } };
+        vst2q_u8(dest + i * 2, uv);
+    }
+
+    for (; i < count; i++) {
+        dest[i * 2] = src_u[i];
+        dest[i * 2 + 1] = src_v[i];
+    }
+}
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+
+static void interleave_uv(uint8_t *dest, const uint8_t *src_u, const uint8_t *src_v, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src_u + i));
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src_v + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2), _mm_unpacklo_epi8(u, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2 + 16), _mm_unpackhi_epi8(u, v));
+    }
+
+    for (; i < count; i++) {
+        dest[i * 2] = src_u[i];
+        dest[i * 2 + 1] = src_v[i];
+    }
+}
+#else
+static void interleave_uv(uint8_t *dest, const uint8_t *src_u, const uint8_t *src_v, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        dest[i * 2] = src_u[i];
+        dest[i * 2 + 1] = src_v[i];
+    }
+}
+#endif
+
+// Copy a plane made of rows of width bytes, in a single copy when the source rows are not padded
+static uint8_t *copy_plane(uint8_t *dest, const uint8_t *src, const int src_pitch, const uint32_t width, const uint32_t height) {
+    if (static_cast<uint32_t>(src_pitch) == width) {
+        memcpy(dest, src, static_cast<size_t>(width) * height);
+        return dest + static_cast<size_t>(width) * height;
+    }
 
-void copy_yuv_data_from_frame(AVFrame *frame, uint8_t *dest, const uint32_t width, const uint32_t height, bool is_p3) {
     for (uint32_t i = 0; i < height; i++) {
-        memcpy(dest, &frame->data[0][frame->linesize[0] * i], width);
+        memcpy(dest, &src[src_pitch * i], width);
         dest += width;
     }
 
+    return dest;
+}
+
+void copy_yuv_data_from_frame(AVFrame *frame, uint8_t *dest, const uint32_t width, const uint32_t height, bool is_p3) {
+    dest = copy_plane(dest, frame->data[0], frame->linesize[0], width, height);
+
     if (is_p3) {
-        for (uint32_t i = 0; i < height / 2; i++) {
-            memcpy(dest, &frame->data[1][frame->linesize[1] * i], width / 2);
-            dest += width / 2;
-        }
-        for (uint32_t i = 0; i < height / 2; i++) {
-            memcpy(dest, &frame->data[2][frame->linesize[2] * i], width / 2);
-            dest += width / 2;
-        }
+        dest = copy_plane(dest, frame->data[1], frame->linesize[1], width / 2, height / 2);
+        copy_plane(dest, frame->data[2], frame->linesize[2], width / 2, height / 2);
     } else {
         // p2 format, U and V are interleaved
         for (uint32_t i = 0; i < height / 2; i++) {
             const uint8_t *src_u = &frame->data[1][frame->linesize[1] * i];
             const uint8_t *src_v = &frame->data[2][frame->linesize[2] * i];
-            for (uint32_t j = 0; j < width / 2; j++) {
-                dest[0] = src_u[j];
-                dest[1] = src_v[j];
-                dest += 2;
-            }
+            interleave_uv(dest, src_u, src_v, width / 2);
+            dest += (width / 2) * 2;
         }
     }
 }
@@ -69,8 +122,10 @@ uint32_t H264DecoderState::get(DecoderQuery query) {
 bool H264DecoderState::send(const uint8_t *data, uint32_t size) {
     int error = 0;
 
-    std::vector<uint8_t> au_frame(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    // the padding must be zeroed, the buffer is kept between the packets
+    au_frame.resize(size + AV_INPUT_BUFFER_PADDING_SIZE);
     memcpy(au_frame.data(), data, size);
+    memset(au_frame.data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 
     AVPacket *packet = av_packet_alloc();
     if (!packet) {
@@ -108,12 +163,12 @@ bool H264DecoderState::send(const uint8_t *data, uint32_t size) {
 }
 
 bool H264DecoderState::receive(uint8_t *data, DecoderSize *size) {
-    AVFrame *frame = av_frame_alloc();
+    av_frame_unref(frame);
 
     int error = avcodec_receive_frame(context, frame);
     if (error < 0) {
-        LOG_WARN("Error receiving H264 frame: {}.", codec_error_name(error));
-        av_frame_free(&frame);
+        // with frame threading, the first frames come out once the next packets are sent
+        LOG_WARN_IF(error != AVERROR(EAGAIN), "Error receiving H264 frame: {}.", codec_error_name(error));
         return false;
     }
 
@@ -130,7 +185,6 @@ bool H264DecoderState::receive(uint8_t *data, DecoderSize *size) {
 
     pts_out = frame->pts;
 
-    av_frame_free(&frame);
     return true;
 }
 
@@ -160,7 +214,7 @@ void H264DecoderState::set_output_format(bool is_yuv_p3) {
     this->output_yuvp3 = is_yuv_p3;
 }
 
-H264DecoderState::H264DecoderState(uint32_t width, uint32_t height) {
+H264DecoderState::H264DecoderState(uint32_t width, uint32_t height, DecoderThreading threading) {
     const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
     assert(codec);
 
@@ -172,11 +226,20 @@ H264DecoderState::H264DecoderState(uint32_t width, uint32_t height) {
     assert(context);
     context->width = width;
     context->height = height;
+    if (threading != DecoderThreading::None) {
+        // as many threads as cores
+        context->thread_count = 0;
+        context->thread_type = threading == DecoderThreading::Frame ? FF_THREAD_FRAME | FF_THREAD_SLICE : FF_THREAD_SLICE;
+    }
 
     int result = avcodec_open2(context, codec, nullptr);
     assert(result == 0);
+
+    frame = av_frame_alloc();
+    assert(frame);
 }
 
 H264DecoderState::~H264DecoderState() {
+    av_frame_free(&frame);
     av_parser_close(parser);
 }
@@ -20,21 +20,24 @@
 #include <util/fs.h>
 #include <util/log.h>
 
+#include <tracy/Tracy.hpp>
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
 }
 
 #include <cassert>
+#include <chrono>
 
 uint64_t PlayerState::get_framerate_microseconds() {
-    AVRational rational = format->streams[video_stream_id]->avg_frame_rate;
-    return 1000000ull * rational.den / rational.num;
+    return framerate_microseconds;
 }
 
 DecoderSize PlayerState::get_size() {
-    if (video_context)
-        return { { static_cast<uint32_t>(video_context->width), static_cast<uint32_t>(video_context->height) } };
+    if (video_width)
+        return { { video_width, video_height } };
 
     return {};
 }
@@ -45,12 +48,25 @@ void PlayerState::pop_video() {
 }
 
 void PlayerState::free_video() {
+    const std::lock_guard<std::mutex> decoder_lock(decoder_mutex);
+    {
+        const std::lock_guard<std::mutex> lock(frames_mutex);
+        decoding = false;
+        video_frames.clear();
+        audio_frames.clear();
+    }
+    // the receivers waiting for a frame return without one
+    ready_cond.notify_all();
+
     if (video_context)
         avcodec_free_context(&video_context);
 
     if (audio_context)
         avcodec_free_context(&audio_context);
 
+    if (swr)
+        swr_free(&swr);
+
     if (format)
         avformat_close_input(&format);
 
@@ -73,6 +89,7 @@ void PlayerState::switch_video(const std::string &path) {
     free_video();
     video_playing = path;
 
+    const std::lock_guard<std::mutex> decoder_lock(decoder_mutex);
     int error = avformat_open_input(&format, path.c_str(), nullptr, nullptr);
     assert(error == 0);
 
@@ -83,12 +100,22 @@ void PlayerState::switch_video(const std::string &path) {
     video_stream_id = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
     audio_stream_id = av_find_best_stream(format, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
 
+    video_width = 0;
+    video_height = 0;
     if (video_stream_id >= 0) {
         AVStream *video_stream = format->streams[video_stream_id];
         const AVCodec *video_codec = avcodec_find_decoder(video_stream->codecpar->codec_id);
         video_context = avcodec_alloc_context3(video_codec);
         avcodec_parameters_to_context(video_context, video_stream->codecpar);
+        // the frames are decoded ahead, so the delay of frame threading does not matter
+        video_context->thread_count = 0;
+        video_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
         avcodec_open2(video_context, video_codec, nullptr);
+
+        const AVRational rational = video_stream->avg_frame_rate;
+        framerate_microseconds = 1000000ull * rational.den / rational.num;
+        video_width = video_context->width;
+        video_height = video_context->height;
     }
 
     if (audio_stream_id >= 0) {
@@ -98,6 +125,32 @@ void PlayerState::switch_video(const std::string &path) {
         avcodec_parameters_to_context(audio_context, audio_stream->codecpar);
         avcodec_open2(audio_context, audio_codec, nullptr);
     }
+
+    if (!frame)
+        frame = av_frame_alloc();
+
+    {
+        const std::lock_guard<std::mutex> lock(frames_mutex);
+        decoding = true;
+        video_ended = false;
+        audio_ended = false;
+        if (!decode_thread.joinable())
+            decode_thread = std::thread([this] { decode_loop(); });
+    }
+    decode_cond.notify_one();
+}
+
+// Called once the video has ended, returns false if there is no other video to play
+bool PlayerState::next_video() {
+    if (videos_queue.empty()) {
+        // Stop playing videos or
+        free_video();
+        return false;
+    }
+
+    // Play the next video (if there is any).
+    pop_video();
+    return true;
 }
 
 bool PlayerState::next_packet(int32_t stream_id) {
@@ -124,109 +177,187 @@ bool PlayerState::next_packet(int32_t stream_id) {
         }
 
         AVPacket *packet = av_packet_alloc();
-        if (av_read_frame(format, packet) != 0)
+        if (av_read_frame(format, packet) != 0) {
+            av_packet_free(&packet);
             return false;
+        }
 
         if (packet->stream_index == stream_id) {
             this_queue.push(packet);
-        } else {
+        } else if (packet->stream_index == video_stream_id || packet->stream_index == audio_stream_id) {
             other_queue.push(packet);
+        } else {
+            // not played, it would never leave the queue
+            av_packet_free(&packet);
         }
     }
 }
 
-std::vector<int16_t> PlayerState::receive_audio() {
-    if (audio_stream_id < 0)
-        return {};
+// Receive the next frame of a stream in frame, false once the stream has ended
+bool PlayerState::decode_frame(int32_t stream_id, AVCodecContext *context) {
+    while (true) {
+        const int error = avcodec_receive_frame(context, frame);
+        if (error == 0)
+            return true;
 
-    if (video_playing.empty())
-        return {};
+        if (error != AVERROR(EAGAIN) || !next_packet(stream_id))
+            return false;
+    }
+}
 
-    AVFrame *frame = av_frame_alloc();
-    std::vector<int16_t> data;
-    while (true) {
-        int error = avcodec_receive_frame(audio_context, frame);
+bool PlayerState::decode_video_frame(PlayerVideoFrame &video) {
+    if (!decode_frame(video_stream_id, video_context))
+        return false;
 
-        if (error == AVERROR(EAGAIN) && next_packet(audio_stream_id))
-            continue;
+    video.timestamp = frame->best_effort_timestamp;
+    video.data.resize(H264DecoderState::buffer_size({ { video_width, video_height } }));
+    copy_yuv_data_from_frame(frame, video.data.data(), frame->width, frame->height, false);
+    return true;
+}
 
-        if (error != 0) {
-            if (videos_queue.empty()) {
-                // Stop playing videos or
-                video_playing.clear();
-                break;
-            } else {
-                // Play the next video (if there is any).
-                switch_video(videos_queue.front());
-                videos_queue.pop();
-                continue;
-            }
-        }
+bool PlayerState::decode_audio_frame(PlayerAudioFrame &audio) {
+    if (!decode_frame(audio_stream_id, audio_context))
+        return false;
+
+    // converts from the decoder format, usually FLTP, to interleaved S16
+    if (!swr) {
+        const int error = swr_alloc_set_opts2(&swr,
+            &frame->ch_layout, AV_SAMPLE_FMT_S16, frame->sample_rate,
+            &frame->ch_layout, static_cast<AVSampleFormat>(frame->format), frame->sample_rate,
+            0, nullptr);
+        assert(error == 0);
+        swr_init(swr);
+    }
 
-        LOG_WARN_IF(frame->format != AV_SAMPLE_FMT_FLTP, "Unknown audio format {}.", frame->format);
+    audio.channels = frame->ch_layout.nb_channels;
+    audio.sample_count = frame->nb_samples;
+    audio.sample_rate = frame->sample_rate;
+    audio.data.resize(audio.sample_count * audio.channels);
 
-        last_channels = frame->ch_layout.nb_channels;
-        last_sample_count = frame->nb_samples;
-        last_sample_rate = frame->sample_rate;
+    uint8_t *data = reinterpret_cast<uint8_t *>(audio.data.data());
+    const int converted = swr_convert(swr, &data, frame->nb_samples, const_cast<const uint8_t **>(frame->extended_data), frame->nb_samples);
+    assert(converted >= 0);
+    return true;
+}
 
-        data.resize(frame->nb_samples * frame->ch_layout.nb_channels);
+void PlayerState::decode_loop() {
+    tracy::SetThreadName("AvPlayer decode thread");
 
-        for (int a = 0; a < frame->nb_samples; a++) {
-            for (int b = 0; b < frame->ch_layout.nb_channels; b++) {
-                auto *frame_data = reinterpret_cast<float *>(frame->data[b]);
-                float current_sample = frame_data[a];
-                int16_t pcm_sample = current_sample * INT16_MAX;
+    // frames_mutex is held
+    const auto needs_video = [&] {
+        return decoding && video_stream_id >= 0 && !video_ended && !video_frames.full();
+    };
+    const auto needs_audio = [&] {
+        return decoding && audio_stream_id >= 0 && !audio_ended && !audio_frames.full();
+    };
 
-                data[a * frame->ch_layout.nb_channels + b] = pcm_sample;
-            }
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(frames_mutex);
+            decode_cond.wait(lock, [&] { return stopping || needs_video() || needs_audio(); });
+            if (stopping)
+                return;
         }
 
-        break;
-    }
+        const std::lock_guard<std::mutex> decoder_lock(decoder_mutex);
+        std::unique_lock<std::mutex> lock(frames_mutex);
+        // the video may have been changed before decoder_mutex was taken
+        if (!needs_video() && !needs_audio())
+            continue;
 
-    av_frame_free(&frame);
-    return data;
+        // the least filled queue first
+        const bool is_video = needs_video() && (!needs_audio() || video_frames.count * AUDIO_QUEUE_SIZE <= audio_frames.count * VIDEO_QUEUE_SIZE);
+        // only the receivers change the queued frames, so the next slot can be filled without the lock
+        PlayerVideoFrame &video = video_frames.next();
+        PlayerAudioFrame &audio = audio_frames.next();
+        lock.unlock();
+
+        ZoneScopedC(0xFFA07A); // Tracy - Track function scope with color light salmon
+        const auto start = std::chrono::steady_clock::now();
+        const bool decoded = is_video ? decode_video_frame(video) : decode_audio_frame(audio);
+        [[maybe_unused]] const double decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        if (is_video) {
+            if (decoded)
+                video_frames.push();
+            else
+                video_ended = true;
+            TracyPlot("AvPlayer video decode (ms)", decode_ms);
+            TracyPlot("AvPlayer video queue", static_cast<int64_t>(video_frames.count));
+        } else {
+            if (decoded)
+                audio_frames.push();
+            else
+                audio_ended = true;
+            TracyPlot("AvPlayer audio decode (ms)", decode_ms);
+            TracyPlot("AvPlayer audio queue", static_cast<int64_t>(audio_frames.count));
+        }
+        lock.unlock();
+        ready_cond.notify_all();
+    }
 }
 
-std::vector<uint8_t> PlayerState::receive_video() {
-    if (video_stream_id < 0)
-        return {};
+const std::vector<int16_t> &PlayerState::receive_audio() {
+    audio_frame.data.clear();
+    if (audio_stream_id < 0)
+        return audio_frame.data;
+
+    while (!video_playing.empty()) {
+        std::unique_lock<std::mutex> lock(frames_mutex);
+        ready_cond.wait(lock, [&] { return !audio_frames.empty() || audio_ended || !decoding; });
+        if (!audio_frames.empty()) {
+            // the buffer of the previous frame goes back to the queue
+            std::swap(audio_frame, audio_frames.front());
+            audio_frames.pop();
+            lock.unlock();
+            decode_cond.notify_one();
+
+            last_channels = audio_frame.channels;
+            last_sample_count = audio_frame.sample_count;
+            last_sample_rate = audio_frame.sample_rate;
+            break;
+        }
 
-    if (video_playing.empty())
-        return {};
+        // when there is a video stream, the video ends with it
+        if (!decoding || video_stream_id >= 0)
+            break;
 
-    AVFrame *frame = av_frame_alloc();
-    std::vector<uint8_t> data;
-    while (true) {
-        int error = avcodec_receive_frame(video_context, frame);
+        lock.unlock();
+        if (!next_video())
+            break;
+    }
 
-        if (error == AVERROR(EAGAIN) && next_packet(video_stream_id))
-            continue;
+    return audio_frame.data;
+}
 
-        if (error != 0) {
-            if (videos_queue.empty()) {
-                // Stop playing videos or
-                video_playing.clear();
-                break;
-            } else {
-                // Play the next video (if there is any).
-                switch_video(videos_queue.front());
-                videos_queue.pop();
-                continue;
-            }
+const std::vector<uint8_t> &PlayerState::receive_video() {
+    video_frame.data.clear();
+    if (video_stream_id < 0)
+        return video_frame.data;
+
+    while (!video_playing.empty()) {
+        std::unique_lock<std::mutex> lock(frames_mutex);
+        ready_cond.wait(lock, [&] { return !video_frames.empty() || video_ended || !decoding; });
+        if (!video_frames.empty()) {
+            std::swap(video_frame, video_frames.front());
+            video_frames.pop();
+            lock.unlock();
+            decode_cond.notify_one();
+
+            last_timestamp = video_frame.timestamp;
+            break;
         }
 
-        last_timestamp = frame->best_effort_timestamp;
+        if (!decoding)
+            break;
 
-        data.resize(H264DecoderState::buffer_size(
-            { { static_cast<uint32_t>(video_context->width), static_cast<uint32_t>(video_context->height) } }));
-        copy_yuv_data_from_frame(frame, data.data(), frame->width, frame->height, false);
-
-        break;
+        lock.unlock();
+        if (!next_video())
+            break;
     }
 
-    av_frame_free(&frame);
-    return data;
+    return video_frame.data;
 }
 
 void PlayerState::queue(const std::string &path) {
@@ -242,7 +373,17 @@ void PlayerState::queue(const std::string &path) {
 }
 
 PlayerState::~PlayerState() {
+    {
+        const std::lock_guard<std::mutex> lock(frames_mutex);
+        stopping = true;
+    }
+    decode_cond.notify_one();
+    if (decode_thread.joinable())
+        decode_thread.join();
+
     free_video();
+    if (frame)
+        av_frame_free(&frame);
 
     video_playing.clear();
     videos_queue = {};
@@ -0,0 +1,136 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <codec/state.h>
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+}
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Frame with random planes, whose rows are padded like the ones given by the decoder
+AVFrame *make_frame(int width, int height, int align) {
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    EXPECT_EQ(av_frame_get_buffer(frame, align), 0);
+
+    std::mt19937 random(width * height);
+    for (int plane = 0; plane < 3; plane++) {
+        const int rows = plane == 0 ? height : height / 2;
+        for (int i = 0; i < frame->linesize[plane] * rows; i++)
+            frame->data[plane][i] = static_cast<uint8_t>(random());
+    }
+
+    return frame;
+}
+
+} // namespace
+
+TEST(codec_h264, copies_yuv_planes) {
+    // padded rows and rows of exactly the frame width
+    for (const auto [width, height, align] : { std::tuple{ 960, 544, 64 }, std::tuple{ 62, 10, 1 }, std::tuple{ 64, 16, 1 } }) {
+        AVFrame *frame = make_frame(width, height, align);
+        for (const bool is_p3 : { false, true }) {
+            std::vector<uint8_t> output(width * height * 3 / 2);
+            copy_yuv_data_from_frame(frame, output.data(), width, height, is_p3);
+
+            const uint8_t *y = output.data();
+            const uint8_t *chroma = y + width * height;
+            for (int i = 0; i < height; i++)
+                ASSERT_EQ(memcmp(y + i * width, frame->data[0] + i * frame->linesize[0], width), 0) << width;
+
+            for (int i = 0; i < height / 2; i++) {
+                for (int j = 0; j < width / 2; j++) {
+                    const uint8_t u = frame->data[1][i * frame->linesize[1] + j];
+                    const uint8_t v = frame->data[2][i * frame->linesize[2] + j];
+                    if (is_p3) {
+                        ASSERT_EQ(chroma[i * width / 2 + j], u);
+                        ASSERT_EQ(chroma[(height / 2 + i) * width / 2 + j], v);
+                    } else {
+                        ASSERT_EQ(chroma[i * width + j * 2], u);
+                        ASSERT_EQ(chroma[i * width + j * 2 + 1], v);
+                    }
+                }
+            }
+        }
+        av_frame_free(&frame);
+    }
+}
+
+// Decodes the raw H.264 stream (Annex B) given by VITA3K_H264_BENCHMARK, the way sceAvcdecDecode does
+TEST(codec_h264_benchmark, decode) {
+    const char *path = std::getenv("VITA3K_H264_BENCHMARK");
+    if (!path)
+        GTEST_SKIP() << "VITA3K_H264_BENCHMARK is not set";
+
+    AVFormatContext *format = nullptr;
+    ASSERT_EQ(avformat_open_input(&format, path, nullptr, nullptr), 0);
+    ASSERT_GE(avformat_find_stream_info(format, nullptr), 0);
+    const int stream_id = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    ASSERT_GE(stream_id, 0);
+
+    std::vector<std::vector<uint8_t>> access_units;
+    AVPacket *packet = av_packet_alloc();
+    while (av_read_frame(format, packet) == 0) {
+        if (packet->stream_index == stream_id)
+            access_units.emplace_back(packet->data, packet->data + packet->size);
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+
+    const uint32_t width = format->streams[stream_id]->codecpar->width;
+    const uint32_t height = format->streams[stream_id]->codecpar->height;
+    avformat_close_input(&format);
+
+    std::vector<uint8_t> output(H264DecoderState::buffer_size({ { width, height } }));
+    for (const auto [threading, name] : { std::pair{ DecoderThreading::None, "none" }, std::pair{ DecoderThreading::Slice, "slice" }, std::pair{ DecoderThreading::Frame, "frame" } }) {
+        H264DecoderState decoder(width, height, threading);
+        decoder.set_res(width, height);
+        decoder.set_output_format(false);
+
+        uint32_t frames = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto &access_unit : access_units) {
+            if (decoder.send(access_unit.data(), static_cast<uint32_t>(access_unit.size())) && decoder.receive(output.data()))
+                frames++;
+        }
+        // the frames still held by the decoding threads
+        avcodec_send_packet(decoder.context, nullptr);
+        while (decoder.receive(output.data()))
+            frames++;
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        EXPECT_EQ(frames, access_units.size()) << name;
+        std::cout << name << " threading: " << frames << " frames of " << width << "x" << height << " at " << frames / seconds << " fps" << std::endl;
+    }
+}
@@ -85,6 +85,7 @@ private:
         console = rhs.console;
         app_args = rhs.app_args;
         load_app_list = rhs.load_app_list;
+        mount_archive = rhs.mount_archive;
         self_path = rhs.self_path;
     }
 
@@ -107,6 +108,7 @@ public:
     bool fullscreen = false;
     bool console = false;
     bool load_app_list = false;
+    bool mount_archive = false;
 
     fs::path get_pref_path() const {
         return fs_utils::utf8_to_path(pref_path);
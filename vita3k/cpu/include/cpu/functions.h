@@ -23,6 +23,7 @@
 #include <cpu/common.h>
 
 #include <cstdint>
+#include <vector>
 
 struct MemState;
 
@@ -30,6 +31,7 @@ CPUStatePtr init_cpu(CPUBackend backend, bool cpu_opt, SceUID thread_id, std::si
 int run(CPUState &state);
 int step(CPUState &state);
 void stop(CPUState &state);
+void release_resources(CPUState &state);
 void set_thread_id(CPUState &state, SceUID thread_id);
 SceUID get_thread_id(CPUState &state);
 uint32_t read_reg(CPUState &state, size_t index);
@@ -48,6 +50,7 @@ bool is_thumb_mode(CPUState &state);
 CPUContext save_context(CPUState &state);
 void load_context(CPUState &state, const CPUContext &ctx);
 std::size_t get_processor_id(CPUState &state);
+void clear_exclusive(CPUState &state);
 void invalidate_jit_cache(CPUState &state, Address start, size_t length);
 
 uint32_t read_fpscr(CPUState &state);
@@ -60,7 +63,15 @@ uint32_t stack_free(CPUState &state, size_t size);
 
 ExclusiveMonitorPtr new_exclusive_monitor(int max_num_cores);
 void free_exclusive_monitor(ExclusiveMonitorPtr monitor);
-void clear_exclusive(ExclusiveMonitorPtr monitor, std::size_t core_num);
+
+// Translated code shared by all the threads of the process
+JitCachePtr new_jit_cache(MemState &mem, ExclusiveMonitorPtr monitor, int max_num_cores, bool cpu_opt);
+void invalidate_jit_cache(JitCachePtr cache, Address start, size_t length);
+// Location descriptors of the blocks translated in a range, and translation of such blocks ahead of time
+std::vector<uint64_t> get_jit_cache_entries(JitCachePtr cache, Address start, size_t length);
+void warm_jit_cache(JitCachePtr cache, const std::vector<uint64_t> &entries);
+// Backend build the entries come from, the entries of another build can't be used
+std::string get_jit_cache_format();
 
 // Debugging helpers
 std::string disassemble(CPUState &state, uint64_t at, bool thumb, uint16_t *insn_size = nullptr);
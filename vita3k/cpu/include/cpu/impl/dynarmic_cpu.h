@@ -23,20 +23,106 @@
 #include <cpu/functions.h>
 #include <cpu/impl/unicorn_cpu.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
 
 class ArmDynarmicCallback;
 class ArmDynarmicCP15;
+class DynarmicCPU;
+
+/*! \brief One dynarmic JIT instance, lent to a guest thread for the duration of a run */
+struct DynarmicJitSlot {
+    std::unique_ptr<ArmDynarmicCallback> cb;
+    std::shared_ptr<ArmDynarmicCP15> cp15;
+    std::unique_ptr<Dynarmic::A32::Jit> jit;
+
+    // Processor id of the JIT in the exclusive monitor, one per JIT which can run at the same time.
+    // It is not the processor id of the guest thread (DynarmicCPU::processor_id), which can run on any JIT,
+    // the reservations are cleared when the thread gives the JIT back and on every SVC return
+    std::size_t monitor_id = 0;
+    bool log_code = false;
+    bool log_mem = false;
+    // number of batches of warm entries already translated by this JIT
+    std::size_t warm_batches_done = 0;
+};
+
+/*! \brief Process-wide pool of JIT instances shared by all guest threads
+ *
+ * A dynarmic JIT can only be executed by one host thread at a time, so the pool hands out a free
+ * JIT to each thread entering guest code and gets it back when the thread leaves it (svc, halt...).
+ * The register state stays in each DynarmicCPU, so the pool only grows up to the number of guest
+ * threads running at the same time instead of the total number of threads.
+ *
+ * Each JIT still has its own translated code, dynarmic can't share it between instances: threads running
+ * at the same time on different JITs translate the same blocks on their own. Only the block entries are
+ * shared, every JIT translates the warm ones ahead of time.
+ */
+class DynarmicCodeCache {
+    MemState &mem;
+    Dynarmic::ExclusiveMonitor *monitor;
+    std::size_t max_slots;
+    bool cpu_opt;
+
+    std::mutex mutex;
+    std::condition_variable slot_released;
+    std::vector<std::unique_ptr<DynarmicJitSlot>> slots;
+    // most recently released last, so the warmest JIT is handed out first
+    std::vector<DynarmicJitSlot *> free_slots;
+    // JITs being created without the lock held, they count in the limit
+    std::size_t pending_slots = 0;
+    // threads waiting for a JIT, the others give theirs back as soon as they leave guest code
+    std::atomic<std::size_t> waiting_threads = 0;
+
+    // location descriptors of every block translated so far, and of the blocks
+    // loaded from the persistent cache, one batch per module, which each JIT translates ahead of time
+    std::mutex entries_mutex;
+    std::unordered_set<uint64_t> block_entries;
+    std::vector<std::vector<uint64_t>> warm_batches;
+    std::atomic<std::size_t> warm_batch_count = 0;
+
+    std::unique_ptr<DynarmicJitSlot> make_slot(std::size_t core_id, bool log_code, bool log_mem);
+    void pretranslate(DynarmicJitSlot &slot, const std::vector<uint64_t> &entries);
+
+public:
+    DynarmicCodeCache(MemState &mem, Dynarmic::ExclusiveMonitor *monitor, std::size_t max_slots, bool cpu_opt);
+    ~DynarmicCodeCache();
+
+    DynarmicJitSlot *acquire(DynarmicCPU &cpu, bool log_code, bool log_mem);
+    void release(DynarmicJitSlot *slot);
+    // Drop the exclusive reservation of the thread running on this JIT
+    void clear_exclusive(DynarmicJitSlot &slot);
+    bool under_pressure() const {
+        return waiting_threads.load(std::memory_order_relaxed) != 0;
+    }
+    bool is_behind(const DynarmicJitSlot &slot) const {
+        return slot.warm_batches_done != warm_batch_count.load(std::memory_order_acquire);
+    }
+    // Translate the warm entries the JIT has not seen yet, on the thread it is bound to. Changes its registers
+    void catch_up(DynarmicJitSlot &slot);
+    void invalidate(Address start, size_t length);
+
+    void record_block_entry(uint64_t entry);
+    std::vector<uint64_t> get_block_entries(Address start, size_t length);
+    void warm(const std::vector<uint64_t> &entries);
+};
 
 class DynarmicCPU : public CPUInterface {
     friend class ArmDynarmicCallback;
 
     CPUState *parent;
 
-    std::unique_ptr<Dynarmic::A32::Jit> jit;
-    std::unique_ptr<ArmDynarmicCallback> cb;
-    std::shared_ptr<ArmDynarmicCP15> cp15;
-    Dynarmic::ExclusiveMonitor *monitor;
+    DynarmicCodeCache *code_cache;
+    // kept across SVCs, only given back when the thread blocks or when another thread is waiting for a JIT
+    DynarmicJitSlot *slot = nullptr;
+    Dynarmic::A32::Jit *jit = nullptr;
+
+    // register state of the thread while it is not bound to a JIT
+    CPUContext context;
+    uint32_t tpidruro = 0;
 
     std::size_t core_id = 0;
 
@@ -46,15 +132,18 @@ class DynarmicCPU : public CPUInterface {
 
     bool log_mem = false;
     bool log_code = false;
-    bool cpu_opt;
 
-    std::unique_ptr<Dynarmic::A32::Jit> make_jit();
+    void bind_jit();
+    void unbind_jit();
+    void prepare_jit();
 
 public:
-    DynarmicCPU(CPUState *state, std::size_t processor_id, Dynarmic::ExclusiveMonitor *monitor, bool cpu_opt);
+    DynarmicCPU(CPUState *state, std::size_t processor_id, DynarmicCodeCache *code_cache);
     ~DynarmicCPU() override;
     int run() override;
     void stop() override;
+    void release_resources() override;
+    void clear_exclusive() override;
 
     uint32_t get_reg(uint8_t idx) override;
     void set_reg(uint8_t idx, uint32_t val) override;
@@ -69,4 +69,10 @@ struct CPUInterface {
     virtual std::size_t processor_id() const {
         return 0;
     }
+
+    // Called by the thread when it is about to block, backends sharing their resources give them back
+    virtual void release_resources() {}
+
+    // Called when the kernel returns from a service call, the exclusive reservation of the thread must not survive it
+    virtual void clear_exclusive() {}
 };
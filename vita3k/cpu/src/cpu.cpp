@@ -59,8 +59,8 @@ CPUStatePtr init_cpu(CPUBackend backend, bool cpu_opt, SceUID thread_id, std::si
 
     switch (backend) {
     case CPUBackend::Dynarmic: {
-        Dynarmic::ExclusiveMonitor *monitor = static_cast<Dynarmic::ExclusiveMonitor *>(protocol->get_exclusive_monitor());
-        state->cpu = std::make_unique<DynarmicCPU>(state.get(), processor_id, monitor, cpu_opt);
+        DynarmicCodeCache *code_cache = static_cast<DynarmicCodeCache *>(protocol->get_jit_cache());
+        state->cpu = std::make_unique<DynarmicCPU>(state.get(), processor_id, code_cache);
         break;
     }
     case CPUBackend::Unicorn: {
@@ -86,6 +86,10 @@ void stop(CPUState &state) {
     state.cpu->stop();
 }
 
+void release_resources(CPUState &state) {
+    state.cpu->release_resources();
+}
+
 uint32_t read_reg(CPUState &state, size_t index) {
     return state.cpu->get_reg(index);
 }
@@ -182,6 +186,10 @@ std::size_t get_processor_id(CPUState &state) {
     return state.cpu->processor_id();
 }
 
+void clear_exclusive(CPUState &state) {
+    state.cpu->clear_exclusive();
+}
+
 void invalidate_jit_cache(CPUState &state, Address start, size_t length) {
     state.cpu->invalidate_jit_cache(start, length);
 }
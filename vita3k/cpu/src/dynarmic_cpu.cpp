@@ -24,8 +24,10 @@
 #include <mem/ptr.h>
 
 #include <dynarmic/frontend/A32/a32_ir_emitter.h>
+#include <dynarmic/frontend/A32/a32_location_descriptor.h>
 #include <dynarmic/interface/A32/coprocessor.h>
 
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <string>
@@ -164,16 +166,26 @@ public:
 class ArmDynarmicCallback : public Dynarmic::A32::UserCallbacks {
     friend class DynarmicCPU;
 
-    CPUState *parent;
-    DynarmicCPU *cpu;
+    DynarmicCodeCache *code_cache;
+    DynarmicJitSlot *slot;
+    Dynarmic::A32::Jit *jit = nullptr;
+
+    // thread currently running on the JIT owning these callbacks
+    CPUState *parent = nullptr;
+    DynarmicCPU *cpu = nullptr;
 
 public:
-    explicit ArmDynarmicCallback(CPUState &parent, DynarmicCPU &cpu)
-        : parent(&parent)
-        , cpu(&cpu) {}
+    explicit ArmDynarmicCallback(DynarmicCodeCache &code_cache, DynarmicJitSlot &slot)
+        : code_cache(&code_cache)
+        , slot(&slot) {}
 
     ~ArmDynarmicCallback() override = default;
 
+    void bind(CPUState &parent, DynarmicCPU &cpu) {
+        this->parent = &parent;
+        this->cpu = &cpu;
+    }
+
     std::optional<std::uint32_t> MemoryReadCode(Dynarmic::A32::VAddr addr) override {
         if (cpu->log_mem)
             LOG_TRACE("Instruction fetch at address 0x{:X}", addr);
@@ -193,7 +205,11 @@ public:
     }
 
     void PreCodeTranslationHook(bool is_thumb, Dynarmic::A32::VAddr pc, Dynarmic::A32::IREmitter &ir) override {
-        if (cpu->log_code) {
+        // first instruction of the block, remember where it starts for the persistent cache
+        if (ir.block.empty())
+            code_cache->record_block_entry(ir.block.Location().Value());
+
+        if (slot->log_code) {
             ir.CallHostFunction(&TraceInstruction, ir.Imm64((uint64_t)this), ir.Imm64(pc), ir.Imm64(is_thumb));
         }
     }
@@ -255,6 +271,8 @@ public:
         }
 
         *ptr.get(*parent->mem) = value;
+        if (parent->mem->track_writes)
+            mark_written(*parent->mem, addr, sizeof(T));
         if (cpu->log_mem) {
             LOG_TRACE("Write uint{}_t at addr: 0x{:x}, val = 0x{:x}", sizeof(T) * 8, addr, value);
         }
@@ -291,6 +309,8 @@ public:
         }
 
         auto result = Ptr<T>(addr).atomic_compare_and_swap(*parent->mem, value, expected);
+        if (result && parent->mem->track_writes)
+            mark_written(*parent->mem, addr, sizeof(T));
         if (cpu->log_mem) {
             LOG_TRACE("Write uint{}_t at addr: 0x{:x}, val = 0x{:x}, expected = 0x{:x}", sizeof(T) * 8, addr, value, expected);
         }
@@ -321,7 +341,7 @@ public:
         switch (exception) {
         case Dynarmic::A32::Exception::Breakpoint: {
             cpu->break_ = true;
-            cpu->jit->HaltExecution();
+            jit->HaltExecution();
             if (cpu->is_thumb_mode())
                 cpu->set_pc(pc | 1);
             else
@@ -330,7 +350,7 @@ public:
         }
         case Dynarmic::A32::Exception::WaitForInterrupt: {
             cpu->halted = true;
-            cpu->jit->HaltExecution();
+            jit->HaltExecution();
             break;
         }
         case Dynarmic::A32::Exception::PreloadDataWithIntentToWrite:
@@ -364,7 +384,7 @@ public:
     void CallSVC(uint32_t svc) override {
         parent->svc_called = true;
         parent->svc = svc;
-        cpu->jit->HaltExecution(Dynarmic::HaltReason::UserDefined8);
+        jit->HaltExecution(Dynarmic::HaltReason::UserDefined8);
     }
 
     void AddTicks(uint64_t ticks) override {}
@@ -374,55 +394,267 @@ public:
     }
 };
 
-std::unique_ptr<Dynarmic::A32::Jit> DynarmicCPU::make_jit() {
+DynarmicCodeCache::DynarmicCodeCache(MemState &mem, Dynarmic::ExclusiveMonitor *monitor, std::size_t max_slots, bool cpu_opt)
+    : mem(mem)
+    , monitor(monitor)
+    , max_slots(max_slots)
+    , cpu_opt(cpu_opt) {
+}
+
+DynarmicCodeCache::~DynarmicCodeCache() = default;
+
+std::unique_ptr<DynarmicJitSlot> DynarmicCodeCache::make_slot(std::size_t monitor_id, bool log_code, bool log_mem) {
+    auto slot = std::make_unique<DynarmicJitSlot>();
+    slot->cb = std::make_unique<ArmDynarmicCallback>(*this, *slot);
+    slot->cp15 = std::make_shared<ArmDynarmicCP15>();
+    slot->monitor_id = monitor_id;
+    slot->log_code = log_code;
+    slot->log_mem = log_mem;
+
     Dynarmic::A32::UserConfig config{};
     config.arch_version = Dynarmic::A32::ArchVersion::v7;
-    config.callbacks = cb.get();
-    if (parent->mem->use_page_table) {
-        config.page_table = (log_mem || !cpu_opt) ? nullptr : reinterpret_cast<decltype(config.page_table)>(parent->mem->page_table.get());
+    config.callbacks = slot->cb.get();
+    // with write tracking, all the writes must go through the callbacks to mark the pages written
+    const bool direct_memory_access = !log_mem && cpu_opt && !mem.track_writes;
+    if (mem.use_page_table) {
+        config.page_table = direct_memory_access ? reinterpret_cast<decltype(config.page_table)>(mem.page_table.get()) : nullptr;
         config.absolute_offset_page_table = true;
-    } else if (!log_mem && cpu_opt) {
-        config.fastmem_pointer = std::bit_cast<uintptr_t>(parent->mem->memory.get());
+    } else if (direct_memory_access) {
+        config.fastmem_pointer = std::bit_cast<uintptr_t>(mem.memory.get());
     }
     config.hook_hint_instructions = true;
     config.enable_cycle_counting = false;
     config.global_monitor = monitor;
     for (int i = 0; i < 15; i++)
         config.coprocessors[i] = std::make_shared<ArmDynarmicLog>(i);
-    config.coprocessors[15] = cp15;
-    config.processor_id = core_id;
+    config.coprocessors[15] = slot->cp15;
+    config.processor_id = slot->monitor_id;
     config.optimizations = cpu_opt ? Dynarmic::all_safe_optimizations : Dynarmic::no_optimizations;
 
-    return std::make_unique<Dynarmic::A32::Jit>(config);
+    slot->jit = std::make_unique<Dynarmic::A32::Jit>(config);
+    slot->cb->jit = slot->jit.get();
+
+    return slot;
+}
+
+void DynarmicCodeCache::catch_up(DynarmicJitSlot &slot) {
+    if (slot.warm_batches_done == warm_batch_count.load(std::memory_order_acquire))
+        return;
+
+    std::vector<uint64_t> entries;
+    {
+        const std::lock_guard<std::mutex> lock(entries_mutex);
+        for (std::size_t i = slot.warm_batches_done; i < warm_batches.size(); i++)
+            entries.insert(entries.end(), warm_batches[i].begin(), warm_batches[i].end());
+        slot.warm_batches_done = warm_batches.size();
+    }
+    pretranslate(slot, entries);
+}
+
+// The callbacks of the slot must be bound to the thread doing the translation
+void DynarmicCodeCache::pretranslate(DynarmicJitSlot &slot, const std::vector<uint64_t> &entries) {
+    Dynarmic::A32::Jit &jit = *slot.jit;
+    for (const uint64_t entry : entries) {
+        const Dynarmic::A32::LocationDescriptor location{ Dynarmic::IR::LocationDescriptor{ entry } };
+        if (location.SingleStepping())
+            continue;
+
+        const uint8_t it = location.IT().Value();
+        uint32_t cpsr = 0x10; // user mode
+        if (location.TFlag())
+            cpsr |= 0x20;
+        if (location.EFlag())
+            cpsr |= 0x200;
+        cpsr |= ((it & 0b11) << 25) | ((it >> 2) << 10);
+
+        jit.Regs()[15] = location.PC();
+        jit.SetCpsr(cpsr);
+        jit.SetFpscr(location.FPSCR().Value());
+
+        // The block is looked up (and translated if needed) before a pending halt is checked,
+        // so this only translates it without executing a single guest instruction
+        jit.HaltExecution(Dynarmic::HaltReason::UserDefined7);
+        jit.Run();
+    }
+}
+
+DynarmicJitSlot *DynarmicCodeCache::acquire(DynarmicCPU &cpu, bool log_code, bool log_mem) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        for (auto it = free_slots.rbegin(); it != free_slots.rend(); ++it) {
+            DynarmicJitSlot *slot = *it;
+            if (slot->log_code == log_code && slot->log_mem == log_mem) {
+                free_slots.erase(std::next(it).base());
+                return slot;
+            }
+        }
+
+        // Never make a thread wait for a JIT while one can still be created,
+        // a guest spinlock could otherwise wait forever for a thread which can't run.
+        // Creating a JIT takes a while, the other threads must not wait for the lock meanwhile
+        if (slots.size() + pending_slots < max_slots) {
+            const std::size_t monitor_id = slots.size() + pending_slots++;
+            lock.unlock();
+            auto slot = make_slot(monitor_id, log_code, log_mem);
+            lock.lock();
+            pending_slots--;
+            slots.push_back(std::move(slot));
+            return slots.back().get();
+        }
+
+        if (!free_slots.empty()) {
+            // Every JIT has been created with another logging configuration, recycle the oldest one
+            DynarmicJitSlot *old_slot = free_slots.front();
+            free_slots.erase(free_slots.begin());
+            lock.unlock();
+            auto new_slot = make_slot(old_slot->monitor_id, log_code, log_mem);
+            lock.lock();
+            const auto it = std::find_if(slots.begin(), slots.end(), [&](const auto &slot) { return slot.get() == old_slot; });
+            *it = std::move(new_slot);
+            return it->get();
+        }
+
+        LOG_WARN_ONCE("All {} JIT instances are in use, waiting for one to be released", max_slots);
+        waiting_threads++;
+        slot_released.wait(lock);
+        waiting_threads--;
+    }
+}
+
+void DynarmicCodeCache::release(DynarmicJitSlot *slot) {
+    // The next thread using this JIT must not see the reservations of the previous one
+    clear_exclusive(*slot);
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        free_slots.push_back(slot);
+    }
+    slot_released.notify_one();
+}
+
+void DynarmicCodeCache::clear_exclusive(DynarmicJitSlot &slot) {
+    monitor->ClearProcessor(slot.monitor_id);
+    slot.jit->ClearExclusiveState();
+}
+
+void DynarmicCodeCache::invalidate(Address start, size_t length) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &slot : slots)
+            slot->jit->InvalidateCacheRange(start, length);
+    }
+
+    // the code there is gone or has changed, don't save or translate its blocks anymore
+    const auto is_in_range = [&](uint64_t entry) {
+        const Address pc = Dynarmic::A32::LocationDescriptor{ Dynarmic::IR::LocationDescriptor{ entry } }.PC();
+        return pc >= start && pc - start < length;
+    };
+    const std::lock_guard<std::mutex> lock(entries_mutex);
+    std::erase_if(block_entries, is_in_range);
+    for (auto &batch : warm_batches)
+        std::erase_if(batch, is_in_range);
+}
+
+void DynarmicCodeCache::record_block_entry(uint64_t entry) {
+    const std::lock_guard<std::mutex> lock(entries_mutex);
+    block_entries.insert(entry);
+}
+
+std::vector<uint64_t> DynarmicCodeCache::get_block_entries(Address start, size_t length) {
+    std::vector<uint64_t> entries;
+    const std::lock_guard<std::mutex> lock(entries_mutex);
+    for (const uint64_t entry : block_entries) {
+        const Address pc = Dynarmic::A32::LocationDescriptor{ Dynarmic::IR::LocationDescriptor{ entry } }.PC();
+        if (pc >= start && pc - start < length)
+            entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+void DynarmicCodeCache::warm(const std::vector<uint64_t> &entries) {
+    // each JIT translates them the next time a thread binds it, on that thread
+    const std::lock_guard<std::mutex> lock(entries_mutex);
+    warm_batches.push_back(entries);
+    warm_batch_count.store(warm_batches.size(), std::memory_order_release);
 }
 
-DynarmicCPU::DynarmicCPU(CPUState *state, std::size_t processor_id, Dynarmic::ExclusiveMonitor *monitor, bool cpu_opt)
+DynarmicCPU::DynarmicCPU(CPUState *state, std::size_t processor_id, DynarmicCodeCache *code_cache)
     : parent(state)
-    , cb(std::make_unique<ArmDynarmicCallback>(*state, *this))
-    , cp15(std::make_shared<ArmDynarmicCP15>())
-    , monitor(monitor)
-    , core_id(processor_id)
-    , cpu_opt(cpu_opt) {
-    jit = make_jit();
+    , code_cache(code_cache)
+    , core_id(processor_id) {
+}
+
+DynarmicCPU::~DynarmicCPU() {
+    if (slot)
+        code_cache->release(slot);
+}
+
+void DynarmicCPU::bind_jit() {
+    slot = code_cache->acquire(*this, log_code, log_mem);
+    slot->cb->bind(*parent, *this);
+    slot->cp15->set_tpidruro(tpidruro);
+    jit = slot->jit.get();
+    code_cache->catch_up(*slot);
+    load_context(context);
+}
+
+void DynarmicCPU::unbind_jit() {
+    context = save_context();
+    jit = nullptr;
+    code_cache->release(slot);
+    slot = nullptr;
 }
 
-DynarmicCPU::~DynarmicCPU() = default;
+void DynarmicCPU::prepare_jit() {
+    if (slot && ((slot->log_code != log_code) || (slot->log_mem != log_mem)))
+        unbind_jit();
+
+    if (!slot) {
+        bind_jit();
+        return;
+    }
+
+    // blocks were loaded from the persistent cache since this JIT was bound
+    if (code_cache->is_behind(*slot)) {
+        const CPUContext ctx = save_context();
+        code_cache->catch_up(*slot);
+        load_context(ctx);
+    }
+}
 
 int DynarmicCPU::run() {
     halted = false;
     break_ = false;
     exit_request = false;
     parent->svc_called = false;
+    prepare_jit();
     jit->Run();
+    if (code_cache->under_pressure())
+        unbind_jit();
     return halted;
 }
 
 int DynarmicCPU::step() {
     parent->svc_called = false;
+    prepare_jit();
     jit->Step();
+    if (code_cache->under_pressure())
+        unbind_jit();
     return 0;
 }
 
+void DynarmicCPU::release_resources() {
+    if (slot)
+        unbind_jit();
+}
+
+void DynarmicCPU::clear_exclusive() {
+    // an unbound thread has no reservation left, the JIT was cleared when it was released
+    if (slot)
+        code_cache->clear_exclusive(*slot);
+}
+
 bool DynarmicCPU::hit_breakpoint() {
     return break_;
 }
@@ -433,19 +665,12 @@ void DynarmicCPU::trigger_breakpoint() {
 }
 
 void DynarmicCPU::set_log_code(bool log) {
-    if (log_code == log)
-        return;
-
+    // takes effect the next time this thread runs
     log_code = log;
-    jit = make_jit();
 }
 
 void DynarmicCPU::set_log_mem(bool log) {
-    if (log_mem == log)
-        return;
-
     log_mem = log;
-    jit = make_jit();
 }
 
 bool DynarmicCPU::get_log_code() {
@@ -461,31 +686,39 @@ void DynarmicCPU::stop() {
 }
 
 uint32_t DynarmicCPU::get_reg(uint8_t idx) {
-    return jit->Regs()[idx];
+    return jit ? jit->Regs()[idx] : context.cpu_registers[idx];
 }
 
 uint32_t DynarmicCPU::get_sp() {
-    return jit->Regs()[13];
+    return get_reg(13);
 }
 
 uint32_t DynarmicCPU::get_pc() {
-    return jit->Regs()[15];
+    return get_reg(15);
 }
 
 void DynarmicCPU::set_reg(uint8_t idx, uint32_t val) {
-    jit->Regs()[idx] = val;
+    if (jit)
+        jit->Regs()[idx] = val;
+    else
+        context.cpu_registers[idx] = val;
 }
 
 void DynarmicCPU::set_cpsr(uint32_t val) {
-    jit->SetCpsr(val);
+    if (jit)
+        jit->SetCpsr(val);
+    else
+        context.cpsr = val;
 }
 
 uint32_t DynarmicCPU::get_tpidruro() {
-    return cp15->get_tpidruro();
+    return tpidruro;
 }
 
 void DynarmicCPU::set_tpidruro(uint32_t val) {
-    cp15->set_tpidruro(val);
+    tpidruro = val;
+    if (slot)
+        slot->cp15->set_tpidruro(val);
 }
 
 void DynarmicCPU::set_pc(uint32_t val) {
@@ -496,30 +729,36 @@ void DynarmicCPU::set_pc(uint32_t val) {
         set_cpsr(get_cpsr() & 0xFFFFFFDF);
         val = val & 0xFFFFFFFC;
     }
-    jit->Regs()[15] = val;
+    set_reg(15, val);
 }
 
 void DynarmicCPU::set_lr(uint32_t val) {
-    jit->Regs()[14] = val;
+    set_reg(14, val);
 }
 
 void DynarmicCPU::set_sp(uint32_t val) {
-    jit->Regs()[13] = val;
+    set_reg(13, val);
 }
 
 uint32_t DynarmicCPU::get_cpsr() {
-    return jit->Cpsr();
+    return jit ? jit->Cpsr() : context.cpsr;
 }
 
 uint32_t DynarmicCPU::get_fpscr() {
-    return jit->Fpscr();
+    return jit ? jit->Fpscr() : context.fpscr;
 }
 
 void DynarmicCPU::set_fpscr(uint32_t val) {
-    jit->SetFpscr(val);
+    if (jit)
+        jit->SetFpscr(val);
+    else
+        context.fpscr = val;
 }
 
 CPUContext DynarmicCPU::save_context() {
+    if (!jit)
+        return context;
+
     CPUContext ctx;
     ctx.cpu_registers = jit->Regs();
     static_assert(sizeof(ctx.fpu_registers) == sizeof(jit->ExtRegs()));
@@ -531,6 +770,11 @@ CPUContext DynarmicCPU::save_context() {
 }
 
 void DynarmicCPU::load_context(const CPUContext &ctx) {
+    if (!jit) {
+        context = ctx;
+        return;
+    }
+
     jit->Regs() = ctx.cpu_registers;
     static_assert(sizeof(ctx.fpu_registers) == sizeof(jit->ExtRegs()));
     memcpy(jit->ExtRegs().data(), ctx.fpu_registers.data(), sizeof(ctx.fpu_registers));
@@ -539,19 +783,22 @@ void DynarmicCPU::load_context(const CPUContext &ctx) {
 }
 
 uint32_t DynarmicCPU::get_lr() {
-    return jit->Regs()[14];
+    return get_reg(14);
 }
 
 float DynarmicCPU::get_float_reg(uint8_t idx) {
-    return std::bit_cast<float>(jit->ExtRegs()[idx]);
+    return jit ? std::bit_cast<float>(jit->ExtRegs()[idx]) : context.fpu_registers[idx];
 }
 
 void DynarmicCPU::set_float_reg(uint8_t idx, float val) {
-    jit->ExtRegs()[idx] = std::bit_cast<uint32_t>(val);
+    if (jit)
+        jit->ExtRegs()[idx] = std::bit_cast<uint32_t>(val);
+    else
+        context.fpu_registers[idx] = val;
 }
 
 bool DynarmicCPU::is_thumb_mode() {
-    return jit->Cpsr() & 0x20;
+    return get_cpsr() & 0x20;
 }
 
 std::size_t DynarmicCPU::processor_id() const {
@@ -559,7 +806,30 @@ std::size_t DynarmicCPU::processor_id() const {
 }
 
 void DynarmicCPU::invalidate_jit_cache(Address start, size_t length) {
-    jit->InvalidateCacheRange(start, length);
+    // every JIT has its own translated code
+    code_cache->invalidate(start, length);
+}
+
+JitCachePtr new_jit_cache(MemState &mem, ExclusiveMonitorPtr monitor, int max_num_cores, bool cpu_opt) {
+    Dynarmic::ExclusiveMonitor *monitor_ = static_cast<Dynarmic::ExclusiveMonitor *>(monitor);
+    return new DynarmicCodeCache(mem, monitor_, max_num_cores, cpu_opt);
+}
+
+void invalidate_jit_cache(JitCachePtr cache, Address start, size_t length) {
+    static_cast<DynarmicCodeCache *>(cache)->invalidate(start, length);
+}
+
+std::vector<uint64_t> get_jit_cache_entries(JitCachePtr cache, Address start, size_t length) {
+    return static_cast<DynarmicCodeCache *>(cache)->get_block_entries(start, length);
+}
+
+void warm_jit_cache(JitCachePtr cache, const std::vector<uint64_t> &entries) {
+    static_cast<DynarmicCodeCache *>(cache)->warm(entries);
+}
+
+std::string get_jit_cache_format() {
+    // the location descriptor layout and the IR can change with any dynarmic commit
+    return "dynarmic-" DYNARMIC_GIT_REV;
 }
 
 // TODO: proper abstraction
@@ -571,8 +841,3 @@ void free_exclusive_monitor(ExclusiveMonitorPtr monitor) {
     Dynarmic::ExclusiveMonitor *monitor_ = static_cast<Dynarmic::ExclusiveMonitor *>(monitor);
     delete monitor_;
 }
-
-void clear_exclusive(ExclusiveMonitorPtr monitor, std::size_t core_num) {
-    Dynarmic::ExclusiveMonitor *monitor_ = static_cast<Dynarmic::ExclusiveMonitor *>(monitor);
-    monitor_->ClearProcessor(core_num);
-}
@@ -276,7 +276,7 @@ static std::string cmd_read_registers(EmuEnvState &state, PacketCommand &command
         || !state.kernel.threads.contains(state.gdb.current_thread))
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *state.kernel.threads.get(state.gdb.current_thread)->cpu.get();
 
     std::stringstream stream;
     for (uint32_t a = 0; a <= 15; a++) {
@@ -292,7 +292,7 @@ static std::string cmd_write_registers(EmuEnvState &state, PacketCommand &comman
         || !state.kernel.threads.contains(state.gdb.current_thread))
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *state.kernel.threads.get(state.gdb.current_thread)->cpu.get();
 
     const std::string content = content_string(command).substr(1);
 
@@ -310,7 +310,7 @@ static std::string cmd_read_register(EmuEnvState &state, PacketCommand &command)
         || !state.kernel.threads.contains(state.gdb.current_thread))
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *state.kernel.threads.get(state.gdb.current_thread)->cpu.get();
 
     const std::string content = content_string(command);
     uint32_t reg = parse_hex(content.substr(1, content.size() - 1));
@@ -324,7 +324,7 @@ static std::string cmd_write_register(EmuEnvState &state, PacketCommand &command
         || !state.kernel.threads.contains(state.gdb.current_thread))
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *state.kernel.threads.get(state.gdb.current_thread)->cpu.get();
 
     const std::string content = content_string(command);
     size_t equal_index = content.find('=');
@@ -441,7 +441,7 @@ static std::string cmd_continue(EmuEnvState &state, PacketCommand &command) {
 
             if (state.gdb.inferior_thread != 0) {
                 const auto guard = std::lock_guard(state.kernel.mutex);
-                auto thread = state.kernel.threads[state.gdb.inferior_thread];
+                auto thread = state.kernel.threads.get(state.gdb.inferior_thread);
                 auto thread_lock = std::unique_lock(thread->mutex);
                 thread->resume(step);
                 if (step) {
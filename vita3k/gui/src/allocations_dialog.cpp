@@ -31,6 +31,39 @@ static constexpr std::array<const char *, 2> blacklist = {
 void draw_allocations_dialog(GuiState &gui, EmuEnvState &emuenv) {
     ImGui::Begin("Memory Allocations", &gui.debug_menu.allocations_dialog);
 
+    if (ImGui::TreeNode("Heap")) {
+        const GuestHeapStats stats = get_heap_stats(emuenv.mem);
+        uint64_t chunk_bytes = 0;
+        uint64_t used_bytes = 0;
+        for (const auto &heap_class : stats.classes) {
+            chunk_bytes += static_cast<uint64_t>(heap_class.chunk_count) * HEAP_CHUNK_SIZE;
+            used_bytes += static_cast<uint64_t>(heap_class.used_blocks) * heap_class.block_size;
+        }
+        ImGui::Text("Small blocks: %u KiB used in %u KiB of chunks", static_cast<uint32_t>(used_bytes / KiB(1)), static_cast<uint32_t>(chunk_bytes / KiB(1)));
+        ImGui::Text("Large blocks: %u (%u KiB)", stats.large_count, static_cast<uint32_t>(stats.large_bytes / KiB(1)));
+
+        if (ImGui::BeginTable("heap_classes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Block size");
+            ImGui::TableSetupColumn("Chunks");
+            ImGui::TableSetupColumn("Used blocks");
+            ImGui::TableHeadersRow();
+            for (const auto &heap_class : stats.classes) {
+                if (heap_class.chunk_count == 0)
+                    continue;
+
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%u", heap_class.block_size);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%u", heap_class.chunk_count);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%u", heap_class.used_blocks);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TreePop();
+    }
+
     const std::lock_guard<std::mutex> lock(emuenv.mem.generation_mutex);
     for (const auto &[generation_num, generation_name] : emuenv.mem.page_name_map) {
         if (vector_utils::contains(blacklist, generation_name))
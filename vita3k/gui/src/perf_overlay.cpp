@@ -18,6 +18,9 @@
 #include "private.h"
 
 #include <config/state.h>
+#include <io/state.h>
+#include <renderer/state.h>
+#include <renderer/texture_cache.h>
 
 namespace gui {
 static const ImVec2 PERF_OVERLAY_PAD = ImVec2(12.f, 12.f);
@@ -55,11 +58,26 @@ void draw_perf_overlay(GuiState &gui, EmuEnvState &emuenv) {
 
     const auto FPS_TEXT = emuenv.cfg.performance_overlay_detail == MINIMUM ? fmt::format("FPS: {}", emuenv.fps) : fmt::format("FPS: {} {}: {}", emuenv.fps, lang["avg"], emuenv.avg_fps);
     const auto MIN_MAX_FPS_TEXT = fmt::format("{}: {} {}: {}", lang["min"], emuenv.min_fps, lang["max"], emuenv.max_fps);
+    const bool show_texture_decode = emuenv.cfg.performance_overlay_detail == MAXIMUM && emuenv.renderer;
+    std::string TEXTURE_DECODE_TEXT;
+    if (show_texture_decode) {
+        const auto decode_stats = emuenv.renderer->get_texture_cache()->get_decode_stats();
+        TEXTURE_DECODE_TEXT = fmt::format("{}: {} ({:.1f} ms, {}: {:.1f} ms)", lang["texture_decode"], decode_stats.texture_count,
+            decode_stats.total_us / 1000.f, lang["max"], decode_stats.max_us / 1000.f);
+    }
+    const bool show_io_queue = emuenv.cfg.performance_overlay_detail == MAXIMUM;
+    const auto cache_stats = emuenv.io.block_cache.get_stats();
+    const auto IO_QUEUE_TEXT = fmt::format("{}: {} ({}: {}/{})", lang["io_queue"], emuenv.io.async.queue_depth(), lang["io_cache_hits"],
+        cache_stats.hits, cache_stats.hits + cache_stats.misses);
 
     const ImVec2 TOTAL_WINDOW_PADDING(ImGui::GetStyle().WindowPadding.x * 2, ImGui::GetStyle().WindowPadding.y * 2);
 
-    const auto MAX_TEXT_WIDTH_SCALED = std::max(ImGui::CalcTextSize(FPS_TEXT.c_str()).x, emuenv.cfg.performance_overlay_detail == MINIMUM ? 0.f : ImGui::CalcTextSize(MIN_MAX_FPS_TEXT.c_str()).x) * FONT_SCALE;
-    const auto MAX_TEXT_HEIGHT_SCALED = SCALED_FONT_SIZE + (emuenv.cfg.performance_overlay_detail >= MEDIUM ? SCALED_FONT_SIZE + (ImGui::GetStyle().ItemSpacing.y * 2.f) : 0.f);
+    const auto MAX_TEXT_WIDTH_SCALED = std::max({ ImGui::CalcTextSize(FPS_TEXT.c_str()).x, emuenv.cfg.performance_overlay_detail == MINIMUM ? 0.f : ImGui::CalcTextSize(MIN_MAX_FPS_TEXT.c_str()).x,
+                                           show_texture_decode ? ImGui::CalcTextSize(TEXTURE_DECODE_TEXT.c_str()).x : 0.f, show_io_queue ? ImGui::CalcTextSize(IO_QUEUE_TEXT.c_str()).x : 0.f })
+        * FONT_SCALE;
+    const auto MAX_TEXT_HEIGHT_SCALED = SCALED_FONT_SIZE + (emuenv.cfg.performance_overlay_detail >= MEDIUM ? SCALED_FONT_SIZE + (ImGui::GetStyle().ItemSpacing.y * 2.f) : 0.f)
+        + (show_texture_decode ? SCALED_FONT_SIZE + (ImGui::GetStyle().ItemSpacing.y * 2.f) : 0.f)
+        + (show_io_queue ? SCALED_FONT_SIZE + (ImGui::GetStyle().ItemSpacing.y * 2.f) : 0.f);
 
     const ImVec2 WINDOW_SIZE(MAX_TEXT_WIDTH_SCALED + TOTAL_WINDOW_PADDING.x, MAX_TEXT_HEIGHT_SCALED + TOTAL_WINDOW_PADDING.y);
     const ImVec2 MAIN_WINDOW_SIZE(WINDOW_SIZE.x + TOTAL_WINDOW_PADDING.x, WINDOW_SIZE.y + TOTAL_WINDOW_PADDING.y + (emuenv.cfg.performance_overlay_detail == MAXIMUM ? WINDOW_SIZE.y : 0.f));
@@ -80,6 +98,14 @@ void draw_perf_overlay(GuiState &gui, EmuEnvState &emuenv) {
         ImGui::Separator();
         ImGui::Text("%s", MIN_MAX_FPS_TEXT.c_str());
     }
+    if (show_texture_decode) {
+        ImGui::Separator();
+        ImGui::Text("%s", TEXTURE_DECODE_TEXT.c_str());
+    }
+    if (show_io_queue) {
+        ImGui::Separator();
+        ImGui::Text("%s", IO_QUEUE_TEXT.c_str());
+    }
     ImGui::EndChild();
     ImGui::PopStyleVar();
     ImGui::PopStyleColor();
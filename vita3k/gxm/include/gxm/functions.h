@@ -24,6 +24,11 @@
 #include <string>
 
 namespace gxm {
+struct IndexRange {
+    uint32_t min = 0;
+    uint32_t max = 0;
+};
+
 // Color.
 SceGxmColorBaseFormat get_base_format(SceGxmColorFormat src);
 size_t bits_per_pixel(SceGxmColorBaseFormat base_format);
@@ -49,6 +54,8 @@ bool is_paletted_format(SceGxmTextureBaseFormat base_format);
 bool is_yuv_format(SceGxmTextureBaseFormat base_format);
 uint32_t attribute_format_size(SceGxmAttributeFormat format);
 uint32_t index_element_size(SceGxmIndexFormat format);
+// Smallest and largest index of a buffer, {0, 0} if the buffer is empty
+IndexRange get_index_range(const void *indices, SceGxmIndexFormat format, uint32_t count);
 bool is_stream_instancing(SceGxmIndexSource source);
 bool convert_color_format_to_texture_format(SceGxmColorFormat format, SceGxmTextureFormat &dest_format);
 
@@ -0,0 +1,67 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <gxm/functions.h>
+#include <mem/util.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+struct MemState;
+
+namespace gxm {
+
+// Remember the index range of the index buffers already drawn so an unchanged buffer is not scanned again.
+// An entry stays valid until the buffer is written to, which is detected with the software write tracking
+// when it is enabled, and with a write protection of the whole pages of the buffer otherwise.
+class IndexRangeCache {
+public:
+    IndexRange get(MemState &mem, Address indices, SceGxmIndexFormat format, uint32_t count);
+    void clear();
+
+private:
+    struct Key {
+        Address address;
+        uint32_t count;
+        SceGxmIndexFormat format;
+
+        bool operator==(const Key &other) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<uint64_t>()((static_cast<uint64_t>(key.address) << 32) | (key.count ^ key.format));
+        }
+    };
+
+    struct Entry {
+        IndexRange range;
+        // used with write tracking
+        uint32_t write_generation = 0;
+        // used with write protection, reset by the protection callback
+        std::atomic<bool> valid = false;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<Key, std::shared_ptr<Entry>, KeyHash> entries;
+};
+
+} // namespace gxm
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <gxm/index_cache.h>
 #include <gxm/types.h>
 #include <mem/ptr.h>
 #include <threads/queue.h>
@@ -62,4 +63,7 @@ struct GxmState {
 
     std::map<Address, MemoryMapInfo> memory_mapped_regions;
     std::mutex callback_lock;
+
+    // index range of the index buffers, used to get the vertex buffer sizes without memory mapping
+    gxm::IndexRangeCache index_ranges;
 };
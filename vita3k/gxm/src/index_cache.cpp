@@ -0,0 +1,110 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <gxm/index_cache.h>
+
+#include <mem/functions.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+#include <util/align.h>
+
+#include <algorithm>
+
+namespace gxm {
+
+// scanning a small buffer again costs less than looking it up and catching the writes to it,
+// this also leaves whole pages to protect in the buffers which are cached
+static constexpr uint32_t MIN_CACHED_PAGES = 4;
+// forget everything past this, so buffers which are drawn once do not pile up
+static constexpr size_t MAX_CACHED_RANGES = 8192;
+
+// Range of the indices of both ranges, an empty range has no index
+static IndexRange merge_ranges(const IndexRange &first, uint32_t first_count, const IndexRange &second, uint32_t second_count) {
+    if (first_count == 0)
+        return second;
+    if (second_count == 0)
+        return first;
+
+    return { std::min(first.min, second.min), std::max(first.max, second.max) };
+}
+
+IndexRange IndexRangeCache::get(MemState &mem, Address indices, SceGxmIndexFormat format, uint32_t count) {
+    const uint32_t element_size = index_element_size(format);
+    const uint32_t size = count * element_size;
+    const uint8_t *data = Ptr<const uint8_t>(indices).get(mem);
+    if (size < mem.page_size * MIN_CACHED_PAGES || indices % element_size != 0)
+        return get_index_range(data, format, count);
+
+    // With write protection, only the whole pages of the buffer are protected and cached, like the textures:
+    // the data sharing its first and last pages, such as vertices or uniforms, is often written
+    // and each write would fault and drop the entry. The indices in these pages are scanned every time.
+    Address cached_begin = indices;
+    Address cached_end = indices + size;
+    if (!mem.track_writes) {
+        cached_begin = align(indices, mem.page_size);
+        cached_end = align_down(indices + size, mem.page_size);
+    }
+    const uint32_t head_count = (cached_begin - indices) / element_size;
+    const uint32_t cached_count = (cached_end - cached_begin) / element_size;
+    const uint32_t tail_count = count - head_count - cached_count;
+    const IndexRange head = get_index_range(data, format, head_count);
+    const IndexRange tail = get_index_range(data + (cached_end - indices), format, tail_count);
+    const auto with_edges = [&](const IndexRange &cached) {
+        return merge_ranges(merge_ranges(head, head_count, cached, cached_count), head_count + cached_count, tail, tail_count);
+    };
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    const Key key{ indices, count, format };
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        // the entries still protected are kept alive by their protection callback
+        if (entries.size() >= MAX_CACHED_RANGES)
+            entries.clear();
+
+        it = entries.emplace(key, std::make_shared<Entry>()).first;
+    } else if (mem.track_writes) {
+        if (get_write_generation(mem, indices, size) <= it->second->write_generation)
+            return it->second->range;
+    } else if (it->second->valid) {
+        return with_edges(it->second->range);
+    }
+
+    const std::shared_ptr<Entry> &entry = it->second;
+
+    // any write done from now on must cause the buffer to be scanned again
+    if (mem.track_writes) {
+        entry->write_generation = next_write_generation(mem);
+    } else {
+        entry->valid = true;
+        const bool protected_range = add_protect(mem, cached_begin, cached_end - cached_begin, MemPerm::ReadOnly, [entry](Address, bool) {
+            entry->valid = false;
+            return true;
+        });
+        if (!protected_range)
+            entry->valid = false;
+    }
+
+    entry->range = get_index_range(data + (cached_begin - indices), format, cached_count);
+    return with_edges(entry->range);
+}
+
+void IndexRangeCache::clear() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+} // namespace gxm
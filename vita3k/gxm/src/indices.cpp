@@ -0,0 +1,201 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/*
+index range scan
+we can have 2 cases
+1 program compiled for aarch64: NEON is always available
+2 autodetect and use the AVX2 or the basic scan depending on the runtime cpu
+*/
+
+#include <gxm/functions.h>
+#include <util/log.h>
+
+#include <algorithm>
+
+namespace gxm {
+
+// also used for the indices left by the vector versions
+template <typename T>
+static void scan_indices_basic(const T *indices, uint32_t count, IndexRange &range) {
+    for (uint32_t i = 0; i < count; i++) {
+        range.min = std::min<uint32_t>(range.min, indices[i]);
+        range.max = std::max<uint32_t>(range.max, indices[i]);
+    }
+}
+
+} // namespace gxm
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+
+namespace gxm {
+
+static IndexRange get_index_range_u16(const uint16_t *indices, uint32_t count) {
+    IndexRange range{ UINT32_MAX, 0 };
+    uint32_t i = 0;
+    if (count >= 8) {
+        uint16x8_t min = vdupq_n_u16(UINT16_MAX);
+        uint16x8_t max = vdupq_n_u16(0);
+        for (; i + 8 <= count; i += 8) {
+            const uint16x8_t values = vld1q_u16(indices + i);
+            min = vminq_u16(min, values);
+            max = vmaxq_u16(max, values);
+        }
+        range = { vminvq_u16(min), vmaxvq_u16(max) };
+    }
+
+    scan_indices_basic(indices + i, count - i, range);
+    return range;
+}
+
+static IndexRange get_index_range_u32(const uint32_t *indices, uint32_t count) {
+    IndexRange range{ UINT32_MAX, 0 };
+    uint32_t i = 0;
+    if (count >= 4) {
+        uint32x4_t min = vdupq_n_u32(UINT32_MAX);
+        uint32x4_t max = vdupq_n_u32(0);
+        for (; i + 4 <= count; i += 4) {
+            const uint32x4_t values = vld1q_u32(indices + i);
+            min = vminq_u32(min, values);
+            max = vmaxq_u32(max, values);
+        }
+        range = { vminvq_u32(min), vmaxvq_u32(max) };
+    }
+
+    scan_indices_basic(indices + i, count - i, range);
+    return range;
+}
+
+} // namespace gxm
+#else
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#else
+#error "Compiler is not supported"
+#endif
+
+#include <util/instrset_detect.h>
+
+namespace gxm {
+
+static IndexRange get_index_range_u16_basic(const uint16_t *indices, uint32_t count) {
+    IndexRange range{ UINT32_MAX, 0 };
+    scan_indices_basic(indices, count, range);
+    return range;
+}
+
+static IndexRange get_index_range_u32_basic(const uint32_t *indices, uint32_t count) {
+    IndexRange range{ UINT32_MAX, 0 };
+    scan_indices_basic(indices, count, range);
+    return range;
+}
+
+static TARGET_AVX2 IndexRange get_index_range_u16_AVX2(const uint16_t *indices, uint32_t count) {
+    IndexRange range{ UINT32_MAX, 0 };
+    uint32_t i = 0;
+    if (count >= 16) {
+        __m256i min = _mm256_set1_epi16(-1);
+        __m256i max = _mm256_setzero_si256();
+        for (; i + 16 <= count; i += 16) {
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + i));
+            min = _mm256_min_epu16(min, values);
+            max = _mm256_max_epu16(max, values);
+        }
+
+        // minpos gives the smallest of 8 words, the largest one is the smallest once inverted
+        const __m128i min_128 = _mm_min_epu16(_mm256_castsi256_si128(min), _mm256_extracti128_si256(min, 1));
+        const __m128i max_128 = _mm_max_epu16(_mm256_castsi256_si128(max), _mm256_extracti128_si256(max, 1));
+        range.min = _mm_extract_epi16(_mm_minpos_epu16(min_128), 0);
+        range.max = UINT16_MAX - _mm_extract_epi16(_mm_minpos_epu16(_mm_xor_si128(max_128, _mm_set1_epi16(-1))), 0);
+    }
+
+    scan_indices_basic(indices + i, count - i, range);
+    return range;
+}
+
+static TARGET_AVX2 IndexRange get_index_range_u32_AVX2(const uint32_t *indices, uint32_t count) {
+    IndexRange range{ UINT32_MAX, 0 };
+    uint32_t i = 0;
+    if (count >= 8) {
+        __m256i min = _mm256_set1_epi32(-1);
+        __m256i max = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8) {
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + i));
+            min = _mm256_min_epu32(min, values);
+            max = _mm256_max_epu32(max, values);
+        }
+
+        alignas(32) uint32_t mins[8];
+        alignas(32) uint32_t maxs[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(mins), min);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), max);
+        range = { *std::min_element(mins, mins + 8), *std::max_element(maxs, maxs + 8) };
+    }
+
+    scan_indices_basic(indices + i, count - i, range);
+    return range;
+}
+
+struct IndexScanFunctions {
+    IndexRange (*u16)(const uint16_t *indices, uint32_t count);
+    IndexRange (*u32)(const uint32_t *indices, uint32_t count);
+};
+
+// check on first use if the AVX2 instruction set can be used
+static const IndexScanFunctions &get_index_scan_functions() {
+    static const IndexScanFunctions functions = []() -> IndexScanFunctions {
+        if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2) {
+            LOG_INFO("AVX2 instruction set is supported. Using fast index range scan");
+            return { get_index_range_u16_AVX2, get_index_range_u32_AVX2 };
+        }
+
+        LOG_INFO("AVX2 instruction set is not supported. Using basic index range scan");
+        return { get_index_range_u16_basic, get_index_range_u32_basic };
+    }();
+
+    return functions;
+}
+
+static IndexRange get_index_range_u16(const uint16_t *indices, uint32_t count) {
+    return get_index_scan_functions().u16(indices, count);
+}
+
+static IndexRange get_index_range_u32(const uint32_t *indices, uint32_t count) {
+    return get_index_scan_functions().u32(indices, count);
+}
+
+} // namespace gxm
+#endif
+
+namespace gxm {
+
+IndexRange get_index_range(const void *indices, SceGxmIndexFormat format, uint32_t count) {
+    if (count == 0)
+        return {};
+
+    if (format == SCE_GXM_INDEX_FORMAT_U16)
+        return get_index_range_u16(static_cast<const uint16_t *>(indices), count);
+    else
+        return get_index_range_u32(static_cast<const uint32_t *>(indices), count);
+}
+
+} // namespace gxm
@@ -0,0 +1,221 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <gxm/functions.h>
+#include <gxm/index_cache.h>
+#include <mem/functions.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+template <typename T>
+std::vector<T> make_indices(uint32_t count, uint32_t min, uint32_t max, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> distribution(min, max);
+    std::vector<T> indices(count);
+    for (T &index : indices)
+        index = static_cast<T>(distribution(random));
+
+    return indices;
+}
+
+template <typename T>
+void expect_reference_range(const std::vector<T> &indices, SceGxmIndexFormat format) {
+    const auto [min, max] = std::minmax_element(indices.begin(), indices.end());
+    const gxm::IndexRange range = gxm::get_index_range(indices.data(), format, static_cast<uint32_t>(indices.size()));
+    EXPECT_EQ(range.min, *min) << indices.size();
+    EXPECT_EQ(range.max, *max) << indices.size();
+}
+
+// Index buffer big enough to be cached, in guest memory
+struct GuestIndices {
+    Address address;
+    uint32_t count;
+    uint16_t *indices;
+
+    GuestIndices(MemState &mem, uint32_t count)
+        : count(count) {
+        address = alloc(mem, count * sizeof(uint16_t), "indices");
+        indices = Ptr<uint16_t>(address).get(mem);
+        for (uint32_t i = 0; i < count; i++)
+            indices[i] = static_cast<uint16_t>(100 + i % 1000);
+    }
+};
+
+} // namespace
+
+TEST(gxm_indices, range_matches_reference) {
+    // odd counts so the last indices are scanned one by one
+    for (uint32_t count : { 1u, 7u, 15u, 16u, 17u, 255u, 4099u }) {
+        expect_reference_range(make_indices<uint16_t>(count, 0, UINT16_MAX, count), SCE_GXM_INDEX_FORMAT_U16);
+        expect_reference_range(make_indices<uint32_t>(count, 0, UINT32_MAX, count), SCE_GXM_INDEX_FORMAT_U32);
+    }
+}
+
+TEST(gxm_indices, range_extremes) {
+    // the smallest and the largest values must not be lost by the horizontal reductions
+    std::vector<uint16_t> indices_u16(1000, 500);
+    indices_u16[333] = UINT16_MAX;
+    indices_u16[999] = 0;
+    expect_reference_range(indices_u16, SCE_GXM_INDEX_FORMAT_U16);
+
+    std::vector<uint32_t> indices_u32(1000, 500);
+    indices_u32[17] = UINT32_MAX;
+    indices_u32[18] = 0;
+    expect_reference_range(indices_u32, SCE_GXM_INDEX_FORMAT_U32);
+
+    const gxm::IndexRange empty = gxm::get_index_range(indices_u32.data(), SCE_GXM_INDEX_FORMAT_U32, 0);
+    EXPECT_EQ(empty.min, 0);
+    EXPECT_EQ(empty.max, 0);
+}
+
+TEST(gxm_index_cache, invalidated_by_tracked_writes) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    enable_write_tracking(mem);
+
+    GuestIndices buffer(mem, 64 * 1024);
+    gxm::IndexRangeCache cache;
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 1099);
+
+    // not seen as long as it is not marked as written, so the cached range is used
+    buffer.indices[10] = 5000;
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 1099);
+
+    mark_written(mem, buffer.address + 10 * sizeof(uint16_t), sizeof(uint16_t));
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 5000);
+
+    // another count is another entry
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, 10).max, 109);
+}
+
+TEST(gxm_index_cache, invalidated_by_hle_writes) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    enable_write_tracking(mem);
+
+    GuestIndices buffer(mem, 64 * 1024);
+    gxm::IndexRangeCache cache;
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 1099);
+
+    // what the HLE functions do, such as memcpy or sceIoRead: a host write through the host pointer of the buffer
+    const std::vector<uint16_t> new_indices(16, 8000);
+    uint16_t *const destination = buffer.indices + buffer.count / 2;
+    std::copy(new_indices.begin(), new_indices.end(), destination);
+    mark_written(mem, destination, static_cast<uint32_t>(new_indices.size() * sizeof(uint16_t)));
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 8000);
+
+    // a host pointer outside the guest memory is ignored
+    mark_written(mem, nullptr, 16);
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 8000);
+}
+
+TEST(gxm_index_cache, invalidated_by_protected_writes) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    GuestIndices buffer(mem, 64 * 1024);
+    gxm::IndexRangeCache cache;
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 1099);
+    ASSERT_TRUE(is_protecting(mem, buffer.address));
+
+    // goes through the access violation handler, which removes the protection
+    buffer.indices[buffer.count - 1] = 6000;
+    ASSERT_FALSE(is_protecting(mem, buffer.address));
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 6000);
+    ASSERT_TRUE(is_protecting(mem, buffer.address));
+
+    // unchanged buffer
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 6000);
+    buffer.indices[0] = 7000;
+    ASSERT_EQ(cache.get(mem, buffer.address, SCE_GXM_INDEX_FORMAT_U16, buffer.count).max, 7000);
+}
+
+TEST(gxm_index_cache, edge_pages_not_protected) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    // the buffer starts and ends in the middle of a page, next to other data
+    const uint32_t count = 8 * mem.page_size / sizeof(uint16_t);
+    const Address block = alloc(mem, (count + 2 * mem.page_size) * sizeof(uint16_t), "block");
+    const Address address = block + mem.page_size / 2;
+    uint16_t *const indices = Ptr<uint16_t>(address).get(mem);
+    std::fill(indices, indices + count, 100);
+    uint8_t *const before = Ptr<uint8_t>(address - 1).get(mem);
+    uint8_t *const after = Ptr<uint8_t>(address + count * sizeof(uint16_t)).get(mem);
+
+    gxm::IndexRangeCache cache;
+    ASSERT_EQ(cache.get(mem, address, SCE_GXM_INDEX_FORMAT_U16, count).max, 100);
+    ASSERT_FALSE(is_protecting(mem, address));
+    ASSERT_TRUE(is_protecting(mem, block + mem.page_size));
+
+    // writing next to the buffer keeps the entry
+    *before = 1;
+    *after = 1;
+    ASSERT_TRUE(is_protecting(mem, block + mem.page_size));
+
+    // the indices in the first and last pages are still seen
+    indices[0] = 2000;
+    ASSERT_EQ(cache.get(mem, address, SCE_GXM_INDEX_FORMAT_U16, count).max, 2000);
+    indices[count - 1] = 3000;
+    ASSERT_EQ(cache.get(mem, address, SCE_GXM_INDEX_FORMAT_U16, count).max, 3000);
+    indices[count / 2] = 4000;
+    ASSERT_EQ(cache.get(mem, address, SCE_GXM_INDEX_FORMAT_U16, count).max, 4000);
+}
+
+TEST(gxm_indices_benchmark, large_meshes) {
+    // a mesh of 1M triangles drawn every frame for 100 frames
+    constexpr uint32_t INDEX_COUNT = 3 * 1024 * 1024;
+    constexpr uint32_t FRAMES = 100;
+
+    const auto measure = [](const char *name, const std::function<uint32_t()> &get_max) {
+        uint32_t max = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < FRAMES; frame++)
+            max = std::max(max, get_max());
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << name << ": " << FRAMES << " draws in " << ms << " ms" << std::endl;
+        return max;
+    };
+
+    const std::vector<uint16_t> indices_u16 = make_indices<uint16_t>(INDEX_COUNT, 0, UINT16_MAX, 1);
+    const uint32_t max_u16 = measure("u16 max_element", [&]() { return *std::max_element(indices_u16.begin(), indices_u16.end()); });
+    ASSERT_EQ(measure("u16 scan", [&]() { return gxm::get_index_range(indices_u16.data(), SCE_GXM_INDEX_FORMAT_U16, INDEX_COUNT).max; }), max_u16);
+
+    const std::vector<uint32_t> indices_u32 = make_indices<uint32_t>(INDEX_COUNT, 0, 1024 * 1024, 2);
+    const uint32_t max_u32 = measure("u32 max_element", [&]() { return *std::max_element(indices_u32.begin(), indices_u32.end()); });
+    ASSERT_EQ(measure("u32 scan", [&]() { return gxm::get_index_range(indices_u32.data(), SCE_GXM_INDEX_FORMAT_U32, INDEX_COUNT).max; }), max_u32);
+
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    const Address address = alloc(mem, INDEX_COUNT * sizeof(uint32_t), "indices");
+    std::copy(indices_u32.begin(), indices_u32.end(), Ptr<uint32_t>(address).get(mem));
+    gxm::IndexRangeCache cache;
+    ASSERT_EQ(measure("u32 cached", [&]() { return cache.get(mem, address, SCE_GXM_INDEX_FORMAT_U32, INDEX_COUNT).max; }), max_u32);
+}
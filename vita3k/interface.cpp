@@ -28,9 +28,11 @@
 #include <display/state.h>
 #include <gui/functions.h>
 #include <gxm/state.h>
+#include <io/archive.h>
 #include <io/functions.h>
 #include <io/vfs.h>
 #include <kernel/state.h>
+#include <packages/archive.h>
 #include <packages/functions.h>
 #include <packages/pkg.h>
 #include <packages/sfo.h>
@@ -124,7 +126,7 @@ static bool set_content_path(EmuEnvState &emuenv, const bool is_theme, fs::path
     return true;
 }
 
-bool install_archive_content(EmuEnvState &emuenv, GuiState *gui, const ZipPtr &zip, const std::string &content_path, const std::function<void(ArchiveContents)> &progress_callback) {
+bool install_archive_content(EmuEnvState &emuenv, GuiState *gui, const fs::path &archive_path, const ZipPtr &zip, const std::string &content_path, const std::function<void(ArchiveContents)> &progress_callback) {
     std::string sfo_path = "sce_sys/param.sfo";
     std::string theme_path = "theme.xml";
     vfs::FileBuffer buffer, theme;
@@ -180,27 +182,13 @@ bool install_archive_content(EmuEnvState &emuenv, GuiState *gui, const ZipPtr &z
             progress_callback({ {}, {}, { file_progress * 0.7f + decrypt_progress * 0.3f } });
     };
 
-    mz_uint num_files = mz_zip_reader_get_num_files(zip.get());
-    for (mz_uint i = 0; i < num_files; i++) {
-        mz_zip_archive_file_stat file_stat;
-        if (!mz_zip_reader_file_stat(zip.get(), i, &file_stat)) {
-            continue;
-        }
-        const std::string m_filename = file_stat.m_filename;
-        if (m_filename.find(content_path) != std::string::npos) {
-            file_progress = static_cast<float>(i) / num_files * 100.0f;
-            update_progress();
-
-            std::string replace_filename = m_filename.substr(content_path.size());
-            const fs::path file_output = (output_path / fs_utils::utf8_to_path(replace_filename)).generic_path();
-            if (mz_zip_reader_is_file_a_directory(zip.get(), i)) {
-                fs::create_directories(file_output);
-            } else {
-                fs::create_directories(file_output.parent_path());
-                LOG_INFO("Extracting {}", file_output);
-                mz_zip_reader_extract_to_file(zip.get(), i, fs_utils::path_to_utf8(file_output).c_str(), 0);
-            }
-        }
+    const auto update_file_progress = [&](float progress) {
+        file_progress = progress;
+        update_progress();
+    };
+    if (!extract_archive(archive_path, content_path, output_path, update_file_progress)) {
+        LOG_CRITICAL("Failed to extract {} from archive: {}", content_path, archive_path);
+        return false;
     }
 
     if (fs::exists(output_path / "sce_sys/package/")) {
@@ -291,7 +279,7 @@ std::vector<ContentInfo> install_archive(EmuEnvState &emuenv, GuiState *gui, con
     for (auto &path : content_path) {
         current++;
         update_progress();
-        const bool state = install_archive_content(emuenv, gui, zip, path, progress_callback);
+        const bool state = install_archive_content(emuenv, gui, archive_path, zip, path, progress_callback);
         content_installed.push_back({ emuenv.app_info.app_title, emuenv.app_info.app_title_id, emuenv.app_info.app_category, emuenv.app_info.app_content_id, path, state });
     }
 
@@ -299,6 +287,45 @@ std::vector<ContentInfo> install_archive(EmuEnvState &emuenv, GuiState *gui, con
     return content_installed;
 }
 
+bool mount_archive(EmuEnvState &emuenv, const fs::path &archive_path) {
+    if (!fs::exists(archive_path)) {
+        LOG_CRITICAL("Failed to load archive file in path: {}", archive_path.generic_path());
+        return false;
+    }
+    const ZipPtr zip(new mz_zip_archive, delete_zip);
+    std::memset(zip.get(), 0, sizeof(*zip));
+
+    FILE *vpk_fp = FOPEN(archive_path.generic_path().c_str(), "rb");
+    if (!mz_zip_reader_init_cfile(zip.get(), vpk_fp, 0, 0)) {
+        LOG_CRITICAL("miniz error reading archive: {}", miniz_get_error(zip));
+        fclose(vpk_fp);
+        return false;
+    }
+
+    bool mounted = false;
+    for (const auto &path : get_archive_contents_path(zip)) {
+        vfs::FileBuffer buffer;
+        if (!mz_zip_reader_extract_file_to_callback(zip.get(), (path + "sce_sys/param.sfo").c_str(), &write_to_buffer, &buffer, 0))
+            continue;
+        sfo::get_param_info(emuenv.app_info, buffer, emuenv.cfg.sys_lang);
+        if (emuenv.app_info.app_category.find("gd") == std::string::npos)
+            continue;
+
+        // the encrypted apps are decrypted while they are installed, which cannot be done in place
+        if (mz_zip_reader_locate_file(zip.get(), (path + "sce_sys/package/work.bin").c_str(), nullptr, 0) >= 0) {
+            LOG_ERROR("{} [{}] is encrypted, it must be installed to run", emuenv.app_info.app_title, emuenv.app_info.app_title_id);
+            break;
+        }
+
+        mounted = vfs::mount_app_archive(emuenv.app_info.app_title_id, archive_path, path);
+        break;
+    }
+
+    fclose(vpk_fp);
+    LOG_INFO_IF(mounted, "{} [{}] is run from archive {}", emuenv.app_info.app_title, emuenv.app_info.app_title_id, archive_path);
+    return mounted;
+}
+
 static std::vector<fs::path> get_contents_path(const fs::path &path) {
     std::vector<fs::path> contents_path;
 
@@ -400,6 +427,8 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv) {
         LOG_WARN("Failed to init kernel!");
         return KernelInitFailed;
     }
+    if (emuenv.kernel.cpu_backend == CPUBackend::Dynarmic)
+        emuenv.kernel.jit_cache_path = emuenv.cache_path / "jit" / emuenv.io.title_id;
 
     if (emuenv.cfg.archive_log) {
         const fs::path log_directory{ emuenv.log_path / "logs" };
@@ -466,7 +495,9 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv) {
         }
     }
     const auto module_app_path{ emuenv.pref_path / "ux0/app" / emuenv.io.app_path / "sce_module" };
-    const auto is_app = fs::exists(module_app_path) && !fs::is_empty(module_app_path);
+    const auto app_archive = vfs::find_app_archive(emuenv.io.app_path);
+    const auto archive_modules = app_archive ? app_archive->find("sce_module") : nullptr;
+    const auto is_app = app_archive ? archive_modules && !archive_modules->children.empty() : fs::exists(module_app_path) && !fs::is_empty(module_app_path);
     std::vector<std::string> lib_load_list = {};
     // todo: check if module is imported
     auto add_preload_module = [&](uint32_t code, SceSysmoduleModuleId module_id, const std::string &name, bool load_from_app) {
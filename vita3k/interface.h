@@ -55,6 +55,8 @@ bool handle_events(EmuEnvState &emuenv, GuiState &gui);
 
 std::vector<ContentInfo> install_archive(EmuEnvState &emuenv, GuiState *gui, const fs::path &archive_path, const std::function<void(ArchiveContents)> &progress_callback = nullptr);
 uint32_t install_contents(EmuEnvState &emuenv, GuiState *gui, const fs::path &path);
+// Run the app of an archive from it, without installing it
+bool mount_archive(EmuEnvState &emuenv, const fs::path &archive_path);
 
 ExitCode load_app(int32_t &main_module_id, EmuEnvState &emuenv);
 ExitCode run_app(EmuEnvState &emuenv, int32_t main_module_id);
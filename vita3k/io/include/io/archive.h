@@ -0,0 +1,105 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <io/block_cache.h>
+
+#include <util/fs.h>
+#include <util/types.h>
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Read only view of a zip archive (.vpk, .zip), so an app can run without being extracted first.
+// The stored entries are read from a mapping of the archive, the deflated ones are inflated from it
+// into a block cache. Reads can be done from any thread.
+class MountedArchive {
+public:
+    struct Entry {
+        // relative to the content, as written in the archive
+        std::string name;
+        uint64_t size = 0;
+        uint64_t compressed_size = 0;
+        // of the data in the archive
+        uint64_t data_offset = 0;
+        time_t time = 0;
+        bool directory = false;
+        bool deflated = false;
+        // names of the entries of a directory
+        std::vector<std::string> children;
+    };
+
+    MountedArchive();
+    ~MountedArchive();
+
+    MountedArchive(const MountedArchive &) = delete;
+    MountedArchive &operator=(const MountedArchive &) = delete;
+
+    // Only the entries starting with prefix, which is the path of the content in the archive, are visible
+    bool open(const fs::path &path, const std::string &prefix = "");
+
+    const fs::path &get_path() const {
+        return path;
+    }
+
+    // path is relative to the content, the root being "". Case insensitive like the Vita file systems
+    const Entry *find(const std::string &path) const;
+    // Returns the number of bytes read, less than size past the end of the entry or if it is damaged
+    uint64_t read(const Entry &entry, uint64_t offset, void *data, uint64_t size);
+
+    BlockCacheStats get_cache_stats() const {
+        return cache.get_stats();
+    }
+
+private:
+    struct InflateCursor;
+
+    void add_entry(const std::string &name, Entry entry);
+    uint64_t read_deflated(const Entry &entry, uint64_t offset, void *data, uint64_t size);
+    void unmap();
+
+    fs::path path;
+    const uint8_t *mapping = nullptr;
+    uint64_t mapping_size = 0;
+    void *mapping_handle = nullptr;
+
+    // by lower case path
+    std::unordered_map<std::string, Entry> entries;
+
+    BlockCache cache;
+    std::mutex cursors_mutex;
+    // where the last inflates of the deflated entries stopped, so sequential reads go on from there
+    std::vector<std::unique_ptr<InflateCursor>> cursors;
+};
+
+namespace vfs {
+
+// Serve ux0:app/<app_path>, so also app0: when running it, from an archive instead of the extracted files
+bool mount_app_archive(const std::string &app_path, const fs::path &archive_path, const std::string &prefix = "");
+void unmount_app_archive(const std::string &app_path);
+std::shared_ptr<MountedArchive> find_app_archive(const std::string &app_path);
+
+// The archive serving a path of ux0 and the path inside it, if there is one
+std::shared_ptr<MountedArchive> find_ux0_archive(const std::string &ux0_path, std::string &archive_path);
+
+} // namespace vfs
@@ -0,0 +1,138 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Priority given to the requests when neither the file, the thread or the process has one
+constexpr int SCE_IO_DEFAULT_PRIORITY = 16;
+
+enum class AsyncIoStatus {
+    Unknown,
+    Waiting,
+    Running,
+    Done,
+};
+
+// Host threads running the asynchronous file operations, so the guest threads do not wait for the disk.
+// Waiting requests start by priority (lowest value first, like the guest thread priorities) then in submission
+// order. The requests on the same file never run at the same time and always run in submission order.
+class AsyncIo {
+public:
+    // Returns the result of the operation, as given to the guest
+    typedef std::function<SceInt64()> Operation;
+    // Called once the request is done, on the I/O thread or on the cancelling thread
+    typedef std::function<void(SceInt64 result)> Completion;
+
+    explicit AsyncIo(uint32_t thread_count = 2);
+    ~AsyncIo();
+
+    AsyncIo(const AsyncIo &) = delete;
+    AsyncIo &operator=(const AsyncIo &) = delete;
+
+    // fd can be invalid (< 0) for requests which do not use an opened file
+    void submit(SceUID id, SceUID fd, int priority, Operation operation, Completion completion);
+    // Work nobody waits for, like prefetching. It has no state and cannot be cancelled
+    void submit_background(int priority, Operation operation);
+    // Remove a request which has not started yet, its completion is called with result. false if it already started
+    bool cancel(SceUID id, SceInt64 result);
+    // Forget a done request and give its result
+    AsyncIoStatus complete(SceUID id, SceInt64 &result);
+    // Wait for all the submitted requests to be done
+    void wait_idle();
+
+    // Keep the requests on fd from running while the calling thread uses the file, after waiting for the running one.
+    // With after_requests, also wait for the requests on fd which are already submitted, like closing the file must.
+    // Does nothing if the calling thread already has the file, like the I/O thread running a request on it.
+    class FileLock {
+        AsyncIo &async;
+        SceUID fd;
+        SceUID previous_file;
+        bool locked;
+
+    public:
+        FileLock(AsyncIo &async, SceUID fd, bool after_requests = false);
+        ~FileLock();
+
+        FileLock(const FileLock &) = delete;
+        FileLock &operator=(const FileLock &) = delete;
+    };
+
+    // Number of requests waiting or running
+    uint32_t queue_depth() const {
+        return depth.load(std::memory_order_relaxed);
+    }
+
+    // The priority of a request is the one of its file, or the default one of its thread or else of the process
+    int get_priority(SceUID fd, SceUID thread_id) const;
+    bool get_file_priority(SceUID fd, int &priority) const;
+    void set_file_priority(SceUID fd, int priority);
+    void forget_file(SceUID fd);
+    int get_thread_default_priority(SceUID thread_id) const;
+    void set_thread_default_priority(SceUID thread_id, int priority);
+    int get_process_default_priority() const;
+    void set_process_default_priority(int priority);
+
+private:
+    struct Request {
+        SceUID id;
+        SceUID fd;
+        int priority;
+        Operation operation;
+        Completion completion;
+    };
+
+    struct RequestState {
+        AsyncIoStatus status;
+        SceInt64 result;
+    };
+
+    bool pop_next_request(Request &request);
+    bool has_waiting_request(SceUID fd) const;
+    void worker_loop();
+
+    const uint32_t thread_count;
+
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable idle_cond;
+    // in submission order
+    std::vector<Request> waiting;
+    // files used by a running request or locked by a guest thread
+    std::unordered_set<SceUID> busy_files;
+    std::unordered_map<SceUID, RequestState> states;
+    uint32_t running = 0;
+    std::atomic<uint32_t> depth = 0;
+    bool stopping = false;
+    // started with the first request
+    std::vector<std::thread> workers;
+
+    std::map<SceUID, int> file_priorities;
+    std::map<SceUID, int> thread_priorities;
+    int process_priority = SCE_IO_DEFAULT_PRIORITY;
+};
@@ -0,0 +1,108 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct BlockCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    // blocks loaded before being read
+    uint64_t prefetched;
+};
+
+// Blocks of the files opened read only, kept in host memory so the same data is not read again from the disk.
+// The least recently used blocks are dropped first once the capacity is reached.
+class BlockCache {
+public:
+    static constexpr uint32_t BLOCK_SIZE = 64 * 1024;
+
+    // Read up to size bytes at offset of the file, returns the number of bytes read
+    typedef std::function<size_t(uint64_t offset, void *data, size_t size)> Reader;
+
+    explicit BlockCache(size_t capacity = 64 * 1024 * 1024);
+
+    // Same as reader, but only the missing blocks are read with it
+    size_t read(const std::string &file, uint64_t offset, void *data, size_t size, const Reader &reader);
+    // Load the missing blocks of a range, returns the number of blocks loaded
+    uint32_t prefetch(const std::string &file, uint64_t offset, size_t size, const Reader &reader);
+    bool contains(const std::string &file, uint64_t offset, size_t size) const;
+    // Forget the blocks of a file, which must be done before it is modified
+    void flush(const std::string &file);
+    // Same for all the files in a directory and its subdirectories
+    void flush_directory(const std::string &dir);
+    void flush();
+
+    BlockCacheStats get_stats() const;
+
+private:
+    typedef std::shared_ptr<const std::vector<uint8_t>> BlockData;
+
+    struct Key {
+        std::string file;
+        uint64_t index;
+
+        bool operator==(const Key &other) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<std::string>()(key.file) ^ std::hash<uint64_t>()(key.index);
+        }
+    };
+
+    struct Block {
+        Key key;
+        BlockData data;
+    };
+
+    // Blocks of a file being read from the disk, without the lock held
+    struct PendingLoads {
+        uint32_t count;
+        // changed by the flushes of the file, the blocks read before are not kept
+        uint64_t generation;
+    };
+
+    BlockData find(const Key &key);
+    BlockData load(const Key &key, const Reader &reader);
+    void erase(std::list<Block>::iterator block);
+    void flush_file(const std::string &file);
+
+    const size_t capacity;
+
+    mutable std::mutex mutex;
+    // most recently used first
+    std::list<Block> blocks;
+    std::unordered_map<Key, std::list<Block>::iterator, KeyHash> block_map;
+    // number of blocks of each file, so files which are not cached are flushed right away
+    std::unordered_map<std::string, uint32_t> file_blocks;
+    std::unordered_map<std::string, PendingLoads> pending_loads;
+    size_t used = 0;
+
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> prefetched = 0;
+};
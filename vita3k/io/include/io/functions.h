@@ -72,6 +72,9 @@ int write_file(SceUID fd, const void *data, SceSize size, const IOState &io, con
 int truncate_file(SceUID fd, unsigned long long length, const IOState &io, const char *export_name);
 SceOff seek_file(SceUID fd, SceOff offset, SceIoSeekMode whence, IOState &io, const char *export_name);
 SceOff tell_file(IOState &io, const SceUID fd, const char *export_name);
+// Read or write at offset and restore the position, without another operation on the file in between
+int read_file_at(void *data, IOState &io, SceUID fd, SceSize size, SceOff offset, const char *export_name);
+int write_file_at(SceUID fd, const void *data, SceSize size, SceOff offset, IOState &io, const char *export_name);
 int stat_file(IOState &io, const char *file, SceIoStat *statp, const fs::path &pref_path, const char *export_name, SceUID fd = invalid_fd);
 int stat_file_by_fd(IOState &io, const SceUID fd, SceIoStat *statp, const fs::path &pref_path, const char *export_name);
 int close_file(IOState &io, SceUID fd, const char *export_name);
@@ -87,3 +90,7 @@ int remove_dir(IOState &io, const char *dir, const fs::path &pref_path, const ch
 // SceFios functions
 SceUID create_overlay(IOState &io, SceFiosProcessOverlay *fios_overlay);
 std::string resolve_path(IOState &io, const char *input, const SceUInt32 min_order = 0, const SceUInt32 max_order = 0x7F);
+// Load a range of an opened file in the block cache on the calling thread, returns the number of blocks loaded
+SceOff prefetch_cached_file(IOState &io, SceUID fd, SceOff offset, SceOff size, const char *export_name);
+bool is_file_cached(IOState &io, SceUID fd, SceOff offset, SceOff size);
+int flush_cached_file(IOState &io, SceUID fd, const char *export_name);
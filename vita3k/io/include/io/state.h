@@ -17,11 +17,15 @@
 
 #pragma once
 
+#include <io/archive.h>
+#include <io/async.h>
+#include <io/block_cache.h>
 #include <io/filesystem.h>
 #include <io/types.h>
 #include <io/util.h>
 
 #include <map>
+#include <mutex>
 #include <unordered_map>
 
 // Class for all needed information to access files on Vita3K.
@@ -29,6 +33,11 @@ class FileStats : public VitaStats {
     // Shared file pointer
     FilePtr wrapped_file;
 
+    // For the files of a mounted archive, which are read from it instead of a file pointer
+    std::shared_ptr<MountedArchive> archive;
+    const MountedArchive::Entry *archive_entry = nullptr;
+    mutable SceOff archive_position = 0;
+
 public:
     // Constructor used for files
     // Based on https://codereview.stackexchange.com/questions/4679/
@@ -43,6 +52,22 @@ public:
         file_info.access_mode = SCE_S_IFREG;
     }
 
+    // Constructor used for the files of a mounted archive, which are read only
+    explicit FileStats(const char *vita, const std::string &t, const fs::path &file, std::shared_ptr<MountedArchive> mounted_archive, const MountedArchive::Entry *entry)
+        : archive(std::move(mounted_archive))
+        , archive_entry(entry) {
+        file_info.vita_loc = vita;
+        file_info.translated = t;
+        file_info.sys_loc = file;
+        file_info.open_mode = SCE_O_RDONLY;
+        file_info.file_mode = SCE_SO_IFREG | SCE_SO_IROTH;
+        file_info.access_mode = SCE_S_IFREG;
+    }
+
+    const MountedArchive::Entry *get_archive_entry() const {
+        return archive_entry;
+    }
+
     bool is_regular_file() const {
         return file_info.file_mode & SCE_SO_IFREG;
     }
@@ -55,6 +80,15 @@ public:
         return can_write(file_info.open_mode);
     }
 
+    // Files opened read only are read through the block cache, the archives have their own
+    bool is_cached() const {
+        return is_regular_file() && !can_write(file_info.open_mode) && !archive_entry;
+    }
+
+    // Used to prefetch the next blocks of sequential reads
+    mutable SceOff last_read_end = 0;
+    mutable SceOff prefetch_end = 0;
+
     // File operations
     FILE *get_file_pointer() const {
         return wrapped_file.get();
@@ -73,6 +107,11 @@ class DirStats : public VitaStats {
     // Shared directory pointer
     DirPtr dir_ptr;
 
+    // For the directories of a mounted archive, listed from their entry
+    std::shared_ptr<MountedArchive> archive;
+    const MountedArchive::Entry *archive_entry = nullptr;
+    mutable size_t next_child = 0;
+
 public:
     DirStats(const char *vita, const std::string &t, const fs::path &file, DirPtr ptr) {
         dir_ptr = std::move(ptr);
@@ -85,6 +124,30 @@ public:
         file_info.access_mode = SCE_S_IFDIR | SCE_S_IRUSR;
     }
 
+    DirStats(const char *vita, const std::string &t, const fs::path &file, std::shared_ptr<MountedArchive> mounted_archive, const MountedArchive::Entry *entry)
+        : archive(std::move(mounted_archive))
+        , archive_entry(entry) {
+        file_info.vita_loc = vita;
+        file_info.translated = t;
+        file_info.sys_loc = file;
+        file_info.open_mode = SCE_O_RDONLY;
+        file_info.file_mode = SCE_SO_IFDIR | SCE_SO_IROTH;
+        file_info.access_mode = SCE_S_IFDIR | SCE_S_IRUSR;
+    }
+
+    const MountedArchive::Entry *get_archive_entry() const {
+        return archive_entry;
+    }
+
+    // Name of the next entry of an archive directory, false once they have all been given
+    bool next_archive_child(std::string &name) const {
+        if (next_child >= archive_entry->children.size())
+            return false;
+
+        name = archive_entry->children[next_child++];
+        return true;
+    }
+
     auto get_dir_ptr() const {
         return get_system_dir_ptr(dir_ptr);
     }
@@ -115,6 +178,8 @@ struct IOState {
 
     bool redirect_stdio;
 
+    // protects next_fd and the file maps, which are also used by the asynchronous I/O threads
+    mutable std::mutex files_mutex;
     SceUID next_fd = 0;
     TtyFiles tty_files;
     StdFiles std_files;
@@ -127,4 +192,12 @@ struct IOState {
     SceUID next_overlay_id = 1;
     // overlay in the order they should be applied
     std::vector<FiosOverlay> overlays;
+
+    // modified by the reads, so also usable from the functions which do not change the state of the files
+    mutable BlockCache block_cache;
+    // declared after what its threads use, so they are stopped first.
+    // The files are also locked in it by the functions which do not change the state of the files
+    mutable AsyncIo async;
+    // where to write the result of the asynchronous operations, protected by files_mutex
+    std::map<SceUID, Ptr<SceIoAsyncParam>> async_params;
 };
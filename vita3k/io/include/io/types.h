@@ -115,6 +115,16 @@ struct SceIoDirent {
     int dummy;
 };
 
+// Filled when an asynchronous operation completes
+struct SceIoAsyncParam {
+    SceInt32 result; //!< File descriptor, byte count or error code. Low word of 64-bit results
+    SceInt32 result_high; //!< High word of 64-bit results (lseek)
+    SceInt32 unk_08;
+    SceInt32 unk_0C;
+    SceInt32 unk_10;
+    SceInt32 unk_14;
+};
+
 struct SceIoDevInfo {
     SceInt64 max_size;
     SceInt64 free_size;
@@ -0,0 +1,329 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <io/archive.h>
+
+#include <util/log.h>
+#include <util/string_utils.h>
+
+#include <miniz.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <map>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// a stream is kept for each file read at the same time, past this the oldest ones start over
+static constexpr size_t MAX_INFLATE_CURSORS = 16;
+// the inflated blocks, the archive itself is in the page cache of the host
+static constexpr size_t INFLATED_CACHE_SIZE = 32 * 1024 * 1024;
+
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+constexpr uint32_t LOCAL_HEADER_SIZE = 30;
+
+struct MountedArchive::InflateCursor {
+    const Entry *entry;
+    mz_stream stream{};
+    // of the data given to the stream
+    uint64_t input_offset = 0;
+    // of the next inflated byte
+    uint64_t position = 0;
+    bool ended = false;
+
+    InflateCursor(const Entry *entry)
+        : entry(entry) {
+        mz_inflateInit2(&stream, -MZ_DEFAULT_WINDOW_BITS);
+    }
+
+    ~InflateCursor() {
+        mz_inflateEnd(&stream);
+    }
+
+    // Returns the number of bytes inflated, less than size at the end of the entry or on an error
+    uint64_t read(const uint8_t *mapping, uint8_t *data, uint64_t size) {
+        uint64_t inflated = 0;
+        while (inflated < size && !ended) {
+            if (stream.avail_in == 0) {
+                const uint64_t input_size = std::min<uint64_t>(entry->compressed_size - input_offset, UINT_MAX);
+                stream.next_in = mapping + entry->data_offset + input_offset;
+                stream.avail_in = static_cast<unsigned int>(input_size);
+                input_offset += input_size;
+            }
+
+            const unsigned int output_size = static_cast<unsigned int>(std::min<uint64_t>(size - inflated, UINT_MAX));
+            stream.next_out = data + inflated;
+            stream.avail_out = output_size;
+            const int status = mz_inflate(&stream, MZ_SYNC_FLUSH);
+            inflated += output_size - stream.avail_out;
+
+            if (status == MZ_STREAM_END) {
+                ended = true;
+            } else if (status != MZ_OK) {
+                LOG_ERROR("Failed to inflate {} ({}), the archive is damaged", entry->name, mz_error(status));
+                ended = true;
+            }
+        }
+
+        position += inflated;
+        return inflated;
+    }
+};
+
+MountedArchive::MountedArchive()
+    : cache(INFLATED_CACHE_SIZE) {
+}
+
+MountedArchive::~MountedArchive() {
+    cursors.clear();
+    unmap();
+}
+
+void MountedArchive::unmap() {
+    if (!mapping)
+        return;
+
+#ifdef WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(mapping_handle);
+#else
+    munmap(const_cast<uint8_t *>(mapping), mapping_size);
+#endif
+    mapping = nullptr;
+    mapping_size = 0;
+    mapping_handle = nullptr;
+}
+
+void MountedArchive::add_entry(const std::string &name, Entry entry) {
+    const std::string key = string_utils::tolower(name);
+    if (entries.contains(key)) {
+        // a directory may have been added for a file inside it before its own entry
+        if (!entry.directory)
+            entries[key] = std::move(entry);
+        return;
+    }
+
+    // also add the directories which are not in the archive
+    const size_t separator = name.find_last_of('/');
+    const std::string parent = separator == std::string::npos ? "" : name.substr(0, separator);
+    if (!entries.contains(string_utils::tolower(parent)))
+        add_entry(parent, { parent, 0, 0, 0, entry.time, true });
+    entries[string_utils::tolower(parent)].children.push_back(name.substr(separator + 1));
+
+    entries.emplace(key, std::move(entry));
+}
+
+bool MountedArchive::open(const fs::path &archive_path, const std::string &prefix) {
+    path = archive_path;
+    const uint64_t file_size = fs::file_size(path);
+#ifdef WIN32
+    const HANDLE file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle != INVALID_HANDLE_VALUE && file_size > 0) {
+        const HANDLE mapping_object = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_object) {
+            mapping = static_cast<const uint8_t *>(MapViewOfFile(mapping_object, FILE_MAP_READ, 0, 0, 0));
+            if (mapping)
+                mapping_handle = mapping_object;
+            else
+                CloseHandle(mapping_object);
+        }
+    }
+    if (file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(file_handle);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0 && file_size > 0) {
+        void *address = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (address != MAP_FAILED)
+            mapping = static_cast<const uint8_t *>(address);
+    }
+    if (fd >= 0)
+        ::close(fd);
+#endif
+    if (!mapping) {
+        LOG_ERROR("Failed to map archive {}", path);
+        return false;
+    }
+    mapping_size = file_size;
+
+    // miniz is only used to read the central directory, the entries are read from the mapping
+    mz_zip_archive zip{};
+    if (!mz_zip_reader_init_mem(&zip, mapping, mapping_size, 0)) {
+        LOG_ERROR("miniz error reading archive {}: {}", path, mz_zip_get_error_string(mz_zip_get_last_error(&zip)));
+        unmap();
+        return false;
+    }
+
+    entries[""] = { "", 0, 0, 0, 0, true };
+    const mz_uint num_files = mz_zip_reader_get_num_files(&zip);
+    for (mz_uint i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(&zip, i, &file_stat))
+            continue;
+
+        std::string name = file_stat.m_filename;
+        if (!name.starts_with(prefix))
+            continue;
+        name.erase(0, prefix.size());
+        while (name.ends_with('/'))
+            name.pop_back();
+        if (name.empty())
+            continue;
+
+        Entry entry{ name, file_stat.m_uncomp_size, file_stat.m_comp_size, 0, file_stat.m_time, static_cast<bool>(file_stat.m_is_directory) };
+        if (!entry.directory) {
+            if (file_stat.m_is_encrypted || (file_stat.m_method != 0 && file_stat.m_method != MZ_DEFLATED)) {
+                LOG_WARN("Entry {} of archive {} is encrypted or uses an unsupported compression, it is skipped", name, path);
+                continue;
+            }
+            entry.deflated = file_stat.m_method == MZ_DEFLATED;
+
+            // the data is after the local header, whose name and extra field can differ from the central directory
+            const uint64_t header = file_stat.m_local_header_ofs;
+            uint32_t signature = 0;
+            uint16_t name_size = 0, extra_size = 0;
+            if (header + LOCAL_HEADER_SIZE <= mapping_size) {
+                memcpy(&signature, mapping + header, sizeof(signature));
+                memcpy(&name_size, mapping + header + 26, sizeof(name_size));
+                memcpy(&extra_size, mapping + header + 28, sizeof(extra_size));
+            }
+            entry.data_offset = header + LOCAL_HEADER_SIZE + name_size + extra_size;
+            if (signature != LOCAL_HEADER_SIGNATURE || entry.data_offset + entry.compressed_size > mapping_size
+                || (!entry.deflated && entry.size != entry.compressed_size)) {
+                LOG_WARN("Entry {} of archive {} is damaged, it is skipped", name, path);
+                continue;
+            }
+        }
+
+        add_entry(name, std::move(entry));
+    }
+    mz_zip_reader_end(&zip);
+
+    LOG_INFO("Mounted archive {} ({} entries)", path, entries.size());
+    return true;
+}
+
+const MountedArchive::Entry *MountedArchive::find(const std::string &entry_path) const {
+    std::string key = string_utils::tolower(entry_path);
+    while (key.ends_with('/'))
+        key.pop_back();
+
+    const auto entry = entries.find(key);
+    return entry == entries.end() ? nullptr : &entry->second;
+}
+
+uint64_t MountedArchive::read_deflated(const Entry &entry, uint64_t offset, void *data, uint64_t size) {
+    // go on from the closest stream of this entry which did not get past offset
+    std::unique_ptr<InflateCursor> cursor;
+    {
+        const std::lock_guard<std::mutex> lock(cursors_mutex);
+        auto best = cursors.end();
+        for (auto it = cursors.begin(); it != cursors.end(); ++it) {
+            if ((*it)->entry == &entry && (*it)->position <= offset && (best == cursors.end() || (*it)->position > (*best)->position))
+                best = it;
+        }
+        if (best != cursors.end()) {
+            cursor = std::move(*best);
+            cursors.erase(best);
+        }
+    }
+    if (!cursor)
+        cursor = std::make_unique<InflateCursor>(&entry);
+
+    std::vector<uint8_t> skipped;
+    while (cursor->position < offset && !cursor->ended) {
+        skipped.resize(std::min<uint64_t>(offset - cursor->position, BlockCache::BLOCK_SIZE));
+        cursor->read(mapping, skipped.data(), skipped.size());
+    }
+
+    const uint64_t inflated = cursor->position == offset ? cursor->read(mapping, static_cast<uint8_t *>(data), size) : 0;
+
+    if (!cursor->ended) {
+        const std::lock_guard<std::mutex> lock(cursors_mutex);
+        if (cursors.size() >= MAX_INFLATE_CURSORS)
+            cursors.erase(cursors.begin());
+        cursors.push_back(std::move(cursor));
+    }
+
+    return inflated;
+}
+
+uint64_t MountedArchive::read(const Entry &entry, uint64_t offset, void *data, uint64_t size) {
+    if (entry.directory || offset >= entry.size)
+        return 0;
+    size = std::min(size, entry.size - offset);
+
+    if (!entry.deflated) {
+        memcpy(data, mapping + entry.data_offset + offset, size);
+        return size;
+    }
+
+    return cache.read(entry.name, offset, data, size, [&](uint64_t block_offset, void *block, size_t block_size) -> size_t {
+        return read_deflated(entry, block_offset, block, std::min<uint64_t>(block_size, entry.size - block_offset));
+    });
+}
+
+namespace vfs {
+
+static std::mutex app_archives_mutex;
+// by lower case app path
+static std::map<std::string, std::shared_ptr<MountedArchive>> app_archives;
+
+bool mount_app_archive(const std::string &app_path, const fs::path &archive_path, const std::string &prefix) {
+    auto archive = std::make_shared<MountedArchive>();
+    if (!archive->open(archive_path, prefix))
+        return false;
+
+    const std::lock_guard<std::mutex> lock(app_archives_mutex);
+    app_archives[string_utils::tolower(app_path)] = std::move(archive);
+    return true;
+}
+
+void unmount_app_archive(const std::string &app_path) {
+    const std::lock_guard<std::mutex> lock(app_archives_mutex);
+    app_archives.erase(string_utils::tolower(app_path));
+}
+
+std::shared_ptr<MountedArchive> find_app_archive(const std::string &app_path) {
+    const std::lock_guard<std::mutex> lock(app_archives_mutex);
+    const auto archive = app_archives.find(string_utils::tolower(app_path));
+    return archive == app_archives.end() ? nullptr : archive->second;
+}
+
+std::shared_ptr<MountedArchive> find_ux0_archive(const std::string &ux0_path, std::string &archive_path) {
+    const std::string path = string_utils::tolower(ux0_path);
+    if (!path.starts_with("app/"))
+        return nullptr;
+
+    const size_t app_end = path.find('/', 4);
+    auto archive = find_app_archive(path.substr(4, app_end == std::string::npos ? std::string::npos : app_end - 4));
+    if (archive)
+        archive_path = app_end == std::string::npos ? "" : ux0_path.substr(app_end + 1);
+
+    return archive;
+}
+
+} // namespace vfs
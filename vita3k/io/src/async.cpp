@@ -0,0 +1,248 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/async.h>
+
+#include <algorithm>
+
+// file locked by this thread or used by the request it runs, it can use it without locking it again
+static thread_local SceUID held_file = -1;
+
+AsyncIo::AsyncIo(uint32_t thread_count)
+    : thread_count(thread_count) {
+}
+
+AsyncIo::~AsyncIo() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        // the guest is gone, the requests which did not start are dropped
+        waiting.clear();
+    }
+    cond.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void AsyncIo::submit(SceUID id, SceUID fd, int priority, Operation operation, Completion completion) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (workers.empty()) {
+            for (uint32_t i = 0; i < thread_count; i++)
+                workers.emplace_back([this] { worker_loop(); });
+        }
+
+        waiting.push_back({ id, fd, priority, std::move(operation), std::move(completion) });
+        if (id != 0)
+            states[id] = { AsyncIoStatus::Waiting, 0 };
+        depth++;
+    }
+    // the guest threads waiting for a file wait on it too
+    cond.notify_all();
+}
+
+void AsyncIo::submit_background(int priority, Operation operation) {
+    submit(0, -1, priority, std::move(operation), {});
+}
+
+bool AsyncIo::cancel(SceUID id, SceInt64 result) {
+    // the background work has no id
+    if (id == 0)
+        return false;
+
+    Request request;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        const auto it = std::find_if(waiting.begin(), waiting.end(), [&](const Request &request) { return request.id == id; });
+        if (it == waiting.end())
+            return false;
+
+        request = std::move(*it);
+        waiting.erase(it);
+        states[id] = { AsyncIoStatus::Done, result };
+        depth--;
+    }
+    // the next request on the same file may be able to start now
+    cond.notify_all();
+    idle_cond.notify_all();
+
+    request.completion(result);
+    return true;
+}
+
+AsyncIoStatus AsyncIo::complete(SceUID id, SceInt64 &result) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = states.find(id);
+    if (it == states.end())
+        return AsyncIoStatus::Unknown;
+
+    const AsyncIoStatus status = it->second.status;
+    if (status == AsyncIoStatus::Done) {
+        result = it->second.result;
+        states.erase(it);
+    }
+
+    return status;
+}
+
+void AsyncIo::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cond.wait(lock, [&] { return waiting.empty() && running == 0; });
+}
+
+AsyncIo::FileLock::FileLock(AsyncIo &async, SceUID fd, bool after_requests)
+    : async(async)
+    , fd(fd)
+    , previous_file(held_file)
+    , locked(fd >= 0 && fd != held_file) {
+    if (!locked)
+        return;
+
+    std::unique_lock<std::mutex> lock(async.mutex);
+    async.cond.wait(lock, [&] { return !async.busy_files.contains(fd) && !(after_requests && async.has_waiting_request(fd)); });
+    async.busy_files.insert(fd);
+    held_file = fd;
+}
+
+AsyncIo::FileLock::~FileLock() {
+    if (!locked)
+        return;
+
+    held_file = previous_file;
+    {
+        const std::lock_guard<std::mutex> lock(async.mutex);
+        async.busy_files.erase(fd);
+    }
+    // the I/O threads and the other guest threads may wait for this file
+    async.cond.notify_all();
+}
+
+bool AsyncIo::has_waiting_request(SceUID fd) const {
+    return std::any_of(waiting.begin(), waiting.end(), [&](const Request &request) { return request.fd == fd; });
+}
+
+// Take the most urgent request whose file is not used by another one, the caller holds the lock
+bool AsyncIo::pop_next_request(Request &request) {
+    // files with an earlier request still waiting
+    std::unordered_set<SceUID> blocked_files;
+    auto best = waiting.end();
+    for (auto it = waiting.begin(); it != waiting.end(); ++it) {
+        if (it->fd >= 0) {
+            const bool blocked = busy_files.contains(it->fd) || blocked_files.contains(it->fd);
+            blocked_files.insert(it->fd);
+            if (blocked)
+                continue;
+        }
+
+        // earlier requests win on equal priorities
+        if (best == waiting.end() || it->priority < best->priority)
+            best = it;
+    }
+
+    if (best == waiting.end())
+        return false;
+
+    request = std::move(*best);
+    waiting.erase(best);
+    if (request.fd >= 0)
+        busy_files.insert(request.fd);
+    if (request.id != 0)
+        states[request.id].status = AsyncIoStatus::Running;
+    running++;
+    return true;
+}
+
+void AsyncIo::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        Request request;
+        cond.wait(lock, [&] { return stopping || pop_next_request(request); });
+        if (stopping && !request.operation)
+            return;
+
+        lock.unlock();
+        held_file = request.fd;
+        const SceInt64 result = request.operation();
+        held_file = -1;
+        lock.lock();
+
+        if (request.fd >= 0)
+            busy_files.erase(request.fd);
+        if (request.id != 0)
+            states[request.id] = { AsyncIoStatus::Done, result };
+        running--;
+        depth--;
+
+        lock.unlock();
+        cond.notify_all();
+        idle_cond.notify_all();
+        if (request.completion)
+            request.completion(result);
+        lock.lock();
+    }
+}
+
+int AsyncIo::get_priority(SceUID fd, SceUID thread_id) const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (const auto file = file_priorities.find(fd); file != file_priorities.end())
+        return file->second;
+    if (const auto thread = thread_priorities.find(thread_id); thread != thread_priorities.end())
+        return thread->second;
+
+    return process_priority;
+}
+
+bool AsyncIo::get_file_priority(SceUID fd, int &priority) const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto file = file_priorities.find(fd);
+    if (file == file_priorities.end())
+        return false;
+
+    priority = file->second;
+    return true;
+}
+
+void AsyncIo::set_file_priority(SceUID fd, int priority) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    file_priorities[fd] = priority;
+}
+
+void AsyncIo::forget_file(SceUID fd) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    file_priorities.erase(fd);
+}
+
+int AsyncIo::get_thread_default_priority(SceUID thread_id) const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto thread = thread_priorities.find(thread_id);
+    return thread == thread_priorities.end() ? process_priority : thread->second;
+}
+
+void AsyncIo::set_thread_default_priority(SceUID thread_id, int priority) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    thread_priorities[thread_id] = priority;
+}
+
+int AsyncIo::get_process_default_priority() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return process_priority;
+}
+
+void AsyncIo::set_process_default_priority(int priority) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    process_priority = priority;
+}
@@ -0,0 +1,196 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/block_cache.h>
+
+#include <algorithm>
+#include <cstring>
+
+BlockCache::BlockCache(size_t capacity)
+    : capacity(capacity) {
+}
+
+BlockCache::BlockData BlockCache::find(const Key &key) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = block_map.find(key);
+    if (it == block_map.end())
+        return {};
+
+    blocks.splice(blocks.begin(), blocks, it->second);
+    return it->second->data;
+}
+
+BlockCache::BlockData BlockCache::load(const Key &key, const Reader &reader) {
+    std::unique_lock<std::mutex> lock(mutex);
+    PendingLoads &pending = pending_loads[key.file];
+    pending.count++;
+    const uint64_t generation = pending.generation;
+    lock.unlock();
+
+    // the disk is read without holding the lock, another thread may load the same block meanwhile
+    auto data = std::make_shared<std::vector<uint8_t>>(BLOCK_SIZE);
+    data->resize(reader(key.index * BLOCK_SIZE, data->data(), BLOCK_SIZE));
+
+    lock.lock();
+    const auto loads = pending_loads.find(key.file);
+    const bool flushed = loads->second.generation != generation;
+    if (--loads->second.count == 0)
+        pending_loads.erase(loads);
+
+    // the file was modified during the read, the data is given to the read racing with the change but not cached
+    if (flushed)
+        return data;
+
+    if (const auto it = block_map.find(key); it != block_map.end())
+        erase(it->second);
+
+    blocks.push_front({ key, data });
+    block_map.emplace(key, blocks.begin());
+    file_blocks[key.file]++;
+    used += BLOCK_SIZE;
+    while (used > capacity)
+        erase(std::prev(blocks.end()));
+
+    return data;
+}
+
+// The caller holds the lock
+void BlockCache::erase(std::list<Block>::iterator block) {
+    const auto file = file_blocks.find(block->key.file);
+    if (--file->second == 0)
+        file_blocks.erase(file);
+
+    block_map.erase(block->key);
+    blocks.erase(block);
+    used -= BLOCK_SIZE;
+}
+
+size_t BlockCache::read(const std::string &file, uint64_t offset, void *data, size_t size, const Reader &reader) {
+    uint8_t *dst = static_cast<uint8_t *>(data);
+    size_t read = 0;
+    while (read < size) {
+        const Key key{ file, (offset + read) / BLOCK_SIZE };
+        BlockData block = find(key);
+        if (block) {
+            hits++;
+        } else {
+            misses++;
+            block = load(key, reader);
+        }
+
+        const size_t block_offset = (offset + read) % BLOCK_SIZE;
+        if (block_offset >= block->size())
+            break;
+
+        const size_t count = std::min(block->size() - block_offset, size - read);
+        memcpy(dst + read, block->data() + block_offset, count);
+        read += count;
+
+        // end of the file
+        if (block->size() < BLOCK_SIZE)
+            break;
+    }
+
+    return read;
+}
+
+uint32_t BlockCache::prefetch(const std::string &file, uint64_t offset, size_t size, const Reader &reader) {
+    uint32_t loaded = 0;
+    const uint64_t last = (offset + size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (uint64_t index = offset / BLOCK_SIZE; index < last; index++) {
+        const Key key{ file, index };
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            // not moved to the front, the block was not used
+            if (block_map.contains(key))
+                continue;
+        }
+
+        const BlockData block = load(key, reader);
+        loaded++;
+        if (block->size() < BLOCK_SIZE)
+            break;
+    }
+
+    prefetched += loaded;
+    return loaded;
+}
+
+bool BlockCache::contains(const std::string &file, uint64_t offset, size_t size) const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const uint64_t last = (offset + size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (uint64_t index = offset / BLOCK_SIZE; index < last; index++) {
+        if (!block_map.contains({ file, index }))
+            return false;
+    }
+
+    return true;
+}
+
+void BlockCache::flush(const std::string &file) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    flush_file(file);
+}
+
+void BlockCache::flush_directory(const std::string &dir) {
+    const auto in_dir = [&](const std::string &file) {
+        return file.size() > dir.size() && file.starts_with(dir) && (file[dir.size()] == '/' || file[dir.size()] == '\\');
+    };
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> files;
+    for (const auto &[file, count] : file_blocks) {
+        if (in_dir(file))
+            files.push_back(file);
+    }
+    for (const auto &[file, loads] : pending_loads) {
+        if (in_dir(file))
+            files.push_back(file);
+    }
+
+    for (const std::string &file : files)
+        flush_file(file);
+}
+
+// The caller holds the lock
+void BlockCache::flush_file(const std::string &file) {
+    if (const auto loads = pending_loads.find(file); loads != pending_loads.end())
+        loads->second.generation++;
+    if (!file_blocks.contains(file))
+        return;
+
+    for (auto block = blocks.begin(); block != blocks.end();) {
+        const auto next = std::next(block);
+        if (block->key.file == file)
+            erase(block);
+        block = next;
+    }
+}
+
+void BlockCache::flush() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (auto &[file, loads] : pending_loads)
+        loads.generation++;
+    blocks.clear();
+    block_map.clear();
+    file_blocks.clear();
+    used = 0;
+}
+
+BlockCacheStats BlockCache::get_stats() const {
+    return { hits.load(), misses.load(), prefetched.load() };
+}
@@ -15,6 +15,7 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <io/archive.h>
 #include <io/device.h>
 #include <io/functions.h>
 #include <io/io.h>
@@ -36,9 +37,11 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <string>
 
 #if defined(__aarch64__) && defined(__APPLE__)
@@ -62,9 +65,102 @@ constexpr bool log_file_read = false;
 constexpr bool log_file_seek = false;
 constexpr bool log_file_stat = false;
 
+// How far sequential reads of the cached files are read ahead
+constexpr SceOff PREFETCH_SIZE = 4 * BlockCache::BLOCK_SIZE;
+// Only run once the I/O threads have nothing else to do
+constexpr int PREFETCH_PRIORITY = std::numeric_limits<int>::max();
+
+// The file maps are also used by the asynchronous I/O threads. The elements of a std::map stay in place
+// when other ones are added or removed, so the lock is only held to look them up. The functions using an
+// opened file lock it in io.async first, so it is not used by a request or closed meanwhile.
+static const FileStats *find_std_file(const IOState &io, const SceUID fd) {
+    const std::lock_guard<std::mutex> lock(io.files_mutex);
+    const auto file = io.std_files.find(fd);
+    return file == io.std_files.end() ? nullptr : &file->second;
+}
+
+static const DirStats *find_dir_entry(const IOState &io, const SceUID fd) {
+    const std::lock_guard<std::mutex> lock(io.files_mutex);
+    const auto dir = io.dir_entries.find(fd);
+    return dir == io.dir_entries.end() ? nullptr : &dir->second;
+}
+
+static bool find_tty_file(const IOState &io, const SceUID fd, TtyType &type) {
+    const std::lock_guard<std::mutex> lock(io.files_mutex);
+    const auto tty_file = io.tty_files.find(fd);
+    if (tty_file == io.tty_files.end())
+        return false;
+
+    type = tty_file->second;
+    return true;
+}
+
+static uint32_t prefetch_blocks(IOState &io, const fs::path &path, const SceOff offset, const SceOff size) {
+    // the guest may use the file pointer meanwhile
+    fs::ifstream stream(path, std::ios::binary);
+    return io.block_cache.prefetch(path.string(), offset, size, [&stream](uint64_t block_offset, void *data, size_t block_size) -> size_t {
+        stream.clear();
+        stream.seekg(block_offset);
+        stream.read(static_cast<char *>(data), block_size);
+        return stream.gcount();
+    });
+}
+
+static void prefetch_file(IOState &io, const fs::path &path, const SceOff offset, const SceOff size) {
+    io.async.submit_background(PREFETCH_PRIORITY, [&io, path, offset, size]() -> SceInt64 {
+        return prefetch_blocks(io, path, offset, size);
+    });
+}
+
+static SceOff read_cached_file(IOState &io, const FileStats &file, void *data, const SceSize size) {
+    const SceOff pos = file.tell();
+    if (pos < 0)
+        return pos;
+
+    const SceOff read = io.block_cache.read(file.get_system_location().string(), pos, data, size, [&file](uint64_t offset, void *block, size_t block_size) -> size_t {
+        if (!file.seek(offset, SCE_SEEK_SET))
+            return 0;
+        return std::max<SceOff>(file.read(block, 1, block_size), 0);
+    });
+    const SceOff end = pos + read;
+    file.seek(end, SCE_SEEK_SET);
+
+    // keep the blocks after a sequential read loaded ahead, without waiting for the last ones to be read
+    const bool sequential = pos == file.last_read_end;
+    file.last_read_end = end;
+    if (sequential && read == size && end + PREFETCH_SIZE / 2 > file.prefetch_end) {
+        const SceOff prefetch_begin = std::max(end, file.prefetch_end);
+        file.prefetch_end = end + PREFETCH_SIZE;
+        prefetch_file(io, file.get_system_location(), prefetch_begin, file.prefetch_end - prefetch_begin);
+    }
+
+    return read;
+}
+
+// The mounted archive serving a translated path, with the path inside it
+static std::shared_ptr<MountedArchive> find_archive(const VitaIoDevice device, const std::string &translated_path, std::string &archive_path) {
+    if (device != VitaIoDevice::ux0)
+        return nullptr;
+
+    return vfs::find_ux0_archive(translated_path, archive_path);
+}
+
+// defined after stat_file, which undefines the st_*time macros of sys/stat.h
+static void stat_archive_entry(const MountedArchive::Entry &entry, SceIoStat *statp);
+
 namespace vfs {
 
 bool read_file(const VitaIoDevice device, FileBuffer &buf, const fs::path &pref_path, const fs::path &vfs_file_path) {
+    std::string archive_path;
+    if (const auto archive = find_archive(device, vfs_file_path.generic_string(), archive_path)) {
+        const MountedArchive::Entry *entry = archive->find(archive_path);
+        if (!entry || entry->directory)
+            return false;
+
+        buf.resize(entry->size);
+        return archive->read(*entry, 0, buf.data(), entry->size) == entry->size;
+    }
+
     const auto host_file_path = device::construct_emulated_path(device, vfs_file_path, pref_path).generic_path();
 
     fs::ifstream f{ host_file_path, fs::ifstream::binary };
@@ -300,6 +396,7 @@ SceUID open_file(IOState &io, const char *path, const int flags, const fs::path
         if (flags & SCE_O_WRONLY)
             tty_type |= TTY_OUT;
 
+        const std::lock_guard<std::mutex> lock(io.files_mutex);
         const auto fd = io.next_fd++;
         io.tty_files.emplace(fd, tty_type);
 
@@ -313,6 +410,30 @@ SceUID open_file(IOState &io, const char *path, const int flags, const fs::path
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
 
+    std::string archive_path;
+    if (const auto archive = find_archive(device, translated_path, archive_path)) {
+        if (can_write(flags) || (flags & SCE_O_TRUNC)) {
+            LOG_ERROR("Cannot write to file of mounted archive: {}", path);
+            return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+        }
+
+        const MountedArchive::Entry *entry = archive->find(archive_path);
+        if (!entry || entry->directory) {
+            LOG_ERROR("Missing file {} in archive {} (target path: {})", archive_path, archive->get_path(), path);
+            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+        }
+
+        const auto normalized_path = device::construct_normalized_path(device, translated_path);
+        FileStats f{ path, normalized_path, archive->get_path() / archive_path, archive, entry };
+        std::unique_lock<std::mutex> lock(io.files_mutex);
+        const auto fd = io.next_fd++;
+        io.std_files.emplace(fd, f);
+        lock.unlock();
+
+        LOG_TRACE_IF(log_file_op, "{}: Opening file {} ({}) from archive, fd: {}", export_name, path, normalized_path, log_hex(fd));
+        return fd;
+    }
+
     auto system_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
     if (fs::is_directory(system_path)) {
         LOG_ERROR("Cannot open directory: {}", system_path);
@@ -352,10 +473,14 @@ SceUID open_file(IOState &io, const char *path, const int flags, const fs::path
     }
 
     const auto normalized_path = device::construct_normalized_path(device, translated_path);
+    if (can_write(flags))
+        io.block_cache.flush(system_path.string());
 
     FileStats f{ path, normalized_path, system_path, flags };
+    std::unique_lock<std::mutex> lock(io.files_mutex);
     const auto fd = io.next_fd++;
     io.std_files.emplace(fd, f);
+    lock.unlock();
 
     LOG_TRACE_IF(log_file_op, "{}: Opening file {} ({}), fd: {}", export_name, path, normalized_path, log_hex(fd));
     return fd;
@@ -365,16 +490,16 @@ int read_file(void *data, IOState &io, const SceUID fd, const SceSize size, cons
     assert(data != nullptr);
     assert(size >= 0);
 
-    const auto file = io.std_files.find(fd);
-    if (file != io.std_files.end()) {
-        const auto read = file->second.read(data, 1, size);
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    if (const FileStats *file = find_std_file(io, fd)) {
+        const auto read = file->is_cached() ? read_cached_file(io, *file, data, size) : file->read(data, 1, size);
         LOG_TRACE_IF(log_file_op && log_file_read, "{}: Reading {} bytes of fd {}", export_name, read, log_hex(fd));
         return static_cast<int>(read);
     }
 
-    const auto tty_file = io.tty_files.find(fd);
-    if (tty_file != io.tty_files.end()) {
-        if (tty_file->second == TTY_IN) {
+    TtyType tty_type;
+    if (find_tty_file(io, fd, tty_type)) {
+        if (tty_type == TTY_IN) {
             std::cin.read(static_cast<char *>(data), size);
             LOG_TRACE_IF(log_file_op && log_file_read, "{}: Reading terminal fd: {}, size: {}", export_name, log_hex(fd), size);
             return size;
@@ -394,9 +519,9 @@ int write_file(SceUID fd, const void *data, const SceSize size, const IOState &i
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
     }
 
-    const auto tty_file = io.tty_files.find(fd);
-    if (tty_file != io.tty_files.end()) {
-        if (tty_file->second & TTY_OUT) {
+    TtyType tty_type;
+    if (find_tty_file(io, fd, tty_type)) {
+        if (tty_type & TTY_OUT) {
             std::string s(static_cast<char const *>(data), size);
 
             // trim newline
@@ -413,16 +538,22 @@ int write_file(SceUID fd, const void *data, const SceSize size, const IOState &i
         return IO_ERROR_UNK();
     }
 
-    const auto file = io.std_files.find(fd);
-    if (file == io.std_files.end())
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *file = find_std_file(io, fd);
+    if (!file)
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
-    if (!fs::is_directory(file->second.get_system_location().parent_path())) {
+    // the files of a mounted archive are read only
+    if (file->get_archive_entry())
+        return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+
+    if (!fs::is_directory(file->get_system_location().parent_path())) {
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT); // TODO: Is it the right error code?
     }
 
-    if (file->second.can_write_file()) {
-        const auto written = file->second.write(data, 1, size);
+    if (file->can_write_file()) {
+        io.block_cache.flush(file->get_system_location().string());
+        const auto written = file->write(data, 1, size);
         LOG_TRACE_IF(log_file_op, "{}: Writing to fd: {}, size: {}", export_name, log_hex(fd), size);
         return static_cast<int>(written);
     }
@@ -434,10 +565,14 @@ int truncate_file(const SceUID fd, unsigned long long length, const IOState &io,
     if (fd < 0)
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
-    const auto file = io.std_files.find(fd);
-    if (file == io.std_files.end())
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *file = find_std_file(io, fd);
+    if (!file)
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
-    auto trunc = file->second.truncate(length);
+    if (file->get_archive_entry())
+        return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+    io.block_cache.flush(file->get_system_location().string());
+    auto trunc = file->truncate(length);
     LOG_TRACE_IF(log_file_op, "{}: Truncating fd: {}, to size: {}", export_name, log_hex(fd), length);
     return trunc;
 }
@@ -449,10 +584,11 @@ SceOff seek_file(const SceUID fd, const SceOff offset, const SceIoSeekMode whenc
     if (fd < 0)
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
-    const auto file = io.std_files.find(fd);
-    if (file == io.std_files.end())
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *file = find_std_file(io, fd);
+    if (!file)
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
-    if (!file->second.seek(offset, whence))
+    if (!file->seek(offset, whence))
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
     const auto log_mode = [](const SceIoSeekMode whence) -> const char * {
@@ -466,20 +602,52 @@ SceOff seek_file(const SceUID fd, const SceOff offset, const SceIoSeekMode whenc
     };
 
     LOG_TRACE_IF(log_file_op && log_file_seek, "{}: Seeking fd: {}, offset: {}, whence: {}", export_name, log_hex(fd), log_hex(offset), log_mode(whence));
-    return file->second.tell();
+    return file->tell();
 }
 
 SceOff tell_file(IOState &io, const SceUID fd, const char *export_name) {
     if (fd < 0)
         return IO_ERROR(SCE_ERROR_ERRNO_EMFILE);
 
-    const auto std_file = io.std_files.find(fd);
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *std_file = find_std_file(io, fd);
 
-    if (std_file == io.std_files.end()) {
+    if (!std_file) {
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
     }
 
-    return std_file->second.tell();
+    return std_file->tell();
+}
+
+int read_file_at(void *data, IOState &io, const SceUID fd, const SceSize size, const SceOff offset, const char *export_name) {
+    // the file is locked until the position is restored, so no other operation sees the offset
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const SceOff pos = tell_file(io, fd, export_name);
+    if (pos < 0)
+        return static_cast<int>(pos);
+
+    const SceOff seek = seek_file(fd, offset, SCE_SEEK_SET, io, export_name);
+    if (seek < 0)
+        return static_cast<int>(seek);
+
+    const int read = read_file(data, io, fd, size, export_name);
+    seek_file(fd, pos, SCE_SEEK_SET, io, export_name);
+    return read;
+}
+
+int write_file_at(SceUID fd, const void *data, const SceSize size, const SceOff offset, IOState &io, const char *export_name) {
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const SceOff pos = tell_file(io, fd, export_name);
+    if (pos < 0)
+        return static_cast<int>(pos);
+
+    const SceOff seek = seek_file(fd, offset, SCE_SEEK_SET, io, export_name);
+    if (seek < 0)
+        return static_cast<int>(seek);
+
+    const int written = write_file(fd, data, size, io, export_name);
+    seek_file(fd, pos, SCE_SEEK_SET, io, export_name);
+    return written;
 }
 
 int stat_file(IOState &io, const char *file, SceIoStat *statp, const fs::path &pref_path, const char *export_name, const SceUID fd) {
@@ -497,6 +665,19 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const fs::path &p
         }
 
         const auto translated_path = translate_path(file, device, io.device_paths);
+        std::string archive_path;
+        if (const auto archive = find_archive(device, translated_path, archive_path)) {
+            const MountedArchive::Entry *entry = archive->find(archive_path);
+            if (!entry) {
+                LOG_ERROR("Missing file {} in archive {} (target path: {})", archive_path, archive->get_path(), file);
+                return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+            }
+
+            LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting file: {} ({}) from archive", export_name, file, device::construct_normalized_path(device, translated_path));
+            stat_archive_entry(*entry, statp);
+            return 0;
+        }
+
         file_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
 
         if (!fs::exists(file_path)) {
@@ -524,14 +705,20 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const fs::path &p
         }
         LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting file: {} ({})", export_name, file, device::construct_normalized_path(device, translated_path));
     } else { // We have previously opened and defined the location
-        const auto fd_file = io.std_files.find(fd);
-        if (fd_file == io.std_files.end())
+        const AsyncIo::FileLock file_lock(io.async, fd);
+        const FileStats *fd_file = find_std_file(io, fd);
+        if (!fd_file)
             return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
-        file_path = fd_file->second.get_system_location();
         LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting fd: {}", export_name, log_hex(fd));
+        if (const MountedArchive::Entry *entry = fd_file->get_archive_entry()) {
+            stat_archive_entry(*entry, statp);
+            return 0;
+        }
+
+        file_path = fd_file->get_system_location();
 
-        statp->st_attr = fd_file->second.get_file_mode();
+        statp->st_attr = fd_file->get_file_mode();
     }
 
     std::uint64_t last_access_time_ticks;
@@ -577,16 +764,34 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const fs::path &p
     return 0;
 }
 
+static void stat_archive_entry(const MountedArchive::Entry &entry, SceIoStat *statp) {
+    statp->st_mode = SCE_S_IRUSR | SCE_S_IRGRP | SCE_S_IROTH | SCE_S_IXUSR | SCE_S_IXGRP | SCE_S_IXOTH;
+    if (entry.directory) {
+        statp->st_attr = SCE_SO_IFDIR;
+        statp->st_mode |= SCE_S_IFDIR;
+    } else {
+        statp->st_size = entry.size;
+        statp->st_attr = SCE_SO_IFREG;
+        statp->st_mode |= SCE_S_IFREG;
+    }
+
+    const uint64_t time_ticks = static_cast<uint64_t>(entry.time) * VITA_CLOCKS_PER_SEC;
+    __RtcTicksToPspTime(&statp->st_atime, time_ticks);
+    __RtcTicksToPspTime(&statp->st_mtime, time_ticks);
+    __RtcTicksToPspTime(&statp->st_ctime, time_ticks);
+}
+
 int stat_file_by_fd(IOState &io, const SceUID fd, SceIoStat *statp, const fs::path &pref_path, const char *export_name) {
     assert(statp != nullptr);
     memset(statp, '\0', sizeof(SceIoStat));
 
-    const auto std_file = io.std_files.find(fd);
-    if (std_file == io.std_files.end()) {
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *std_file = find_std_file(io, fd);
+    if (!std_file) {
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
     }
 
-    return stat_file(io, std_file->second.get_vita_loc(), statp, pref_path, export_name, fd);
+    return stat_file(io, std_file->get_vita_loc(), statp, pref_path, export_name, fd);
 }
 
 int close_file(IOState &io, const SceUID fd, const char *export_name) {
@@ -595,6 +800,9 @@ int close_file(IOState &io, const SceUID fd, const char *export_name) {
 
     LOG_TRACE_IF(log_file_op, "{}: Closing file fd: {}", export_name, log_hex(fd));
 
+    // the requests already submitted on the file still use it
+    const AsyncIo::FileLock file_lock(io.async, fd, true);
+    const std::lock_guard<std::mutex> lock(io.files_mutex);
     io.tty_files.erase(fd);
     io.std_files.erase(fd);
 
@@ -614,6 +822,12 @@ int remove_file(IOState &io, const char *file, const fs::path &pref_path, const
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
 
+    std::string archive_path;
+    if (find_archive(device, translated_path, archive_path)) {
+        LOG_ERROR("Cannot remove file of mounted archive: {}", file);
+        return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+    }
+
     const auto emulated_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
     if (!fs::exists(emulated_path) || fs::is_directory(emulated_path)) {
         LOG_ERROR("File does not exist at path: {} (target path: {})", emulated_path, file);
@@ -621,6 +835,7 @@ int remove_file(IOState &io, const char *file, const fs::path &pref_path, const
 
     LOG_TRACE_IF(log_file_op, "{}: Removing file {} ({})", export_name, file, device::construct_normalized_path(device, translated_path));
 
+    io.block_cache.flush(emulated_path.string());
     boost::system::error_code error_code{};
     auto res = fs::detail::remove(emulated_path, &error_code);
 
@@ -652,6 +867,12 @@ int rename(IOState &io, const char *old_name, const char *new_name, const fs::pa
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
 
+    std::string archive_path;
+    if (find_archive(device, translated_old_path, archive_path) || find_archive(device, translated_new_path, archive_path)) {
+        LOG_ERROR("Cannot rename file of mounted archive: {} to {}", old_name, new_name);
+        return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+    }
+
     const auto emulated_old_path = device::construct_emulated_path(device, translated_old_path, pref_path, io.redirect_stdio);
     if (!fs::exists(emulated_old_path)) {
         LOG_ERROR("File does not exist at path: {} (target path: {})", emulated_old_path, old_name);
@@ -662,6 +883,10 @@ int rename(IOState &io, const char *old_name, const char *new_name, const fs::pa
 
     LOG_TRACE_IF(log_file_op, "{}: Renaming file {} to {} ({} to {})", export_name, old_name, new_name, emulated_old_path, emulated_new_path);
 
+    io.block_cache.flush(emulated_old_path.string());
+    io.block_cache.flush(emulated_new_path.string());
+    io.block_cache.flush_directory(emulated_old_path.string());
+    io.block_cache.flush_directory(emulated_new_path.string());
     boost::system::error_code error_code{};
     fs::rename(emulated_old_path, emulated_new_path, error_code);
 
@@ -679,6 +904,25 @@ SceUID open_dir(IOState &io, const char *path, const fs::path &pref_path, const
     auto device_for_icase = device;
     const auto translated_path = translate_path(path, device, io.device_paths);
 
+    std::string archive_path;
+    if (const auto archive = find_archive(device, translated_path, archive_path)) {
+        const MountedArchive::Entry *entry = archive->find(archive_path);
+        if (!entry || !entry->directory) {
+            LOG_ERROR("Directory {} does not exist in archive {} (target path: {})", archive_path, archive->get_path(), path);
+            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+        }
+
+        const auto normalized = device::construct_normalized_path(device, translated_path);
+        const DirStats d{ path, normalized, archive->get_path() / archive_path, archive, entry };
+        std::unique_lock<std::mutex> lock(io.files_mutex);
+        const auto fd = io.next_fd++;
+        io.dir_entries.emplace(fd, d);
+        lock.unlock();
+
+        LOG_TRACE_IF(log_file_op, "{}: Opening dir {} ({}) from archive, fd: {}", export_name, path, normalized, log_hex(fd));
+        return fd;
+    }
+
     auto dir_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio) / "";
     if (!fs::exists(dir_path)) {
         if (io.case_isens_find_enabled) {
@@ -712,8 +956,10 @@ SceUID open_dir(IOState &io, const char *path, const fs::path &pref_path, const
 
     const auto normalized = device::construct_normalized_path(device, translated_path);
     const DirStats d{ path, normalized, dir_path, opened };
+    std::unique_lock<std::mutex> lock(io.files_mutex);
     const auto fd = io.next_fd++;
     io.dir_entries.emplace(fd, d);
+    lock.unlock();
 
     LOG_TRACE_IF(log_file_op, "{}: Opening dir {} ({}), fd: {}", export_name, path, normalized, log_hex(fd));
 
@@ -725,23 +971,35 @@ SceUID read_dir(IOState &io, const SceUID fd, SceIoDirent *dent, const fs::path
 
     memset(dent->d_name, '\0', sizeof(dent->d_name));
 
-    const auto dir = io.dir_entries.find(fd);
-
-    if (dir != io.dir_entries.end()) {
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    if (const DirStats *dir = find_dir_entry(io, fd)) {
         // Refuse any fd that is not explicitly a directory
-        if (!dir->second.is_directory())
+        if (!dir->is_directory())
             return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
-        const auto d = dir->second.get_dir_ptr();
+        if (dir->get_archive_entry()) {
+            std::string name;
+            if (!dir->next_archive_child(name))
+                return 0;
+
+            strncpy(dent->d_name, name.c_str(), sizeof(dent->d_name));
+            const auto file_path = std::string(dir->get_vita_loc()) + '/' + name;
+            LOG_TRACE_IF(log_file_op, "{}: Reading entry {} of fd: {}", export_name, file_path, log_hex(fd));
+            if (stat_file(io, file_path.c_str(), &dent->d_stat, pref_path, export_name) < 0)
+                return IO_ERROR(SCE_ERROR_ERRNO_EMFILE);
+            return 1;
+        }
+
+        const auto d = dir->get_dir_ptr();
         if (!d)
             return 0;
 
         const auto d_name_utf8 = get_file_in_dir(d);
         strncpy(dent->d_name, d_name_utf8.c_str(), sizeof(dent->d_name));
 
-        const auto cur_path = dir->second.get_system_location() / d_name_utf8;
+        const auto cur_path = dir->get_system_location() / d_name_utf8;
         if (!(cur_path.filename_is_dot() || cur_path.filename_is_dot_dot())) {
-            const auto file_path = std::string(dir->second.get_vita_loc()) + '/' + d_name_utf8;
+            const auto file_path = std::string(dir->get_vita_loc()) + '/' + d_name_utf8;
 
             LOG_TRACE_IF(log_file_op, "{}: Reading entry {} of fd: {}", export_name, file_path, log_hex(fd));
             if (stat_file(io, file_path.c_str(), &dent->d_stat, pref_path, export_name) < 0)
@@ -800,6 +1058,12 @@ int create_dir(IOState &io, const char *dir, int mode, const fs::path &pref_path
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
 
+    std::string archive_path;
+    if (find_archive(device, translated_path, archive_path)) {
+        LOG_ERROR("Cannot create directory in mounted archive: {}", dir);
+        return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+    }
+
     const auto emulated_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
     if (recursive)
         return fs::create_directories(emulated_path);
@@ -824,7 +1088,10 @@ int close_dir(IOState &io, const SceUID fd, const char *export_name) {
     if (fd < 0)
         return IO_ERROR(SCE_ERROR_ERRNO_EMFILE);
 
+    const AsyncIo::FileLock file_lock(io.async, fd, true);
+    std::unique_lock<std::mutex> lock(io.files_mutex);
     const auto erased_entries = io.dir_entries.erase(fd);
+    lock.unlock();
 
     LOG_TRACE_IF(log_file_op, "{}: Closing dir fd: {}", export_name, log_hex(fd));
 
@@ -847,9 +1114,17 @@ int remove_dir(IOState &io, const char *dir, const fs::path &pref_path, const ch
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
 
+    std::string archive_path;
+    if (find_archive(device, translated_path, archive_path)) {
+        LOG_ERROR("Cannot remove directory of mounted archive: {}", dir);
+        return IO_ERROR(SCE_ERROR_ERRNO_EROFS);
+    }
+
     LOG_TRACE_IF(log_file_op, "{}: Removing dir {} ({})", export_name, dir, device::construct_normalized_path(device, translated_path));
 
-    if (!fs::remove_all(device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio))) {
+    const auto emulated_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+    io.block_cache.flush_directory(emulated_path.string());
+    if (!fs::remove_all(emulated_path)) {
         LOG_ERROR("Cannot remove dir: {} ({})", dir, device::construct_normalized_path(device, translated_path));
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
@@ -889,6 +1164,38 @@ SceUID create_overlay(IOState &io, SceFiosProcessOverlay *fios_overlay) {
     return res;
 }
 
+SceOff prefetch_cached_file(IOState &io, const SceUID fd, const SceOff offset, const SceOff size, const char *export_name) {
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *file = find_std_file(io, fd);
+    if (!file)
+        return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
+
+    // the files which can be written are not cached
+    if (!file->is_cached() || offset < 0 || size <= 0)
+        return 0;
+
+    return prefetch_blocks(io, file->get_system_location(), offset, size);
+}
+
+bool is_file_cached(IOState &io, const SceUID fd, const SceOff offset, const SceOff size) {
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *file = find_std_file(io, fd);
+    if (!file || !file->is_cached() || offset < 0 || size < 0)
+        return false;
+
+    return io.block_cache.contains(file->get_system_location().string(), offset, size);
+}
+
+int flush_cached_file(IOState &io, const SceUID fd, const char *export_name) {
+    const AsyncIo::FileLock file_lock(io.async, fd);
+    const FileStats *file = find_std_file(io, fd);
+    if (!file)
+        return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
+
+    io.block_cache.flush(file->get_system_location().string());
+    return 0;
+}
+
 std::string resolve_path(IOState &io, const char *input, const SceUInt32 min_order, const SceUInt32 max_order) {
     std::lock_guard<std::mutex> lock(io.overlay_mutex);
 
@@ -27,6 +27,12 @@
 #include <io/state.h>
 
 SceOff FileStats::read(void *input_data, const int element_size, const SceSize element_count) const {
+    if (archive_entry) {
+        const uint64_t read = archive->read(*archive_entry, archive_position, input_data, static_cast<uint64_t>(element_size) * element_count);
+        archive_position += read;
+        return read / element_size;
+    }
+
     if (!wrapped_file)
         return -1;
 
@@ -41,6 +47,9 @@ SceOff FileStats::write(const void *data, const SceSize size, const int count) c
 }
 
 int FileStats::truncate(const SceSize size) const {
+    if (archive_entry)
+        return -1;
+
 #ifdef _WIN32
     return _chsize_s(_fileno(get_file_pointer()), size);
 #else
@@ -49,6 +58,21 @@ int FileStats::truncate(const SceSize size) const {
 }
 
 bool FileStats::seek(const SceOff offset, const SceIoSeekMode seek_mode) const {
+    if (archive_entry) {
+        SceOff position = offset;
+        if (seek_mode == SCE_SEEK_CUR)
+            position += archive_position;
+        else if (seek_mode == SCE_SEEK_END)
+            position += archive_entry->size;
+        else if (seek_mode != SCE_SEEK_SET)
+            return false;
+        if (position < 0)
+            return false;
+
+        archive_position = position;
+        return true;
+    }
+
     if (!wrapped_file)
         return false;
 
@@ -75,6 +99,9 @@ bool FileStats::seek(const SceOff offset, const SceIoSeekMode seek_mode) const {
 }
 
 SceOff FileStats::tell() const {
+    if (archive_entry)
+        return archive_position;
+
     if (!wrapped_file)
         return -1;
 
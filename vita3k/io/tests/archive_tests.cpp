@@ -0,0 +1,146 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/archive.h>
+#include <io/functions.h>
+#include <io/io.h>
+#include <io/state.h>
+#include <io/vfs.h>
+#include <testutil/files.h>
+
+#include <gtest/gtest.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr const char *APP_PATH = "PCSG00001";
+
+struct io_archive : public testutil::TempDirTest {
+    fs::path archive_path;
+    const std::vector<uint8_t> eboot = testutil::make_data(300 * 1024 + 5, 1);
+    const std::vector<uint8_t> level = testutil::make_data(2 * 1024 * 1024 + 333, 2);
+
+    void SetUp() override {
+        TempDirTest::SetUp();
+        archive_path = path / "content.vpk";
+
+        // the content is in a directory of the archive, like in the ones holding several contents
+        mz_zip_archive zip{};
+        ASSERT_TRUE(mz_zip_writer_init_file(&zip, archive_path.string().c_str(), 0));
+        ASSERT_TRUE(mz_zip_writer_add_mem(&zip, "PCSG00001/eboot.bin", eboot.data(), eboot.size(), MZ_NO_COMPRESSION));
+        ASSERT_TRUE(mz_zip_writer_add_mem(&zip, "PCSG00001/Data/Level.dat", level.data(), level.size(), MZ_BEST_SPEED));
+        ASSERT_TRUE(mz_zip_writer_add_mem(&zip, "PCSG00001/Data/Empty/", nullptr, 0, 0));
+        ASSERT_TRUE(mz_zip_writer_add_mem(&zip, "other/eboot.bin", eboot.data(), 100, MZ_NO_COMPRESSION));
+        ASSERT_TRUE(mz_zip_writer_finalize_archive(&zip));
+        ASSERT_TRUE(mz_zip_writer_end(&zip));
+    }
+
+    void TearDown() override {
+        vfs::unmount_app_archive(APP_PATH);
+        TempDirTest::TearDown();
+    }
+
+    static void expect_range(MountedArchive &archive, const MountedArchive::Entry &entry, const std::vector<uint8_t> &data, uint64_t offset, uint64_t size) {
+        std::vector<uint8_t> read(size);
+        const uint64_t expected = std::min<uint64_t>(size, data.size() - std::min<uint64_t>(offset, data.size()));
+        ASSERT_EQ(archive.read(entry, offset, read.data(), size), expected) << offset;
+        EXPECT_TRUE(std::equal(read.begin(), read.begin() + expected, data.begin() + offset)) << offset;
+    }
+};
+
+} // namespace
+
+TEST_F(io_archive, reads_entries) {
+    MountedArchive archive;
+    ASSERT_TRUE(archive.open(archive_path, "PCSG00001/"));
+
+    const MountedArchive::Entry *eboot_entry = archive.find("eboot.bin");
+    const MountedArchive::Entry *level_entry = archive.find("data/LEVEL.DAT");
+    ASSERT_TRUE(eboot_entry && level_entry);
+    EXPECT_FALSE(eboot_entry->deflated);
+    EXPECT_TRUE(level_entry->deflated);
+    EXPECT_EQ(level_entry->size, level.size());
+    EXPECT_EQ(archive.find("other/eboot.bin"), nullptr);
+
+    expect_range(archive, *eboot_entry, eboot, 0, eboot.size());
+    expect_range(archive, *level_entry, level, 0, level.size());
+
+    // going back starts the stream over, going forward goes on from the last read
+    std::mt19937 random(3);
+    for (int i = 0; i < 50; i++) {
+        const uint64_t offset = random() % (level.size() + 100);
+        expect_range(archive, *level_entry, level, offset, random() % 200000);
+    }
+    expect_range(archive, *level_entry, level, level.size(), 10);
+
+    // directories are listed, including the ones without an entry in the archive
+    const MountedArchive::Entry *root = archive.find("");
+    ASSERT_TRUE(root && root->directory);
+    EXPECT_EQ(root->children, (std::vector<std::string>{ "eboot.bin", "Data" }));
+    const MountedArchive::Entry *data_dir = archive.find("Data/");
+    ASSERT_TRUE(data_dir && data_dir->directory);
+    EXPECT_EQ(data_dir->children, (std::vector<std::string>{ "Level.dat", "Empty" }));
+    EXPECT_TRUE(archive.find("data/empty")->children.empty());
+}
+
+TEST_F(io_archive, serves_app0) {
+    ASSERT_TRUE(vfs::mount_app_archive(APP_PATH, archive_path, "PCSG00001/"));
+
+    IOState io;
+    io.app_path = APP_PATH;
+    init_device_paths(io);
+    const fs::path pref_path = fs::temp_directory_path();
+
+    const SceUID fd = open_file(io, "app0:data/level.dat", SCE_O_RDONLY, pref_path, "test");
+    ASSERT_GE(fd, 0);
+    std::vector<uint8_t> read(1000);
+    ASSERT_EQ(seek_file(fd, -1000, SCE_SEEK_END, io, "test"), level.size() - 1000);
+    ASSERT_EQ(read_file(read.data(), io, fd, 2000, "test"), 1000);
+    EXPECT_TRUE(std::equal(read.begin(), read.end(), level.end() - 1000));
+    EXPECT_EQ(tell_file(io, fd, "test"), level.size());
+    EXPECT_EQ(write_file(fd, read.data(), 10, io, "test"), SCE_ERROR_ERRNO_EROFS);
+    EXPECT_EQ(truncate_file(fd, 10, io, "test"), SCE_ERROR_ERRNO_EROFS);
+
+    SceIoStat stat;
+    ASSERT_EQ(stat_file_by_fd(io, fd, &stat, pref_path, "test"), 0);
+    EXPECT_EQ(stat.st_size, level.size());
+    EXPECT_TRUE(stat.st_mode & SCE_S_IFREG);
+    close_file(io, fd, "test");
+
+    EXPECT_EQ(open_file(io, "app0:data/save.dat", SCE_O_WRONLY | SCE_O_CREAT, pref_path, "test"), SCE_ERROR_ERRNO_EROFS);
+    EXPECT_EQ(open_file(io, "app0:missing.bin", SCE_O_RDONLY, pref_path, "test"), SCE_ERROR_ERRNO_ENOENT);
+    EXPECT_EQ(remove_file(io, "app0:eboot.bin", pref_path, "test"), SCE_ERROR_ERRNO_EROFS);
+
+    const SceUID dir = open_dir(io, "app0:data", pref_path, "test");
+    ASSERT_GE(dir, 0);
+    std::vector<std::string> names;
+    SceIoDirent dent;
+    while (read_dir(io, dir, &dent, pref_path, "test") > 0) {
+        names.push_back(dent.d_name);
+        EXPECT_EQ(static_cast<bool>(dent.d_stat.st_mode & SCE_S_IFDIR), names.back() == "Empty");
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{ "Level.dat", "Empty" }));
+    close_dir(io, dir, "test");
+
+    vfs::FileBuffer eboot_buffer;
+    ASSERT_TRUE(vfs::read_app_file(eboot_buffer, pref_path, APP_PATH, "eboot.bin"));
+    EXPECT_EQ(eboot_buffer, eboot);
+}
@@ -0,0 +1,211 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/async.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Keeps the I/O threads busy until released, so the next requests stay waiting
+struct Blocker {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    AsyncIo::Operation operation() {
+        return [future = released]() -> SceInt64 {
+            future.wait();
+            return 0;
+        };
+    }
+};
+
+// Records the order in which the operations run
+struct Recorder {
+    std::mutex mutex;
+    std::vector<SceUID> order;
+
+    AsyncIo::Operation operation(SceUID id) {
+        return [this, id]() -> SceInt64 {
+            const std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+            return id * 10;
+        };
+    }
+};
+
+const AsyncIo::Completion ignore_completion = [](SceInt64) {};
+
+} // namespace
+
+TEST(io_async, runs_by_priority) {
+    AsyncIo async(1);
+    Blocker blocker;
+    Recorder recorder;
+    async.submit(1, -1, SCE_IO_DEFAULT_PRIORITY, blocker.operation(), ignore_completion);
+    async.submit(2, -1, 20, recorder.operation(2), ignore_completion);
+    async.submit(3, -1, 8, recorder.operation(3), ignore_completion);
+    async.submit(4, -1, 20, recorder.operation(4), ignore_completion);
+    async.submit(5, -1, 1, recorder.operation(5), ignore_completion);
+    EXPECT_EQ(async.queue_depth(), 5);
+
+    blocker.release.set_value();
+    async.wait_idle();
+    EXPECT_EQ(recorder.order, (std::vector<SceUID>{ 5, 3, 2, 4 }));
+    EXPECT_EQ(async.queue_depth(), 0);
+}
+
+TEST(io_async, keeps_file_order) {
+    AsyncIo async(4);
+    Blocker blocker;
+    Recorder recorder;
+    std::promise<void> other_file_done;
+    async.submit(1, 7, SCE_IO_DEFAULT_PRIORITY, blocker.operation(), ignore_completion);
+    // a more urgent request on the same file must still wait for the earlier ones
+    async.submit(2, 7, 20, recorder.operation(2), ignore_completion);
+    async.submit(3, 7, 1, recorder.operation(3), ignore_completion);
+    // other files are not held back
+    async.submit(4, 8, 20, recorder.operation(4), [&](SceInt64) { other_file_done.set_value(); });
+
+    other_file_done.get_future().wait();
+    EXPECT_EQ(async.queue_depth(), 3);
+
+    blocker.release.set_value();
+    async.wait_idle();
+    EXPECT_EQ(recorder.order, (std::vector<SceUID>{ 4, 2, 3 }));
+}
+
+TEST(io_async, cancels_waiting_requests) {
+    AsyncIo async(1);
+    Blocker blocker;
+    Recorder recorder;
+    SceInt64 cancelled_result = 0;
+    async.submit(1, -1, SCE_IO_DEFAULT_PRIORITY, blocker.operation(), ignore_completion);
+    async.submit(2, -1, SCE_IO_DEFAULT_PRIORITY, recorder.operation(2), [&](SceInt64 result) { cancelled_result = result; });
+    async.submit(3, -1, SCE_IO_DEFAULT_PRIORITY, recorder.operation(3), ignore_completion);
+
+    EXPECT_TRUE(async.cancel(2, -5));
+    EXPECT_EQ(cancelled_result, -5);
+    EXPECT_FALSE(async.cancel(2, -5));
+    EXPECT_EQ(async.queue_depth(), 2);
+
+    blocker.release.set_value();
+    async.wait_idle();
+    EXPECT_EQ(recorder.order, (std::vector<SceUID>{ 3 }));
+    // already done
+    EXPECT_FALSE(async.cancel(3, -5));
+
+    SceInt64 result = 0;
+    EXPECT_EQ(async.complete(2, result), AsyncIoStatus::Done);
+    EXPECT_EQ(result, -5);
+}
+
+TEST(io_async, completes_once) {
+    AsyncIo async(1);
+    Blocker blocker;
+    Recorder recorder;
+    std::promise<SceInt64> completed;
+    async.submit(1, 3, SCE_IO_DEFAULT_PRIORITY, blocker.operation(), ignore_completion);
+    async.submit(2, 3, SCE_IO_DEFAULT_PRIORITY, recorder.operation(2), [&](SceInt64 result) { completed.set_value(result); });
+
+    SceInt64 result = 0;
+    EXPECT_EQ(async.complete(2, result), AsyncIoStatus::Waiting);
+    EXPECT_EQ(async.complete(9, result), AsyncIoStatus::Unknown);
+
+    blocker.release.set_value();
+    // the state is done before the completion is called
+    EXPECT_EQ(completed.get_future().get(), 20);
+    EXPECT_EQ(async.complete(2, result), AsyncIoStatus::Done);
+    EXPECT_EQ(result, 20);
+    EXPECT_EQ(async.complete(2, result), AsyncIoStatus::Unknown);
+}
+
+TEST(io_async, file_lock_excludes_requests) {
+    AsyncIo async(2);
+    Blocker blocker;
+    Recorder recorder;
+    std::atomic<bool> locked = false;
+    async.submit(1, 5, SCE_IO_DEFAULT_PRIORITY, blocker.operation(), ignore_completion);
+
+    // waits for the running request on the file
+    auto guest = std::async(std::launch::async, [&]() {
+        const AsyncIo::FileLock lock(async, 5);
+        locked = true;
+        // the requests on the file wait for the lock, the lock can be taken again by its thread
+        async.submit(2, 5, SCE_IO_DEFAULT_PRIORITY, recorder.operation(2), ignore_completion);
+        const AsyncIo::FileLock nested_lock(async, 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const std::lock_guard<std::mutex> recorder_lock(recorder.mutex);
+        EXPECT_TRUE(recorder.order.empty());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(locked);
+
+    blocker.release.set_value();
+    guest.get();
+    async.wait_idle();
+    EXPECT_EQ(recorder.order, (std::vector<SceUID>{ 2 }));
+}
+
+TEST(io_async, file_lock_after_requests) {
+    AsyncIo async(1);
+    Blocker blocker;
+    Recorder recorder;
+    async.submit(1, 5, SCE_IO_DEFAULT_PRIORITY, blocker.operation(), ignore_completion);
+    async.submit(2, 5, SCE_IO_DEFAULT_PRIORITY, recorder.operation(2), ignore_completion);
+    // the requests can use the file they run on without waiting for themselves
+    async.submit(3, 5, SCE_IO_DEFAULT_PRIORITY, [&]() -> SceInt64 {
+        const AsyncIo::FileLock lock(async, 5, true);
+        return recorder.operation(3)();
+    },
+        ignore_completion);
+
+    blocker.release.set_value();
+    // like closing the file, the submitted requests run first
+    const AsyncIo::FileLock lock(async, 5, true);
+    const std::lock_guard<std::mutex> recorder_lock(recorder.mutex);
+    EXPECT_EQ(recorder.order, (std::vector<SceUID>{ 2, 3 }));
+}
+
+TEST(io_async, priorities) {
+    AsyncIo async;
+    EXPECT_EQ(async.get_priority(3, 100), SCE_IO_DEFAULT_PRIORITY);
+
+    async.set_process_default_priority(10);
+    EXPECT_EQ(async.get_priority(3, 100), 10);
+    EXPECT_EQ(async.get_thread_default_priority(100), 10);
+
+    async.set_thread_default_priority(100, 12);
+    EXPECT_EQ(async.get_priority(3, 100), 12);
+    EXPECT_EQ(async.get_priority(3, 101), 10);
+
+    int priority = 0;
+    EXPECT_FALSE(async.get_file_priority(3, priority));
+    async.set_file_priority(3, 4);
+    EXPECT_TRUE(async.get_file_priority(3, priority));
+    EXPECT_EQ(priority, 4);
+    EXPECT_EQ(async.get_priority(3, 100), 4);
+
+    async.forget_file(3);
+    EXPECT_EQ(async.get_priority(3, 100), 12);
+}
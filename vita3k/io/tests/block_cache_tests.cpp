@@ -0,0 +1,178 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/block_cache.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// File in memory which counts the reads done on it
+struct TestFile {
+    std::vector<uint8_t> data;
+    uint32_t reads = 0;
+
+    explicit TestFile(size_t size)
+        : data(size) {
+        for (size_t i = 0; i < size; i++)
+            data[i] = static_cast<uint8_t>(i * 7 + i / 251);
+    }
+
+    BlockCache::Reader reader() {
+        return [this](uint64_t offset, void *dst, size_t size) -> size_t {
+            reads++;
+            if (offset >= data.size())
+                return 0;
+            const size_t count = std::min(size, data.size() - offset);
+            memcpy(dst, data.data() + offset, count);
+            return count;
+        };
+    }
+};
+
+constexpr uint32_t BLOCK = BlockCache::BLOCK_SIZE;
+
+} // namespace
+
+TEST(io_block_cache, reads_across_blocks) {
+    BlockCache cache;
+    TestFile file(3 * BLOCK + 100);
+    std::vector<uint8_t> buffer(2 * BLOCK);
+
+    // starts in the middle of the first block and ends in the third one
+    ASSERT_EQ(cache.read("file", BLOCK / 2, buffer.data(), buffer.size(), file.reader()), buffer.size());
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), file.data.begin() + BLOCK / 2));
+    EXPECT_EQ(file.reads, 3);
+
+    // the end of the file is short
+    ASSERT_EQ(cache.read("file", 3 * BLOCK - 10, buffer.data(), buffer.size(), file.reader()), 110);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.begin() + 110, file.data.begin() + 3 * BLOCK - 10));
+    EXPECT_EQ(cache.read("file", 4 * BLOCK, buffer.data(), 10, file.reader()), 0);
+
+    const BlockCacheStats stats = cache.get_stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 5);
+}
+
+TEST(io_block_cache, hits_do_not_read) {
+    BlockCache cache;
+    TestFile file(4 * BLOCK);
+    std::vector<uint8_t> buffer(4 * BLOCK);
+
+    ASSERT_EQ(cache.read("file", 0, buffer.data(), buffer.size(), file.reader()), buffer.size());
+    ASSERT_EQ(file.reads, 4);
+    ASSERT_EQ(cache.read("file", 100, buffer.data(), 3 * BLOCK, file.reader()), 3 * BLOCK);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.begin() + 3 * BLOCK, file.data.begin() + 100));
+    EXPECT_EQ(file.reads, 4);
+    EXPECT_TRUE(cache.contains("file", 0, 4 * BLOCK));
+    EXPECT_FALSE(cache.contains("other", 0, 1));
+}
+
+TEST(io_block_cache, drops_least_recently_used) {
+    BlockCache cache(2 * BLOCK);
+    TestFile file(4 * BLOCK);
+    uint8_t byte;
+
+    cache.read("file", 0, &byte, 1, file.reader());
+    cache.read("file", BLOCK, &byte, 1, file.reader());
+    // the first block is now the most recently used one
+    cache.read("file", 0, &byte, 1, file.reader());
+    cache.read("file", 2 * BLOCK, &byte, 1, file.reader());
+
+    EXPECT_TRUE(cache.contains("file", 0, 1));
+    EXPECT_FALSE(cache.contains("file", BLOCK, 1));
+    EXPECT_TRUE(cache.contains("file", 2 * BLOCK, 1));
+}
+
+TEST(io_block_cache, prefetch_and_flush) {
+    BlockCache cache;
+    TestFile file(3 * BLOCK);
+    TestFile other(BLOCK);
+    std::vector<uint8_t> buffer(BLOCK);
+
+    EXPECT_EQ(cache.prefetch("file", BLOCK, 10 * BLOCK, file.reader()), 3);
+    // already loaded
+    EXPECT_EQ(cache.prefetch("file", BLOCK, BLOCK, file.reader()), 0);
+    EXPECT_EQ(cache.get_stats().prefetched, 3);
+
+    const uint32_t reads = file.reads;
+    ASSERT_EQ(cache.read("file", 2 * BLOCK, buffer.data(), BLOCK, file.reader()), BLOCK);
+    EXPECT_EQ(file.reads, reads);
+    EXPECT_EQ(cache.get_stats().hits, 1);
+
+    cache.read("other", 0, buffer.data(), BLOCK, other.reader());
+    cache.flush("file");
+    EXPECT_FALSE(cache.contains("file", 2 * BLOCK, 1));
+    EXPECT_TRUE(cache.contains("other", 0, BLOCK));
+
+    // the data is read again once modified
+    file.data[2 * BLOCK] = ~file.data[2 * BLOCK];
+    ASSERT_EQ(cache.read("file", 2 * BLOCK, buffer.data(), 1, file.reader()), 1);
+    EXPECT_EQ(buffer[0], file.data[2 * BLOCK]);
+
+    cache.flush();
+    EXPECT_FALSE(cache.contains("other", 0, 1));
+}
+
+TEST(io_block_cache, flush_during_load) {
+    BlockCache cache;
+    TestFile file(2 * BLOCK);
+    uint8_t byte;
+
+    // the file is modified while its block is read, like a write from another thread
+    const BlockCache::Reader reader = file.reader();
+    const uint8_t old_byte = file.data[0];
+    ASSERT_EQ(cache.read("file", 0, &byte, 1, [&](uint64_t offset, void *dst, size_t size) {
+        const size_t count = reader(offset, dst, size);
+        file.data[0] = ~old_byte;
+        cache.flush("file");
+        return count;
+    }),
+        1);
+    EXPECT_EQ(byte, old_byte);
+    EXPECT_FALSE(cache.contains("file", 0, 1));
+
+    ASSERT_EQ(cache.read("file", 0, &byte, 1, file.reader()), 1);
+    EXPECT_EQ(byte, file.data[0]);
+    EXPECT_TRUE(cache.contains("file", 0, 1));
+
+    // the other files are kept
+    cache.prefetch("other", 0, BLOCK, [&](uint64_t offset, void *dst, size_t size) {
+        cache.flush("file");
+        return reader(offset, dst, size);
+    });
+    EXPECT_TRUE(cache.contains("other", 0, BLOCK));
+}
+
+TEST(io_block_cache, flush_directory) {
+    BlockCache cache;
+    TestFile file(BLOCK);
+    uint8_t byte;
+
+    cache.read("dir/file", 0, &byte, 1, file.reader());
+    cache.read("dir/sub/file", 0, &byte, 1, file.reader());
+    cache.read("dir2/file", 0, &byte, 1, file.reader());
+
+    cache.flush_directory("dir");
+    EXPECT_FALSE(cache.contains("dir/file", 0, 1));
+    EXPECT_FALSE(cache.contains("dir/sub/file", 0, 1));
+    EXPECT_TRUE(cache.contains("dir2/file", 0, 1));
+}
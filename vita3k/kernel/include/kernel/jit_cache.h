@@ -0,0 +1,28 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+struct KernelState;
+struct KernelModule;
+struct MemState;
+
+// Persistent cache of the blocks translated by the JIT, one file per module
+void compute_module_code_hash(KernelModule &module, const MemState &mem);
+void load_module_jit_cache(KernelState &kernel, const KernelModule &module);
+void save_module_jit_cache(KernelState &kernel, const KernelModule &module);
+void save_jit_cache(KernelState &kernel);
@@ -0,0 +1,221 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/log.h>
+#include <util/types.h>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A kernel UID is made of a slot index (low bits) and a generation (high bits).
+// The generation is bumped each time the index is released, so a stale UID kept
+// by the guest will never match an object created later in the same slot.
+constexpr int UID_INDEX_BITS = 20;
+constexpr int UID_GENERATION_BITS = 10;
+constexpr SceUID UID_INDEX_MASK = (1 << UID_INDEX_BITS) - 1;
+constexpr uint32_t UID_GENERATION_MASK = (1 << UID_GENERATION_BITS) - 1;
+// The UIDs of the objects which are not kept in an ObjectTable are never released,
+// they come from a counter and have this bit set so they never match a table UID
+constexpr SceUID UID_UNTRACKED_BIT = 1 << (UID_INDEX_BITS + UID_GENERATION_BITS);
+
+inline uint32_t uid_index(SceUID uid) {
+    return static_cast<uint32_t>(uid) & UID_INDEX_MASK;
+}
+
+class UidAllocator {
+public:
+    SceUID allocate() {
+        const std::lock_guard<std::mutex> lock(mutex);
+        uint32_t index;
+        // recycle the oldest released index first to delay reusing a generation as much as possible
+        const bool out_of_indexes = next_index > static_cast<uint32_t>(UID_INDEX_MASK);
+        if (free_indexes.size() > MIN_FREE_INDEXES || (out_of_indexes && !free_indexes.empty())) {
+            index = free_indexes.front();
+            free_indexes.pop_front();
+        } else if (out_of_indexes) {
+            // more than a million live objects, nothing sane to hand out
+            LOG_CRITICAL("No kernel object UID left, {} objects are alive", next_index - 1);
+            return -1;
+        } else {
+            index = next_index++;
+            generations.push_back(0);
+        }
+
+        return static_cast<SceUID>((generations[index] << UID_INDEX_BITS) | index);
+    }
+
+    void release(SceUID uid) {
+        const std::lock_guard<std::mutex> lock(mutex);
+        const uint32_t index = uid_index(uid);
+        if (index == 0 || index >= next_index)
+            return;
+
+        generations[index] = (generations[index] + 1) & UID_GENERATION_MASK;
+        free_indexes.push_back(index);
+    }
+
+private:
+    // keep some indexes on hold before reusing them, a freshly deleted object is the most likely to be looked up again
+    static constexpr size_t MIN_FREE_INDEXES = 1024;
+
+    std::mutex mutex;
+    // index 0 is never handed out, SceUID 0 is not a valid object
+    uint32_t next_index = 1;
+    std::vector<uint32_t> generations = { 0 };
+    std::deque<uint32_t> free_indexes;
+};
+
+#ifdef __cpp_lib_atomic_shared_ptr
+template <typename T>
+using AtomicSharedPtr = std::atomic<std::shared_ptr<T>>;
+#else
+// fallback for standard libraries which don't provide std::atomic<std::shared_ptr>
+template <typename T>
+class AtomicSharedPtr {
+public:
+    std::shared_ptr<T> load(std::memory_order order = std::memory_order_seq_cst) const {
+        return std::atomic_load_explicit(&ptr, order);
+    }
+
+    void store(std::shared_ptr<T> desired, std::memory_order order = std::memory_order_seq_cst) {
+        std::atomic_store_explicit(&ptr, std::move(desired), order);
+    }
+
+private:
+    std::shared_ptr<T> ptr;
+};
+#endif
+
+// Table of kernel objects indexed by UID.
+// Modifications and iteration must be done with the owner's mutex locked, exactly like the std::map it replaces,
+// but get() can be called from any thread without locking: each UID index maps to a slot in a page (slab)
+// owned by this table, and the slot is read atomically.
+template <typename T>
+class ObjectTable {
+public:
+    using Ptr = std::shared_ptr<T>;
+    using Map = std::map<SceUID, Ptr>;
+    using const_iterator = typename Map::const_iterator;
+    using iterator = const_iterator;
+
+    explicit ObjectTable(UidAllocator &uids)
+        : uids(uids) {}
+
+    ObjectTable(const ObjectTable &) = delete;
+    ObjectTable &operator=(const ObjectTable &) = delete;
+
+    ~ObjectTable() {
+        for (auto &page : pages)
+            delete page.load(std::memory_order_relaxed);
+    }
+
+    // lock-free lookup
+    Ptr get(SceUID uid) const {
+        if (uid <= 0)
+            return nullptr;
+
+        const uint32_t index = uid_index(uid);
+        const Page *page = pages[index >> PAGE_BITS].load(std::memory_order_acquire);
+        if (!page)
+            return nullptr;
+
+        const Slot &slot = page->slots[index & PAGE_MASK];
+        if (slot.uid.load(std::memory_order_acquire) != uid)
+            return nullptr;
+        Ptr object = slot.object.load(std::memory_order_acquire);
+        // the slot may have been reused while we were loading the object
+        if (slot.uid.load(std::memory_order_acquire) != uid)
+            return nullptr;
+
+        return object;
+    }
+
+    std::pair<iterator, bool> emplace(SceUID uid, Ptr object) {
+        const auto [it, inserted] = objects.emplace(uid, object);
+        if (inserted) {
+            Slot &slot = get_slot(uid);
+            slot.object.store(std::move(object), std::memory_order_release);
+            slot.uid.store(uid, std::memory_order_release);
+        }
+
+        return { it, inserted };
+    }
+
+    size_t erase(SceUID uid) {
+        if (!objects.erase(uid))
+            return 0;
+
+        Slot &slot = get_slot(uid);
+        slot.uid.store(0, std::memory_order_release);
+        slot.object.store(nullptr, std::memory_order_release);
+        uids.release(uid);
+
+        return 1;
+    }
+
+    iterator find(SceUID uid) const { return objects.find(uid); }
+    bool contains(SceUID uid) const { return objects.contains(uid); }
+    iterator begin() const { return objects.begin(); }
+    iterator end() const { return objects.end(); }
+    size_t size() const { return objects.size(); }
+    bool empty() const { return objects.empty(); }
+
+private:
+    static constexpr int PAGE_BITS = 10;
+    static constexpr uint32_t PAGE_SIZE = 1 << PAGE_BITS;
+    static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+    static constexpr uint32_t PAGE_COUNT = 1 << (UID_INDEX_BITS - PAGE_BITS);
+
+    struct Slot {
+        std::atomic<SceUID> uid = 0;
+        AtomicSharedPtr<T> object;
+    };
+
+    struct Page {
+        std::array<Slot, PAGE_SIZE> slots;
+    };
+
+    Slot &get_slot(SceUID uid) {
+        const uint32_t index = uid_index(uid);
+        auto &page_ptr = pages[index >> PAGE_BITS];
+        Page *page = page_ptr.load(std::memory_order_acquire);
+        if (!page) {
+            // pages are only allocated by writers, which are serialized by the owner's mutex
+            page = new Page();
+            page_ptr.store(page, std::memory_order_release);
+        }
+
+        return page->slots[index & PAGE_MASK];
+    }
+
+    UidAllocator &uids;
+    Map objects;
+    std::array<std::atomic<Page *>, PAGE_COUNT> pages = {};
+};
+
+// ObjectTable lookups don't need the lock, this overload keeps the lock_and_find call sites unchanged
+template <typename T>
+std::shared_ptr<T> lock_and_find(SceUID uid, const ObjectTable<T> &table, std::mutex &) {
+    return table.get(uid);
+}
@@ -21,6 +21,7 @@
 #include <kernel/cpu_protocol.h>
 #include <kernel/debugger.h>
 #include <kernel/object_store.h>
+#include <kernel/object_table.h>
 #include <kernel/sync_primitives.h>
 #include <kernel/types.h>
 #include <mem/allocator.h>
@@ -28,6 +29,7 @@
 #include <mem/util.h>
 #include <rtc/rtc.h>
 #include <util/containers.h>
+#include <util/fs.h>
 #include <util/types.h>
 
 #include <atomic>
@@ -45,6 +47,7 @@ struct KernelModule {
     SceKernelModuleInfo info;
     Ptr<const uint8_t> info_segment_address;
     uint32_t info_offset;
+    uint64_t code_hash = 0;
 };
 typedef std::shared_ptr<KernelModule> SceKernelModulePtr;
 
@@ -55,11 +58,11 @@ typedef std::map<SceUID, KernelInernalModuleInfoPtr> KernelInernalModuleInfos;
 typedef std::shared_ptr<ThreadState> ThreadStatePtr;
 typedef std::map<SceUID, CodecEngineBlock> CodecEngineBlocks;
 typedef std::map<SceUID, Ptr<Ptr<void>>> SlotToAddress;
-typedef std::map<SceUID, ThreadStatePtr> ThreadStatePtrs;
+typedef ObjectTable<ThreadState> ThreadStatePtrs;
 typedef std::shared_ptr<SDL_Thread> ThreadPtr;
 typedef std::map<SceUID, ThreadPtr> ThreadPtrs;
 typedef std::map<SceUID, SceKernelModulePtr> SceKernelModuleInfoPtrs;
-typedef std::map<SceUID, CallbackPtr> CallbackPtrs;
+typedef ObjectTable<Callback> CallbackPtrs;
 typedef unordered_map_fast<uint32_t, Address> ExportNids;
 
 typedef std::map<Address, uint32_t> NotFoundVars;
@@ -98,6 +101,8 @@ struct KernelState {
     KernelState();
 
     std::mutex mutex;
+    // must be declared before the object tables, which release their UIDs to it
+    UidAllocator uid_allocator;
     CodecEngineBlocks codec_blocks;
 
     Ptr<const void> tls_address = Ptr<const void>(0);
@@ -109,19 +114,19 @@ struct KernelState {
     Ptr<const void> thread_event_end = Ptr<const void>(0);
     Address thread_event_end_arg = 0;
 
-    SimpleEventPtrs simple_events;
-    TimerPtrs timers;
-    SemaphorePtrs semaphores;
-    CondvarPtrs condvars;
-    CondvarPtrs lwcondvars;
-    MutexPtrs mutexes;
-    MutexPtrs lwmutexes; // also Mutexes for now
-    RWLockPtrs rwlocks;
-    EventFlagPtrs eventflags;
-    MsgPipePtrs msgpipes;
-    CallbackPtrs callbacks;
+    SimpleEventPtrs simple_events{ uid_allocator };
+    TimerPtrs timers{ uid_allocator };
+    SemaphorePtrs semaphores{ uid_allocator };
+    CondvarPtrs condvars{ uid_allocator };
+    CondvarPtrs lwcondvars{ uid_allocator };
+    MutexPtrs mutexes{ uid_allocator };
+    MutexPtrs lwmutexes{ uid_allocator }; // also Mutexes for now
+    RWLockPtrs rwlocks{ uid_allocator };
+    EventFlagPtrs eventflags{ uid_allocator };
+    MsgPipePtrs msgpipes{ uid_allocator };
+    CallbackPtrs callbacks{ uid_allocator };
 
-    ThreadStatePtrs threads;
+    ThreadStatePtrs threads{ uid_allocator };
 
     SceKernelModuleInfoPtrs loaded_modules;
     LoadedSysmodules loaded_sysmodules;
@@ -130,6 +135,8 @@ struct KernelState {
     // the variables in this block must be accessed by first locking export_nids_mutex
     std::mutex export_nids_mutex;
     ExportNids export_nids;
+    // incremented each time export_nids is modified, can be read without locking
+    std::atomic<uint32_t> export_nids_generation{ 1 };
     FuncBindingInfos func_binding_infos;
     VarBindingInfos var_binding_infos;
     ModuleUidByNid module_uid_by_nid;
@@ -139,6 +146,8 @@ struct KernelState {
     CorenumAllocator corenum_allocator;
     CPUProtocolPtr cpu_protocol;
     ExclusiveMonitorPtr exclusive_monitor;
+    JitCachePtr jit_cache;
+    fs::path jit_cache_path;
 
     ObjectStore obj_store;
 
@@ -148,8 +157,14 @@ struct KernelState {
 
     Debugger debugger;
 
+    // for the objects kept in an ObjectTable, which releases the UID when they are erased. Negative when none is left
+    SceUID get_next_object_uid() {
+        return uid_allocator.allocate();
+    }
+
+    // for everything else, the UID is never reused
     SceUID get_next_uid() {
-        return next_uid++;
+        return UID_UNTRACKED_BIT | (next_uid++ & (UID_UNTRACKED_BIT - 1));
     }
 
     bool init(MemState &mem, const CallImportFunc &call_import, CPUBackend cpu_backend, bool cpu_opt);
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <kernel/object_table.h>
 #include <kernel/thread/thread_data_queue.h>
 #include <kernel/types.h>
 #include <util/byte_ring_buffer.h>
@@ -98,7 +99,7 @@ struct SimpleEvent : SyncPrimitive {
 };
 
 typedef std::shared_ptr<SimpleEvent> SimpleEventPtr;
-typedef std::map<SceUID, SimpleEventPtr> SimpleEventPtrs;
+typedef ObjectTable<SimpleEvent> SimpleEventPtrs;
 
 struct Timer : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
@@ -114,7 +115,7 @@ struct Timer : SyncPrimitive {
 };
 
 typedef std::shared_ptr<Timer> TimerPtr;
-typedef std::map<SceUID, TimerPtr> TimerPtrs;
+typedef ObjectTable<Timer> TimerPtrs;
 
 struct Semaphore : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
@@ -124,7 +125,7 @@ struct Semaphore : SyncPrimitive {
 };
 
 typedef std::shared_ptr<Semaphore> SemaphorePtr;
-typedef std::map<SceUID, SemaphorePtr> SemaphorePtrs;
+typedef ObjectTable<Semaphore> SemaphorePtrs;
 
 struct Mutex : SyncPrimitive {
     int init_count;
@@ -135,7 +136,7 @@ struct Mutex : SyncPrimitive {
 };
 
 typedef std::shared_ptr<Mutex> MutexPtr;
-typedef std::map<SceUID, MutexPtr> MutexPtrs;
+typedef ObjectTable<Mutex> MutexPtrs;
 
 enum class RWLockState {
     Unlocked,
@@ -153,7 +154,7 @@ struct RWLock : SyncPrimitive {
 };
 
 typedef std::shared_ptr<RWLock> RWLockPtr;
-typedef std::map<SceUID, RWLockPtr> RWLockPtrs;
+typedef ObjectTable<RWLock> RWLockPtrs;
 
 struct EventFlag : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
@@ -161,7 +162,7 @@ struct EventFlag : SyncPrimitive {
 };
 
 typedef std::shared_ptr<EventFlag> EventFlagPtr;
-typedef std::map<SceUID, EventFlagPtr> EventFlagPtrs;
+typedef ObjectTable<EventFlag> EventFlagPtrs;
 
 struct Condvar : SyncPrimitive {
     struct SignalTarget {
@@ -185,7 +186,7 @@ struct Condvar : SyncPrimitive {
     MutexPtr associated_mutex;
 };
 typedef std::shared_ptr<Condvar> CondvarPtr;
-typedef std::map<SceUID, CondvarPtr> CondvarPtrs;
+typedef ObjectTable<Condvar> CondvarPtrs;
 
 struct MsgPipe : SyncPrimitive {
     MsgPipe(std::size_t bufSize)
@@ -200,7 +201,7 @@ struct MsgPipe : SyncPrimitive {
 };
 
 typedef std::shared_ptr<MsgPipe> MsgPipePtr;
-typedef std::map<SceUID, MsgPipePtr> MsgPipePtrs;
+typedef ObjectTable<MsgPipe> MsgPipePtrs;
 
 enum class SyncWeight {
     Light, // lightweight
@@ -56,7 +56,7 @@ void CPUProtocol::call_svc(CPUState &cpu, uint32_t svc, Address pc, ThreadState
     call_import(cpu, nid, thread.id);
 
     // ARM recommends clearing exclusive state inside interrupt handler
-    clear_exclusive(kernel->exclusive_monitor, get_processor_id(cpu));
+    clear_exclusive(cpu);
 }
 
 Address CPUProtocol::get_watch_memory_addr(Address addr) {
@@ -66,3 +66,7 @@ Address CPUProtocol::get_watch_memory_addr(Address addr) {
 ExclusiveMonitorPtr CPUProtocol::get_exclusive_monitor() {
     return kernel->exclusive_monitor;
 }
+
+JitCachePtr CPUProtocol::get_jit_cache() {
+    return kernel->jit_cache;
+}
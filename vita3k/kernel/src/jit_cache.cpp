@@ -0,0 +1,151 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/jit_cache.h>
+
+#include <cpu/functions.h>
+#include <kernel/state.h>
+#include <util/fs.h>
+#include <util/log.h>
+
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
+#include <string>
+#include <vector>
+
+static constexpr uint32_t JIT_CACHE_MAGIC = 0x4354494A; // JITC
+static constexpr uint32_t JIT_CACHE_VERSION = 2;
+
+struct JitCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    // hash of the backend build
+    uint64_t format_hash;
+    uint64_t code_hash;
+    uint64_t entries_count;
+};
+
+static uint64_t get_jit_cache_format_hash() {
+    const std::string format = get_jit_cache_format();
+    return XXH3_64bits(format.data(), format.size());
+}
+
+// Keyed by the code hash as well, several modules or several versions of one module can share a name
+static fs::path get_module_jit_cache_path(const KernelState &kernel, const KernelModule &module) {
+    return kernel.jit_cache_path / fmt::format("{}-{:016x}.bin", module.info.module_name, module.code_hash);
+}
+
+static void remove_stale_module_jit_caches(const KernelState &kernel, const KernelModule &module) {
+    const std::string prefix = fmt::format("{}-", module.info.module_name);
+    const auto current_name = get_module_jit_cache_path(kernel, module).filename();
+    boost::system::error_code error{};
+    std::vector<fs::path> stale_caches;
+    for (const auto &entry : fs::directory_iterator(kernel.jit_cache_path, error)) {
+        const auto file_name = entry.path().filename();
+        const std::string name = file_name.string();
+        // <module name>-<16 hex digits>.bin
+        if ((file_name == current_name) || (name.size() != prefix.size() + 16 + 4) || !name.starts_with(prefix) || !name.ends_with(".bin"))
+            continue;
+        if (name.find_first_not_of("0123456789abcdef", prefix.size()) != name.size() - 4)
+            continue;
+        stale_caches.push_back(entry.path());
+    }
+
+    for (const auto &path : stale_caches)
+        fs::remove(path, error);
+}
+
+void compute_module_code_hash(KernelModule &module, const MemState &mem) {
+    // The blocks are only valid for the exact same relocated code at the exact same address
+    uint64_t hash = 0;
+    for (const auto &segment : module.info.segments) {
+        if (segment.size == 0)
+            continue;
+
+        hash = XXH3_64bits_withSeed(segment.vaddr.cast<const uint8_t>().get(mem), segment.filesz, hash ^ segment.vaddr.address());
+    }
+    module.code_hash = hash;
+}
+
+void load_module_jit_cache(KernelState &kernel, const KernelModule &module) {
+    if (kernel.jit_cache_path.empty() || (kernel.cpu_backend != CPUBackend::Dynarmic))
+        return;
+
+    const auto cache_path = get_module_jit_cache_path(kernel, module);
+    fs::ifstream cache_file(cache_path, std::ios::in | std::ios::binary);
+    if (!cache_file.is_open())
+        return;
+
+    JitCacheHeader header{};
+    cache_file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!cache_file || header.magic != JIT_CACHE_MAGIC || header.version != JIT_CACHE_VERSION || header.format_hash != get_jit_cache_format_hash() || header.code_hash != module.code_hash) {
+        LOG_INFO("JIT cache of module {} is outdated, discarding it", module.info.module_name);
+        cache_file.close();
+        fs::remove(cache_path);
+        return;
+    }
+
+    std::vector<uint64_t> entries(header.entries_count);
+    cache_file.read(reinterpret_cast<char *>(entries.data()), entries.size() * sizeof(uint64_t));
+    if (!cache_file) {
+        LOG_ERROR("JIT cache of module {} is truncated", module.info.module_name);
+        return;
+    }
+
+    LOG_INFO("Translating {} blocks of module {} from the JIT cache", entries.size(), module.info.module_name);
+    warm_jit_cache(kernel.jit_cache, entries);
+}
+
+void save_module_jit_cache(KernelState &kernel, const KernelModule &module) {
+    if (kernel.jit_cache_path.empty() || (kernel.cpu_backend != CPUBackend::Dynarmic))
+        return;
+
+    std::vector<uint64_t> entries;
+    for (const auto &segment : module.info.segments) {
+        if (segment.size == 0)
+            continue;
+
+        const auto segment_entries = get_jit_cache_entries(kernel.jit_cache, segment.vaddr.address(), segment.memsz);
+        entries.insert(entries.end(), segment_entries.begin(), segment_entries.end());
+    }
+    if (entries.empty())
+        return;
+
+    fs::create_directories(kernel.jit_cache_path);
+    remove_stale_module_jit_caches(kernel, module);
+    fs::ofstream cache_file(get_module_jit_cache_path(kernel, module), std::ios::out | std::ios::binary);
+    if (!cache_file.is_open()) {
+        LOG_ERROR("Failed to save the JIT cache of module {}", module.info.module_name);
+        return;
+    }
+
+    const JitCacheHeader header{ JIT_CACHE_MAGIC, JIT_CACHE_VERSION, get_jit_cache_format_hash(), module.code_hash, entries.size() };
+    cache_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    cache_file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(uint64_t));
+}
+
+void save_jit_cache(KernelState &kernel) {
+    SceKernelModuleInfoPtrs loaded_modules;
+    {
+        const std::lock_guard<std::mutex> lock(kernel.mutex);
+        loaded_modules = kernel.loaded_modules;
+    }
+
+    for (const auto &[_, module] : loaded_modules)
+        save_module_jit_cache(kernel, *module);
+}
@@ -98,6 +98,7 @@ bool KernelState::init(MemState &mem, const CallImportFunc &call_import, CPUBack
 
     corenum_allocator.set_max_core_count(MAX_CORE_COUNT);
     exclusive_monitor = new_exclusive_monitor(MAX_CORE_COUNT);
+    jit_cache = new_jit_cache(mem, exclusive_monitor, MAX_CORE_COUNT, cpu_opt);
     start_tick = rtc_get_ticks(rtc_base_ticks());
     base_tick = { rtc_base_ticks() };
     cpu_protocol = std::make_unique<CPUProtocol>(*this, mem, call_import);
@@ -131,6 +132,12 @@ void KernelState::set_memory_watch(bool enabled) {
 }
 
 void KernelState::invalidate_jit_cache(Address start, size_t length) {
+    if (cpu_backend == CPUBackend::Dynarmic) {
+        // the translated code is shared by all the threads
+        ::invalidate_jit_cache(jit_cache, start, length);
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(mutex);
     for (const auto &[_, thread] : threads) {
         ::invalidate_jit_cache(*thread->cpu, start, length);
@@ -146,9 +153,14 @@ ThreadStatePtr KernelState::create_thread(MemState &mem, const char *name, Ptr<c
 }
 
 ThreadStatePtr KernelState::create_thread(MemState &mem, const char *name, Ptr<const void> entry_point, int init_priority, SceInt32 affinity_mask, int stack_size, const SceKernelThreadOptParam *option) {
-    ThreadStatePtr thread = std::make_shared<ThreadState>(get_next_uid(), *this, mem);
-    if (thread->init(name, entry_point, init_priority, affinity_mask, stack_size, option) < 0)
+    const SceUID thread_id = get_next_object_uid();
+    if (thread_id < 0)
         return nullptr;
+    ThreadStatePtr thread = std::make_shared<ThreadState>(thread_id, *this, mem);
+    if (thread->init(name, entry_point, init_priority, affinity_mask, stack_size, option) < 0) {
+        uid_allocator.release(thread_id);
+        return nullptr;
+    }
     thread->affinity_mask = affinity_mask & 0x70000;
     if (thread->affinity_mask == 0) {
         thread->affinity_mask = 0x70000;
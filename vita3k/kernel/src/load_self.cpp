@@ -16,6 +16,7 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include <cpu/functions.h>
+#include <kernel/jit_cache.h>
 #include <kernel/load_self.h>
 #include <kernel/relocation.h>
 #include <kernel/state.h>
@@ -274,6 +275,8 @@ static bool load_func_exports(SceKernelModuleInfo *kernel_module_info, const uin
         }
     }
 
+    kernel.export_nids_generation++;
+
     return true;
 }
 
@@ -300,6 +303,8 @@ static bool unload_func_exports(SceKernelModuleInfo *kernel_module_info, const u
         }
     }
 
+    kernel.export_nids_generation++;
+
     return true;
 }
 
@@ -376,6 +381,9 @@ static bool load_var_exports(const uint32_t *nids, const Ptr<uint32_t> *entries,
         if (old_entry_address)
             free(mem, old_entry_address);
     }
+
+    kernel.export_nids_generation++;
+
     return true;
 }
 
@@ -428,6 +436,9 @@ static bool unload_var_exports(const uint32_t *nids, const Ptr<uint32_t> *entrie
             }
         }
     }
+
+    kernel.export_nids_generation++;
+
     return true;
 }
 
@@ -750,6 +761,10 @@ SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std
     if (!load_imports(*module_info, module_info_segment_address, segment_reloc_info, kernel, mem)) {
         return -1;
     }
+
+    compute_module_code_hash(*kernelModuleInfo, mem);
+    load_module_jit_cache(kernel, *kernelModuleInfo);
+
     const SceUID uid = kernel.get_next_uid();
     sceKernelModuleInfo->modid = uid;
     {
@@ -786,6 +801,8 @@ int unload_self(KernelState &kernel, MemState &mem, KernelModule &module) {
 
     SceUID mod_nid = module_info->module_nid;
 
+    save_module_jit_cache(kernel, module);
+
     // last step: free the memory
     for (int i = 0; i < MODULE_INFO_NUM_SEGMENTS; i++) {
         const auto &segment = module.info.segments[i];
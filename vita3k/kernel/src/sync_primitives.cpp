@@ -123,7 +123,9 @@ SceUID simple_event_create(KernelState &kernel, MemState &mem, const char *expor
         return RET_ERROR(SCE_KERNEL_ERROR_UID_NAME_TOO_LONG);
     }
 
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
 
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {} pattern: {:#b}",
@@ -321,7 +323,9 @@ SceUID timer_create(KernelState &kernel, MemState &mem, const char *export_name,
         return RET_ERROR(SCE_KERNEL_ERROR_UID_NAME_TOO_LONG);
     }
 
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
 
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {}",
@@ -550,7 +554,9 @@ SceUID mutex_create(SceUID *uid_out, KernelState &kernel, MemState &mem, const c
     }
 
     const MutexPtr mutex = std::make_shared<Mutex>();
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
     mutex->uid = uid;
     mutex->init_count = init_count;
     mutex->lock_count = init_count;
@@ -809,7 +815,9 @@ SceUID rwlock_create(KernelState &kernel, MemState &mem, const char *export_name
     }
 
     const RWLockPtr rwlock = std::make_shared<RWLock>();
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
     rwlock->uid = uid;
     strncpy(rwlock->name, name, KERNELOBJECT_MAX_NAME_LENGTH);
     rwlock->attr = attr;
@@ -981,7 +989,9 @@ SceUID semaphore_create(KernelState &kernel, const char *export_name, const char
     }
 
     const SemaphorePtr semaphore = std::make_shared<Semaphore>();
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
     semaphore->uid = uid;
     semaphore->init_val = init_val;
     semaphore->val = init_val;
@@ -1195,7 +1205,9 @@ SceUID condvar_create(SceUID *uid_out, KernelState &kernel, const char *export_n
     if (auto error = find_mutex(assoc_mutex, nullptr, kernel, export_name, assoc_mutexid, weight))
         return error;
 
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
 
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {} assoc_mutexid: {}",
@@ -1359,7 +1371,9 @@ SceUID eventflag_create(KernelState &kernel, const char *export_name, SceUID thr
         return RET_ERROR(SCE_KERNEL_ERROR_UID_NAME_TOO_LONG);
     }
 
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
 
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {} bitPattern: {:#b}",
@@ -1618,7 +1632,9 @@ SceUID msgpipe_create(KernelState &kernel, const char *export_name, const char *
         return RET_ERROR(SCE_KERNEL_ERROR_UID_NAME_TOO_LONG);
     }
 
-    const SceUID uid = kernel.get_next_uid();
+    const SceUID uid = kernel.get_next_object_uid();
+    if (uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
 
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {}",
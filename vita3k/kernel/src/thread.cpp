@@ -353,6 +353,7 @@ bool ThreadState::run_loop() {
             }
             break;
         case ThreadToDo::wait:
+            release_resources(*cpu);
             something_to_do.wait(lock);
             break;
         case ThreadToDo::suspend:
@@ -442,6 +443,11 @@ void ThreadState::update_status(ThreadStatus status, std::optional<ThreadStatus>
     this->status = status;
     status_cond.notify_all();
 
+    if (status == ThreadStatus::wait) {
+        // a thread only puts itself to sleep, let another one use its JIT meanwhile
+        release_resources(*cpu);
+    }
+
     if (status == ThreadStatus::dormant) {
         raise_waiting_threads();
     }
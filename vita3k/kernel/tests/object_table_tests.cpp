@@ -0,0 +1,174 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/object_table.h>
+#include <kernel/state.h>
+#include <kernel/sync_primitives.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct FakeMutex {
+    std::mutex mutex;
+    int lock_count = 0;
+};
+
+typedef std::shared_ptr<FakeMutex> FakeMutexPtr;
+
+} // namespace
+
+TEST(object_table, emplace_get_erase) {
+    UidAllocator uids;
+    ObjectTable<FakeMutex> table(uids);
+
+    const SceUID uid = uids.allocate();
+    const auto mutex = std::make_shared<FakeMutex>();
+    ASSERT_TRUE(table.emplace(uid, mutex).second);
+    ASSERT_FALSE(table.emplace(uid, mutex).second);
+    ASSERT_EQ(table.get(uid), mutex);
+    ASSERT_EQ(table.size(), 1);
+    ASSERT_TRUE(table.contains(uid));
+
+    ASSERT_EQ(table.erase(uid), 1);
+    ASSERT_EQ(table.erase(uid), 0);
+    ASSERT_EQ(table.get(uid), nullptr);
+    ASSERT_TRUE(table.empty());
+
+    ASSERT_EQ(table.get(0), nullptr);
+    ASSERT_EQ(table.get(-1), nullptr);
+}
+
+TEST(object_table, stale_uid_is_rejected) {
+    UidAllocator uids;
+    ObjectTable<FakeMutex> table(uids);
+
+    // go through enough objects for the first index to be recycled
+    const SceUID first = uids.allocate();
+    table.emplace(first, std::make_shared<FakeMutex>());
+    table.erase(first);
+
+    SceUID reused = 0;
+    for (int i = 0; i < 4096 && !reused; i++) {
+        const SceUID uid = uids.allocate();
+        ASSERT_GT(uid, 0);
+        if (uid_index(uid) == uid_index(first))
+            reused = uid;
+        table.emplace(uid, std::make_shared<FakeMutex>());
+        table.erase(uid);
+    }
+
+    ASSERT_NE(reused, 0);
+    ASSERT_NE(reused, first);
+
+    table.emplace(reused, std::make_shared<FakeMutex>());
+    ASSERT_EQ(table.get(first), nullptr);
+    ASSERT_NE(table.get(reused), nullptr);
+}
+
+TEST(object_table, kernel_uids_are_released) {
+    KernelState kernel;
+
+    // more semaphores than there are indexes, one at a time, like a game creating and deleting them each frame
+    for (uint32_t i = 0; i <= UID_INDEX_MASK + 4096; i++) {
+        const SceUID uid = semaphore_create(kernel, "test", "semaphore", 0, 0, 0, 1);
+        ASSERT_GT(uid, 0);
+        ASSERT_EQ(uid & UID_UNTRACKED_BIT, 0);
+        ASSERT_EQ(semaphore_delete(kernel, "test", 0, uid), SCE_KERNEL_OK);
+    }
+
+    // the UIDs of the other objects are not taken from the table indexes, and never match a table object
+    const SceUID untracked = kernel.get_next_uid();
+    ASSERT_GT(untracked, 0);
+    ASSERT_NE(untracked & UID_UNTRACKED_BIT, 0);
+    ASSERT_EQ(kernel.semaphores.get(untracked), nullptr);
+    ASSERT_EQ(kernel.get_next_uid(), untracked + 1);
+}
+
+// Many host threads going through the sync primitives at the same time, each on its own objects,
+// like guest threads using their own lwmutex: only the lookups in the kernel can contend
+namespace {
+
+constexpr int CALL_COUNT = 50'000;
+
+template <typename Call>
+double measure_contention(int thread_count, Call call) {
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < CALL_COUNT; i++)
+                call(t);
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(CALL_COUNT) * thread_count);
+}
+
+} // namespace
+
+TEST(object_table_benchmark, sync_primitives_contention) {
+    const int thread_count = std::max(32u, std::thread::hardware_concurrency());
+
+    KernelState kernel;
+    MemState mem;
+    std::vector<SceUID> mutexes(thread_count);
+    std::vector<SceUID> semaphores(thread_count);
+    std::vector<SceUID> eventflags(thread_count);
+    for (int t = 0; t < thread_count; t++) {
+        ASSERT_EQ(mutex_create(&mutexes[t], kernel, mem, "test", "mutex", 0, 0, 0, Ptr<SceKernelLwMutexWork>(), SyncWeight::Heavy), SCE_KERNEL_OK);
+        semaphores[t] = semaphore_create(kernel, "test", "semaphore", 0, 0, 0, 1);
+        eventflags[t] = eventflag_create(kernel, "test", 0, "eventflag", 0, 0);
+        ASSERT_GT(semaphores[t], 0);
+        ASSERT_GT(eventflags[t], 0);
+    }
+
+    // none of these calls has to wait, the objects of a thread are only used by it
+    std::atomic<int> errors = 0;
+    const double mutex_ns = measure_contention(thread_count, [&](int t) {
+        if (mutex_try_lock(kernel, mem, "test", 0, mutexes[t], 1, SyncWeight::Heavy) != SCE_KERNEL_OK
+            || mutex_unlock(kernel, "test", 0, mutexes[t], 1, SyncWeight::Heavy) != SCE_KERNEL_OK)
+            errors++;
+    });
+    const double semaphore_ns = measure_contention(thread_count, [&](int t) {
+        if (semaphore_signal(kernel, "test", 0, semaphores[t], 1) != SCE_KERNEL_OK
+            || semaphore_wait(kernel, "test", 0, semaphores[t], 1, nullptr) != SCE_KERNEL_OK)
+            errors++;
+    });
+    const double eventflag_ns = measure_contention(thread_count, [&](int t) {
+        uint32_t bits = 0;
+        if (eventflag_set(kernel, "test", 0, eventflags[t], 1) != SCE_KERNEL_OK
+            || eventflag_poll(kernel, "test", 0, eventflags[t], 1, SCE_EVENT_WAITAND | SCE_EVENT_WAITCLEAR_PAT, &bits) != SCE_KERNEL_OK)
+            errors++;
+    });
+    ASSERT_EQ(errors, 0);
+
+    std::cout << thread_count << " threads, mutex try lock + unlock: " << mutex_ns << " ns" << std::endl;
+    std::cout << thread_count << " threads, semaphore signal + wait: " << semaphore_ns << " ns" << std::endl;
+    std::cout << thread_count << " threads, event flag set + poll: " << eventflag_ns << " ns" << std::endl;
+}
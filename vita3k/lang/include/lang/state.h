@@ -232,7 +232,8 @@ struct LangState {
     std::map<std::string, std::string> compile_shaders = {
         { "compiling_shaders", "Compiling Shaders" },
         { "pipelines_compiled", "{} pipelines compiled" },
-        { "shaders_compiled", "{} shaders compiled" }
+        { "shaders_compiled", "{} shaders compiled" },
+        { "time_remaining", "{} remaining" }
     };
     struct ContentManager {
         std::map<std::string, std::string> main = {
@@ -445,7 +446,10 @@ struct LangState {
     std::map<std::string, std::string> performance_overlay = {
         { "avg", "Avg" },
         { "min", "Min" },
-        { "max", "Max" }
+        { "max", "Max" },
+        { "texture_decode", "Texture decode" },
+        { "io_queue", "I/O queue" },
+        { "io_cache_hits", "cache hits" }
     };
     struct Settings {
         std::map<std::string, std::string> main = { { "title", "Settings" } };
@@ -28,6 +28,7 @@
 #include <include/cpu.h>
 #include <include/environment.h>
 #include <io/state.h>
+#include <kernel/jit_cache.h>
 #include <kernel/state.h>
 #include <modules/module_parent.h>
 #include <packages/functions.h>
@@ -40,8 +41,6 @@
 #include <util/log.h>
 #include <util/string_utils.h>
 
-#include "c:\Users\Dima\Documents\git\Vita3K\external\thread-pool\BS_thread_pool.hpp"
-
 #if USE_DISCORD
 #include <app/discord.h>
 #endif
@@ -145,6 +144,7 @@ int main(int argc, char *argv[]) {
                 fs::remove_all(cfg.get_pref_path() / "ux0/addcont" / *cfg.delete_title_id);
                 fs::remove_all(cfg.get_pref_path() / "ux0/user/00/savedata" / *cfg.delete_title_id);
                 fs::remove_all(root_paths.get_cache_path() / "shaders" / *cfg.delete_title_id);
+                fs::remove_all(root_paths.get_cache_path() / "jit" / *cfg.delete_title_id);
             }
             if (cfg.pup_path.has_value()) {
                 LOG_INFO("Installing firmware file {}", *cfg.pup_path);
@@ -240,6 +240,9 @@ int main(int argc, char *argv[]) {
         const auto is_directory = fs::is_directory(*cfg.content_path);
 
         const auto content_is_app = [&]() {
+            if (cfg.mount_archive && mount_archive(emuenv, *cfg.content_path))
+                return true;
+
             std::vector<ContentInfo> contents_info = install_archive(emuenv, gui_ptr, *cfg.content_path);
             const auto content_index = std::find_if(contents_info.begin(), contents_info.end(), [&](const ContentInfo &c) {
                 return c.category == "gd";
@@ -388,18 +391,10 @@ int main(int argc, char *argv[]) {
     emuenv.renderer->set_app(emuenv.io.title_id.c_str(), emuenv.self_name.c_str());
     if (renderer::get_shaders_cache_hashs(*emuenv.renderer) && cfg.shader_cache) {
         SDL_SetWindowTitle(emuenv.window.get(), fmt::format("{} | {} ({}) | Please wait, compiling shaders...", window_title, emuenv.current_app_title, emuenv.io.title_id).c_str());
-        BS::thread_pool pool;
-        for (const auto &hash : emuenv.renderer->shaders_cache_hashs) {
-            pool.push_task([&renderer = emuenv.renderer, hash]() { renderer->precompile_shader(hash); });
-        }
-        /*
-        for (const auto &hash : emuenv.renderer->shaders_cache_hashs) {
-            std::thread th([&renderer = emuenv.renderer, hash]() { emuenv.renderer->precompile_shader(hash); });
-            th.detach();
-        }*/
-        // uint32_t totals = uint32_t(emuenv.renderer->shaders_cache_hashs.size());
-        //  while (totals < emuenv.renderer->programs_count_pre_compiled) {
-        while (handle_events(emuenv, gui) && pool.get_tasks_total() > 0) {
+        renderer::precompile_shaders(*emuenv.renderer, [&]() {
+            if (!handle_events(emuenv, gui))
+                return false;
+
             gui::draw_begin(gui, emuenv);
             draw_app_background(gui, emuenv);
 
@@ -407,8 +402,8 @@ int main(int argc, char *argv[]) {
 
             gui::draw_end(gui);
             emuenv.renderer->swap_window(emuenv.window.get());
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        } /**/
+            return true;
+        });
     }
     {
         const auto err = run_app(emuenv, main_module_id);
@@ -477,6 +472,7 @@ int main(int argc, char *argv[]) {
 #endif
 
     emuenv.renderer->preclose_action();
+    save_jit_cache(emuenv.kernel);
     app::destroy(emuenv, gui.imgui_state.get());
 
     if (emuenv.load_exec)
@@ -20,13 +20,42 @@
 #include <cstdint>
 #include <vector>
 
+// Two level index of the words of a bitmap matching a condition, so that searches can skip the other ones
+struct BitmapSummary {
+    // one bit for each word of the bitmap
+    std::vector<std::uint64_t> bits;
+    // one bit for each non zero element of bits
+    std::vector<std::uint64_t> groups;
+    std::size_t count = 0;
+
+    void reset(const std::size_t word_count);
+    void set(const std::size_t index, const bool value);
+
+    // Index of the first matching word at or after index, count if there is none
+    std::size_t find_next(const std::size_t index) const;
+};
+
 struct BitmapAllocator {
+    // A set bit is a free slot, the first slot of each word is its most significant bit.
+    // The summaries are built from the words on the first allocation.
     std::vector<std::uint32_t> words;
-    std::size_t max_offset;
+    std::size_t max_offset = 0;
 
 protected:
+    // words with at least one free slot
+    BitmapSummary free_words;
+    // words with at least one used slot
+    BitmapSummary used_words;
+    bool summaries_valid = false;
+
     int force_fill(const std::uint32_t offset, const int size, const bool or_mode = false);
 
+    void build_summaries();
+    void update_summaries(const std::size_t first_word, const std::size_t end_word);
+
+    // First slot at or after offset which is free (or used), max_offset if there is none
+    std::size_t find_slot(const std::size_t offset, const bool free) const;
+
 public:
     BitmapAllocator() = default;
     explicit BitmapAllocator(const std::size_t total_bits);
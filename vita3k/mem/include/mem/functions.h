@@ -23,6 +23,7 @@
 #include <functional>
 
 struct MemState;
+struct GuestHeapStats;
 
 typedef std::function<bool(uint8_t *addr, bool write)> AccessViolationHandler;
 
@@ -51,9 +52,28 @@ bool is_protecting(MemState &state, Address addr, MemPerm *perm = nullptr);
 bool is_valid_addr(const MemState &state, Address addr);
 bool is_valid_addr_range(const MemState &state, Address start, Address end);
 bool handle_access_violation(MemState &state, uint8_t *addr, bool write) noexcept;
+// Software write tracking, an alternative to add_protect which does not go through access violations.
+// It must be enabled before any CPU thread is created: the JIT then stops writing directly to the memory
+// and marks the pages written through its write callbacks instead.
+void enable_write_tracking(MemState &state);
+void mark_written(MemState &state, Address addr, uint32_t size);
+// Same for a host pointer to guest memory, every HLE function writing to the guest memory must call it
+void mark_written(MemState &state, const void *data, uint32_t size);
+// Start a new write generation and return the previous one: the range was not written to after this call
+// as long as get_write_generation returns a value lower or equal to it.
+uint32_t next_write_generation(MemState &state);
+// Return the generation of the last write to the range
+uint32_t get_write_generation(const MemState &state, Address addr, uint32_t size);
 Block alloc_block(MemState &mem, uint32_t size, const char *name, Address start_addr = user_main_memory_start);
 Address alloc_at(MemState &state, Address address, uint32_t size, const char *name);
 Address try_alloc_at(MemState &state, Address address, uint32_t size, const char *name);
 void free(MemState &state, Address address);
 uint32_t mem_available(MemState &state);
 const char *mem_name(Address address, MemState &state);
+
+// Guest heap, for the allocations made by the HLE libc
+Address heap_alloc(MemState &state, uint32_t size, uint32_t alignment = 0);
+Address heap_realloc(MemState &state, Address addr, uint32_t size);
+void heap_free(MemState &state, Address addr);
+uint32_t heap_usable_size(MemState &state, Address addr);
+GuestHeapStats get_heap_stats(MemState &state);
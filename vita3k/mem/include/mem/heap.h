@@ -0,0 +1,85 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <mem/util.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+// Block sizes of the guest heap, bigger blocks get their own pages
+constexpr std::array<uint32_t, 20> HEAP_SIZE_CLASSES = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512,
+    768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384
+};
+// Blocks of a size class are carved from chunks of this size
+constexpr uint32_t HEAP_CHUNK_SIZE = KiB(64);
+
+struct GuestHeapThreadCache;
+
+struct GuestHeapClass {
+    // blocks freed and not kept by a thread cache
+    std::vector<Address> free_blocks;
+    // part of the last chunk which was never handed out
+    Address chunk_next = 0;
+    Address chunk_end = 0;
+
+    uint32_t chunk_count = 0;
+    std::atomic<uint32_t> used_blocks = 0;
+};
+
+// Heap serving the allocations of the HLE libc.
+// Small blocks are grouped by size class in chunks of guest memory, each thread keeps a few freed blocks
+// of each class to serve its next allocations without taking the heap lock.
+struct GuestHeap {
+    GuestHeap();
+    ~GuestHeap();
+
+    GuestHeap(const GuestHeap &) = delete;
+    GuestHeap &operator=(const GuestHeap &) = delete;
+
+    std::mutex mutex;
+    std::array<GuestHeapClass, HEAP_SIZE_CLASSES.size()> classes;
+    // size class + 1 of the chunk each 4 KiB page belongs to, 0 if it is not part of a chunk
+    std::unique_ptr<uint8_t[]> page_classes;
+
+    std::atomic<uint32_t> large_count = 0;
+    std::atomic<uint64_t> large_bytes = 0;
+    // blocks with their own pages, protected by the heap lock
+    std::unordered_set<Address> large_blocks;
+
+    // caches of the threads which used this heap, protected by the global cache lock
+    std::vector<GuestHeapThreadCache *> thread_caches;
+};
+
+struct GuestHeapClassStats {
+    uint32_t block_size = 0;
+    uint32_t chunk_count = 0;
+    uint32_t used_blocks = 0;
+};
+
+struct GuestHeapStats {
+    std::vector<GuestHeapClassStats> classes;
+    uint32_t large_count = 0;
+    uint64_t large_bytes = 0;
+};
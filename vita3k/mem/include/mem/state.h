@@ -19,8 +19,10 @@
 
 #include <mem/allocator.h>
 #include <mem/functions.h>
+#include <mem/heap.h>
 #include <mem/util.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -78,4 +80,11 @@ struct MemState {
     bool use_page_table = false;
     PageTable page_table;
     std::map<uint64_t, MemExternalMapping, std::greater<>> external_mapping;
+
+    // software write tracking, generation of the last write to each 4 KiB page
+    bool track_writes = false;
+    std::atomic<uint32_t> write_generation = 0;
+    std::unique_ptr<std::atomic<uint32_t>[]> page_write_generations;
+
+    GuestHeap heap;
 };
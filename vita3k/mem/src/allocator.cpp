@@ -17,6 +17,58 @@
 
 #include <mem/allocator.h>
 
+#include <algorithm>
+#include <bit>
+
+void BitmapSummary::reset(const std::size_t word_count) {
+    count = word_count;
+    bits.assign((word_count + 63) >> 6, 0);
+    groups.assign((bits.size() + 63) >> 6, 0);
+}
+
+void BitmapSummary::set(const std::size_t index, const bool value) {
+    std::uint64_t &bits_word = bits[index >> 6];
+    const std::uint64_t mask = 1ULL << (index & 63);
+    bits_word = value ? (bits_word | mask) : (bits_word & ~mask);
+
+    const std::size_t group = index >> 6;
+    const std::uint64_t group_mask = 1ULL << (group & 63);
+    std::uint64_t &groups_word = groups[group >> 6];
+    groups_word = (bits_word != 0) ? (groups_word | group_mask) : (groups_word & ~group_mask);
+}
+
+std::size_t BitmapSummary::find_next(const std::size_t index) const {
+    if (index >= count) {
+        return count;
+    }
+
+    // Rest of the summary word holding index
+    std::size_t bits_index = index >> 6;
+    const std::uint64_t bits_word = bits[bits_index] & (~0ULL << (index & 63));
+    if (bits_word != 0) {
+        return (bits_index << 6) + std::countr_zero(bits_word);
+    }
+
+    // Then look for the next non empty summary word with the groups
+    bits_index++;
+    if (bits_index >= bits.size()) {
+        return count;
+    }
+
+    std::size_t group_index = bits_index >> 6;
+    std::uint64_t groups_word = groups[group_index] & (~0ULL << (bits_index & 63));
+    while (groups_word == 0) {
+        group_index++;
+        if (group_index >= groups.size()) {
+            return count;
+        }
+        groups_word = groups[group_index];
+    }
+
+    bits_index = (group_index << 6) + std::countr_zero(groups_word);
+    return (bits_index << 6) + std::countr_zero(bits[bits_index]);
+}
+
 BitmapAllocator::BitmapAllocator(const std::size_t total_bits)
     : words((total_bits >> 5) + ((total_bits % 32 != 0) ? 1 : 0), 0xFFFFFFFF)
     , max_offset(total_bits) {
@@ -35,13 +87,52 @@ void BitmapAllocator::set_maximum(const std::size_t total_bits) {
     }
 
     max_offset = total_bits;
+    summaries_valid = false;
 }
 
 void BitmapAllocator::reset() {
     words.clear();
+    summaries_valid = false;
+}
+
+void BitmapAllocator::build_summaries() {
+    free_words.reset(words.size());
+    used_words.reset(words.size());
+    update_summaries(0, words.size());
+    summaries_valid = true;
+}
+
+void BitmapAllocator::update_summaries(const std::size_t first_word, const std::size_t end_word) {
+    for (std::size_t i = first_word; i < std::min(end_word, words.size()); i++) {
+        free_words.set(i, words[i] != 0);
+        used_words.set(i, words[i] != 0xFFFFFFFFU);
+    }
+}
+
+std::size_t BitmapAllocator::find_slot(const std::size_t offset, const bool free) const {
+    std::size_t index = offset >> 5;
+    if (index >= words.size()) {
+        return max_offset;
+    }
+
+    // Search for a set bit in the words or in their complement
+    const std::uint32_t flip = free ? 0 : 0xFFFFFFFFU;
+    std::uint32_t wv = (words[index] ^ flip) & (0xFFFFFFFFU >> (offset & 31));
+    if (wv == 0) {
+        index = (free ? free_words : used_words).find_next(index + 1);
+        if (index >= words.size()) {
+            return max_offset;
+        }
+        wv = words[index] ^ flip;
+    }
+
+    return std::min<std::size_t>((index << 5) + std::countl_zero(wv), max_offset);
 }
 
 int BitmapAllocator::force_fill(const std::uint32_t offset, const int size, const bool or_mode) {
+    const std::size_t first_word = offset >> 5;
+    const std::size_t end_word = size > 0 ? ((static_cast<std::size_t>(offset) + size - 1) >> 5) + 1 : first_word;
+
     std::uint32_t *word = &words[0] + (offset >> 5);
     const std::uint32_t set_bit = offset & 31;
     int end_bit = static_cast<int>(set_bit + size);
@@ -58,6 +149,10 @@ int BitmapAllocator::force_fill(const std::uint32_t offset, const int size, cons
             *word = wval & (~mask);
         }
 
+        if (summaries_valid) {
+            update_summaries(first_word, end_word);
+        }
+
         return std::min<int>(size, (words.size() << 5) - set_bit);
     }
 
@@ -85,6 +180,10 @@ int BitmapAllocator::force_fill(const std::uint32_t offset, const int size, cons
         }
     }
 
+    if (summaries_valid) {
+        update_summaries(first_word, end_word);
+    }
+
     return std::min<int>(size, (words.size() << 5) - set_bit);
 }
 
@@ -101,79 +200,44 @@ int BitmapAllocator::allocate_from(const std::uint32_t start_offset, int &size,
         return -1;
     }
 
-    std::uint32_t *word = &words[0] + (start_offset >> 5);
-
-    // We have arrived at le word that still have free position (bit 1)
-    std::uint32_t *word_end = &words[words.size() - 1];
-
-    int bflmin = 0xFFFFFF;
-    int bofmin = -1;
-    std::uint32_t *wordmin = nullptr;
-
-    // Keep finding
-    while (word <= word_end) {
-        std::uint32_t wv = *word;
-
-        if (wv != 0) {
-            // Still have free stuff
-            int bflen = 0;
-            int boff = 0;
-            std::uint32_t *bword = nullptr;
-
-            int cursor = 31;
-
-            while (cursor >= 0) {
-                if (((wv >> cursor) & 1) == 1) {
-                    boff = cursor;
-                    bflen = 0;
-                    bword = word;
-
-                    while (cursor >= 0 && (((wv >> cursor) & 1) == 1)) {
-                        bflen++;
-                        cursor--;
-
-                        if (cursor < 0 && (word + 1 <= word_end)) {
-                            cursor = 31;
-                            word++;
-                            wv = *word;
-                        }
-                    }
-
-                    if (bflen >= size) {
-                        if (!best_fit) {
-                            // Force allocate and then return
-                            const int offset = static_cast<int>(31 - boff + ((bword - &words[0]) << 5));
-                            if ((static_cast<std::size_t>(offset) + size) <= max_offset) {
-                                size = force_fill(static_cast<const std::uint32_t>(offset), size, false);
-                                return offset;
-                            }
-                        } else {
-                            if (bflen < bflmin) {
-                                bflmin = bflen;
-                                bofmin = boff;
-                                wordmin = bword;
-                            }
-                        }
-                    }
-                }
-
-                cursor--;
+    if (!summaries_valid) {
+        build_summaries();
+    }
+
+    const std::size_t wanted = static_cast<std::size_t>(size);
+    std::size_t best_length = static_cast<std::size_t>(-1);
+    int best_offset = -1;
+
+    // The search starts at the beginning of the word holding the start offset.
+    // Each free run is found with the summaries, so full words or long free runs cost a few bit operations.
+    std::size_t offset = start_offset & ~31U;
+    while (offset < max_offset) {
+        const std::size_t run_begin = find_slot(offset, true);
+        if (run_begin >= max_offset) {
+            break;
+        }
+
+        const std::size_t run_end = find_slot(run_begin, false);
+        const std::size_t run_length = run_end - run_begin;
+        if (run_length >= wanted && run_length < best_length) {
+            best_offset = static_cast<int>(run_begin);
+            best_length = run_length;
+
+            // Nothing can fit better than an exact fit
+            if (!best_fit || run_length == wanted) {
+                break;
             }
         }
 
-        word++;
+        offset = run_end;
     }
 
-    if (best_fit && bofmin != -1) {
-        // Force allocate and then return
-        const int offset = static_cast<int>(31 - bofmin + ((wordmin - &words[0]) << 5));
-        if ((static_cast<std::size_t>(offset) + size) <= max_offset) {
-            size = force_fill(static_cast<std::uint32_t>(offset), size, false);
-            return offset;
-        }
+    if (best_offset == -1) {
+        return -1;
     }
 
-    return -1;
+    size = force_fill(static_cast<std::uint32_t>(best_offset), size, false);
+    return best_offset;
 }
 
 int BitmapAllocator::allocate_at(const std::uint32_t start_offset, int size) {
@@ -0,0 +1,268 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/functions.h>
+#include <mem/heap.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t HEAP_PAGE_SIZE = KiB(4);
+constexpr uint32_t HEAP_PAGE_COUNT = GiB(4) / HEAP_PAGE_SIZE;
+
+// how much memory a thread can keep in its cache for each size class
+constexpr uint32_t THREAD_CACHE_BYTES = KiB(16);
+constexpr uint32_t THREAD_CACHE_MIN_BLOCKS = 4;
+
+// protects the link between the thread caches and the heaps
+std::mutex thread_caches_mutex;
+
+uint32_t get_thread_cache_capacity(size_t class_index) {
+    return std::max(THREAD_CACHE_MIN_BLOCKS, THREAD_CACHE_BYTES / HEAP_SIZE_CLASSES[class_index]);
+}
+
+int get_size_class(uint32_t size) {
+    const auto it = std::lower_bound(HEAP_SIZE_CLASSES.begin(), HEAP_SIZE_CLASSES.end(), size);
+    if (it == HEAP_SIZE_CLASSES.end())
+        return -1;
+
+    return static_cast<int>(it - HEAP_SIZE_CLASSES.begin());
+}
+
+} // namespace
+
+struct GuestHeapThreadCache {
+    GuestHeap *heap = nullptr;
+    std::array<std::vector<Address>, HEAP_SIZE_CLASSES.size()> blocks;
+
+    ~GuestHeapThreadCache() {
+        unbind();
+    }
+
+    // give the cached blocks back to the heap
+    void unbind() {
+        const std::lock_guard<std::mutex> lock(thread_caches_mutex);
+        if (!heap)
+            return;
+
+        {
+            const std::lock_guard<std::mutex> heap_lock(heap->mutex);
+            for (size_t i = 0; i < blocks.size(); i++) {
+                auto &free_blocks = heap->classes[i].free_blocks;
+                free_blocks.insert(free_blocks.end(), blocks[i].begin(), blocks[i].end());
+                blocks[i].clear();
+            }
+        }
+
+        auto &caches = heap->thread_caches;
+        caches.erase(std::find(caches.begin(), caches.end(), this));
+        heap = nullptr;
+    }
+};
+
+static thread_local GuestHeapThreadCache thread_cache;
+
+GuestHeap::GuestHeap()
+    : page_classes(std::make_unique<uint8_t[]>(HEAP_PAGE_COUNT)) {
+}
+
+GuestHeap::~GuestHeap() {
+    // the memory of the heap is going away with it, the cached blocks can be dropped
+    const std::lock_guard<std::mutex> lock(thread_caches_mutex);
+    for (GuestHeapThreadCache *cache : thread_caches) {
+        cache->heap = nullptr;
+        for (auto &blocks : cache->blocks)
+            blocks.clear();
+    }
+}
+
+static GuestHeapThreadCache &get_thread_cache(GuestHeap &heap) {
+    GuestHeapThreadCache &cache = thread_cache;
+    if (cache.heap != &heap) {
+        cache.unbind();
+
+        const std::lock_guard<std::mutex> lock(thread_caches_mutex);
+        cache.heap = &heap;
+        heap.thread_caches.push_back(&cache);
+    }
+
+    return cache;
+}
+
+// Move up to half a thread cache of blocks from the heap to the thread cache, carving a new chunk if needed
+static void refill_thread_cache(MemState &state, size_t class_index, std::vector<Address> &blocks) {
+    GuestHeap &heap = state.heap;
+    GuestHeapClass &heap_class = heap.classes[class_index];
+    const uint32_t block_size = HEAP_SIZE_CLASSES[class_index];
+    const uint32_t count = std::max(get_thread_cache_capacity(class_index) / 2, 1u);
+
+    const std::lock_guard<std::mutex> lock(heap.mutex);
+    const size_t reused = std::min<size_t>(count, heap_class.free_blocks.size());
+    blocks.insert(blocks.end(), heap_class.free_blocks.end() - reused, heap_class.free_blocks.end());
+    heap_class.free_blocks.resize(heap_class.free_blocks.size() - reused);
+
+    for (size_t i = reused; i < count; i++) {
+        if (heap_class.chunk_next + block_size > heap_class.chunk_end) {
+            const Address chunk = alloc(state, HEAP_CHUNK_SIZE, "heap");
+            if (!chunk)
+                break;
+
+            std::fill_n(&heap.page_classes[chunk / HEAP_PAGE_SIZE], HEAP_CHUNK_SIZE / HEAP_PAGE_SIZE, static_cast<uint8_t>(class_index + 1));
+            heap_class.chunk_next = chunk;
+            heap_class.chunk_end = chunk + HEAP_CHUNK_SIZE;
+            heap_class.chunk_count++;
+        }
+
+        blocks.push_back(heap_class.chunk_next);
+        heap_class.chunk_next += block_size;
+    }
+}
+
+static Address alloc_large(MemState &state, uint32_t size, uint32_t alignment) {
+    const Address addr = (alignment > HEAP_PAGE_SIZE) ? alloc_aligned(state, size, "memalign", alignment) : alloc(state, size, "malloc");
+    if (!addr)
+        return 0;
+
+    {
+        const std::lock_guard<std::mutex> lock(state.heap.mutex);
+        state.heap.large_blocks.insert(addr);
+    }
+    state.heap.large_count++;
+    state.heap.large_bytes += heap_usable_size(state, addr);
+    return addr;
+}
+
+Address heap_alloc(MemState &state, uint32_t size, uint32_t alignment) {
+    size = std::max(size, 1u);
+    if (alignment > HEAP_PAGE_SIZE)
+        return alloc_large(state, size, alignment);
+    if (alignment > HEAP_SIZE_CLASSES[0])
+        // blocks of a power of two size class are aligned on their size
+        size = std::bit_ceil(std::max(size, alignment));
+
+    const int class_index = get_size_class(size);
+    if (class_index < 0)
+        return alloc_large(state, size, alignment);
+
+    std::vector<Address> &blocks = get_thread_cache(state.heap).blocks[class_index];
+    if (blocks.empty()) {
+        refill_thread_cache(state, class_index, blocks);
+        if (blocks.empty())
+            return 0;
+    }
+
+    const Address addr = blocks.back();
+    blocks.pop_back();
+    state.heap.classes[class_index].used_blocks.fetch_add(1, std::memory_order_relaxed);
+
+    return addr;
+}
+
+void heap_free(MemState &state, Address addr) {
+    if (!addr)
+        return;
+
+    GuestHeap &heap = state.heap;
+    const uint8_t class_entry = heap.page_classes[addr / HEAP_PAGE_SIZE];
+    if (class_entry == 0) {
+        {
+            const std::lock_guard<std::mutex> lock(heap.mutex);
+            if (heap.large_blocks.erase(addr) == 0) {
+                LOG_ERROR("Freeing {}, which was not allocated by the heap", log_hex(addr));
+                return;
+            }
+        }
+        heap.large_count--;
+        heap.large_bytes -= heap_usable_size(state, addr);
+        free(state, addr);
+        return;
+    }
+
+    const size_t class_index = class_entry - 1;
+    heap.classes[class_index].used_blocks.fetch_sub(1, std::memory_order_relaxed);
+
+    std::vector<Address> &blocks = get_thread_cache(heap).blocks[class_index];
+    blocks.push_back(addr);
+
+    const uint32_t capacity = get_thread_cache_capacity(class_index);
+    if (blocks.size() > capacity) {
+        // give the oldest half back to the heap so that other threads can use them
+        const size_t count = blocks.size() - capacity / 2;
+        auto &free_blocks = heap.classes[class_index].free_blocks;
+        const std::lock_guard<std::mutex> lock(heap.mutex);
+        free_blocks.insert(free_blocks.end(), blocks.begin(), blocks.begin() + count);
+        blocks.erase(blocks.begin(), blocks.begin() + count);
+    }
+}
+
+uint32_t heap_usable_size(MemState &state, Address addr) {
+    if (!addr)
+        return 0;
+
+    const uint8_t class_entry = state.heap.page_classes[addr / HEAP_PAGE_SIZE];
+    if (class_entry != 0)
+        return HEAP_SIZE_CLASSES[class_entry - 1];
+
+    // large blocks span whole pages, memalign may have moved the start inside the first one
+    const uint32_t page_num = addr / state.page_size;
+    return state.alloc_table[page_num].size * state.page_size - (addr - page_num * state.page_size);
+}
+
+Address heap_realloc(MemState &state, Address addr, uint32_t size) {
+    if (!addr)
+        return heap_alloc(state, size);
+
+    if (size == 0) {
+        heap_free(state, addr);
+        return 0;
+    }
+
+    const uint32_t usable_size = heap_usable_size(state, addr);
+    if (size <= usable_size)
+        return addr;
+
+    const Address new_addr = heap_alloc(state, size);
+    if (!new_addr)
+        return 0;
+
+    memcpy(Ptr<uint8_t>(new_addr).get(state), Ptr<uint8_t>(addr).get(state), usable_size);
+    mark_written(state, new_addr, usable_size);
+    heap_free(state, addr);
+
+    return new_addr;
+}
+
+GuestHeapStats get_heap_stats(MemState &state) {
+    GuestHeap &heap = state.heap;
+    GuestHeapStats stats;
+
+    const std::lock_guard<std::mutex> lock(heap.mutex);
+    for (size_t i = 0; i < heap.classes.size(); i++) {
+        const GuestHeapClass &heap_class = heap.classes[i];
+        stats.classes.push_back({ HEAP_SIZE_CLASSES[i], heap_class.chunk_count, heap_class.used_blocks.load(std::memory_order_relaxed) });
+    }
+    stats.large_count = heap.large_count;
+    stats.large_bytes = heap.large_bytes;
+
+    return stats;
+}
@@ -335,6 +335,59 @@ bool handle_access_violation(MemState &state, uint8_t *addr, bool write) noexcep
     return true;
 }
 
+constexpr uint32_t WRITE_TRACKING_PAGE_SIZE = KiB(4);
+
+void enable_write_tracking(MemState &state) {
+    const size_t page_count = TOTAL_MEM_SIZE / WRITE_TRACKING_PAGE_SIZE;
+    state.page_write_generations = std::make_unique<std::atomic<uint32_t>[]>(page_count);
+    state.write_generation = 1;
+    state.track_writes = true;
+    LOG_INFO("Using software write tracking");
+}
+
+void mark_written(MemState &state, Address addr, uint32_t size) {
+    if (!state.track_writes || size == 0)
+        return;
+
+    // the generation only changes when a consumer takes a snapshot, so most writes only read the page entries
+    // and different cores writing to the same pages do not keep invalidating each other's cache line
+    const uint32_t generation = state.write_generation.load();
+    const uint32_t first_page = addr / WRITE_TRACKING_PAGE_SIZE;
+    const uint32_t last_page = (addr + (size - 1)) / WRITE_TRACKING_PAGE_SIZE;
+    for (uint32_t page = first_page; page <= last_page; page++) {
+        std::atomic<uint32_t> &page_generation = state.page_write_generations[page];
+        if (page_generation.load(std::memory_order_relaxed) != generation)
+            page_generation.store(generation, std::memory_order_release);
+    }
+}
+
+void mark_written(MemState &state, const void *data, uint32_t size) {
+    if (!state.track_writes || !data)
+        return;
+
+    mark_written(state, static_cast<Address>(static_cast<const uint8_t *>(data) - state.memory.get()), size);
+}
+
+uint32_t next_write_generation(MemState &state) {
+    if (!state.track_writes)
+        return 0;
+
+    return state.write_generation.fetch_add(1);
+}
+
+uint32_t get_write_generation(const MemState &state, Address addr, uint32_t size) {
+    if (!state.track_writes || size == 0)
+        return 0;
+
+    const uint32_t first_page = addr / WRITE_TRACKING_PAGE_SIZE;
+    const uint32_t last_page = (addr + (size - 1)) / WRITE_TRACKING_PAGE_SIZE;
+    uint32_t generation = 0;
+    for (uint32_t page = first_page; page <= last_page; page++)
+        generation = std::max(generation, state.page_write_generations[page].load(std::memory_order_acquire));
+
+    return generation;
+}
+
 bool add_protect(MemState &state, Address addr, const uint32_t size, const MemPerm perm, const ProtectCallback &callback) {
     const std::lock_guard<std::mutex> lock(state.protect_mutex);
     ProtectSegmentInfo protect(size, perm);
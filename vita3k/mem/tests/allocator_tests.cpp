@@ -21,6 +21,10 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <iostream>
+#include <random>
+
 TEST(bitmap_allocator, one_bit_allocation) {
     BitmapAllocator allocator(KiB(5));
 
@@ -243,3 +247,133 @@ TEST(bitmap_allocator, count_unaligned) {
     // 4 valid bits + 12 bits + 5 valid bits = 21
     ASSERT_EQ(alloc.free_slot_count(22, 92), 21);
 }
+
+namespace {
+
+// Allocation of the old linear scan, with the free runs ending at max_offset
+int linear_scan_allocation(const std::vector<std::uint32_t> &words, const std::size_t max_offset, const std::uint32_t start_offset, const int size, const bool best_fit) {
+    int best_offset = -1;
+    int best_length = 0;
+
+    std::size_t offset = start_offset & ~31U;
+    while (offset < max_offset) {
+        const auto is_free = [&](std::size_t bit) { return (words[bit >> 5] >> (31 - (bit & 31))) & 1; };
+        if (!is_free(offset)) {
+            offset++;
+            continue;
+        }
+
+        const std::size_t begin = offset;
+        while (offset < max_offset && is_free(offset))
+            offset++;
+
+        const int length = static_cast<int>(offset - begin);
+        if (length >= size && (best_offset == -1 || length < best_length)) {
+            best_offset = static_cast<int>(begin);
+            best_length = length;
+            if (!best_fit)
+                break;
+        }
+    }
+
+    return best_offset;
+}
+
+} // namespace
+
+TEST(bitmap_allocator, matches_linear_scan) {
+    constexpr int MEM_SIZE = KiB(8) + 17;
+
+    std::mt19937 rng(42);
+    BitmapAllocator allocator(MEM_SIZE);
+
+    for (int i = 0; i < 20000; ++i) {
+        const bool best_fit = rng() % 2;
+        const std::uint32_t start_offset = rng() % 4 == 0 ? rng() % MEM_SIZE : 0;
+        int size = rng() % 4 == 0 ? rng() % 200 + 1 : rng() % 8 + 1;
+
+        const int expected = linear_scan_allocation(allocator.words, allocator.max_offset, start_offset, size, best_fit);
+        ASSERT_EQ(allocator.allocate_from(start_offset, size, best_fit), expected);
+
+        // free a random range, partially free ones included
+        const int free_offset = rng() % MEM_SIZE;
+        allocator.free(free_offset, std::min<int>(rng() % 24 + 1, MEM_SIZE - free_offset));
+    }
+}
+
+TEST(bitmap_allocator, allocate_up_to_maximum) {
+    BitmapAllocator allocator(100);
+
+    int size = 100;
+    ASSERT_EQ(allocator.allocate_from(0, size), 0);
+    size = 1;
+    ASSERT_EQ(allocator.allocate_from(0, size), -1);
+
+    allocator.free(99, 1);
+    ASSERT_EQ(allocator.allocate_from(0, size), 99);
+
+    allocator.set_maximum(200);
+    size = 100;
+    ASSERT_EQ(allocator.allocate_from(0, size, true), 100);
+    ASSERT_EQ(allocator.free_slot_count(0, 200), 0);
+}
+
+// Allocate and free random sizes in a heavily fragmented bitmap
+TEST(bitmap_allocator_benchmark, fragmentation_stress) {
+    constexpr int MEM_SIZE = KiB(1024);
+    constexpr int MAX_CHUNK_SIZE = 64;
+    constexpr int OPERATIONS = 20000;
+
+    for (const bool best_fit : { false, true }) {
+        std::mt19937 rng(1234);
+        BitmapAllocator allocator(MEM_SIZE);
+
+        struct Chunk {
+            int offset;
+            int size;
+        };
+        std::vector<Chunk> chunks;
+
+        // fill the whole bitmap, then free every other chunk to leave small holes everywhere
+        while (true) {
+            int size = rng() % MAX_CHUNK_SIZE + 1;
+            const int offset = allocator.allocate_from(0, size);
+            if (offset < 0)
+                break;
+            chunks.push_back({ offset, size });
+        }
+        std::vector<Chunk> live_chunks;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            if (i % 2 == 0)
+                allocator.free(chunks[i].offset, chunks[i].size);
+            else
+                live_chunks.push_back(chunks[i]);
+        }
+
+        int failures = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < OPERATIONS; ++i) {
+            int size = rng() % (MAX_CHUNK_SIZE * 2) + 1;
+            const int offset = allocator.allocate_from(0, size, best_fit);
+            if (offset >= 0)
+                live_chunks.push_back({ offset, size });
+            else
+                failures++;
+
+            const size_t victim = rng() % live_chunks.size();
+            allocator.free(live_chunks[victim].offset, live_chunks[victim].size);
+            live_chunks[victim] = live_chunks.back();
+            live_chunks.pop_back();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        int used = 0;
+        for (const Chunk &chunk : live_chunks)
+            used += chunk.size;
+        ASSERT_EQ(allocator.free_slot_count(0, MEM_SIZE), MEM_SIZE - used);
+
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << (best_fit ? "best fit: " : "first fit: ") << OPERATIONS << " allocations in " << ms << " ms ("
+                  << ms * 1000.0 / OPERATIONS << " us per allocation, " << failures << " failed)" << std::endl;
+    }
+}
@@ -0,0 +1,169 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/functions.h>
+#include <mem/heap.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(guest_heap, small_blocks_share_pages) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    const uint32_t available = mem_available(mem);
+
+    std::set<Address> blocks;
+    for (int i = 0; i < 1000; i++) {
+        const Address addr = heap_alloc(mem, 16);
+        ASSERT_NE(addr, 0);
+        ASSERT_EQ(addr % 16, 0);
+        ASSERT_TRUE(blocks.insert(addr).second);
+    }
+
+    // 1000 blocks of 16 bytes fit in a single chunk
+    ASSERT_EQ(available - mem_available(mem), HEAP_CHUNK_SIZE);
+
+    for (const Address addr : blocks)
+        heap_free(mem, addr);
+
+    const GuestHeapStats stats = get_heap_stats(mem);
+    ASSERT_EQ(stats.classes[0].block_size, 16);
+    ASSERT_EQ(stats.classes[0].chunk_count, 1);
+    ASSERT_EQ(stats.classes[0].used_blocks, 0);
+}
+
+TEST(guest_heap, alignment) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    for (uint32_t alignment = 16; alignment <= KiB(64); alignment *= 2) {
+        const Address addr = heap_alloc(mem, 24, alignment);
+        ASSERT_NE(addr, 0);
+        ASSERT_EQ(addr % alignment, 0) << alignment;
+        ASSERT_GE(heap_usable_size(mem, addr), 24);
+        heap_free(mem, addr);
+    }
+}
+
+TEST(guest_heap, large_blocks_and_realloc) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    Address addr = heap_alloc(mem, 100);
+    ASSERT_EQ(heap_usable_size(mem, addr), 128);
+    memset(Ptr<uint8_t>(addr).get(mem), 0x5A, 100);
+
+    // grows in place as long as it fits in its block
+    ASSERT_EQ(heap_realloc(mem, addr, 128), addr);
+
+    addr = heap_realloc(mem, addr, KiB(100));
+    ASSERT_NE(addr, 0);
+    ASSERT_GE(heap_usable_size(mem, addr), KiB(100));
+    const uint8_t *data = Ptr<uint8_t>(addr).get(mem);
+    for (int i = 0; i < 100; i++)
+        ASSERT_EQ(data[i], 0x5A);
+
+    GuestHeapStats stats = get_heap_stats(mem);
+    ASSERT_EQ(stats.large_count, 1);
+    ASSERT_EQ(stats.large_bytes, KiB(100));
+
+    heap_free(mem, addr);
+    stats = get_heap_stats(mem);
+    ASSERT_EQ(stats.large_count, 0);
+    ASSERT_EQ(stats.large_bytes, 0);
+}
+
+TEST(guest_heap, realloc_marks_written) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    enable_write_tracking(mem);
+
+    const Address addr = heap_alloc(mem, KiB(100));
+    const uint32_t snapshot = next_write_generation(mem);
+
+    // the data moved to the new block is a write to it, the caches watching it must see it
+    const Address new_addr = heap_realloc(mem, addr, KiB(200));
+    ASSERT_NE(new_addr, addr);
+    ASSERT_GT(get_write_generation(mem, new_addr, KiB(100)), snapshot);
+    heap_free(mem, new_addr);
+}
+
+TEST(guest_heap, free_unknown_address) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    const Address addr = heap_alloc(mem, KiB(100));
+    const Address other = alloc(mem, KiB(8), "other");
+
+    // neither the stats nor the other allocation are touched
+    heap_free(mem, other);
+    heap_free(mem, addr + KiB(8));
+    GuestHeapStats stats = get_heap_stats(mem);
+    ASSERT_EQ(stats.large_count, 1);
+    ASSERT_EQ(stats.large_bytes, KiB(100));
+    ASSERT_EQ(heap_usable_size(mem, other), KiB(8));
+
+    heap_free(mem, addr);
+    heap_free(mem, addr);
+    stats = get_heap_stats(mem);
+    ASSERT_EQ(stats.large_count, 0);
+    ASSERT_EQ(stats.large_bytes, 0);
+}
+
+TEST(guest_heap, threads) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    constexpr int THREAD_COUNT = 8;
+    constexpr int BLOCK_COUNT = 2000;
+    std::vector<std::vector<Address>> blocks(THREAD_COUNT);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&mem, &thread_blocks = blocks[t], t] {
+            for (int i = 0; i < BLOCK_COUNT; i++) {
+                const uint32_t size = 8 + (i * 37 + t) % 2000;
+                const Address addr = heap_alloc(mem, size);
+                memset(Ptr<uint8_t>(addr).get(mem), t, size);
+                thread_blocks.push_back(addr);
+                // free some blocks allocated by the other threads too
+                if (i % 3 == 0) {
+                    heap_free(mem, thread_blocks.front());
+                    thread_blocks.erase(thread_blocks.begin());
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    std::set<Address> all_blocks;
+    for (const auto &thread_blocks : blocks) {
+        for (const Address addr : thread_blocks)
+            ASSERT_TRUE(all_blocks.insert(addr).second);
+    }
+
+    uint32_t used_blocks = 0;
+    for (const auto &heap_class : get_heap_stats(mem).classes)
+        used_blocks += heap_class.used_blocks;
+    ASSERT_EQ(used_blocks, all_blocks.size());
+}
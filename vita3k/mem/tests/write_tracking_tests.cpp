@@ -0,0 +1,123 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/functions.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+TEST(write_tracking, generation_changes_on_write) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    enable_write_tracking(mem);
+
+    const Address addr = alloc(mem, KiB(64), "write_tracking");
+    mark_written(mem, addr, KiB(64));
+
+    uint32_t snapshot = next_write_generation(mem);
+    ASSERT_LE(get_write_generation(mem, addr, KiB(16)), snapshot);
+    ASSERT_LE(get_write_generation(mem, addr + KiB(16), KiB(48)), snapshot);
+
+    // write outside of the range
+    mark_written(mem, addr + KiB(32), 4);
+    ASSERT_LE(get_write_generation(mem, addr, KiB(16)), snapshot);
+    ASSERT_GT(get_write_generation(mem, addr + KiB(16), KiB(48)), snapshot);
+
+    // write at the end of the last page of the range
+    mark_written(mem, addr + KiB(16) - 4, 4);
+    ASSERT_GT(get_write_generation(mem, addr, KiB(16)), snapshot);
+
+    // write across the boundary of the two ranges
+    snapshot = next_write_generation(mem);
+    mark_written(mem, addr + KiB(16) - 2, 4);
+    ASSERT_GT(get_write_generation(mem, addr, KiB(16)), snapshot);
+    ASSERT_GT(get_write_generation(mem, addr + KiB(16), KiB(48)), snapshot);
+}
+
+TEST(write_tracking, disabled_by_default) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    const Address addr = alloc(mem, KiB(16), "write_tracking");
+    const uint32_t snapshot = next_write_generation(mem);
+    mark_written(mem, addr, KiB(16));
+    ASSERT_LE(get_write_generation(mem, addr, KiB(16)), snapshot);
+}
+
+// Simulate a game rewriting all its dynamic textures every frame
+TEST(write_tracking_benchmark, against_protect) {
+    constexpr uint32_t TEXTURE_COUNT = 256;
+    constexpr uint32_t TEXTURE_SIZE = KiB(64);
+    constexpr uint32_t FRAMES = 20;
+
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    const Address base = alloc(mem, TEXTURE_COUNT * TEXTURE_SIZE, "textures");
+    uint32_t *const data = Ptr<uint32_t>(base).get(mem);
+
+    // the texture cache protects each uploaded texture, the first write to it faults
+    uint32_t faults = 0;
+    const auto protect_start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        for (uint32_t texture = 0; texture < TEXTURE_COUNT; texture++) {
+            add_protect(mem, base + texture * TEXTURE_SIZE, TEXTURE_SIZE, MemPerm::ReadOnly, [&](Address, bool) {
+                faults++;
+                return true;
+            });
+        }
+
+        for (uint32_t i = 0; i < TEXTURE_COUNT * TEXTURE_SIZE / 4; i++)
+            data[i] = frame;
+    }
+    const auto protect_end = std::chrono::steady_clock::now();
+
+    // with write tracking every store marks its page, the texture cache polls the generations
+    enable_write_tracking(mem);
+    std::vector<uint32_t> generations(TEXTURE_COUNT);
+    uint32_t dirty_textures = 0;
+    const auto tracking_start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        for (uint32_t texture = 0; texture < TEXTURE_COUNT; texture++)
+            generations[texture] = next_write_generation(mem);
+
+        for (uint32_t i = 0; i < TEXTURE_COUNT * TEXTURE_SIZE / 4; i++) {
+            data[i] = frame;
+            mark_written(mem, base + i * 4, 4);
+        }
+
+        for (uint32_t texture = 0; texture < TEXTURE_COUNT; texture++) {
+            if (get_write_generation(mem, base + texture * TEXTURE_SIZE, TEXTURE_SIZE) > generations[texture])
+                dirty_textures++;
+        }
+    }
+    const auto tracking_end = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(faults, TEXTURE_COUNT * FRAMES);
+    ASSERT_EQ(dirty_textures, TEXTURE_COUNT * FRAMES);
+
+    const double protect_ms = std::chrono::duration<double, std::milli>(protect_end - protect_start).count();
+    const double tracking_ms = std::chrono::duration<double, std::milli>(tracking_end - tracking_start).count();
+    std::cout << "protect: " << faults << " faults in " << protect_ms << " ms ("
+              << faults / (protect_ms / 1000.0) << " faults/s, " << protect_ms * 1000.0 / faults << " us per texture)" << std::endl;
+    std::cout << "write tracking: " << dirty_textures << " dirty textures in " << tracking_ms << " ms ("
+              << tracking_ms * 1000.0 / dirty_textures << " us per texture)" << std::endl;
+}
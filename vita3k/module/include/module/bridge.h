@@ -28,7 +28,7 @@
 #include <config/state.h>
 #include <emuenv/state.h>
 
-using ImportFn = std::function<void(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id)>;
+using ImportFn = void (*)(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id);
 using ImportVarFactory = std::function<Address(EmuEnvState &emuenv)>;
 
 // Function returns a value that is written to CPU registers.
@@ -44,17 +44,38 @@ void call(void (*export_fn)(EmuEnvState &, SceUID, const char *, Args...), const
     (*export_fn)(emuenv, thread_id, export_name, read<Args, indices, Args...>(cpu, args_layout, state, emuenv.mem)...);
 }
 
-template <typename Ret, typename... Args>
-ImportFn bridge(Ret (*export_fn)(EmuEnvState &, SceUID, const char *, Args...), const char *export_name) {
-    constexpr std::tuple<ArgsLayout<Args...>, LayoutArgsState> args_layout = lay_out<typename BridgeTypes<Args>::ArmType...>();
+// Reads the arguments from the guest registers and stack, calls the export and writes back its return value.
+// The export and its name are template parameters, so the argument layout is computed at compile time
+// and every export gets its own plain function, without any type erasure.
+template <auto export_fn, const char *export_name, typename Ret, typename... Args>
+constexpr ImportFn make_bridge(Ret (*)(EmuEnvState &, SceUID, const char *, Args...)) {
+    return [](EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
+        static constexpr std::tuple<ArgsLayout<Args...>, LayoutArgsState> args_layout = lay_out<typename BridgeTypes<Args>::ArmType...>();
+        using Indices = std::index_sequence_for<Args...>;
+
+        call(export_fn, export_name, std::get<0>(args_layout), std::get<1>(args_layout), Indices(), thread_id, cpu, emuenv);
+    };
+}
 
-    return [export_fn, export_name, args_layout](EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
 #ifdef TRACY_ENABLE
+// Same as make_bridge, with a Tracy zone named after the export around the call
+template <auto export_fn, const char *export_name>
+constexpr ImportFn make_traced_bridge() {
+    return [](EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
+        constexpr ImportFn bridged = make_bridge<export_fn, export_name>(export_fn);
+
         ZoneNamedC(___tracy_scoped_zone, 0xFFF34C, emuenv.cfg.tracy_primitive_impl); // Tracy - Track function scope and set color to yellow
         ZoneNameV(___tracy_scoped_zone, export_name, strlen(export_name)); // Tracy - Edit scope name based on export_name
+        bridged(emuenv, cpu, thread_id);
+    };
+}
 #endif
 
-        using Indices = std::index_sequence_for<Args...>;
-        call(export_fn, export_name, std::get<0>(args_layout), std::get<1>(args_layout), Indices(), thread_id, cpu, emuenv);
-    };
+template <auto export_fn, const char *export_name>
+constexpr ImportFn bridge() {
+#ifdef TRACY_ENABLE
+    return make_traced_bridge<export_fn, export_name>();
+#else
+    return make_bridge<export_fn, export_name>(export_fn);
+#endif
 }
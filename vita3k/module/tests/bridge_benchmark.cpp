@@ -0,0 +1,136 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+// Measures the per-call overhead of the HLE bridge from module/bridge.h, on a stub CPU which keeps
+// its registers in an array, so that only the dispatch, the argument reading and the return value are measured.
+// The same bridge behind a std::function, as ImportFn used to be, is measured for comparison.
+
+#include <module/module.h>
+
+#include <cpu/impl/interface.h>
+#include <cpu/state.h>
+#include <emuenv/state.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+
+namespace {
+
+struct StubCPU : CPUInterface {
+    std::array<uint32_t, 16> regs{};
+    std::array<float, 32> float_regs{};
+    uint32_t cpsr = 0;
+    uint32_t fpscr = 0;
+    uint32_t tpidruro = 0;
+
+    int run() override { return 0; }
+    void stop() override {}
+
+    uint32_t get_reg(uint8_t idx) override { return regs[idx]; }
+    void set_reg(uint8_t idx, uint32_t val) override { regs[idx] = val; }
+
+    uint32_t get_sp() override { return regs[13]; }
+    void set_sp(uint32_t val) override { regs[13] = val; }
+
+    uint32_t get_pc() override { return regs[15]; }
+    void set_pc(uint32_t val) override { regs[15] = val; }
+
+    uint32_t get_lr() override { return regs[14]; }
+    void set_lr(uint32_t val) override { regs[14] = val; }
+
+    uint32_t get_cpsr() override { return cpsr; }
+    void set_cpsr(uint32_t val) override { cpsr = val; }
+
+    uint32_t get_tpidruro() override { return tpidruro; }
+    void set_tpidruro(uint32_t val) override { tpidruro = val; }
+
+    float get_float_reg(uint8_t idx) override { return float_regs[idx]; }
+    void set_float_reg(uint8_t idx, float val) override { float_regs[idx] = val; }
+
+    uint32_t get_fpscr() override { return fpscr; }
+    void set_fpscr(uint32_t val) override { fpscr = val; }
+
+    CPUContext save_context() override { return {}; }
+    void load_context(const CPUContext &ctx) override {}
+    void invalidate_jit_cache(Address start, size_t length) override {}
+
+    bool is_thumb_mode() override { return false; }
+    int step() override { return 0; }
+
+    bool hit_breakpoint() override { return false; }
+    void trigger_breakpoint() override {}
+    void set_log_code(bool log) override {}
+    void set_log_mem(bool log) override {}
+    bool get_log_code() override { return false; }
+    bool get_log_mem() override { return false; }
+};
+
+uint64_t export_calls = 0;
+
+// Small enough to keep the test run short, the results are only indicative
+constexpr int CALL_COUNT = 100'000;
+
+template <typename Fn>
+double measure_ns_per_call(const Fn &fn, EmuEnvState &emuenv, CPUState &cpu) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CALL_COUNT; i++) {
+        write_reg(cpu, 0, i);
+        write_reg(cpu, 1, 1);
+        fn(emuenv, cpu, 1);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / CALL_COUNT;
+}
+
+} // namespace
+
+EXPORT(int32_t, bridge_benchmark_add, int32_t a, int32_t b) {
+    export_calls++;
+    return a + b;
+}
+
+TEST(bridge_benchmark, per_call_overhead) {
+    EmuEnvState emuenv;
+    CPUState cpu;
+    cpu.cpu = std::make_unique<StubCPU>();
+
+    // the real bridge reads r0 and r1 and writes the result to r0
+    write_reg(cpu, 0, 5);
+    write_reg(cpu, 1, 7);
+    import_bridge_benchmark_add(emuenv, cpu, 1);
+    ASSERT_EQ(read_reg(cpu, 0), 12u);
+
+    // Stored in volatile locations so that the calls can't be resolved at compile time
+    static volatile ImportFn fn_bridge = import_bridge_benchmark_add;
+    static const std::function<void(EmuEnvState &, CPUState &, SceUID)> std_bridge = import_bridge_benchmark_add;
+
+    export_calls = 0;
+    const ImportFn fn = fn_bridge;
+    const double function_pointer_ns = measure_ns_per_call(fn, emuenv, cpu);
+    const double std_function_ns = measure_ns_per_call(std_bridge, emuenv, cpu);
+
+    std::cout << "function pointer bridge: " << function_pointer_ns << " ns/call" << std::endl;
+    std::cout << "std::function bridge: " << std_function_ns << " ns/call" << std::endl;
+
+    ASSERT_EQ(export_calls, 2 * static_cast<uint64_t>(CALL_COUNT));
+    ASSERT_EQ(read_reg(cpu, 0), static_cast<uint32_t>(CALL_COUNT));
+}
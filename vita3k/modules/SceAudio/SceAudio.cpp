@@ -183,6 +183,7 @@ EXPORT(int, sceAudioOutOpenPort, SceAudioOutPortType type, int len, int freq, Sc
     const std::lock_guard<std::mutex> lock(emuenv.audio.mutex);
     const int port_id = emuenv.audio.next_port_id++;
     emuenv.audio.out_ports.emplace(port_id, port);
+    emuenv.audio.out_ports_version++;
 
     return port_id;
 }
@@ -228,6 +229,7 @@ EXPORT(int, sceAudioOutReleasePort, int port) {
     if (!emuenv.audio.out_ports.erase(port)) {
         return RET_ERROR(SCE_AUDIO_OUT_ERROR_INVALID_PORT);
     }
+    emuenv.audio.out_ports_version++;
 
     return 0;
 }
@@ -290,6 +292,7 @@ EXPORT(int, sceAudioOutSetConfig, int port, int len, int freq, int mode) {
 
     const std::lock_guard<std::mutex> lock(emuenv.audio.mutex);
     emuenv.audio.out_ports.emplace(port, prt);
+    emuenv.audio.out_ports_version++;
 
     return 0;
 }
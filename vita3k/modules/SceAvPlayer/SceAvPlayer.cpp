@@ -20,6 +20,7 @@
 #include <codec/state.h>
 #include <io/functions.h>
 #include <kernel/state.h>
+#include <mem/functions.h>
 
 #include <util/lock_and_find.h>
 #include <util/log.h>
@@ -334,13 +335,14 @@ EXPORT(bool, sceAvPlayerGetAudioData, SceUID player_handle, SceAvPlayerFrameInfo
                 player_info->player.last_sample_count * sizeof(int16_t) * player_info->player.last_channels, true);
         }
     } else {
-        std::vector<int16_t> data = player_info->player.receive_audio();
+        const std::vector<int16_t> &data = player_info->player.receive_audio();
 
         if (data.empty())
             return false;
 
         buffer = get_buffer(player_info, MediaType::AUDIO, emuenv.mem, (uint32_t)data.size() * sizeof(int16_t), false);
         std::memcpy(buffer.get(emuenv.mem), data.data(), data.size() * sizeof(int16_t));
+        mark_written(emuenv.mem, buffer.address(), data.size() * sizeof(int16_t));
     }
 
     frame_info->timestamp = player_info->player.last_timestamp;
@@ -411,8 +413,9 @@ EXPORT(bool, sceAvPlayerGetVideoData, SceUID player_handle, SceAvPlayerFrameInfo
         } else {
             buffer = get_buffer(player_info, MediaType::VIDEO, emuenv.mem, H264DecoderState::buffer_size(size), true);
 
-            std::vector<uint8_t> data = player_info->player.receive_video();
+            const std::vector<uint8_t> &data = player_info->player.receive_video();
             std::memcpy(buffer.get(emuenv.mem), data.data(), data.size());
+            mark_written(emuenv.mem, buffer.address(), data.size());
         }
     } else {
         buffer = get_buffer(player_info, MediaType::VIDEO, emuenv.mem, H264DecoderState::buffer_size(size), false);
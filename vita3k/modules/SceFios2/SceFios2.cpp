@@ -17,6 +17,65 @@
 
 #include <module/module.h>
 
+#include <io/functions.h>
+#include <io/state.h>
+#include <mem/functions.h>
+
+// Only the synchronous reads and the cache functions are implemented here, on top of the block cache of io.
+// libfios2 is loaded from the firmware unless the modules are chosen manually, it then uses sceIo itself.
+// The file handles are the fds of io.
+
+typedef SceInt32 SceFiosFH;
+typedef SceInt64 SceFiosOffset;
+typedef SceInt64 SceFiosSize;
+
+enum SceFiosErrorCode : uint32_t {
+    SCE_FIOS_OK = 0,
+    SCE_FIOS_ERROR_BAD_PATH = 0x80820005,
+    SCE_FIOS_ERROR_BAD_PTR = 0x80820006,
+    SCE_FIOS_ERROR_BAD_OFFSET = 0x80820007,
+    SCE_FIOS_ERROR_BAD_FH = 0x8082000B,
+};
+
+enum SceFiosWhence : int32_t {
+    SCE_FIOS_SEEK_SET = 0,
+    SCE_FIOS_SEEK_CUR = 1,
+    SCE_FIOS_SEEK_END = 2,
+};
+
+// Not used, the operations are run right away
+struct SceFiosOpAttr;
+struct SceFiosOpenParams;
+
+// The FIOS paths go through the overlays, then /app0/... is app0:/...
+static std::string resolve_fios_path(EmuEnvState &emuenv, const char *path) {
+    std::string resolved = resolve_path(emuenv.io, path);
+    if (resolved.starts_with('/')) {
+        const size_t device_end = resolved.find('/', 1);
+        if (device_end == std::string::npos)
+            resolved = resolved.substr(1) + ":";
+        else
+            resolved = resolved.substr(1, device_end - 1) + ":" + resolved.substr(device_end);
+    }
+
+    return resolved;
+}
+
+static SceUID open_fios_file(EmuEnvState &emuenv, const char *path, const char *export_name) {
+    if (!path)
+        return -1;
+
+    return open_file(emuenv.io, resolve_fios_path(emuenv, path).c_str(), SCE_O_RDONLY, emuenv.pref_path, export_name);
+}
+
+static SceFiosSize get_file_size(EmuEnvState &emuenv, SceUID fd, const char *export_name) {
+    SceIoStat stat;
+    if (stat_file_by_fd(emuenv.io, fd, &stat, emuenv.pref_path, export_name) < 0)
+        return -1;
+
+    return stat.st_size;
+}
+
 EXPORT(int, sceFiosArchiveGetDecompressorThreadCount) {
     return UNIMPLEMENTED();
 }
@@ -49,24 +108,43 @@ EXPORT(int, sceFiosArchiveUnmountSync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosCacheContainsFileRangeSync) {
-    return UNIMPLEMENTED();
+EXPORT(bool, sceFiosCacheContainsFileRangeSync, const SceFiosOpAttr *pAttr, const char *pPath, SceFiosOffset startOffset, SceFiosSize length) {
+    const SceUID fd = open_fios_file(emuenv, pPath, export_name);
+    if (fd < 0)
+        return false;
+
+    const bool contained = is_file_cached(emuenv.io, fd, startOffset, length);
+    close_file(emuenv.io, fd, export_name);
+    return contained;
 }
 
-EXPORT(int, sceFiosCacheContainsFileSync) {
-    return UNIMPLEMENTED();
+EXPORT(bool, sceFiosCacheContainsFileSync, const SceFiosOpAttr *pAttr, const char *pPath) {
+    const SceUID fd = open_fios_file(emuenv, pPath, export_name);
+    if (fd < 0)
+        return false;
+
+    const bool contained = is_file_cached(emuenv.io, fd, 0, get_file_size(emuenv, fd, export_name));
+    close_file(emuenv.io, fd, export_name);
+    return contained;
 }
 
 EXPORT(int, sceFiosCacheFlushFileRangeSync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosCacheFlushFileSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCacheFlushFileSync, const SceFiosOpAttr *pAttr, const char *pPath) {
+    const SceUID fd = open_fios_file(emuenv, pPath, export_name);
+    if (fd < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    flush_cached_file(emuenv.io, fd, export_name);
+    close_file(emuenv.io, fd, export_name);
+    return SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCacheFlushSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCacheFlushSync, const SceFiosOpAttr *pAttr) {
+    emuenv.io.block_cache.flush();
+    return SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosCachePrefetchFH) {
@@ -77,12 +155,21 @@ EXPORT(int, sceFiosCachePrefetchFHRange) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosCachePrefetchFHRangeSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCachePrefetchFHRangeSync, const SceFiosOpAttr *pAttr, SceFiosFH fh, SceFiosOffset startOffset, SceFiosSize length) {
+    if (startOffset < 0 || length < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_OFFSET);
+    if (prefetch_cached_file(emuenv.io, fh, startOffset, length, export_name) < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    return SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCachePrefetchFHSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCachePrefetchFHSync, const SceFiosOpAttr *pAttr, SceFiosFH fh) {
+    const SceFiosSize size = get_file_size(emuenv, fh, export_name);
+    if (size < 0 || prefetch_cached_file(emuenv.io, fh, 0, size, export_name) < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    return SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosCachePrefetchFile) {
@@ -241,8 +328,12 @@ EXPORT(int, sceFiosFHClose) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHCloseSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosFHCloseSync, const SceFiosOpAttr *pAttr, SceFiosFH fh) {
+    emuenv.io.async.forget_file(fh);
+    if (close_file(emuenv.io, fh, export_name) < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    return SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosFHGetOpenParams) {
@@ -253,8 +344,12 @@ EXPORT(int, sceFiosFHGetPath) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHGetSize) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosFHGetSize, SceFiosFH fh) {
+    const SceFiosSize size = get_file_size(emuenv, fh, export_name);
+    if (size < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    return size;
 }
 
 EXPORT(int, sceFiosFHIoctl) {
@@ -269,8 +364,16 @@ EXPORT(int, sceFiosFHOpen) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHOpenSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosFHOpenSync, const SceFiosOpAttr *pAttr, SceFiosFH *pOutFH, const char *pPath, const SceFiosOpenParams *pOpenParams) {
+    if (!pOutFH)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PTR);
+
+    const SceUID fd = open_fios_file(emuenv, pPath, export_name);
+    if (fd < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    *pOutFH = fd;
+    return SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosFHOpenWithMode) {
@@ -285,8 +388,18 @@ EXPORT(int, sceFiosFHPread) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHPreadSync) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosFHPreadSync, const SceFiosOpAttr *pAttr, SceFiosFH fh, void *pBuf, SceFiosSize length, SceFiosOffset offset) {
+    if (!pBuf)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PTR);
+    if (offset < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_OFFSET);
+
+    const int read = read_file_at(pBuf, emuenv.io, fh, static_cast<SceSize>(length), offset, export_name);
+    if (read < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    mark_written(emuenv.mem, pBuf, read);
+    return read;
 }
 
 EXPORT(int, sceFiosFHPreadv) {
@@ -317,8 +430,16 @@ EXPORT(int, sceFiosFHRead) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHReadSync) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosFHReadSync, const SceFiosOpAttr *pAttr, SceFiosFH fh, void *pBuf, SceFiosSize length) {
+    if (!pBuf)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PTR);
+
+    const int read = read_file(pBuf, emuenv.io, fh, static_cast<SceSize>(length), export_name);
+    if (read < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    mark_written(emuenv.mem, pBuf, read);
+    return read;
 }
 
 EXPORT(int, sceFiosFHReadv) {
@@ -329,8 +450,12 @@ EXPORT(int, sceFiosFHReadvSync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHSeek) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOffset, sceFiosFHSeek, SceFiosFH fh, SceFiosOffset offset, SceFiosWhence whence) {
+    const SceOff position = seek_file(fh, offset, static_cast<SceIoSeekMode>(whence), emuenv.io, export_name);
+    if (position < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_OFFSET);
+
+    return position;
 }
 
 EXPORT(int, sceFiosFHStat) {
@@ -349,8 +474,12 @@ EXPORT(int, sceFiosFHSyncSync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFHTell) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOffset, sceFiosFHTell, SceFiosFH fh) {
+    const SceOff position = tell_file(emuenv.io, fh, export_name);
+    if (position < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_FH);
+
+    return position;
 }
 
 EXPORT(int, sceFiosFHToFileno) {
@@ -393,24 +522,48 @@ EXPORT(int, sceFiosFileExists) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFileExistsSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosFileExistsSync, const SceFiosOpAttr *pAttr, const char *pPath, bool *pOutExists) {
+    if (!pOutExists)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PTR);
+
+    SceIoStat stat;
+    *pOutExists = stat_file(emuenv.io, resolve_fios_path(emuenv, pPath).c_str(), &stat, emuenv.pref_path, export_name) >= 0 && (stat.st_attr & SCE_SO_IFREG);
+    return SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosFileGetSize) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFileGetSizeSync) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosFileGetSizeSync, const SceFiosOpAttr *pAttr, const char *pPath) {
+    SceIoStat stat;
+    if (stat_file(emuenv.io, resolve_fios_path(emuenv, pPath).c_str(), &stat, emuenv.pref_path, export_name) < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return stat.st_size;
 }
 
 EXPORT(int, sceFiosFileRead) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosFileReadSync) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosFileReadSync, const SceFiosOpAttr *pAttr, const char *pPath, void *pBuf, SceFiosSize length, SceFiosOffset offset) {
+    if (!pBuf)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PTR);
+    if (offset < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_OFFSET);
+
+    const SceUID fd = open_fios_file(emuenv, pPath, export_name);
+    if (fd < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    const int read = read_file_at(pBuf, emuenv.io, fd, static_cast<SceSize>(length), offset, export_name);
+    close_file(emuenv.io, fd, export_name);
+    if (read < 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_OFFSET);
+
+    mark_written(emuenv.mem, pBuf, read);
+    return read;
 }
 
 EXPORT(int, sceFiosFileTruncate) {
@@ -18,11 +18,36 @@
 #include "SceIofilemgr.h"
 
 #include <io/functions.h>
+#include <kernel/state.h>
+#include <kernel/sync_primitives.h>
 #include <kernel/types.h>
+#include <mem/functions.h>
 
 #include <util/tracy.h>
 TRACY_MODULE_NAME(SceIofilemgr);
 
+// The operation uid is a simple event set once the operation is done, any bit the guest waits for is set.
+// sceIoComplete then gives the result and releases the uid.
+constexpr SceUInt32 ASYNC_IO_DONE_PATTERN = 0xFFFFFFFF;
+
+SceUID submit_async_io(EmuEnvState &emuenv, const char *export_name, SceUID thread_id, SceUID fd, Ptr<SceIoAsyncParam> param, AsyncIo::Operation operation) {
+    const SceUID id = simple_event_create(emuenv.kernel, emuenv.mem, export_name, "SceIoAsyncOp", thread_id, 0, 0);
+    if (id < 0)
+        return id;
+
+    {
+        const std::lock_guard<std::mutex> lock(emuenv.io.files_mutex);
+        emuenv.io.async_params.emplace(id, param);
+    }
+
+    const int priority = emuenv.io.async.get_priority(fd, thread_id);
+    emuenv.io.async.submit(id, fd, priority, std::move(operation), [&emuenv, export_name, thread_id, id](SceInt64) {
+        simple_event_setorpulse(emuenv.kernel, export_name, thread_id, id, ASYNC_IO_DONE_PATTERN, 0, true);
+    });
+
+    return id;
+}
+
 EXPORT(int, _sceIoChstat) {
     TRACY_FUNC(_sceIoChstat);
     return UNIMPLEMENTED();
@@ -71,9 +96,14 @@ EXPORT(int, _sceIoGetstat, const char *file, SceIoStat *stat) {
     return stat_file(emuenv.io, file, stat, emuenv.pref_path, export_name);
 }
 
-EXPORT(int, _sceIoGetstatAsync) {
-    TRACY_FUNC(_sceIoGetstatAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, _sceIoGetstatAsync, const char *file, SceIoStat *stat, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(_sceIoGetstatAsync, file, stat, param);
+    if (!file || !stat)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, invalid_fd, param, [&emuenv, export_name, path = std::string(file), stat]() -> SceInt64 {
+        return stat_file(emuenv.io, path.c_str(), stat, emuenv.pref_path, export_name);
+    });
 }
 
 EXPORT(int, _sceIoGetstatByFd, const SceUID fd, SceIoStat *stat) {
@@ -96,9 +126,16 @@ EXPORT(SceOff, _sceIoLseek, const SceUID fd, Ptr<_sceIoLseekOpt> opt) {
     return seek_file(fd, opt.get(emuenv.mem)->offset, opt.get(emuenv.mem)->whence, emuenv.io, export_name);
 }
 
-EXPORT(int, _sceIoLseekAsync) {
-    TRACY_FUNC(_sceIoLseekAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, _sceIoLseekAsync, const SceUID fd, Ptr<_sceIoLseekOpt> opt, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(_sceIoLseekAsync, fd, opt, param);
+    if (!opt)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    const SceOff offset = opt.get(emuenv.mem)->offset;
+    const SceIoSeekMode whence = opt.get(emuenv.mem)->whence;
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, offset, whence]() -> SceInt64 {
+        return seek_file(fd, offset, whence, emuenv.io, export_name);
+    });
 }
 
 EXPORT(int, _sceIoMkdir, const char *dir, const SceMode mode) {
@@ -106,9 +143,14 @@ EXPORT(int, _sceIoMkdir, const char *dir, const SceMode mode) {
     return create_dir(emuenv.io, dir, mode, emuenv.pref_path, export_name);
 }
 
-EXPORT(int, _sceIoMkdirAsync) {
-    TRACY_FUNC(_sceIoMkdirAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, _sceIoMkdirAsync, const char *dir, const SceMode mode, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(_sceIoMkdirAsync, dir, mode, param);
+    if (!dir)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, invalid_fd, param, [&emuenv, export_name, path = std::string(dir), mode]() -> SceInt64 {
+        return create_dir(emuenv.io, path.c_str(), mode, emuenv.pref_path, export_name);
+    });
 }
 
 EXPORT(int, _sceIoOpen, const char *file, const int flags, const SceMode mode) {
@@ -120,9 +162,15 @@ EXPORT(int, _sceIoOpen, const char *file, const int flags, const SceMode mode) {
     return open_file(emuenv.io, file, flags, emuenv.pref_path, export_name);
 }
 
-EXPORT(int, _sceIoOpenAsync) {
-    TRACY_FUNC(_sceIoOpenAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, _sceIoOpenAsync, const char *file, const int flags, const SceMode mode, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(_sceIoOpenAsync, file, flags, mode, param);
+    if (file == nullptr) {
+        return RET_ERROR(SCE_ERROR_ERRNO_EINVAL);
+    }
+    LOG_INFO("Opening file asynchronously: {}", file);
+    return submit_async_io(emuenv, export_name, thread_id, invalid_fd, param, [&emuenv, export_name, path = std::string(file), flags]() -> SceInt64 {
+        return open_file(emuenv.io, path.c_str(), flags, emuenv.pref_path, export_name);
+    });
 }
 
 EXPORT(int, _sceIoPread) {
@@ -185,9 +233,14 @@ EXPORT(int, _sceIoSyncAsync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoCancel) {
-    TRACY_FUNC(sceIoCancel);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoCancel, const SceUID id) {
+    TRACY_FUNC(sceIoCancel, id);
+    if (!emuenv.io.async.cancel(id, static_cast<SceInt32>(SCE_KERNEL_ERROR_CANCELING))) {
+        // already running or done
+        return RET_ERROR(SCE_KERNEL_ERROR_NOT_QUEUED);
+    }
+
+    return 0;
 }
 
 EXPORT(int, sceIoChstatByFdAsync) {
@@ -197,17 +250,45 @@ EXPORT(int, sceIoChstatByFdAsync) {
 
 EXPORT(int, sceIoClose, const SceUID fd) {
     TRACY_FUNC(sceIoClose, fd);
+    emuenv.io.async.forget_file(fd);
     return close_file(emuenv.io, fd, export_name);
 }
 
-EXPORT(int, sceIoCloseAsync) {
-    TRACY_FUNC(sceIoCloseAsync);
-    return UNIMPLEMENTED();
-}
+EXPORT(SceUID, sceIoCloseAsync, const SceUID fd, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoCloseAsync, fd, param);
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd]() -> SceInt64 {
+        emuenv.io.async.forget_file(fd);
+        return close_file(emuenv.io, fd, export_name);
+    });
+}
+
+EXPORT(int, sceIoComplete, const SceUID id) {
+    TRACY_FUNC(sceIoComplete, id);
+    SceInt64 result = 0;
+    switch (emuenv.io.async.complete(id, result)) {
+    case AsyncIoStatus::Unknown:
+        return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_UID);
+    case AsyncIoStatus::Waiting:
+    case AsyncIoStatus::Running:
+        return RET_ERROR(SCE_KERNEL_ERROR_ON_TRANSFERRING);
+    case AsyncIoStatus::Done:
+        break;
+    }
 
-EXPORT(int, sceIoComplete) {
-    TRACY_FUNC(sceIoComplete);
-    return UNIMPLEMENTED();
+    Ptr<SceIoAsyncParam> param;
+    {
+        const std::lock_guard<std::mutex> lock(emuenv.io.files_mutex);
+        param = emuenv.io.async_params[id];
+        emuenv.io.async_params.erase(id);
+    }
+
+    if (param) {
+        param.get(emuenv.mem)->result = static_cast<SceInt32>(result);
+        param.get(emuenv.mem)->result_high = static_cast<SceInt32>(result >> 32);
+    }
+
+    simple_event_delete(emuenv.kernel, export_name, thread_id, id);
+    return 0;
 }
 
 EXPORT(int, sceIoDclose, const SceUID fd) {
@@ -215,19 +296,31 @@ EXPORT(int, sceIoDclose, const SceUID fd) {
     return close_dir(emuenv.io, fd, export_name);
 }
 
-EXPORT(int, sceIoDcloseAsync) {
-    TRACY_FUNC(sceIoDcloseAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoDcloseAsync, const SceUID fd, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoDcloseAsync, fd, param);
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd]() -> SceInt64 {
+        return close_dir(emuenv.io, fd, export_name);
+    });
 }
 
-EXPORT(int, sceIoDopenAsync) {
-    TRACY_FUNC(sceIoDopenAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoDopenAsync, const char *dir, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoDopenAsync, dir, param);
+    if (!dir)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, invalid_fd, param, [&emuenv, export_name, path = std::string(dir)]() -> SceInt64 {
+        return open_dir(emuenv.io, path.c_str(), emuenv.pref_path, export_name);
+    });
 }
 
-EXPORT(int, sceIoDreadAsync) {
-    TRACY_FUNC(sceIoDreadAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoDreadAsync, const SceUID fd, SceIoDirent *dir, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoDreadAsync, fd, dir, param);
+    if (dir == nullptr) {
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+    }
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, dir]() -> SceInt64 {
+        return read_dir(emuenv.io, fd, dir, emuenv.pref_path, export_name);
+    });
 }
 
 EXPORT(int, sceIoFlockForSystem) {
@@ -235,9 +328,13 @@ EXPORT(int, sceIoFlockForSystem) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoGetPriority) {
-    TRACY_FUNC(sceIoGetPriority);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoGetPriority, const SceUID fd) {
+    TRACY_FUNC(sceIoGetPriority, fd);
+    int priority;
+    if (!emuenv.io.async.get_file_priority(fd, priority))
+        return emuenv.io.async.get_priority(fd, thread_id);
+
+    return priority;
 }
 
 EXPORT(int, sceIoGetPriorityForSystem) {
@@ -247,12 +344,12 @@ EXPORT(int, sceIoGetPriorityForSystem) {
 
 EXPORT(int, sceIoGetProcessDefaultPriority) {
     TRACY_FUNC(sceIoGetProcessDefaultPriority);
-    return UNIMPLEMENTED();
+    return emuenv.io.async.get_process_default_priority();
 }
 
 EXPORT(int, sceIoGetThreadDefaultPriority) {
     TRACY_FUNC(sceIoGetThreadDefaultPriority);
-    return UNIMPLEMENTED();
+    return emuenv.io.async.get_thread_default_priority(thread_id);
 }
 
 EXPORT(int, sceIoGetThreadDefaultPriorityForSystem) {
@@ -260,9 +357,14 @@ EXPORT(int, sceIoGetThreadDefaultPriorityForSystem) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoGetstatByFdAsync) {
-    TRACY_FUNC(sceIoGetstatByFdAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoGetstatByFdAsync, const SceUID fd, SceIoStat *stat, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoGetstatByFdAsync, fd, stat, param);
+    if (!stat)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, stat]() -> SceInt64 {
+        return stat_file_by_fd(emuenv.io, fd, stat, emuenv.pref_path, export_name);
+    });
 }
 
 EXPORT(int, sceIoLseek32, const SceUID fd, const int32_t offset, const SceIoSeekMode whence) {
@@ -272,17 +374,29 @@ EXPORT(int, sceIoLseek32, const SceUID fd, const int32_t offset, const SceIoSeek
 
 EXPORT(int, sceIoRead, const SceUID fd, void *data, const SceSize size) {
     TRACY_FUNC(sceIoRead, fd, data, size);
-    return read_file(data, emuenv.io, fd, size, export_name);
+    const int res = read_file(data, emuenv.io, fd, size, export_name);
+    if (res > 0)
+        mark_written(emuenv.mem, data, res);
+    return res;
 }
 
-EXPORT(int, sceIoReadAsync) {
-    TRACY_FUNC(sceIoReadAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoReadAsync, const SceUID fd, void *data, const SceSize size, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoReadAsync, fd, data, size, param);
+    if (!data)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, data, size]() -> SceInt64 {
+        const int res = read_file(data, emuenv.io, fd, size, export_name);
+        if (res > 0)
+            mark_written(emuenv.mem, data, res);
+        return res;
+    });
 }
 
-EXPORT(int, sceIoSetPriority) {
-    TRACY_FUNC(sceIoSetPriority);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoSetPriority, const SceUID fd, const int priority) {
+    TRACY_FUNC(sceIoSetPriority, fd, priority);
+    emuenv.io.async.set_file_priority(fd, priority);
+    return 0;
 }
 
 EXPORT(int, sceIoSetPriorityForSystem) {
@@ -290,14 +404,16 @@ EXPORT(int, sceIoSetPriorityForSystem) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoSetProcessDefaultPriority) {
-    TRACY_FUNC(sceIoSetProcessDefaultPriority);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoSetProcessDefaultPriority, const int priority) {
+    TRACY_FUNC(sceIoSetProcessDefaultPriority, priority);
+    emuenv.io.async.set_process_default_priority(priority);
+    return 0;
 }
 
-EXPORT(int, sceIoSetThreadDefaultPriority) {
-    TRACY_FUNC(sceIoSetThreadDefaultPriority);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoSetThreadDefaultPriority, const int priority) {
+    TRACY_FUNC(sceIoSetThreadDefaultPriority, priority);
+    emuenv.io.async.set_thread_default_priority(thread_id, priority);
+    return 0;
 }
 
 EXPORT(int, sceIoSetThreadDefaultPriorityForSystem) {
@@ -320,7 +436,12 @@ EXPORT(int, sceIoWrite, const SceUID fd, const void *data, const SceSize size) {
     return write_file(fd, data, size, emuenv.io, export_name);
 }
 
-EXPORT(int, sceIoWriteAsync) {
-    TRACY_FUNC(sceIoWriteAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoWriteAsync, const SceUID fd, const void *data, const SceSize size, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoWriteAsync, fd, data, size, param);
+    if (!data)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, data, size]() -> SceInt64 {
+        return write_file(fd, data, size, emuenv.io, export_name);
+    });
 }
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <io/async.h>
 #include <io/types.h>
 #include <module/module.h>
 
@@ -31,3 +32,10 @@ DECL_EXPORT(int, _sceIoDread, const SceUID fd, SceIoDirent *dir);
 DECL_EXPORT(int, _sceIoMkdir, const char *dir, const SceMode mode);
 DECL_EXPORT(SceOff, _sceIoLseek, const SceUID fd, Ptr<_sceIoLseekOpt> opt);
 DECL_EXPORT(int, _sceIoGetstat, const char *file, SceIoStat *stat);
+DECL_EXPORT(SceUID, _sceIoGetstatAsync, const char *file, SceIoStat *stat, Ptr<SceIoAsyncParam> param);
+DECL_EXPORT(SceUID, _sceIoLseekAsync, const SceUID fd, Ptr<_sceIoLseekOpt> opt, Ptr<SceIoAsyncParam> param);
+DECL_EXPORT(SceUID, _sceIoMkdirAsync, const char *dir, const SceMode mode, Ptr<SceIoAsyncParam> param);
+DECL_EXPORT(SceUID, _sceIoOpenAsync, const char *file, const int flags, const SceMode mode, Ptr<SceIoAsyncParam> param);
+
+// Queue an asynchronous file operation, the returned operation uid is signaled once it is done
+SceUID submit_async_io(EmuEnvState &emuenv, const char *export_name, SceUID thread_id, SceUID fd, Ptr<SceIoAsyncParam> param, AsyncIo::Operation operation);
@@ -20,6 +20,7 @@
 #include <codec/state.h>
 #include <codec/types.h>
 #include <kernel/state.h>
+#include <mem/functions.h>
 
 #include <util/tracy.h>
 TRACY_MODULE_NAME(SceJpegUser);
@@ -199,6 +200,7 @@ EXPORT(int, sceJpegCsc, uint8_t *pRGBA, const uint8_t *pYCbCr,
 
     calculate_pitch_info(width, height, 0, colorSpace, false, yuv_pitch);
     convert_yuv_to_rgb(pYCbCr, pRGBA, iFrameWidth, colorSpace, false, yuv_pitch);
+    mark_written(emuenv.mem, pRGBA, iFrameWidth * height * 4);
 
     return 0;
 }
@@ -225,6 +227,7 @@ EXPORT(int, sceJpegDecodeMJpeg, const unsigned char *pJpeg, SceSize isize, uint8
     }
 
     convert_yuv_to_rgb(temporary.data(), pRGBA, yuv_pitch[0].x, state->decoder->get_color_space(), false, yuv_pitch);
+    mark_written(emuenv.mem, pRGBA, osize);
 
     // Top 16 bits = pitch_width, bottom 16 bits = pitch_height.
     return (yuv_pitch[0].x << 16u) | yuv_pitch[0].y;
@@ -241,6 +244,7 @@ EXPORT(int, sceJpegDecodeMJpegYCbCr, const uint8_t *pJpeg, SceSize isize,
 
     state->decoder->send(pJpeg, isize);
     state->decoder->receive(pYCbCr, &size);
+    mark_written(emuenv.mem, pYCbCr, osize);
 
     SceJpegPitch yuv_pitch[4];
     state->decoder->get_pitch_info(yuv_pitch);
@@ -380,6 +384,7 @@ EXPORT(int, sceJpegMJpegCsc, uint8_t *pRGBA, const uint8_t *pYCbCr,
 
     calculate_pitch_info(width, height, 0, colorSpace, true, yuv_pitch);
     convert_yuv_to_rgb(pYCbCr, pRGBA, iFrameWidth, colorSpace, colorOption == SCE_JPEG_PIXEL_BGRA8888, yuv_pitch);
+    mark_written(emuenv.mem, pRGBA, iFrameWidth * height * 4);
 
     return 0;
 }
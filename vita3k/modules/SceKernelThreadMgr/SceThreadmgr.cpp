@@ -1017,7 +1017,9 @@ EXPORT(SceUID, sceKernelCreateCallback, char *name, SceUInt32 attr, Ptr<SceKerne
     std::string cb_name = name;
     auto cb = std::make_shared<Callback>(thread_id, thread, cb_name, callbackFunc, pCommon);
     std::lock_guard lock(emuenv.kernel.mutex);
-    SceUID cb_uid = emuenv.kernel.get_next_uid();
+    SceUID cb_uid = emuenv.kernel.get_next_object_uid();
+    if (cb_uid < 0)
+        return RET_ERROR(SCE_KERNEL_ERROR_SYSMEM_CANNOT_ALLOCATE_UIDENTRY);
     emuenv.kernel.callbacks.emplace(cb_uid, cb);
     thread->callbacks.push_back(cb);
     return cb_uid;
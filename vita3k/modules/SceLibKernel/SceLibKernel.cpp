@@ -28,6 +28,7 @@
 #include <io/functions.h>
 #include <kernel/state.h>
 #include <kernel/sync_primitives.h>
+#include <mem/functions.h>
 #include <packages/functions.h>
 
 #include <io/device.h>
@@ -575,9 +576,9 @@ EXPORT(int, sceIoGetstat, const char *file, SceIoStat *stat) {
     return CALL_EXPORT(_sceIoGetstat, file, stat);
 }
 
-EXPORT(int, sceIoGetstatAsync) {
-    TRACY_FUNC(sceIoGetstatAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoGetstatAsync, const char *file, SceIoStat *stat, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoGetstatAsync, file, stat, param);
+    return CALL_EXPORT(_sceIoGetstatAsync, file, stat, param);
 }
 
 EXPORT(int, sceIoGetstatByFd, const SceUID fd, SceIoStat *stat) {
@@ -607,9 +608,17 @@ EXPORT(SceOff, sceIoLseek, const SceUID fd, const SceOff offset, const SceIoSeek
     return res;
 }
 
-EXPORT(int, sceIoLseekAsync) {
-    TRACY_FUNC(sceIoLseekAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoLseekAsync, const SceUID fd, const SceOff offset, const SceIoSeekMode whence, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoLseekAsync, fd, offset, whence, param);
+    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
+
+    // the options are read when the operation is queued
+    Ptr<_sceIoLseekOpt> options = Ptr<_sceIoLseekOpt>(stack_alloc(*thread->cpu, sizeof(_sceIoLseekOpt)));
+    options.get(emuenv.mem)->offset = offset;
+    options.get(emuenv.mem)->whence = whence;
+    const SceUID res = CALL_EXPORT(_sceIoLseekAsync, fd, options, param);
+    stack_free(*thread->cpu, sizeof(_sceIoLseekOpt));
+    return res;
 }
 
 EXPORT(int, sceIoMkdir, const char *dir, const SceMode mode) {
@@ -617,9 +626,9 @@ EXPORT(int, sceIoMkdir, const char *dir, const SceMode mode) {
     return CALL_EXPORT(_sceIoMkdir, dir, mode);
 }
 
-EXPORT(int, sceIoMkdirAsync) {
-    TRACY_FUNC(sceIoMkdirAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoMkdirAsync, const char *dir, const SceMode mode, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoMkdirAsync, dir, mode, param);
+    return CALL_EXPORT(_sceIoMkdirAsync, dir, mode, param);
 }
 
 EXPORT(SceUID, sceIoOpen, const char *file, const int flags, const SceMode mode) {
@@ -631,43 +640,45 @@ EXPORT(SceUID, sceIoOpen, const char *file, const int flags, const SceMode mode)
     return open_file(emuenv.io, file, flags, emuenv.pref_path, export_name);
 }
 
-EXPORT(int, sceIoOpenAsync) {
-    TRACY_FUNC(sceIoOpenAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoOpenAsync, const char *file, const int flags, const SceMode mode, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoOpenAsync, file, flags, mode, param);
+    return CALL_EXPORT(_sceIoOpenAsync, file, flags, mode, param);
 }
 
 EXPORT(SceSSize, sceIoPread, SceUID fd, void *buf, SceSize nbyte, SceOff offset) {
     TRACY_FUNC(sceIoPread, fd, buf, nbyte, offset);
-    auto pos = tell_file(emuenv.io, fd, export_name);
-    if (pos < 0) {
-        return static_cast<SceSSize>(pos);
-    }
-    seek_file(fd, offset, SCE_SEEK_SET, emuenv.io, export_name);
-    const auto res = read_file(buf, emuenv.io, fd, nbyte, export_name);
-    seek_file(fd, pos, SCE_SEEK_SET, emuenv.io, export_name);
+    const auto res = read_file_at(buf, emuenv.io, fd, nbyte, offset, export_name);
+    if (res > 0)
+        mark_written(emuenv.mem, buf, res);
     return res;
 }
 
-EXPORT(int, sceIoPreadAsync) {
-    TRACY_FUNC(sceIoPreadAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoPreadAsync, SceUID fd, void *buf, SceSize nbyte, SceOff offset, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoPreadAsync, fd, buf, nbyte, offset, param);
+    if (!buf)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, buf, nbyte, offset]() -> SceInt64 {
+        const auto res = read_file_at(buf, emuenv.io, fd, nbyte, offset, export_name);
+        if (res > 0)
+            mark_written(emuenv.mem, buf, res);
+        return res;
+    });
 }
 
 EXPORT(SceSSize, sceIoPwrite, SceUID fd, const void *buf, SceSize nbyte, SceOff offset) {
     TRACY_FUNC(sceIoPwrite, fd, buf, nbyte, offset);
-    auto pos = tell_file(emuenv.io, fd, export_name);
-    if (pos < 0) {
-        return static_cast<SceSSize>(pos);
-    }
-    seek_file(fd, offset, SCE_SEEK_SET, emuenv.io, export_name);
-    const auto res = write_file(fd, buf, nbyte, emuenv.io, export_name);
-    seek_file(fd, pos, SCE_SEEK_SET, emuenv.io, export_name);
-    return res;
+    return write_file_at(fd, buf, nbyte, offset, emuenv.io, export_name);
 }
 
-EXPORT(int, sceIoPwriteAsync) {
-    TRACY_FUNC(sceIoPwriteAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoPwriteAsync, SceUID fd, const void *buf, SceSize nbyte, SceOff offset, Ptr<SceIoAsyncParam> param) {
+    TRACY_FUNC(sceIoPwriteAsync, fd, buf, nbyte, offset, param);
+    if (!buf)
+        return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_ADDR);
+
+    return submit_async_io(emuenv, export_name, thread_id, fd, param, [&emuenv, export_name, fd, buf, nbyte, offset]() -> SceInt64 {
+        return write_file_at(fd, buf, nbyte, offset, emuenv.io, export_name);
+    });
 }
 
 EXPORT(int, sceIoRead2) {
@@ -19,6 +19,7 @@
 
 #include <io/functions.h>
 #include <kernel/state.h>
+#include <mem/functions.h>
 #include <util/lock_and_find.h>
 #include <util/log.h>
 #include <util/tracy.h>
@@ -334,9 +335,19 @@ EXPORT(int, c32rtomb) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, calloc) {
-    TRACY_FUNC(calloc);
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, calloc, SceSize num, SceSize size) {
+    TRACY_FUNC(calloc, num, size);
+    const uint64_t total_size = static_cast<uint64_t>(num) * size;
+    if (total_size > UINT32_MAX)
+        return Ptr<void>();
+
+    const Address address = heap_alloc(emuenv.mem, static_cast<uint32_t>(total_size));
+    if (address) {
+        memset(Ptr<uint8_t>(address).get(emuenv.mem), 0, total_size);
+        mark_written(emuenv.mem, address, static_cast<uint32_t>(total_size));
+    }
+
+    return Ptr<void>(address);
 }
 
 EXPORT(int, clearerr) {
@@ -477,7 +488,7 @@ EXPORT(int, fread) {
 
 EXPORT(void, free, Address mem) {
     TRACY_FUNC(free, mem);
-    free(emuenv.mem, mem);
+    heap_free(emuenv.mem, mem);
 }
 
 EXPORT(int, freopen) {
@@ -762,7 +773,7 @@ EXPORT(int, longjmp) {
 
 EXPORT(int, malloc, SceSize size) {
     TRACY_FUNC(malloc, size);
-    return alloc(emuenv.mem, size, __FUNCTION__);
+    return heap_alloc(emuenv.mem, size);
 }
 
 EXPORT(int, malloc_stats) {
@@ -775,9 +786,9 @@ EXPORT(int, malloc_stats_fast) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, malloc_usable_size) {
-    TRACY_FUNC(malloc_usable_size);
-    return UNIMPLEMENTED();
+EXPORT(SceSize, malloc_usable_size, Address mem) {
+    TRACY_FUNC(malloc_usable_size, mem);
+    return heap_usable_size(emuenv.mem, mem);
 }
 
 EXPORT(int, mblen) {
@@ -837,7 +848,7 @@ EXPORT(int, mbtowc) {
 
 EXPORT(Ptr<void>, memalign, uint32_t alignment, uint32_t size) {
     TRACY_FUNC(memalign, alignment, size);
-    Address address = alloc_aligned(emuenv.mem, size, "memalign", alignment);
+    Address address = heap_alloc(emuenv.mem, size, alignment);
 
     return Ptr<void>(address);
 }
@@ -855,6 +866,7 @@ EXPORT(int, memcmp) {
 EXPORT(void, memcpy, void *destination, const void *source, uint32_t num) {
     TRACY_FUNC(memcpy, destination, source, num);
     memcpy(destination, source, num);
+    mark_written(emuenv.mem, destination, num);
 }
 
 EXPORT(int, memcpy_s) {
@@ -865,6 +877,7 @@ EXPORT(int, memcpy_s) {
 EXPORT(void, memmove, void *destination, const void *source, uint32_t num) {
     TRACY_FUNC(memmove, destination, source, num);
     memmove(destination, source, num);
+    mark_written(emuenv.mem, destination, num);
 }
 
 EXPORT(int, memmove_s) {
@@ -875,6 +888,7 @@ EXPORT(int, memmove_s) {
 EXPORT(void, memset, Ptr<void> str, int c, uint32_t n) {
     TRACY_FUNC(memset, str, c, n);
     memset(str.get(emuenv.mem), c, n);
+    mark_written(emuenv.mem, str.address(), n);
 }
 
 EXPORT(int, mktime) {
@@ -1034,14 +1048,29 @@ EXPORT(int, rand_r) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, realloc) {
-    TRACY_FUNC(realloc);
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, realloc, Address mem, SceSize size) {
+    TRACY_FUNC(realloc, mem, size);
+    return Ptr<void>(heap_realloc(emuenv.mem, mem, size));
 }
 
-EXPORT(int, reallocalign) {
-    TRACY_FUNC(reallocalign);
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, reallocalign, Address mem, SceSize size, SceSize alignment) {
+    TRACY_FUNC(reallocalign, mem, size, alignment);
+    if (size == 0) {
+        heap_free(emuenv.mem, mem);
+        return Ptr<void>();
+    }
+    if (mem && (mem % std::max<SceSize>(alignment, 1)) == 0 && size <= heap_usable_size(emuenv.mem, mem))
+        return Ptr<void>(mem);
+
+    const Address address = heap_alloc(emuenv.mem, size, alignment);
+    if (address && mem) {
+        const SceSize copy_size = std::min(size, heap_usable_size(emuenv.mem, mem));
+        memcpy(Ptr<uint8_t>(address).get(emuenv.mem), Ptr<uint8_t>(mem).get(emuenv.mem), copy_size);
+        mark_written(emuenv.mem, address, copy_size);
+        heap_free(emuenv.mem, mem);
+    }
+
+    return Ptr<void>(address);
 }
 
 EXPORT(int, remove) {
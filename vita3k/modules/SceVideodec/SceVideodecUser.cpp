@@ -19,6 +19,7 @@
 
 #include <codec/state.h>
 #include <kernel/state.h>
+#include <mem/functions.h>
 #include <util/lock_and_find.h>
 
 #include <util/tracy.h>
@@ -149,6 +150,15 @@ struct SceAvcdecArrayPicture {
     Ptr<Ptr<SceAvcdecPicture>> pPicture;
 };
 
+static DecoderThreading get_decoder_threading(const std::string &threading) {
+    if (threading == "None")
+        return DecoderThreading::None;
+    if (threading == "Frame")
+        return DecoderThreading::Frame;
+
+    return DecoderThreading::Slice;
+}
+
 EXPORT(int, sceAvcdecCreateDecoder, uint32_t codec_type, SceAvcdecCtrl *decoder, const SceAvcdecQueryDecoderInfo *query) {
     TRACY_FUNC(sceAvcdecCreateDecoder, codec_type, decoder, query);
     assert(codec_type == SCE_VIDEODEC_TYPE_HW_AVCDEC);
@@ -158,7 +168,7 @@ EXPORT(int, sceAvcdecCreateDecoder, uint32_t codec_type, SceAvcdecCtrl *decoder,
     SceUID handle = emuenv.kernel.get_next_uid();
     decoder->handle = handle;
 
-    state->decoders[handle] = std::make_shared<H264DecoderState>(query->horizontal, query->vertical);
+    state->decoders[handle] = std::make_shared<H264DecoderState>(query->horizontal, query->vertical, get_decoder_threading(emuenv.cfg.video_decoder_threading));
 
     return 0;
 }
@@ -212,6 +222,8 @@ EXPORT(int, sceAvcdecDecode, SceAvcdecCtrl *decoder, const SceAvcdecAu *au, SceA
     const auto send = decoder_info->send(au->es.pBuf.cast<uint8_t>().get(emuenv.mem), au->es.size);
     decoder_info->set_res(pPicture->frame.frameWidth, pPicture->frame.frameHeight);
     if (send && decoder_info->receive(output)) {
+        // yuv420, the chroma planes are half the size of the luma plane
+        mark_written(emuenv.mem, output, pPicture->frame.frameWidth * pPicture->frame.frameHeight * 3 / 2);
         decoder_info->get_res(pPicture->frame.horizontalSize, pPicture->frame.verticalSize);
         decoder_info->get_pts(pPicture->info.pts.upper, pPicture->info.pts.lower);
         picture->numOfOutput++;
@@ -23,6 +23,7 @@
 
 #include <cpu/functions.h>
 #include <emuenv/state.h>
+#include <io/archive.h>
 #include <io/device.h>
 #include <io/state.h>
 #include <io/vfs.h>
@@ -36,6 +37,9 @@
 #include <util/log.h>
 #include <util/string_utils.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <unordered_set>
 
 static constexpr bool LOG_UNK_NIDS_ALWAYS = false;
@@ -52,18 +56,53 @@ static constexpr bool LOG_UNK_NIDS_ALWAYS = false;
 
 struct EmuEnvState;
 
-static ImportFn resolve_import(uint32_t nid) {
-    switch (nid) {
+struct HleImport {
+    uint32_t nid;
+    ImportFn fn;
+};
+
+constexpr int hle_imports_size =
 #define VAR_NID(name, nid)
-#define NID(name, nid) \
-    case nid:          \
-        return import_##name;
+#define NID(name, nid) 1 +
 #include <nids/nids.inc>
+    0;
 #undef NID
 #undef VAR_NID
-    }
 
-    return ImportFn();
+// All the HLE functions sorted by NID, never modified once built so it can be read without locking.
+// Sorted on first use: the bridges are defined in the other translation units, so they are not
+// constant expressions here, and sorting only the NIDs at compile time would bring back an indirection per call.
+static const std::array<HleImport, hle_imports_size> &get_hle_imports() {
+    static const std::array<HleImport, hle_imports_size> hle_imports = [] {
+        std::array<HleImport, hle_imports_size> imports = { {
+#define VAR_NID(name, nid)
+#define NID(name, nid) { nid, import_##name },
+#include <nids/nids.inc>
+#undef NID
+#undef VAR_NID
+        } };
+        std::sort(imports.begin(), imports.end(), [](const HleImport &a, const HleImport &b) { return a.nid < b.nid; });
+        return imports;
+    }();
+    return hle_imports;
+}
+
+// Value of export_nids_generation when the NID at the same index in hle_imports was last checked
+// not to be exported by a loaded module. If it is still current, the HLE function can be called right away.
+static std::array<std::atomic<uint32_t>, hle_imports_size> hle_import_generations;
+
+/**
+ * \brief Finds the HLE function implementing a NID.
+ * \param nid NID to resolve
+ * \return Index of the function in the HLE imports table, -1 if not implemented
+ */
+static int resolve_import(uint32_t nid) {
+    const auto &hle_imports = get_hle_imports();
+    const auto it = std::lower_bound(hle_imports.begin(), hle_imports.end(), nid, [](const HleImport &import, uint32_t nid) { return import.nid < nid; });
+    if (it == hle_imports.end() || it->nid != nid)
+        return -1;
+
+    return static_cast<int>(it - hle_imports.begin());
 }
 
 const std::array<VarExport, var_exports_size> &get_var_exports() {
@@ -106,12 +145,21 @@ static void log_import_call(char emulation_level, uint32_t nid, SceUID thread_id
 }
 
 void call_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t nid, SceUID thread_id) {
-    Address export_pc = resolve_export(emuenv.kernel, nid);
+    const int hle_index = resolve_import(nid);
+    const uint32_t export_nids_generation = emuenv.kernel.export_nids_generation.load(std::memory_order_acquire);
+
+    // Only look for a LLE export (which requires locking) if the export table changed since the last call to this NID
+    Address export_pc = 0;
+    if (hle_index < 0 || hle_import_generations[hle_index].load(std::memory_order_relaxed) != export_nids_generation) {
+        export_pc = resolve_export(emuenv.kernel, nid);
+        if (!export_pc && hle_index >= 0)
+            hle_import_generations[hle_index].store(export_nids_generation, std::memory_order_relaxed);
+    }
 
     if (!export_pc) {
         // HLE - call our C++ function
         if (emuenv.kernel.debugger.watch_import_calls) {
-            const std::unordered_set<uint32_t> hle_nid_blacklist = {
+            static const std::unordered_set<uint32_t> hle_nid_blacklist = {
                 0xB295EB61, // sceKernelGetTLSAddr
                 0x46E7BE7B, // sceKernelLockLwMutex
                 0x91FA6614, // sceKernelUnlockLwMutex
@@ -119,9 +167,8 @@ void call_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t nid, SceUID thread
             auto lr = read_lr(cpu);
             log_import_call('H', nid, thread_id, hle_nid_blacklist, lr);
         }
-        const ImportFn fn = resolve_import(nid);
-        if (fn) {
-            fn(emuenv, cpu, thread_id);
+        if (hle_index >= 0) {
+            get_hle_imports()[hle_index].fn(emuenv, cpu, thread_id);
         } else {
             const ThreadStatePtr thread = emuenv.kernel.get_thread(thread_id);
             // make the function return 0
@@ -161,7 +208,7 @@ void call_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t nid, SceUID thread
             return;
         }*/
 
-        const std::unordered_set<uint32_t> lle_nid_blacklist = {};
+        static const std::unordered_set<uint32_t> lle_nid_blacklist = {};
         log_import_call('L', nid, thread_id, lle_nid_blacklist, pc);
         write_pc(cpu, export_pc);
         // invalidate this small region (without it, this code will be called again)
@@ -191,7 +238,11 @@ SceUID load_module(EmuEnvState &emuenv, const std::string &module_path) {
     fs::path translated_module_path = translate_path(module_path.c_str(), device, emuenv.io.device_paths);
     auto system_path = device::construct_emulated_path(device, translated_module_path, emuenv.pref_path, emuenv.io.redirect_stdio);
 
-    if (emuenv.io.case_isens_find_enabled && !fs::exists(system_path)) {
+    // the entries of a mounted archive are already found case-insensitively
+    std::string archive_path;
+    const bool in_archive = (device == VitaIoDevice::ux0) && vfs::find_ux0_archive(translated_module_path.string(), archive_path);
+
+    if (emuenv.io.case_isens_find_enabled && !in_archive && !fs::exists(system_path)) {
         // Attempt a case-insensitive file search.
         const auto original_translated_module_path = translated_module_path;
         const auto cached_path = find_in_cache(emuenv.io, string_utils::tolower(translated_module_path.string()));
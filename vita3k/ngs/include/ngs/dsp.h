@@ -0,0 +1,136 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#else
+#error "Compiler is not supported"
+#endif
+
+// Building blocks of the NGS audio modules.
+// All the sample buffers hold interleaved stereo frames, the format used between the modules of a voice.
+namespace ngs::dsp {
+
+// Four floats processed at once, used either as two stereo frames or as a single frame in the two first lanes
+struct Vec4 {
+#if defined(__aarch64__)
+    float32x4_t value;
+#else
+    __m128 value;
+#endif
+};
+
+#if defined(__aarch64__)
+inline Vec4 splat(float value) { return { vdupq_n_f32(value) }; }
+inline Vec4 set(float a, float b, float c, float d) {
+    const float values[4] = { a, b, c, d };
+    return { vld1q_f32(values) };
+}
+inline Vec4 load(const float *src) { return { vld1q_f32(src) }; }
+inline void store(float *dest, Vec4 v) { vst1q_f32(dest, v.value); }
+inline Vec4 load_frame(const float *src) { return { vcombine_f32(vld1_f32(src), vdup_n_f32(0.0f)) }; }
+inline void store_frame(float *dest, Vec4 v) { vst1_f32(dest, vget_low_f32(v.value)); }
+inline Vec4 operator+(Vec4 a, Vec4 b) { return { vaddq_f32(a.value, b.value) }; }
+inline Vec4 operator-(Vec4 a, Vec4 b) { return { vsubq_f32(a.value, b.value) }; }
+inline Vec4 operator*(Vec4 a, Vec4 b) { return { vmulq_f32(a.value, b.value) }; }
+inline Vec4 min(Vec4 a, Vec4 b) { return { vminq_f32(a.value, b.value) }; }
+inline Vec4 max(Vec4 a, Vec4 b) { return { vmaxq_f32(a.value, b.value) }; }
+inline Vec4 abs(Vec4 a) { return { vabsq_f32(a.value) }; }
+// value where a >= b, 0 elsewhere
+inline Vec4 keep_if_greater_equal(Vec4 value, Vec4 a, Vec4 b) {
+    return { vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(value.value), vcgeq_f32(a.value, b.value))) };
+}
+#else
+inline Vec4 splat(float value) { return { _mm_set1_ps(value) }; }
+inline Vec4 set(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+inline Vec4 load(const float *src) { return { _mm_loadu_ps(src) }; }
+inline void store(float *dest, Vec4 v) { _mm_storeu_ps(dest, v.value); }
+inline Vec4 load_frame(const float *src) { return { _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(src))) }; }
+inline void store_frame(float *dest, Vec4 v) { _mm_store_sd(reinterpret_cast<double *>(dest), _mm_castps_pd(v.value)); }
+inline Vec4 operator+(Vec4 a, Vec4 b) { return { _mm_add_ps(a.value, b.value) }; }
+inline Vec4 operator-(Vec4 a, Vec4 b) { return { _mm_sub_ps(a.value, b.value) }; }
+inline Vec4 operator*(Vec4 a, Vec4 b) { return { _mm_mul_ps(a.value, b.value) }; }
+inline Vec4 min(Vec4 a, Vec4 b) { return { _mm_min_ps(a.value, b.value) }; }
+inline Vec4 max(Vec4 a, Vec4 b) { return { _mm_max_ps(a.value, b.value) }; }
+inline Vec4 abs(Vec4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.value) }; }
+// value where a >= b, 0 elsewhere
+inline Vec4 keep_if_greater_equal(Vec4 value, Vec4 a, Vec4 b) { return { _mm_and_ps(value.value, _mm_cmpge_ps(a.value, b.value)) }; }
+#endif
+
+inline float decibels_to_gain(float decibels) {
+    return std::pow(10.0f, decibels / 20.0f);
+}
+
+inline float millibels_to_gain(float millibels) {
+    return std::pow(10.0f, millibels / 2000.0f);
+}
+
+inline float gain_to_decibels(float gain) {
+    return 20.0f * std::log10(std::max(gain, 1e-9f));
+}
+
+// Coefficient c of the smoother y += (1 - c) * (x - y) run every step_frames, reaching 63% of its target after time_ms
+inline float get_smoothing_coefficient(float time_ms, float sample_rate, uint32_t step_frames = 1) {
+    if (time_ms <= 0.0f)
+        return 0.0f;
+
+    return std::exp(-static_cast<float>(step_frames) * 1000.0f / (time_ms * sample_rate));
+}
+
+// y[0] = b0 x[0] + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2], the default is a pass through
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+};
+
+// Transposed direct form II state of a biquad for both channels
+struct BiquadState {
+    float z1[2];
+    float z2[2];
+};
+
+// Run count biquads in series on the frames, in and out can be the same buffer
+void process_biquads(const BiquadCoefficients *coefficients, BiquadState *states, uint32_t count, const float *in, float *out, uint32_t frames);
+
+// out = in * gain, the gain of each channel going linearly from start_gain to end_gain over the frames
+void apply_gain_ramp(const float *in, float *out, uint32_t frames, const float start_gain[2], const float end_gain[2]);
+
+inline void apply_gain(const float *in, float *out, uint32_t frames, float gain) {
+    const float gains[2] = { gain, gain };
+    apply_gain_ramp(in, out, frames, gains, gains);
+}
+
+// Largest absolute sample of each channel
+void get_peak_levels(const float *samples, uint32_t frames, float levels[2]);
+
+// Sum of the squared samples of each channel
+void get_energy(const float *samples, uint32_t frames, float energy[2]);
+
+} // namespace ngs::dsp
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <ngs/dsp.h>
 #include <ngs/system.h>
 #include <ngs/types.h>
 
@@ -62,6 +63,17 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
 };
 
+struct CompressorState {
+    SceNgsCompressorStates levels;
+    // gain applied to each channel in dB, before the makeup gain
+    float gains[SCE_NGS_MAX_SYSTEM_CHANNELS];
+};
+
+// Gain in dB the compressor applies to a signal at level_db
+float get_compressor_gain(const SceNgsCompressorParams &params, float level_db);
+void process_compressor(const SceNgsCompressorParams &params, CompressorState &state, float *samples, uint32_t frames, float sample_rate);
+
 } // namespace ngs
@@ -60,6 +60,21 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
 };
 
+// Longest delay of a tap, its modulation included
+constexpr float DELAY_MAX_MILLISECONDS = 2000.0f;
+
+struct DelayState {
+    uint32_t write_position;
+    float modulation_phase;
+    // two filter values of each channel for each tap
+    float tap_filters[SCE_NGS_DELAY_MAX_TAPS][4];
+};
+
+// Number of frames of the delay line, a power of two
+uint32_t get_delay_line_frames(float sample_rate);
+void process_delay(const SceNgsDelayParams &params, DelayState &state, float *line, uint32_t line_frames, float *samples, uint32_t frames, float sample_rate);
+
 } // namespace ngs
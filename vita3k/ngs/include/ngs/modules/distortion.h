@@ -46,4 +46,7 @@ public:
     }
 };
 
+// wet = clamp(fA x - fB x^3, -fClip, fClip), silenced while |x| < fGate
+void process_distortion(const SceNgsDistortionParams &params, float *samples, uint32_t frames);
+
 } // namespace ngs
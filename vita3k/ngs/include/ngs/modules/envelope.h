@@ -64,6 +64,10 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
 };
 
+// Multiply the samples by the envelope and move along it, releasing makes it fade out from its current height
+void process_envelope(const SceNgsEnvelopeParams &params, SceNgsEnvelopeStates &state, bool releasing, float *samples, uint32_t frames, float sample_rate);
+
 } // namespace ngs
@@ -49,6 +49,11 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
+};
+
+struct EqualizerState {
+    dsp::BiquadState filters[SCE_NGS_MAX_EQ_FILTERS];
 };
 
 } // namespace ngs
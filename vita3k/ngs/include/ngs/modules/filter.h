@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <ngs/dsp.h>
 #include <ngs/system.h>
 #include <ngs/types.h>
 
@@ -77,6 +78,11 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
 };
 
+// Biquad implementing the filter at the sample rate, following the audio EQ cookbook of Robert Bristow-Johnson
+dsp::BiquadCoefficients get_filter_coefficients(const SceNgsParamFilter &filter, float sample_rate);
+dsp::BiquadCoefficients get_filter_coefficients(const SceNgsParamCoEff &coefficients);
+
 } // namespace ngs
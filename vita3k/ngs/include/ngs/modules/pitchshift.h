@@ -39,6 +39,17 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
 };
 
+struct PitchShiftState {
+    uint32_t write_position;
+    // delay of the first read head, the second one is half a window further
+    float delay;
+};
+
+// Number of frames of the delay line the read heads move in, a power of two
+uint32_t get_pitch_shift_line_frames(float sample_rate);
+void process_pitch_shift(const SceNgsPitchShiftParams &params, PitchShiftState &state, float *line, uint32_t line_frames, float *samples, uint32_t frames, float sample_rate);
+
 } // namespace ngs
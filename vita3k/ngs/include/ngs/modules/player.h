@@ -17,9 +17,12 @@
 #pragma once
 
 #include <codec/state.h>
+#include <ngs/ring.h>
 #include <ngs/system.h>
 #include <ngs/types.h>
 
+#include <vector>
+
 enum {
     SCE_NGS_PLAYER_END_OF_DATA = 0,
     SCE_NGS_PLAYER_SWAPPED_BUFFER = 1,
@@ -51,8 +54,8 @@ struct SceNgsPlayerStates {
 
     // INTERNAL
     int8_t current_loop_count = 0;
-    uint32_t decoded_samples_pending = 0;
-    uint32_t decoded_samples_passed = 0;
+    // decoded frames waiting to be output, its samples follow the output frames in the extra storage
+    ngs::FrameRing ring;
     // needed for he_adpcm because a same decoder can be used for many voices
     ADPCMHistory adpcm_history[SCE_NGS_PLAYER_MAX_PCM_CHANNELS] = {};
     // used if the input must be resampled
@@ -87,10 +90,15 @@ namespace ngs {
 class PlayerModule : public Module {
 private:
     std::unique_ptr<PCMDecoderState> decoder;
+    // scratch buffers kept between the updates so decoding does not allocate once they are big enough
+    std::vector<float> decoded_frames;
+    std::vector<float> resampled_frames;
 
 public:
     bool process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) override;
     uint32_t module_id() const override { return 0x5CE6; }
+    // the decoder is used by all the voices
+    bool shares_state_between_voices() const override { return true; }
     void on_state_change(const MemState &mem, ModuleData &v, const VoiceState previous) override;
     void on_param_change(const MemState &mem, ModuleData &data) override;
 
@@ -64,6 +64,22 @@ public:
     uint32_t get_buffer_parameter_size() const override {
         return get_max_parameter_size();
     }
+    void on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) override;
 };
 
+constexpr uint32_t REVERB_COMB_COUNT = 8;
+constexpr uint32_t REVERB_ALLPASS_COUNT = 4;
+
+struct ReverbState {
+    uint32_t predelay_position;
+    uint32_t comb_positions[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_COMB_COUNT];
+    uint32_t allpass_positions[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_ALLPASS_COUNT];
+    float comb_filters[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_COMB_COUNT];
+    float input_filter;
+};
+
+// Number of floats used by the delay lines of the reverb
+uint32_t get_reverb_memory_size(float sample_rate);
+void process_reverb(const SceNgsReverbParams &params, ReverbState &state, float *memory, float *samples, uint32_t frames, float sample_rate);
+
 } // namespace ngs
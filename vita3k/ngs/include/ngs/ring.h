@@ -0,0 +1,61 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ngs {
+
+// Single producer, single consumer queue of interleaved stereo frames.
+// The ring does not own its samples, they usually live in the extra storage of a module and must outlive it.
+// The capacity is a power of two so the positions can grow freely and be masked when accessing the samples.
+class FrameRing {
+    float *samples = nullptr;
+    uint32_t frame_capacity = 0;
+
+    std::atomic<uint32_t> read_position = 0;
+    std::atomic<uint32_t> write_position = 0;
+
+public:
+    // Use the frame_capacity frames at samples, frame_capacity must be a power of two. The ring is emptied
+    void init(float *samples, uint32_t frame_capacity);
+    // Drop all the queued frames
+    void clear();
+
+    uint32_t capacity() const {
+        return frame_capacity;
+    }
+
+    // Frames that can be popped
+    uint32_t size() const {
+        return write_position.load(std::memory_order_acquire) - read_position.load(std::memory_order_acquire);
+    }
+
+    // Frames that can be pushed
+    uint32_t space() const {
+        return frame_capacity - size();
+    }
+
+    // Queue as many of the count frames as possible, returns the number of frames queued
+    uint32_t push(const float *frames, uint32_t count);
+    // Move up to count frames to dest, returns the number of frames moved
+    uint32_t pop(float *dest, uint32_t count);
+};
+
+} // namespace ngs
@@ -22,6 +22,7 @@
 #include <mem/ptr.h>
 
 #include <condition_variable>
+#include <functional>
 #include <queue>
 #include <vector>
 
@@ -80,8 +81,15 @@ public:
     bool stop(const MemState &mem, Voice *voice);
     bool off(const MemState &mem, Voice *voice);
 
+    // Process all the scheduled voices. Voices which do not depend on each other are processed on the shared thread pool.
     void update(KernelState &kern, const MemState &mem, const SceUID thread_id);
 
+    // If the calling thread is processing voices for an update, run callback on the thread which called update and return true.
+    // Guest callbacks must be run this way: they can't be run from the workers, and they may change any voice,
+    // so no voice is processed while one runs. The scheduler mutex is not held during the callback, as before
+    // the voices were processed in parallel, since the guest may wait for a thread using ngs.
+    static bool run_on_update_thread(const std::function<void()> &callback);
+
     Ptr<Patch> patch(const MemState &mem, SceNgsPatchSetupInfo *info);
 };
 } // namespace ngs
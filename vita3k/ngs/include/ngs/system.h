@@ -26,7 +26,9 @@
 
 #include <array>
 #include <cstdint>
+#include <functional>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 struct MemState;
@@ -102,6 +104,15 @@ struct ModuleData {
 
     void fill_to_fit_granularity();
 
+    // Copy the samples of the output port of the voice to the local storage and make the port use the copy,
+    // the module can then process them in place. The port is silent if no module produced anything for it.
+    // extra_frames more stereo frames are kept after them for the own use of the module.
+    float *take_port_samples(const uint32_t port, const uint32_t extra_frames = 0);
+    // Forget the state and the samples kept by the module, done when its voice starts playing
+    void reset_processing();
+    // Position of the module among the modules of its type in the voice and how many of them there are
+    std::pair<uint32_t, uint32_t> get_position_among_same_modules() const;
+
     void invoke_callback(KernelState &kern, const MemState &mem, const SceUID thread_id, const uint32_t reason1,
         const uint32_t reason2, Address reason_ptr);
 
@@ -115,6 +126,8 @@ public:
 
     virtual bool process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) = 0;
     virtual uint32_t module_id() const { return 0; }
+    // True if the module keeps data shared by all the voices of its rack, they are then never processed at the same time
+    virtual bool shares_state_between_voices() const { return false; }
     virtual uint32_t get_buffer_parameter_size() const = 0;
     virtual void on_state_change(const MemState &mem, ModuleData &v, const VoiceState previous) {}
     virtual void on_param_change(const MemState &mem, ModuleData &data) {}
@@ -154,6 +167,8 @@ struct Voice {
     bool is_paused;
     bool is_keyed_off;
     uint32_t frame_count;
+    // position in the list of voices processed by the current or last update
+    uint32_t update_index;
 
     using Patches = std::vector<Ptr<Patch>>;
 
@@ -214,8 +229,9 @@ struct System : public MempoolObject {
     static uint32_t get_required_memspace_size(SceNgsSystemInitParams *parameters);
 };
 
-bool deliver_data(const MemState &mem, const std::vector<Voice *> &voice_queue, Voice *source, const uint8_t output_port,
-    const VoiceProduct &data_to_deliver);
+// Mix the products of the sources into the inputs of the voices patched to them for which is_scheduled returns true.
+// Each destination receives its inputs in the order of the sources, the destinations are handled in parallel.
+void deliver_data(const MemState &mem, const std::vector<Voice *> &sources, const std::function<bool(const Voice *)> &is_scheduled);
 
 bool init_system(State &ngs, const MemState &mem, SceNgsSystemInitParams *parameters, Ptr<void> memspace, const uint32_t memspace_size);
 void release_system(State &ngs, const MemState &mem, System *system);
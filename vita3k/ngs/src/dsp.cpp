@@ -0,0 +1,122 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <ngs/dsp.h>
+
+#include <algorithm>
+
+namespace ngs::dsp {
+
+void process_biquads(const BiquadCoefficients *coefficients, BiquadState *states, uint32_t count, const float *in, float *out, uint32_t frames) {
+    for (uint32_t i = 0; i < count; i++) {
+        // both channels go through the filter together in the two first lanes
+        const Vec4 b0 = splat(coefficients[i].b0);
+        const Vec4 b1 = splat(coefficients[i].b1);
+        const Vec4 b2 = splat(coefficients[i].b2);
+        const Vec4 a1 = splat(coefficients[i].a1);
+        const Vec4 a2 = splat(coefficients[i].a2);
+        Vec4 z1 = load_frame(states[i].z1);
+        Vec4 z2 = load_frame(states[i].z2);
+
+        for (uint32_t frame = 0; frame < frames; frame++) {
+            const Vec4 x = load_frame(in + frame * 2);
+            const Vec4 y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            store_frame(out + frame * 2, y);
+        }
+
+        store_frame(states[i].z1, z1);
+        store_frame(states[i].z2, z2);
+
+        // flush the denormals once the filter went quiet, they are very slow to compute with
+        for (int channel = 0; channel < 2; channel++) {
+            if (std::abs(states[i].z1[channel]) < 1e-15f)
+                states[i].z1[channel] = 0.0f;
+            if (std::abs(states[i].z2[channel]) < 1e-15f)
+                states[i].z2[channel] = 0.0f;
+        }
+
+        // the next filters work in place on the output
+        in = out;
+    }
+
+    if (count == 0 && in != out)
+        std::copy_n(in, frames * 2, out);
+}
+
+void apply_gain_ramp(const float *in, float *out, uint32_t frames, const float start_gain[2], const float end_gain[2]) {
+    if (frames == 0)
+        return;
+
+    const float step[2] = { (end_gain[0] - start_gain[0]) / frames, (end_gain[1] - start_gain[1]) / frames };
+
+    // gains of two frames
+    Vec4 gains = set(start_gain[0], start_gain[1], start_gain[0] + step[0], start_gain[1] + step[1]);
+    const Vec4 gains_step = set(step[0] * 2, step[1] * 2, step[0] * 2, step[1] * 2);
+
+    uint32_t frame = 0;
+    for (; frame + 2 <= frames; frame += 2) {
+        store(out + frame * 2, load(in + frame * 2) * gains);
+        gains = gains + gains_step;
+    }
+
+    if (frame < frames) {
+        out[frame * 2] = in[frame * 2] * (start_gain[0] + step[0] * frame);
+        out[frame * 2 + 1] = in[frame * 2 + 1] * (start_gain[1] + step[1] * frame);
+    }
+}
+
+void get_peak_levels(const float *samples, uint32_t frames, float levels[2]) {
+    Vec4 peaks = splat(0.0f);
+
+    uint32_t frame = 0;
+    for (; frame + 2 <= frames; frame += 2)
+        peaks = max(peaks, abs(load(samples + frame * 2)));
+
+    float lanes[4];
+    store(lanes, peaks);
+    levels[0] = std::max(lanes[0], lanes[2]);
+    levels[1] = std::max(lanes[1], lanes[3]);
+
+    if (frame < frames) {
+        levels[0] = std::max(levels[0], std::abs(samples[frame * 2]));
+        levels[1] = std::max(levels[1], std::abs(samples[frame * 2 + 1]));
+    }
+}
+
+void get_energy(const float *samples, uint32_t frames, float energy[2]) {
+    Vec4 sums = splat(0.0f);
+
+    uint32_t frame = 0;
+    for (; frame + 2 <= frames; frame += 2) {
+        const Vec4 values = load(samples + frame * 2);
+        sums = sums + values * values;
+    }
+
+    float lanes[4];
+    store(lanes, sums);
+    energy[0] = lanes[0] + lanes[2];
+    energy[1] = lanes[1] + lanes[3];
+
+    if (frame < frames) {
+        energy[0] += samples[frame * 2] * samples[frame * 2];
+        energy[1] += samples[frame * 2 + 1] * samples[frame * 2 + 1];
+    }
+}
+
+} // namespace ngs::dsp
@@ -24,8 +24,10 @@ extern "C" {
 
 namespace ngs {
 
-SwrContext *Atrac9Module::swr_mono_to_stereo = nullptr;
-SwrContext *Atrac9Module::swr_stereo = nullptr;
+Atrac9Module::~Atrac9Module() {
+    swr_free(&swr_mono_to_stereo);
+    swr_free(&swr_stereo);
+}
 
 void Atrac9Module::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
     SceNgsAT9States *state = data.get_state<SceNgsAT9States>();
@@ -20,14 +20,95 @@
 
 namespace ngs {
 
+// the level is measured and the gain updated on blocks of this many frames, the gain is interpolated in between
+static constexpr uint32_t COMPRESSOR_STEP_FRAMES = 16;
+
+float get_compressor_gain(const SceNgsCompressorParams &params, float level_db) {
+    const float slope = 1.0f / std::max(params.fRatio, 1.0f) - 1.0f;
+    const float knee = std::max(params.fSoftKnee, 0.0f);
+    const float over = level_db - params.fThreshold;
+
+    if (2.0f * over <= -knee)
+        return 0.0f;
+
+    if (2.0f * std::abs(over) < knee) {
+        const float knee_over = over + knee / 2.0f;
+        return slope * knee_over * knee_over / (2.0f * knee);
+    }
+
+    return slope * over;
+}
+
+void process_compressor(const SceNgsCompressorParams &params, CompressorState &state, float *samples, uint32_t frames, float sample_rate) {
+    const float attack = dsp::get_smoothing_coefficient(params.fAttack, sample_rate, COMPRESSOR_STEP_FRAMES);
+    const float release = dsp::get_smoothing_coefficient(params.fRelease, sample_rate, COMPRESSOR_STEP_FRAMES);
+    const float makeup = dsp::decibels_to_gain(params.fMakeupGain);
+
+    dsp::get_peak_levels(samples, frames, state.levels.fInputLevel);
+
+    for (uint32_t offset = 0; offset < frames; offset += COMPRESSOR_STEP_FRAMES) {
+        float *step_samples = samples + offset * 2;
+        const uint32_t step_frames = std::min(COMPRESSOR_STEP_FRAMES, frames - offset);
+
+        float levels[2];
+        if (params.nPeakMode == SCE_NGS_COMPRESSOR_PEAK_MODE) {
+            dsp::get_peak_levels(step_samples, step_frames, levels);
+        } else {
+            dsp::get_energy(step_samples, step_frames, levels);
+            levels[0] = std::sqrt(levels[0] / step_frames);
+            levels[1] = std::sqrt(levels[1] / step_frames);
+        }
+
+        if (params.nStereoLink == SCE_NGS_COMPRESSOR_STEREO_LINK_ON) {
+            levels[0] = std::max(levels[0], levels[1]);
+            levels[1] = levels[0];
+        }
+
+        float start_gains[2];
+        float end_gains[2];
+        for (int channel = 0; channel < 2; channel++) {
+            const float target = get_compressor_gain(params, dsp::gain_to_decibels(levels[channel]));
+            const float current = state.gains[channel];
+            // the gain goes down at the attack speed and back up at the release speed
+            const float smoothing = (target < current) ? attack : release;
+            const float next = target + smoothing * (current - target);
+
+            start_gains[channel] = dsp::decibels_to_gain(current) * makeup;
+            end_gains[channel] = dsp::decibels_to_gain(next) * makeup;
+            state.gains[channel] = next;
+        }
+
+        dsp::apply_gain_ramp(step_samples, step_samples, step_frames, start_gains, end_gains);
+    }
+
+    dsp::get_peak_levels(samples, frames, state.levels.fOutputLevel);
+}
+
 bool CompressorModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
         if (desc->id == SCE_NGS_COMPRESSOR_PARAMS_STRUCT_ID || desc->id == SCE_NGS_COMPRESSOR_PARAMS_STRUCT_ID_V2) {
-            LOG_WARN_ONCE("Game is using unimplemented compressor audio module");
+            if (data.parent->rack->modules.size() > 2)
+                LOG_WARN_ONCE("Side chain of the compressor is not implemented, the main input drives the compression");
+
+            SceNgsCompressorParams params = *data.get_parameters<SceNgsCompressorParams>(mem);
+            if (desc->id == SCE_NGS_COMPRESSOR_PARAMS_STRUCT_ID)
+                // the soft knee is assumed to come with the second version of the parameters
+                params.fSoftKnee = 0.0f;
+
+            const System *system = data.parent->rack->system;
+            float *samples = data.take_port_samples(0);
+            process_compressor(params, *data.get_state<CompressorState>(), samples,
+                system->granularity, static_cast<float>(system->sample_rate));
         }
     }
 
     return false;
 }
+
+void CompressorModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
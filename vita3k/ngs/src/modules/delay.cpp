@@ -15,19 +15,151 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/dsp.h>
 #include <ngs/modules/delay.h>
 #include <util/log.h>
 
+#include <bit>
+#include <numbers>
+
 namespace ngs {
 
+// the modulation is computed every this many frames and interpolated in between
+static constexpr uint32_t DELAY_STEP_FRAMES = 16;
+
+struct DelayTapSetup {
+    const SceNgsDelayTap *tap;
+    float *filter;
+    float start_delay;
+    float delay_step;
+    dsp::Vec4 volume;
+    dsp::Vec4 feedback;
+    dsp::Vec4 coefficient;
+};
+
+uint32_t get_delay_line_frames(float sample_rate) {
+    return std::bit_ceil(static_cast<uint32_t>(DELAY_MAX_MILLISECONDS * sample_rate / 1000.0f) + 2);
+}
+
+static float get_tap_delay(const SceNgsDelayTap &tap, float phase, float sample_rate, float max_delay) {
+    const float modulation = 0.5f + 0.5f * std::sin(2.0f * std::numbers::pi_v<float> * (phase + tap.fPhaseOffsetDeg / 360.0f));
+    const float delay = (tap.fDelayMillisecs + tap.fModWidthMillisecs * modulation) * sample_rate / 1000.0f;
+
+    // the current frame is written after the taps are read
+    return std::clamp(delay, 1.0f, max_delay);
+}
+
+void process_delay(const SceNgsDelayParams &params, DelayState &state, float *line, uint32_t line_frames, float *samples, uint32_t frames, float sample_rate) {
+    using namespace dsp;
+
+    const uint32_t mask = line_frames - 1;
+    const float max_delay = static_cast<float>(line_frames - 2);
+    const float phase_step = params.fModRate / sample_rate;
+    const Vec4 dry = splat(params.fDryVol);
+
+    DelayTapSetup taps[SCE_NGS_DELAY_MAX_TAPS];
+    uint32_t tap_count = 0;
+    for (uint32_t i = 0; i < SCE_NGS_DELAY_MAX_TAPS; i++) {
+        const SceNgsDelayTap &tap = params.taps[i];
+        if (tap.fVolume == 0.0f && tap.fFeedback == 0.0f)
+            continue;
+
+        float coefficient = 0.0f;
+        const float w = std::numbers::pi_v<float> * std::clamp(tap.fCutoff, 10.0f, sample_rate * 0.49f) / sample_rate;
+        if (tap.eFilterMode == SCE_NGS_DELAY_FILTER_MODE_ALLPASS)
+            coefficient = (std::tan(w) - 1.0f) / (std::tan(w) + 1.0f);
+        else
+            coefficient = 1.0f - std::exp(-2.0f * w);
+
+        taps[tap_count++] = { &tap, state.tap_filters[i], 0.0f, 0.0f, splat(tap.fVolume), splat(std::clamp(tap.fFeedback, -0.99f, 0.99f)), splat(coefficient) };
+    }
+
+    for (uint32_t offset = 0; offset < frames; offset += DELAY_STEP_FRAMES) {
+        const uint32_t step_frames = std::min(DELAY_STEP_FRAMES, frames - offset);
+        const float next_phase = state.modulation_phase + phase_step * step_frames;
+        for (uint32_t i = 0; i < tap_count; i++) {
+            taps[i].start_delay = get_tap_delay(*taps[i].tap, state.modulation_phase, sample_rate, max_delay);
+            taps[i].delay_step = (get_tap_delay(*taps[i].tap, next_phase, sample_rate, max_delay) - taps[i].start_delay) / step_frames;
+        }
+        state.modulation_phase = next_phase - std::floor(next_phase);
+
+        for (uint32_t frame = 0; frame < step_frames; frame++) {
+            float *sample = samples + (offset + frame) * 2;
+            const Vec4 input = load_frame(sample);
+            Vec4 output = input * dry;
+            Vec4 line_input = input;
+
+            for (uint32_t i = 0; i < tap_count; i++) {
+                DelayTapSetup &tap = taps[i];
+                const float delay = tap.start_delay + tap.delay_step * frame;
+                // split the delay before going back in the line to keep the precision of the fraction
+                const uint32_t whole_delay = static_cast<uint32_t>(delay);
+                const uint32_t index = state.write_position + line_frames - whole_delay - 1;
+                const Vec4 fraction = splat(1.0f - (delay - static_cast<float>(whole_delay)));
+                const Vec4 first = load_frame(line + (index & mask) * 2);
+                const Vec4 second = load_frame(line + ((index + 1) & mask) * 2);
+                Vec4 value = first + (second - first) * fraction;
+
+                switch (tap.tap->eFilterMode) {
+                case SCE_NGS_DELAY_FILTER_MODE_LOWPASS_ONEPOLE: {
+                    const Vec4 low = load_frame(tap.filter);
+                    value = low + (value - low) * tap.coefficient;
+                    store_frame(tap.filter, value);
+                    break;
+                }
+                case SCE_NGS_DELAY_FILTER_MODE_HIGHPASS_ONEPOLE: {
+                    Vec4 low = load_frame(tap.filter);
+                    low = low + (value - low) * tap.coefficient;
+                    store_frame(tap.filter, low);
+                    value = value - low;
+                    break;
+                }
+                case SCE_NGS_DELAY_FILTER_MODE_ALLPASS: {
+                    // y = c x + x[-1] - c y[-1]
+                    const Vec4 previous_input = load_frame(tap.filter);
+                    const Vec4 previous_output = load_frame(tap.filter + 2);
+                    const Vec4 filtered = tap.coefficient * (value - previous_output) + previous_input;
+                    store_frame(tap.filter, value);
+                    store_frame(tap.filter + 2, filtered);
+                    value = filtered;
+                    break;
+                }
+                default:
+                    break;
+                }
+
+                output = output + value * tap.volume;
+                line_input = line_input + value * tap.feedback;
+            }
+
+            store_frame(line + state.write_position * 2, line_input);
+            state.write_position = (state.write_position + 1) & mask;
+            store_frame(sample, output);
+        }
+    }
+}
+
 bool DelayModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
         if (desc->id == SCE_NGS_DELAY_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented delay audio module");
+            const System *system = data.parent->rack->system;
+            const float sample_rate = static_cast<float>(system->sample_rate);
+            const uint32_t line_frames = get_delay_line_frames(sample_rate);
+
+            // the delay line is kept after the output
+            float *samples = data.take_port_samples(0, line_frames);
+            process_delay(*data.get_parameters<SceNgsDelayParams>(mem), *data.get_state<DelayState>(), samples + system->granularity * 2,
+                line_frames, samples, system->granularity, sample_rate);
         }
     }
 
     return false;
 }
+
+void DelayModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
@@ -15,19 +15,51 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/dsp.h>
 #include <ngs/modules/distortion.h>
 #include <util/log.h>
 
+#include <limits>
+
 namespace ngs {
 
+void process_distortion(const SceNgsDistortionParams &params, float *samples, uint32_t frames) {
+    using namespace dsp;
+
+    // no clipping level means no clipping
+    const float clip = (params.fClip > 0.0f) ? params.fClip : std::numeric_limits<float>::max();
+    const Vec4 a = splat(params.fA);
+    const Vec4 b = splat(params.fB);
+    const Vec4 high = splat(clip);
+    const Vec4 low = splat(-clip);
+    const Vec4 gate = splat(params.fGate);
+    const Vec4 wet_gain = splat(params.fWetGain);
+    const Vec4 dry_gain = splat(params.fDryGain);
+
+    const auto distort = [&](Vec4 x) {
+        Vec4 wet = max(min(a * x - b * x * x * x, high), low);
+        wet = keep_if_greater_equal(wet, abs(x), gate);
+        return dry_gain * x + wet_gain * wet;
+    };
+
+    uint32_t frame = 0;
+    for (; frame + 2 <= frames; frame += 2)
+        store(samples + frame * 2, distort(load(samples + frame * 2)));
+
+    if (frame < frames)
+        store_frame(samples + frame * 2, distort(load_frame(samples + frame * 2)));
+}
+
 bool DistortionModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
         if (desc->id == SCE_NGS_DISTORTION_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented distortion audio module");
+            float *samples = data.take_port_samples(0);
+            process_distortion(*data.get_parameters<SceNgsDistortionParams>(mem), samples, data.parent->rack->system->granularity);
         }
     }
 
     return false;
 }
+
 } // namespace ngs
@@ -15,19 +15,108 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/dsp.h>
 #include <ngs/modules/envelope.h>
 #include <util/log.h>
 
 namespace ngs {
 
+// the height is computed every this many frames and interpolated in between
+static constexpr uint32_t ENVELOPE_STEP_FRAMES = 16;
+
+static uint32_t get_point_count(const SceNgsEnvelopeParams &params) {
+    return std::clamp<uint32_t>(params.uNumPoints, 1, SCE_NGS_ENVELOPE_MAX_POINTS);
+}
+
+static float get_envelope_height(const SceNgsEnvelopeParams &params, const SceNgsEnvelopeStates &state) {
+    if (state.nReleasing) {
+        if (params.uReleaseMsecs == 0)
+            return 0.0f;
+
+        return state.fReleaseScale * std::max(1.0f - state.fPosition / params.uReleaseMsecs, 0.0f);
+    }
+
+    const uint32_t last_point = get_point_count(params) - 1;
+    const uint32_t point = static_cast<uint32_t>(state.nCurrentPoint);
+    if (point >= last_point)
+        return params.envelopePoints[last_point].fAmplitude;
+
+    const SceNgsEnvelopePoint &start = params.envelopePoints[point];
+    const SceNgsEnvelopePoint &end = params.envelopePoints[point + 1];
+    float progress = (start.uMsecsToNextPoint > 0) ? std::min(state.fPosition / start.uMsecsToNextPoint, 1.0f) : 1.0f;
+    if (start.eCurveType == SCE_NGS_ENVELOPE_CURVED)
+        progress *= progress;
+
+    return start.fAmplitude + (end.fAmplitude - start.fAmplitude) * progress;
+}
+
+static void advance_envelope(const SceNgsEnvelopeParams &params, SceNgsEnvelopeStates &state, float elapsed_ms) {
+    state.fPosition += elapsed_ms;
+    if (state.nReleasing)
+        return;
+
+    const uint32_t last_point = get_point_count(params) - 1;
+    // a loop made of segments without length would never end
+    for (uint32_t i = 0; i < SCE_NGS_ENVELOPE_MAX_POINTS * 2; i++) {
+        const uint32_t point = static_cast<uint32_t>(state.nCurrentPoint);
+        if (point >= last_point) {
+            state.fPosition = 0.0f;
+            return;
+        }
+
+        const float length = static_cast<float>(params.envelopePoints[point].uMsecsToNextPoint);
+        if (state.fPosition < length)
+            return;
+
+        state.fPosition -= length;
+        state.nCurrentPoint++;
+        if (params.nLoopEnd >= 0 && state.nCurrentPoint >= params.nLoopEnd && params.uLoopStart < static_cast<uint32_t>(params.nLoopEnd))
+            state.nCurrentPoint = static_cast<SceInt32>(params.uLoopStart);
+    }
+}
+
+void process_envelope(const SceNgsEnvelopeParams &params, SceNgsEnvelopeStates &state, bool releasing, float *samples, uint32_t frames, float sample_rate) {
+    if (releasing && !state.nReleasing) {
+        state.fReleaseScale = get_envelope_height(params, state);
+        state.nReleasing = 1;
+        state.fPosition = 0.0f;
+    }
+
+    const float ms_per_frame = 1000.0f / sample_rate;
+    for (uint32_t offset = 0; offset < frames; offset += ENVELOPE_STEP_FRAMES) {
+        const uint32_t step_frames = std::min(ENVELOPE_STEP_FRAMES, frames - offset);
+        const float start_height = get_envelope_height(params, state);
+        advance_envelope(params, state, step_frames * ms_per_frame);
+        const float end_height = get_envelope_height(params, state);
+
+        const float start_gains[2] = { start_height, start_height };
+        const float end_gains[2] = { end_height, end_height };
+        dsp::apply_gain_ramp(samples + offset * 2, samples + offset * 2, step_frames, start_gains, end_gains);
+        state.fCurrentHeight = end_height;
+    }
+}
+
 bool EnvelopeModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
         if (desc->id == SCE_NGS_ENVELOPE_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented envelope audio module");
+            const SceNgsEnvelopeParams *params = data.get_parameters<SceNgsEnvelopeParams>(mem);
+            // without any point there is no envelope to apply
+            if (params->uNumPoints > 0) {
+                const System *system = data.parent->rack->system;
+                float *samples = data.take_port_samples(0);
+                process_envelope(*params, *data.get_state<SceNgsEnvelopeStates>(), data.parent->state == VOICE_STATE_FINALIZING,
+                    samples, system->granularity, static_cast<float>(system->sample_rate));
+            }
         }
     }
 
     return false;
 }
+
+void EnvelopeModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
@@ -21,18 +21,55 @@
 namespace ngs {
 
 bool EqualizerModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
+    // Definitions with equalizers can have up to 4 outputs. When they have more than one equalizer,
+    // the first one is shared and each of the others is in front of an output.
+    const auto [position, count] = data.get_position_among_same_modules();
+    const uint32_t port = (position > 0) ? std::min(position - 1, MAX_VOICE_OUTPUT - 1) : 0;
+    if (position == 1) {
+        data.parent->products[1] = data.parent->products[0];
+        data.parent->products[2] = data.parent->products[0];
+        data.parent->products[3] = data.parent->products[0];
+    }
+
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
-        if (desc->id == SCE_NGS_PARAM_EQ_COEFF_STRUCT_ID || desc->id == SCE_NGS_PARAM_EQ_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented equalizer audio module");
+        const System *system = data.parent->rack->system;
+
+        dsp::BiquadCoefficients coefficients[SCE_NGS_MAX_EQ_FILTERS];
+        uint32_t filter_count = 0;
+        if (desc->id == SCE_NGS_PARAM_EQ_STRUCT_ID) {
+            const SceNgsParamEqParams *params = data.get_parameters<SceNgsParamEqParams>(mem);
+            for (uint32_t i = 0; i < SCE_NGS_MAX_EQ_FILTERS; i++) {
+                // disabled filters pass the samples through, only the ones after the last enabled one are skipped
+                coefficients[i] = get_filter_coefficients(params->filter[i], static_cast<float>(system->sample_rate));
+                if (params->filter[i].eFilterMode != SCE_NGS_FILTER_MODE_OFF)
+                    filter_count = i + 1;
+            }
+        } else if (desc->id == SCE_NGS_PARAM_EQ_COEFF_STRUCT_ID) {
+            const SceNgsParamEqParamsCoEff *params = data.get_parameters<SceNgsParamEqParamsCoEff>(mem);
+            for (uint32_t i = 0; i < SCE_NGS_MAX_EQ_FILTERS; i++)
+                coefficients[i] = get_filter_coefficients(params->filterCoEff[i]);
+            filter_count = SCE_NGS_MAX_EQ_FILTERS;
+        }
+
+        if (filter_count > 0) {
+            float *samples = data.take_port_samples(port);
+            dsp::process_biquads(coefficients, data.get_state<EqualizerState>()->filters, filter_count, samples, samples, system->granularity);
         }
     }
 
-    // Definitions with equalizers can have up to 4 outputs
-    data.parent->products[1] = data.parent->products[0];
-    data.parent->products[2] = data.parent->products[0];
-    data.parent->products[3] = data.parent->products[0];
+    if (count <= 1) {
+        data.parent->products[1] = data.parent->products[0];
+        data.parent->products[2] = data.parent->products[0];
+        data.parent->products[3] = data.parent->products[0];
+    }
 
     return false;
 }
+
+void EqualizerModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
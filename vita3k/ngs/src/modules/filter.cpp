@@ -18,19 +18,182 @@
 #include <ngs/modules/filter.h>
 #include <util/log.h>
 
+#include <cmath>
+#include <numbers>
+
 namespace ngs {
 
+dsp::BiquadCoefficients get_filter_coefficients(const SceNgsParamFilter &filter, float sample_rate) {
+    if (filter.eFilterMode == SCE_NGS_FILTER_MODE_OFF || sample_rate <= 0.0f)
+        return {};
+
+    const double frequency = std::clamp<double>(filter.fFrequency, 10.0, sample_rate * 0.49);
+    const double q = std::max<double>(filter.fResonance, 0.01);
+    const double a = std::pow(10.0, filter.fGain / 40.0);
+    const double w0 = 2.0 * std::numbers::pi * frequency / sample_rate;
+    const double cos_w0 = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double sqrt_a_alpha = 2.0 * std::sqrt(a) * alpha;
+
+    double b0, b1, b2, a0, a1, a2;
+    switch (filter.eFilterMode) {
+    case SCE_NGS_FILTER_LOWPASS_RESONANT:
+    case SCE_NGS_FILTER_LOWPASS_RESONANT_NORMALIZED:
+        b0 = (1.0 - cos_w0) / 2.0;
+        b1 = 1.0 - cos_w0;
+        b2 = b0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha;
+        if (filter.eFilterMode == SCE_NGS_FILTER_LOWPASS_RESONANT_NORMALIZED) {
+            // the resonance peak is about q high, keep it at unity gain
+            const double scale = 1.0 / std::max(q, 1.0);
+            b0 *= scale;
+            b1 *= scale;
+            b2 *= scale;
+        }
+        break;
+    case SCE_NGS_FILTER_HIGHPASS_RESONANT:
+        b0 = (1.0 + cos_w0) / 2.0;
+        b1 = -(1.0 + cos_w0);
+        b2 = b0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha;
+        break;
+    case SCE_NGS_FILTER_BANDPASS_PEAK:
+        // constant skirt gain, the peak gain is q
+        b0 = q * alpha;
+        b1 = 0.0;
+        b2 = -q * alpha;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha;
+        break;
+    case SCE_NGS_FILTER_BANDPASS_ZERO:
+        // constant 0 dB peak gain
+        b0 = alpha;
+        b1 = 0.0;
+        b2 = -alpha;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha;
+        break;
+    case SCE_NGS_FILTER_NOTCH:
+        b0 = 1.0;
+        b1 = -2.0 * cos_w0;
+        b2 = 1.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha;
+        break;
+    case SCE_NGS_FILTER_PEAK:
+        b0 = 1.0 + alpha * a;
+        b1 = -2.0 * cos_w0;
+        b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha / a;
+        break;
+    case SCE_NGS_FILTER_HIGHSHELF:
+        b0 = a * ((a + 1.0) + (a - 1.0) * cos_w0 + sqrt_a_alpha);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cos_w0);
+        b2 = a * ((a + 1.0) + (a - 1.0) * cos_w0 - sqrt_a_alpha);
+        a0 = (a + 1.0) - (a - 1.0) * cos_w0 + sqrt_a_alpha;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cos_w0);
+        a2 = (a + 1.0) - (a - 1.0) * cos_w0 - sqrt_a_alpha;
+        break;
+    case SCE_NGS_FILTER_LOWSHELF:
+        b0 = a * ((a + 1.0) - (a - 1.0) * cos_w0 + sqrt_a_alpha);
+        b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cos_w0);
+        b2 = a * ((a + 1.0) - (a - 1.0) * cos_w0 - sqrt_a_alpha);
+        a0 = (a + 1.0) + (a - 1.0) * cos_w0 + sqrt_a_alpha;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cos_w0);
+        a2 = (a + 1.0) + (a - 1.0) * cos_w0 - sqrt_a_alpha;
+        break;
+    case SCE_NGS_FILTER_LOWPASS_ONEPOLE: {
+        const double pole = std::exp(-w0);
+        b0 = 1.0 - pole;
+        b1 = 0.0;
+        b2 = 0.0;
+        a0 = 1.0;
+        a1 = -pole;
+        a2 = 0.0;
+        break;
+    }
+    case SCE_NGS_FILTER_HIGHPASS_ONEPOLE: {
+        const double pole = std::exp(-w0);
+        b0 = (1.0 + pole) / 2.0;
+        b1 = -b0;
+        b2 = 0.0;
+        a0 = 1.0;
+        a1 = -pole;
+        a2 = 0.0;
+        break;
+    }
+    case SCE_NGS_FILTER_ALLPASS:
+        b0 = 1.0 - alpha;
+        b1 = -2.0 * cos_w0;
+        b2 = 1.0 + alpha;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cos_w0;
+        a2 = 1.0 - alpha;
+        break;
+    default:
+        LOG_WARN_ONCE("Unknown filter mode {}", static_cast<uint32_t>(filter.eFilterMode));
+        return {};
+    }
+
+    return {
+        static_cast<float>(b0 / a0),
+        static_cast<float>(b1 / a0),
+        static_cast<float>(b2 / a0),
+        static_cast<float>(a1 / a0),
+        static_cast<float>(a2 / a0),
+    };
+}
+
+dsp::BiquadCoefficients get_filter_coefficients(const SceNgsParamCoEff &coefficients) {
+    return { coefficients.fB0, coefficients.fB1, coefficients.fB2, coefficients.fA1, coefficients.fA2 };
+}
+
 bool FilterModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
+    // Definitions with filters have 2 outputs, each of them goes through its own filter when there are two
+    const auto [position, count] = data.get_position_among_same_modules();
+    const uint32_t port = (count > 1) ? std::min(position, 1u) : 0;
+    if (count > 1 && position == 0)
+        data.parent->products[1] = data.parent->products[0];
+
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
-        if (desc->id == SCE_NGS_FILTER_PARAMS_COEFF_STRUCT_ID || desc->id == SCE_NGS_FILTER_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented filter audio module");
+        const System *system = data.parent->rack->system;
+
+        dsp::BiquadCoefficients coefficients;
+        bool is_enabled = false;
+        if (desc->id == SCE_NGS_FILTER_PARAMS_STRUCT_ID) {
+            const SceNgsParamFilter &filter = data.get_parameters<SceNgsFilterParams>(mem)->params;
+            coefficients = get_filter_coefficients(filter, static_cast<float>(system->sample_rate));
+            is_enabled = (filter.eFilterMode != SCE_NGS_FILTER_MODE_OFF);
+        } else if (desc->id == SCE_NGS_FILTER_PARAMS_COEFF_STRUCT_ID) {
+            coefficients = get_filter_coefficients(data.get_parameters<SceNgsFilterParamsCoEff>(mem)->params);
+            is_enabled = true;
+        }
+
+        if (is_enabled) {
+            float *samples = data.take_port_samples(port);
+            dsp::process_biquads(&coefficients, data.get_state<dsp::BiquadState>(), 1, samples, samples, system->granularity);
         }
     }
 
-    // Definitions with filters have 2 outputs
-    data.parent->products[1] = data.parent->products[0];
+    if (count <= 1)
+        data.parent->products[1] = data.parent->products[0];
 
     return false;
 }
+
+void FilterModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
@@ -15,6 +15,7 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/dsp.h>
 #include <ngs/modules/mixer.h>
 #include <util/log.h>
 
@@ -30,7 +31,12 @@ bool MixerModule::process(KernelState &kern, const MemState &mem, const SceUID t
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
         if (desc->id == SCE_NGS_MIXER_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented mixer audio module");
+            // the second input is the generator, which produces nothing for now
+            const SceNgsMixerParams *params = data.get_parameters<SceNgsMixerParams>(mem);
+            if (params->fGainIn[0] != 1.0f) {
+                float *samples = data.take_port_samples(0);
+                dsp::apply_gain(samples, samples, data.parent->rack->system->granularity, params->fGainIn[0]);
+            }
         }
     }
 
@@ -15,19 +15,90 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/dsp.h>
 #include <ngs/modules/pitchshift.h>
 #include <util/log.h>
 
+#include <bit>
+
 namespace ngs {
 
+// length of the window the read heads sweep before jumping back
+static constexpr float PITCH_SHIFT_WINDOW_MILLISECONDS = 40.0f;
+
+static float get_window_frames(float sample_rate) {
+    return PITCH_SHIFT_WINDOW_MILLISECONDS * sample_rate / 1000.0f;
+}
+
+uint32_t get_pitch_shift_line_frames(float sample_rate) {
+    return std::bit_ceil(static_cast<uint32_t>(get_window_frames(sample_rate)) + 2);
+}
+
+// Two read heads move through the delay line at the shifted speed, half a window apart. When a head reaches the end of
+// the window it jumps back to its start, the heads are crossfaded with triangular windows to hide the jumps.
+void process_pitch_shift(const SceNgsPitchShiftParams &params, PitchShiftState &state, float *line, uint32_t line_frames, float *samples, uint32_t frames, float sample_rate) {
+    using namespace dsp;
+
+    const uint32_t mask = line_frames - 1;
+    const float window = std::min(get_window_frames(sample_rate), static_cast<float>(line_frames - 2));
+    const float delay_step = 1.0f - std::exp2(params.fPitchOffsetInCents / 1200.0f);
+
+    const auto read = [&](float delay) {
+        // split the delay before going back in the line to keep the precision of the fraction
+        const uint32_t whole_delay = static_cast<uint32_t>(delay);
+        const uint32_t index = state.write_position + line_frames - whole_delay - 1;
+        const Vec4 fraction = splat(1.0f - (delay - static_cast<float>(whole_delay)));
+        const Vec4 first = load_frame(line + (index & mask) * 2);
+        const Vec4 second = load_frame(line + ((index + 1) & mask) * 2);
+        return first + (second - first) * fraction;
+    };
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        float *sample = samples + frame * 2;
+        store_frame(line + state.write_position * 2, load_frame(sample));
+
+        float first_delay = state.delay;
+        float second_delay = first_delay + window / 2.0f;
+        if (second_delay >= window)
+            second_delay -= window;
+
+        const float first_gain = 1.0f - std::abs(2.0f * first_delay / window - 1.0f);
+        const Vec4 output = read(first_delay) * splat(first_gain) + read(second_delay) * splat(1.0f - first_gain);
+        store_frame(sample, output);
+
+        state.delay += delay_step;
+        if (state.delay >= window)
+            state.delay -= window;
+        else if (state.delay < 0.0f)
+            state.delay += window;
+        state.write_position = (state.write_position + 1) & mask;
+    }
+}
+
 bool PitchShiftModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
         if (desc->id == SCE_NGS_PITCHSHIFT_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented pitchshift audio module");
+            const SceNgsPitchShiftParams *params = data.get_parameters<SceNgsPitchShiftParams>(mem);
+            if (params->fPitchOffsetInCents != 0.0f) {
+                const System *system = data.parent->rack->system;
+                const float sample_rate = static_cast<float>(system->sample_rate);
+                const uint32_t line_frames = get_pitch_shift_line_frames(sample_rate);
+
+                // the delay line is kept after the output
+                float *samples = data.take_port_samples(0, line_frames);
+                process_pitch_shift(*params, *data.get_state<PitchShiftState>(), samples + system->granularity * 2, line_frames,
+                    samples, system->granularity, sample_rate);
+            }
         }
     }
 
     return false;
 }
+
+void PitchShiftModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
@@ -23,11 +23,30 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstring>
 
 namespace ngs {
 
+namespace {
+
+// Dump the decoder input and the output of each player to soundlog/, formatting the file names every update is not free
+constexpr bool LOG_PLAYER_AUDIO = false;
+
+// Lay out the extra storage as the output buffer followed by a ring of frame_capacity frames, keeping the queued frames
+void reserve_ring(ModuleData &data, FrameRing &ring, const uint32_t granularity, const uint32_t frame_capacity) {
+    std::vector<float> queued(ring.size() * 2);
+    ring.pop(queued.data(), ring.size());
+
+    data.extra_storage.resize((granularity + frame_capacity) * 2 * sizeof(float));
+    ring.init(reinterpret_cast<float *>(data.extra_storage.data()) + granularity * 2, frame_capacity);
+    ring.push(queued.data(), queued.size() / 2);
+}
+
+} // namespace
+
 void PlayerModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
     SceNgsPlayerStates *state = data.get_state<SceNgsPlayerStates>();
     SceNgsPlayerParams *params = data.get_parameters<SceNgsPlayerParams>(mem);
@@ -37,6 +56,7 @@ void PlayerModule::on_state_change(const MemState &mem, ModuleData &data, const
         state->current_buffer = params->start_buffer;
         state->current_byte_position_in_buffer = params->start_bytes;
         state->current_loop_count = 0;
+        state->ring.clear();
 
         memset(&state->adpcm_history, 0, sizeof(state->adpcm_history));
     } else if (data.parent->is_keyed_off) {
@@ -95,200 +115,175 @@ bool PlayerModule::process(KernelState &kern, const MemState &mem, const SceUID
         decoder = std::make_unique<PCMDecoderState>(sample_rate);
     }
 
-    // If the amount of samples already processed and pending to be passed is smaller than the amount of samples of the audio buffer
-    if (static_cast<int>(state->decoded_samples_pending) < granularity) {
-        // Memory cleaning check
-        if (!data.extra_storage.empty()) {
-            // Delete data from previous processing if memory isn't empty
-            data.extra_storage.erase(data.extra_storage.begin(), data.extra_storage.begin() + state->decoded_samples_passed * 2 * sizeof(float));
-        }
-
-        // Reset the passed samples count to 0
-        state->decoded_samples_passed = 0;
+    if (state->ring.capacity() == 0)
+        reserve_ring(data, state->ring, granularity, std::bit_ceil<uint32_t>(granularity * 4));
 
-        while (static_cast<int>(state->decoded_samples_pending) < granularity) {
-            // Ran out of data, supply new
-            // Decode new data and deliver them
-            // Let's open our context
+    // Decode until there is enough to fill the audio buffer
+    while (static_cast<int>(state->ring.size()) < granularity) {
+        // Ran out of data, supply new
+        // Decode new data and deliver them
+        // Let's open our context
 
-            if (state->current_buffer == -1
-                || !params->buffer_params[state->current_buffer].buffer) {
-                // If no buffer is found, stop processing
-                finished = true;
-                break;
-            }
-            // If the current byte position in the buffer exceeds the total amount of bytes in the buffer
-            else if (state->current_byte_position_in_buffer >= params->buffer_params[state->current_buffer].bytes_count) {
-                const int32_t prev_index = state->current_buffer;
-                state->current_byte_position_in_buffer = 0;
-                state->current_loop_count++;
-
-                voice_lock.unlock();
-                scheduler_lock.unlock();
-
-                // Enable looping over the buffer if needed
-                if (params->buffer_params[state->current_buffer].loop_count != -1
-                    && state->current_loop_count > params->buffer_params[state->current_buffer].loop_count) {
-                    state->current_buffer = params->buffer_params[state->current_buffer].next_buffer_index;
-                    state->current_loop_count = 0;
-
-                    if (state->current_buffer == -1
-                        || !params->buffer_params[state->current_buffer].buffer) {
-                        data.invoke_callback(kern, mem, thread_id, SCE_NGS_PLAYER_END_OF_DATA, 0, 0);
-
-                        // we are done
-                        finished = true;
-                        scheduler_lock.lock();
-                        voice_lock.lock();
-                        break;
-                    } else {
-                        std::this_thread::sleep_for(std::chrono::microseconds(10));
-                        data.invoke_callback(kern, mem, thread_id, SCE_NGS_PLAYER_SWAPPED_BUFFER, prev_index,
-                            params->buffer_params[state->current_buffer].buffer.address());
-                    }
+        if (state->current_buffer == -1
+            || !params->buffer_params[state->current_buffer].buffer) {
+            // If no buffer is found, stop processing
+            finished = true;
+            break;
+        }
+        // If the current byte position in the buffer exceeds the total amount of bytes in the buffer
+        else if (state->current_byte_position_in_buffer >= params->buffer_params[state->current_buffer].bytes_count) {
+            const int32_t prev_index = state->current_buffer;
+            state->current_byte_position_in_buffer = 0;
+            state->current_loop_count++;
+
+            voice_lock.unlock();
+            scheduler_lock.unlock();
+
+            // Enable looping over the buffer if needed
+            if (params->buffer_params[state->current_buffer].loop_count != -1
+                && state->current_loop_count > params->buffer_params[state->current_buffer].loop_count) {
+                state->current_buffer = params->buffer_params[state->current_buffer].next_buffer_index;
+                state->current_loop_count = 0;
+
+                if (state->current_buffer == -1
+                    || !params->buffer_params[state->current_buffer].buffer) {
+                    data.invoke_callback(kern, mem, thread_id, SCE_NGS_PLAYER_END_OF_DATA, 0, 0);
+
+                    // we are done
+                    finished = true;
+                    scheduler_lock.lock();
+                    voice_lock.lock();
+                    break;
                 } else {
-                    data.invoke_callback(kern, mem, thread_id, SCE_NGS_PLAYER_LOOPED_BUFFER, state->current_loop_count,
+                    std::this_thread::sleep_for(std::chrono::microseconds(10));
+                    data.invoke_callback(kern, mem, thread_id, SCE_NGS_PLAYER_SWAPPED_BUFFER, prev_index,
                         params->buffer_params[state->current_buffer].buffer.address());
                 }
-
-                scheduler_lock.lock();
-                voice_lock.lock();
+            } else {
+                data.invoke_callback(kern, mem, thread_id, SCE_NGS_PLAYER_LOOPED_BUFFER, state->current_loop_count,
+                    params->buffer_params[state->current_buffer].buffer.address());
             }
 
-            if (data.extra_storage.size() < sizeof(float) * 2 * granularity
-                && state->current_buffer != -1
-                && params->buffer_params[state->current_buffer].bytes_count != 0) {
-                // Set up decoder
-                decoder->source_channels = params->channels;
-                decoder->source_frequency = params->playback_frequency;
-                // Enable ADPCM mode on the decoder if needed, and restore state
-                decoder->he_adpcm = static_cast<bool>(params->type);
-                if (decoder->he_adpcm) {
-                    std::copy_n(state->adpcm_history, decoder->source_channels, decoder->adpcm_history);
-                }
-
-                // Get audio buffer
-                auto *input = params->buffer_params[state->current_buffer].buffer.cast<uint8_t>().get(mem);
-
-                DecoderSize samples_count;
-                // we need to know how many samples (not bytes!) we need to send (just enough for the system granularity)
-                uint32_t samples_needed = granularity - state->decoded_samples_pending;
-
-                if (params->playback_scalar != 1.0f) {
-                    samples_needed = static_cast<uint32_t>(samples_needed * params->playback_scalar) + 0x10;
-                }
-                if (static_cast<int>(params->playback_frequency) != sample_rate) {
-                    samples_needed = static_cast<uint32_t>((samples_needed * params->playback_frequency) / sample_rate) + 0x10;
-                }
-
-                // Convert samples count to actual bytes count that we need
-                uint32_t bytes_to_send;
-                if (decoder->he_adpcm) {
-                    bytes_to_send = (samples_needed + 27) / 28 * params->channels * 16;
-                } else {
-                    bytes_to_send = samples_needed * params->channels * sizeof(int16_t);
-                }
-
-                // makes the value 4 bits aligned so we have no issue with decoding, adpcm or not and whether the sound is mono or stereo
-                bytes_to_send = std::min<uint32_t>(bytes_to_send, params->buffer_params[state->current_buffer].bytes_count - state->current_byte_position_in_buffer);
-
-                // Send buffered audio data to decoder
-                decoder->send(input + state->current_byte_position_in_buffer, bytes_to_send);
-
-                std::string file_name = fmt::format("soundlog/ngs_pcm_decoder_voice_{}_voice_module_{}_input.dat", log_hex(intptr_t(data.parent)), log_hex(intptr_t(&data)));
-                log_to_file(file_name, (const char *)(input + state->current_byte_position_in_buffer), bytes_to_send);
-
-                state->current_byte_position_in_buffer += bytes_to_send;
-                state->bytes_consumed_since_key_on += bytes_to_send;
-                state->total_bytes_consumed += bytes_to_send;
-                // save he_adpcm state
-                if (decoder->he_adpcm)
-                    std::copy_n(decoder->adpcm_history, decoder->source_channels, state->adpcm_history);
-
-                // Get the amount of samples about to be received from the decoder and dump the value in samples_count
-                decoder->receive(nullptr, &samples_count);
-                // Playback rate scaling
-                if (params->playback_scalar != 1 || static_cast<int>(round(params->playback_frequency)) != sample_rate) {
-                    LOG_INFO_ONCE("The currently running game requests playback rate scaling when decoding audio. Audio might crackle.");
-
-                    // Received decoded samples from decoder
-                    std::vector<uint8_t> decoded_data(samples_count.samples * sizeof(float) * 2, 0);
-
-                    // Receive the samples processed by the decoder
-                    decoder->receive(decoded_data.data(), nullptr);
-
-                    // resample the audio
-                    int src_sample_rate = static_cast<int>(params->playback_frequency);
-                    if (params->playback_scalar != 1.0f)
-                        src_sample_rate = static_cast<int>(src_sample_rate * params->playback_scalar);
-
-                    if (!state->swr || state->reset_swr) {
-                        if (state->swr)
-                            swr_free(&state->swr);
+            scheduler_lock.lock();
+            voice_lock.lock();
+        }
 
-                        AVChannelLayout layout_stereo = AV_CHANNEL_LAYOUT_STEREO;
-                        int ret = swr_alloc_set_opts2(&state->swr,
-                            &layout_stereo, AV_SAMPLE_FMT_FLT, sample_rate,
-                            &layout_stereo, AV_SAMPLE_FMT_FLT, src_sample_rate,
-                            0, nullptr);
-                        assert(ret == 0);
+        if (state->current_buffer == -1
+            || params->buffer_params[state->current_buffer].bytes_count == 0)
+            continue;
+
+        // Set up decoder
+        decoder->source_channels = params->channels;
+        decoder->source_frequency = params->playback_frequency;
+        // Enable ADPCM mode on the decoder if needed, and restore state
+        decoder->he_adpcm = static_cast<bool>(params->type);
+        if (decoder->he_adpcm) {
+            std::copy_n(state->adpcm_history, decoder->source_channels, decoder->adpcm_history);
+        }
 
-                        ret = swr_init(state->swr);
-                        assert(ret == 0);
-                        state->reset_swr = false;
-                    }
-                    int scaled_samples_amount = swr_get_out_samples(state->swr, samples_count.samples);
-                    std::vector<uint8_t> scaled_data(scaled_samples_amount * sizeof(float) * 2, 0);
+        // Get audio buffer
+        auto *input = params->buffer_params[state->current_buffer].buffer.cast<uint8_t>().get(mem);
 
-                    uint8_t *scaled_dest_data = scaled_data.data();
-                    const uint8_t *scaled_src_data = decoded_data.data();
-                    scaled_samples_amount = swr_convert(state->swr, &scaled_dest_data, scaled_samples_amount, &scaled_src_data, samples_count.samples);
-                    assert(scaled_samples_amount > 0);
+        DecoderSize samples_count;
+        // we need to know how many samples (not bytes!) we need to send (just enough for the system granularity)
+        uint32_t samples_needed = granularity - state->ring.size();
 
-                    // Get current size of audio queue for processed samples in memory
-                    const uint32_t current_count = state->decoded_samples_pending * sizeof(float) * 2;
+        if (params->playback_scalar != 1.0f) {
+            samples_needed = static_cast<uint32_t>(samples_needed * params->playback_scalar) + 0x10;
+        }
+        if (static_cast<int>(params->playback_frequency) != sample_rate) {
+            samples_needed = static_cast<uint32_t>((samples_needed * params->playback_frequency) / sample_rate) + 0x10;
+        }
 
-                    // Allocate memory to accommodate the result of the scaling process into the queue for the final audio buffer
-                    data.extra_storage.resize(current_count + scaled_samples_amount * sizeof(float) * 2);
+        // Convert samples count to actual bytes count that we need
+        uint32_t bytes_to_send;
+        if (decoder->he_adpcm) {
+            bytes_to_send = (samples_needed + 27) / 28 * params->channels * 16;
+        } else {
+            bytes_to_send = samples_needed * params->channels * sizeof(int16_t);
+        }
 
-                    // Pass scaled audio data into the queue for the final audio buffer
-                    memcpy(data.extra_storage.data() + current_count, scaled_data.data(), scaled_samples_amount * sizeof(float) * 2);
+        // makes the value 4 bits aligned so we have no issue with decoding, adpcm or not and whether the sound is mono or stereo
+        bytes_to_send = std::min<uint32_t>(bytes_to_send, params->buffer_params[state->current_buffer].bytes_count - state->current_byte_position_in_buffer);
 
-                } else {
-                    // Get current size of audio buffer for processed samples in memory
-                    const uint32_t current_count = state->decoded_samples_pending * sizeof(float) * 2;
+        // Send buffered audio data to decoder
+        decoder->send(input + state->current_byte_position_in_buffer, bytes_to_send);
 
-                    // Increase the size the audio buffer for processed samples to accommodate the new about-to-be-received samples
-                    data.extra_storage.resize(current_count + samples_count.samples * sizeof(float) * 2);
+        if constexpr (LOG_PLAYER_AUDIO) {
+            std::string file_name = fmt::format("soundlog/ngs_pcm_decoder_voice_{}_voice_module_{}_input.dat", log_hex(intptr_t(data.parent)), log_hex(intptr_t(&data)));
+            log_to_file(file_name, (const char *)(input + state->current_byte_position_in_buffer), bytes_to_send);
+        }
 
-                    // Receive the samples processed by the decoder and append them to the buffer of already processed samples
-                    decoder->receive(current_count + data.extra_storage.data(), nullptr);
-                }
+        state->current_byte_position_in_buffer += bytes_to_send;
+        state->bytes_consumed_since_key_on += bytes_to_send;
+        state->total_bytes_consumed += bytes_to_send;
+        // save he_adpcm state
+        if (decoder->he_adpcm)
+            std::copy_n(decoder->adpcm_history, decoder->source_channels, state->adpcm_history);
+
+        // Receive the samples processed by the decoder, the scratch buffer only grows until it fits the largest chunk
+        decoder->receive(nullptr, &samples_count);
+        decoded_frames.resize(samples_count.samples * 2);
+        decoder->receive(reinterpret_cast<uint8_t *>(decoded_frames.data()), nullptr);
+
+        const float *frames = decoded_frames.data();
+        uint32_t frames_count = samples_count.samples;
+
+        // Playback rate scaling
+        if (params->playback_scalar != 1 || static_cast<int>(round(params->playback_frequency)) != sample_rate) {
+            LOG_INFO_ONCE("The currently running game requests playback rate scaling when decoding audio. Audio might crackle.");
+
+            // resample the audio
+            int src_sample_rate = static_cast<int>(params->playback_frequency);
+            if (params->playback_scalar != 1.0f)
+                src_sample_rate = static_cast<int>(src_sample_rate * params->playback_scalar);
+
+            if (!state->swr || state->reset_swr) {
+                if (state->swr)
+                    swr_free(&state->swr);
+
+                AVChannelLayout layout_stereo = AV_CHANNEL_LAYOUT_STEREO;
+                int ret = swr_alloc_set_opts2(&state->swr,
+                    &layout_stereo, AV_SAMPLE_FMT_FLT, sample_rate,
+                    &layout_stereo, AV_SAMPLE_FMT_FLT, src_sample_rate,
+                    0, nullptr);
+                assert(ret == 0);
+
+                ret = swr_init(state->swr);
+                assert(ret == 0);
+                state->reset_swr = false;
             }
+            int scaled_samples_amount = swr_get_out_samples(state->swr, samples_count.samples);
+            resampled_frames.resize(scaled_samples_amount * 2);
 
-            uint32_t bytes_left_in_buffer = data.extra_storage.size();
-            uint32_t samples_to_take_per_channel = bytes_left_in_buffer / sizeof(float) / 2;
+            uint8_t *scaled_dest_data = reinterpret_cast<uint8_t *>(resampled_frames.data());
+            const uint8_t *scaled_src_data = reinterpret_cast<const uint8_t *>(decoded_frames.data());
+            scaled_samples_amount = swr_convert(state->swr, &scaled_dest_data, scaled_samples_amount, &scaled_src_data, samples_count.samples);
+            assert(scaled_samples_amount > 0);
 
-            state->decoded_samples_pending = samples_to_take_per_channel;
+            frames = resampled_frames.data();
+            frames_count = std::max(scaled_samples_amount, 0);
         }
-    }
 
-    uint32_t samples_to_be_passed = std::min<uint32_t>(state->decoded_samples_pending, granularity);
+        // Queue the decoded audio, a chunk bigger than usual makes the ring grow
+        if (state->ring.space() < frames_count)
+            reserve_ring(data, state->ring, granularity, std::bit_ceil(state->ring.size() + frames_count));
 
-    auto const new_size = 2 * sizeof(float) * (state->decoded_samples_passed + granularity);
-    if (data.extra_storage.size() < new_size) {
-        data.extra_storage.resize(new_size);
+        state->ring.push(frames, frames_count);
     }
-    uint8_t *data_ptr = data.extra_storage.data();
-    data_ptr += 2 * sizeof(float) * state->decoded_samples_passed;
 
-    data.parent->products[0].data = data_ptr;
+    // The audio buffer is at the start of the extra storage, followed by the samples of the ring
+    float *output = reinterpret_cast<float *>(data.extra_storage.data());
+    const uint32_t samples_to_be_passed = state->ring.pop(output, granularity);
+    std::fill(output + samples_to_be_passed * 2, output + granularity * 2, 0.0f);
 
-    std::string file_name = fmt::format("soundlog/ngs_pcm_decoder_voice_{}_voice_module{}.dat", log_hex(intptr_t(data.parent)), log_hex(intptr_t(&data)));
-    log_to_file(file_name, reinterpret_cast<const char *>(data.parent->products[0].data), data.parent->rack->system->granularity * 2 * sizeof(float));
+    data.parent->products[0].data = data.extra_storage.data();
+
+    if constexpr (LOG_PLAYER_AUDIO) {
+        std::string file_name = fmt::format("soundlog/ngs_pcm_decoder_voice_{}_voice_module{}.dat", log_hex(intptr_t(data.parent)), log_hex(intptr_t(&data)));
+        log_to_file(file_name, reinterpret_cast<const char *>(data.parent->products[0].data), data.parent->rack->system->granularity * 2 * sizeof(float));
+    }
 
-    state->decoded_samples_pending -= samples_to_be_passed;
-    state->decoded_samples_passed += samples_to_be_passed;
     state->samples_generated_since_key_on += samples_to_be_passed * params->channels;
     state->samples_generated_total += samples_to_be_passed * params->channels;
 
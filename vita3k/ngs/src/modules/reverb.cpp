@@ -15,19 +15,197 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/dsp.h>
 #include <ngs/modules/reverb.h>
 #include <util/log.h>
 
+#include <array>
+#include <bit>
+#include <numbers>
+
 namespace ngs {
 
+// The late reverberation is a Freeverb style network: parallel damped comb filters followed by serial allpasses.
+// Lengths are in frames at 44100 Hz, the right channel uses slightly longer ones to decorrelate the channels.
+static constexpr std::array<uint32_t, REVERB_COMB_COUNT> REVERB_COMB_LENGTHS = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+static constexpr std::array<uint32_t, REVERB_ALLPASS_COUNT> REVERB_ALLPASS_LENGTHS = { 556, 441, 341, 225 };
+static constexpr uint32_t REVERB_STEREO_SPREAD = 23;
+static constexpr float REVERB_COMB_INPUT_GAIN = 0.015f;
+
+static constexpr float REVERB_MAX_REFLECTIONS_DELAY = 0.3f;
+static constexpr float REVERB_MAX_REVERB_DELAY = 0.1f;
+
+// Delays in ms after the reflections delay and gains of the early reflection taps of each pattern
+static constexpr uint32_t REVERB_EARLY_TAP_COUNT = 4;
+static constexpr float REVERB_EARLY_TAP_DELAYS[6][REVERB_EARLY_TAP_COUNT] = {
+    { 0.0f, 7.1f, 13.3f, 19.7f },
+    { 0.0f, 8.3f, 11.9f, 21.1f },
+    { 0.0f, 11.3f, 23.9f, 37.1f },
+    { 0.0f, 13.7f, 26.3f, 41.9f },
+    { 0.0f, 17.9f, 35.3f, 59.3f },
+    { 0.0f, 19.1f, 43.7f, 67.9f },
+};
+static constexpr float REVERB_EARLY_TAP_GAINS[REVERB_EARLY_TAP_COUNT] = { 0.35f, 0.28f, 0.21f, 0.16f };
+static constexpr float REVERB_MAX_EARLY_TAP_DELAY = 0.07f;
+
+struct ReverbLayout {
+    uint32_t predelay_frames;
+    uint32_t comb_lengths[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_COMB_COUNT];
+    uint32_t allpass_lengths[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_ALLPASS_COUNT];
+    uint32_t size;
+};
+
+static ReverbLayout get_reverb_layout(float sample_rate) {
+    ReverbLayout layout;
+    layout.predelay_frames = std::bit_ceil(static_cast<uint32_t>((REVERB_MAX_REFLECTIONS_DELAY + REVERB_MAX_REVERB_DELAY + REVERB_MAX_EARLY_TAP_DELAY) * sample_rate) + 2);
+    layout.size = layout.predelay_frames;
+
+    const float scale = sample_rate / 44100.0f;
+    for (uint32_t channel = 0; channel < SCE_NGS_MAX_SYSTEM_CHANNELS; channel++) {
+        const uint32_t spread = channel * REVERB_STEREO_SPREAD;
+        for (uint32_t i = 0; i < REVERB_COMB_COUNT; i++) {
+            layout.comb_lengths[channel][i] = std::max(static_cast<uint32_t>((REVERB_COMB_LENGTHS[i] + spread) * scale), 1u);
+            layout.size += layout.comb_lengths[channel][i];
+        }
+        for (uint32_t i = 0; i < REVERB_ALLPASS_COUNT; i++) {
+            layout.allpass_lengths[channel][i] = std::max(static_cast<uint32_t>((REVERB_ALLPASS_LENGTHS[i] + spread) * scale), 1u);
+            layout.size += layout.allpass_lengths[channel][i];
+        }
+    }
+
+    return layout;
+}
+
+uint32_t get_reverb_memory_size(float sample_rate) {
+    return get_reverb_layout(sample_rate).size;
+}
+
+void process_reverb(const SceNgsReverbParams &params, ReverbState &state, float *memory, float *samples, uint32_t frames, float sample_rate) {
+    const ReverbLayout layout = get_reverb_layout(sample_rate);
+    const uint32_t predelay_mask = layout.predelay_frames - 1;
+    float *predelay = memory;
+
+    const float decay_time = std::clamp(params.fDecayTime, 0.1f, 20.0f);
+    const uint32_t reflections_delay = static_cast<uint32_t>(std::clamp(params.fReflectionsDelay, 0.0f, REVERB_MAX_REFLECTIONS_DELAY) * sample_rate);
+    const uint32_t late_delay = reflections_delay + static_cast<uint32_t>(std::clamp(params.fReverbDelay, 0.0f, REVERB_MAX_REVERB_DELAY) * sample_rate);
+
+    // the density shortens the combs down to 60% of their length
+    const float density = 0.6f + 0.4f * std::clamp(params.fDensity, 0.0f, 100.0f) / 100.0f;
+    const float damping = std::clamp(1.0f - params.fDecayHFRatio, 0.0f, 0.9f);
+    const float allpass_feedback = 0.5f * std::clamp(params.fDiffusion, 0.0f, 100.0f) / 100.0f;
+
+    // the room HF attenuation is a one pole lowpass on the input of the reverb with this gain at the HF reference
+    float input_coefficient = 1.0f;
+    const float room_hf = std::min(dsp::millibels_to_gain(params.fRoomHF), 1.0f);
+    if (room_hf < 0.999f) {
+        const float cutoff = std::max(params.fHFReference, 10.0f) * room_hf / std::sqrt(1.0f - room_hf * room_hf);
+        input_coefficient = 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> * cutoff / sample_rate);
+    }
+
+    const float room = dsp::millibels_to_gain(params.fRoom);
+    const float reflections_gain = room * dsp::millibels_to_gain(params.fReflections) * params.fEarlyReflectionScalar;
+    const float reverb_gain = room * dsp::millibels_to_gain(params.fReverb);
+    const float dry_gain = dsp::millibels_to_gain(params.fDryMB);
+
+    uint32_t comb_lengths[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_COMB_COUNT];
+    float comb_feedbacks[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_COMB_COUNT];
+    float *combs[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_COMB_COUNT];
+    float *allpasses[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_ALLPASS_COUNT];
+    uint32_t early_delays[SCE_NGS_MAX_SYSTEM_CHANNELS][REVERB_EARLY_TAP_COUNT];
+
+    float *buffer = memory + layout.predelay_frames;
+    for (uint32_t channel = 0; channel < SCE_NGS_MAX_SYSTEM_CHANNELS; channel++) {
+        for (uint32_t i = 0; i < REVERB_COMB_COUNT; i++) {
+            combs[channel][i] = buffer;
+            buffer += layout.comb_lengths[channel][i];
+
+            comb_lengths[channel][i] = std::max(static_cast<uint32_t>(layout.comb_lengths[channel][i] * density), 1u);
+            // each pass through a comb must lose its share of the 60 dB of the decay time
+            comb_feedbacks[channel][i] = std::pow(10.0f, -3.0f * comb_lengths[channel][i] / (decay_time * sample_rate));
+            if (state.comb_positions[channel][i] >= comb_lengths[channel][i])
+                state.comb_positions[channel][i] = 0;
+        }
+        for (uint32_t i = 0; i < REVERB_ALLPASS_COUNT; i++) {
+            allpasses[channel][i] = buffer;
+            buffer += layout.allpass_lengths[channel][i];
+        }
+
+        const uint32_t pattern = std::min<uint32_t>(static_cast<uint32_t>(params.eEarlyReflectionPattern[channel]), 5);
+        for (uint32_t i = 0; i < REVERB_EARLY_TAP_COUNT; i++)
+            early_delays[channel][i] = reflections_delay + static_cast<uint32_t>(REVERB_EARLY_TAP_DELAYS[pattern][i] * sample_rate / 1000.0f);
+    }
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        float *sample = samples + frame * 2;
+
+        state.input_filter += input_coefficient * ((sample[0] + sample[1]) * 0.5f - state.input_filter);
+        predelay[state.predelay_position] = state.input_filter;
+        const float late_input = predelay[(state.predelay_position - late_delay) & predelay_mask] * REVERB_COMB_INPUT_GAIN;
+
+        for (uint32_t channel = 0; channel < SCE_NGS_MAX_SYSTEM_CHANNELS; channel++) {
+            float early = 0.0f;
+            for (uint32_t i = 0; i < REVERB_EARLY_TAP_COUNT; i++)
+                early += predelay[(state.predelay_position - early_delays[channel][i]) & predelay_mask] * REVERB_EARLY_TAP_GAINS[i];
+
+            float late = 0.0f;
+            for (uint32_t i = 0; i < REVERB_COMB_COUNT; i++) {
+                uint32_t &position = state.comb_positions[channel][i];
+                float &filter = state.comb_filters[channel][i];
+                const float output = combs[channel][i][position];
+                filter = output + damping * (filter - output);
+                combs[channel][i][position] = late_input + filter * comb_feedbacks[channel][i];
+                if (++position == comb_lengths[channel][i])
+                    position = 0;
+                late += output;
+            }
+
+            for (uint32_t i = 0; i < REVERB_ALLPASS_COUNT; i++) {
+                uint32_t &position = state.allpass_positions[channel][i];
+                const float delayed = allpasses[channel][i][position];
+                allpasses[channel][i][position] = late + delayed * allpass_feedback;
+                late = delayed - late;
+                if (++position == layout.allpass_lengths[channel][i])
+                    position = 0;
+            }
+
+            sample[channel] = sample[channel] * dry_gain + early * reflections_gain + late * reverb_gain;
+        }
+
+        state.predelay_position = (state.predelay_position + 1) & predelay_mask;
+    }
+
+    // flush the denormals once the reverb went quiet, they are very slow to compute with
+    if (std::abs(state.input_filter) < 1e-15f)
+        state.input_filter = 0.0f;
+    for (auto &filters : state.comb_filters) {
+        for (float &filter : filters) {
+            if (std::abs(filter) < 1e-15f)
+                filter = 0.0f;
+        }
+    }
+}
+
 bool ReverbModule::process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     if (!data.is_bypassed) {
         const SceNgsParamsDescriptor *desc = data.get_parameters<SceNgsParamsDescriptor>(mem);
-        if (desc->id == SCE_NGS_REVERB_PARAMS_STRUCT_ID) {
-            LOG_WARN_ONCE("Game is using unimplemented reverb audio module");
+        if (desc->id == SCE_NGS_REVERB_PARAMS_STRUCT_ID || desc->id == SCE_NGS_REVERB_PARAMS_STRUCT_ID_V2) {
+            const System *system = data.parent->rack->system;
+            const float sample_rate = static_cast<float>(system->sample_rate);
+
+            // the delay lines are kept after the output
+            const uint32_t memory_frames = (get_reverb_memory_size(sample_rate) + 1) / 2;
+            float *samples = data.take_port_samples(0, memory_frames);
+            process_reverb(*data.get_parameters<SceNgsReverbParams>(mem), *data.get_state<ReverbState>(), samples + system->granularity * 2,
+                samples, system->granularity, sample_rate);
         }
     }
 
     return false;
 }
+
+void ReverbModule::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
+    if (data.parent->state == VOICE_STATE_ACTIVE && previous == VOICE_STATE_AVAILABLE)
+        data.reset_processing();
+}
+
 } // namespace ngs
@@ -20,10 +20,14 @@
 
 #include <ngs/state.h>
 #include <ngs/system.h>
+#include <util/audio_mix.h>
 #include <util/lock_and_find.h>
 
 #include <util/vector_utils.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace ngs {
 Rack::Rack(System *mama, const Ptr<void> memspace, const uint32_t memspace_size)
     : MempoolObject(memspace, memspace_size)
@@ -86,12 +90,7 @@ int32_t VoiceInputManager::receive(ngs::Patch *patch, const VoiceProduct &produc
 
     // Try mixing, also with the use of this volume matrix
     // Dest is our voice to receive this data.
-    for (int32_t k = 0; k < patch->dest->rack->system->granularity; k++) {
-        dest_buffer[k * 2] = std::clamp(dest_buffer[k * 2] + data_to_mix_in[k * 2] * volume_matrix[0][0]
-                + data_to_mix_in[k * 2 + 1] * volume_matrix[1][0],
-            -1.0f, 1.0f);
-        dest_buffer[k * 2 + 1] = std::clamp(dest_buffer[k * 2 + 1] + data_to_mix_in[k * 2] * volume_matrix[0][1] + data_to_mix_in[k * 2 + 1] * volume_matrix[1][1], -1.0f, 1.0f);
-    }
+    util::mix_stereo_f32(dest_buffer, data_to_mix_in, patch->dest->rack->system->granularity, volume_matrix);
 
     return 0;
 }
@@ -149,12 +148,53 @@ void ModuleData::fill_to_fit_granularity() {
     }
 }
 
+float *ModuleData::take_port_samples(const uint32_t port, const uint32_t extra_frames) {
+    const uint32_t granularity = parent->rack->system->granularity;
+    const size_t size = (granularity + extra_frames) * 2 * sizeof(float);
+    if (extra_storage.size() < size)
+        extra_storage.resize(size);
+
+    float *samples = reinterpret_cast<float *>(extra_storage.data());
+    const uint8_t *product = parent->products[port].data;
+    if (product)
+        memcpy(samples, product, granularity * 2 * sizeof(float));
+    else
+        std::fill_n(samples, granularity * 2, 0.0f);
+
+    parent->products[port].data = extra_storage.data();
+    return samples;
+}
+
+void ModuleData::reset_processing() {
+    voice_state_data.clear();
+    std::fill(extra_storage.begin(), extra_storage.end(), 0);
+}
+
+std::pair<uint32_t, uint32_t> ModuleData::get_position_among_same_modules() const {
+    const auto &modules = parent->rack->modules;
+    const uint32_t id = modules[index]->module_id();
+
+    uint32_t position = 0;
+    uint32_t count = 0;
+    for (size_t i = 0; i < modules.size(); i++) {
+        if (modules[i]->module_id() != id)
+            continue;
+
+        if (i < index)
+            position++;
+        count++;
+    }
+
+    return { position, count };
+}
+
 void Voice::init(Rack *mama) {
     rack = mama;
     state = VoiceState::VOICE_STATE_AVAILABLE;
     is_pending = false;
     is_paused = false;
     is_keyed_off = false;
+    update_index = 0;
 
     datas.resize(mama->modules.size());
 
@@ -321,6 +361,12 @@ void Voice::invoke_callback(KernelState &kernel, const MemState &mem, const SceU
         return;
     }
 
+    if (VoiceScheduler::run_on_update_thread([&]() {
+            invoke_callback(kernel, mem, thread_id, callback, user_data, module_id, reason1, reason2, reason_ptr);
+        })) {
+        return;
+    }
+
     const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
     const Address callback_info_addr = stack_alloc(*thread->cpu, sizeof(SceNgsCallbackInfo));
 
@@ -0,0 +1,69 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <ngs/ring.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace ngs {
+
+void FrameRing::init(float *samples, uint32_t frame_capacity) {
+    assert((frame_capacity & (frame_capacity - 1)) == 0);
+
+    this->samples = samples;
+    this->frame_capacity = frame_capacity;
+    clear();
+}
+
+void FrameRing::clear() {
+    read_position.store(0, std::memory_order_relaxed);
+    write_position.store(0, std::memory_order_release);
+}
+
+uint32_t FrameRing::push(const float *frames, uint32_t count) {
+    // only the producer writes write_position
+    const uint32_t write = write_position.load(std::memory_order_relaxed);
+    const uint32_t read = read_position.load(std::memory_order_acquire);
+    count = std::min(count, frame_capacity - (write - read));
+
+    // the frames may wrap around the end of the samples
+    const uint32_t start = write & (frame_capacity - 1);
+    const uint32_t first_part = std::min(count, frame_capacity - start);
+    std::copy_n(frames, first_part * 2, samples + start * 2);
+    std::copy_n(frames + first_part * 2, (count - first_part) * 2, samples);
+
+    write_position.store(write + count, std::memory_order_release);
+    return count;
+}
+
+uint32_t FrameRing::pop(float *dest, uint32_t count) {
+    // only the consumer writes read_position
+    const uint32_t read = read_position.load(std::memory_order_relaxed);
+    const uint32_t write = write_position.load(std::memory_order_acquire);
+    count = std::min(count, write - read);
+
+    const uint32_t start = read & (frame_capacity - 1);
+    const uint32_t first_part = std::min(count, frame_capacity - start);
+    std::copy_n(samples + start * 2, first_part * 2, dest);
+    std::copy_n(samples, (count - first_part) * 2, dest + first_part * 2);
+
+    read_position.store(read + count, std::memory_order_release);
+    return count;
+}
+
+} // namespace ngs
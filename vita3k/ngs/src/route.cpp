@@ -17,28 +17,65 @@
 
 #include <ngs/system.h>
 
-#include <util/vector_utils.h>
+#include <threads/thread_pool.h>
+
+#include <algorithm>
 
 namespace ngs {
-bool deliver_data(const MemState &mem, const std::vector<Voice *> &voice_queue, Voice *source, const uint8_t output_port,
-    const VoiceProduct &data_to_deliver) {
-    if (!data_to_deliver.data) {
-        return false;
-    }
+namespace {
+
+struct PatchDelivery {
+    Voice *dest;
+    Patch *patch;
+    const VoiceProduct *product;
+};
+
+} // namespace
+
+void deliver_data(const MemState &mem, const std::vector<Voice *> &sources, const std::function<bool(const Voice *)> &is_scheduled) {
+    std::vector<PatchDelivery> deliveries;
+    for (Voice *source : sources) {
+        for (uint32_t port = 0; port < source->rack->vdef->output_count; port++) {
+            const VoiceProduct &product = source->products[port];
+            if (!product.data)
+                continue;
 
-    for (auto &patch_ptr : source->patches[output_port]) {
-        Patch *patch = patch_ptr.get(mem);
+            for (auto &patch_ptr : source->patches[port]) {
+                Patch *patch = patch_ptr.get(mem);
+
+                if (!patch || patch->output_sub_index == -1)
+                    continue;
+
+                if (!is_scheduled(patch->dest))
+                    continue;
+
+                deliveries.push_back({ patch->dest, patch, &product });
+            }
+        }
+    }
 
-        if (!patch || patch->output_sub_index == -1)
-            continue;
+    if (deliveries.empty())
+        return;
 
-        if (!vector_utils::contains(voice_queue, patch->dest))
-            continue;
+    // group the deliveries by destination, keeping the order of the sources so that the mix does not depend on the threads
+    std::stable_sort(deliveries.begin(), deliveries.end(), [](const PatchDelivery &lhs, const PatchDelivery &rhs) {
+        return std::less<Voice *>()(lhs.dest, rhs.dest);
+    });
 
-        const std::lock_guard<std::mutex> guard(*patch->dest->voice_mutex);
-        patch->dest->inputs.receive(patch, data_to_deliver);
+    std::vector<size_t> dest_starts;
+    for (size_t i = 0; i < deliveries.size(); i++) {
+        if (i == 0 || deliveries[i].dest != deliveries[i - 1].dest)
+            dest_starts.push_back(i);
     }
+    dest_starts.push_back(deliveries.size());
 
-    return true;
+    get_shared_thread_pool().parallel_for(dest_starts.size() - 1, 4, [&](size_t begin, size_t end) {
+        for (size_t dest = begin; dest < end; dest++) {
+            Voice *voice = deliveries[dest_starts[dest]].dest;
+            const std::lock_guard<std::mutex> guard(*voice->voice_mutex);
+            for (size_t i = dest_starts[dest]; i < dest_starts[dest + 1]; i++)
+                voice->inputs.receive(deliveries[i].patch, *deliveries[i].product);
+        }
+    });
 }
 } // namespace ngs
@@ -19,13 +19,177 @@
 #include <ngs/system.h>
 
 #include <kernel/state.h>
+#include <threads/thread_pool.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <memory>
 #include <util/vector_utils.h>
 
 namespace ngs {
 
+namespace {
+
+struct UpdateVoice {
+    Voice *voice;
+    // length of the longest chain of patches leading to this voice
+    uint32_t level;
+    bool finished;
+    uint32_t finished_module;
+};
+
+struct CallbackRequest {
+    const std::function<void()> *callback;
+    bool done;
+};
+
+// Voices of the same level, they can be processed in parallel
+struct UpdateLevel {
+    std::vector<UpdateVoice> &voices;
+    // indexes of the voices in voices, grouped by job
+    std::vector<uint32_t> job_voices;
+    // start of each job in job_voices, followed by the end of the last one
+    std::vector<uint32_t> job_starts;
+    std::atomic<size_t> next_job = 0;
+
+    std::mutex mutex;
+    std::condition_variable condvar;
+    size_t done_jobs = 0;
+    // callbacks the workers want to run on the update thread
+    std::vector<CallbackRequest *> callback_requests;
+    // Guest callbacks can change any voice of the system (state, parameters, patches), so one only runs
+    // once no other thread is processing a voice, and no voice is processed until it returns
+    size_t processing = 0;
+    bool callback_running = false;
+
+    explicit UpdateLevel(std::vector<UpdateVoice> &voices)
+        : voices(voices) {}
+
+    size_t job_count() const {
+        return job_starts.size() - 1;
+    }
+};
+
+// level the worker running on this thread is processing
+thread_local UpdateLevel *worker_level = nullptr;
+// level the update thread is processing its share of
+thread_local UpdateLevel *update_level = nullptr;
+// set while this thread runs a guest callback, the callback can then be run directly
+thread_local bool running_callback = false;
+
+void run_callback(const std::function<void()> &callback) {
+    running_callback = true;
+    callback();
+    running_callback = false;
+}
+
+// Wait for the other threads to stop processing voices, the level mutex must be held
+void begin_callback(UpdateLevel &level, std::unique_lock<std::mutex> &level_lock) {
+    level.callback_running = true;
+    level.condvar.wait(level_lock, [&]() { return level.processing == 0; });
+}
+
+void end_callback(UpdateLevel &level) {
+    level.callback_running = false;
+    level.condvar.notify_all();
+}
+
+void process_voice(KernelState &kern, const MemState &mem, const SceUID thread_id, UpdateVoice &update, std::unique_lock<std::recursive_mutex> &scheduler_lock) {
+    Voice *voice = update.voice;
+
+    // Modify the state, in peace....
+    std::unique_lock<std::mutex> voice_lock(*voice->voice_mutex);
+    memset(voice->products, 0, sizeof(voice->products));
+
+    for (size_t i = 0; i < voice->rack->modules.size(); i++) {
+        if (voice->rack->modules[i]) {
+            if (voice->rack->modules[i]->process(kern, mem, thread_id, voice->datas[i], scheduler_lock, voice_lock)) {
+                update.finished = true;
+                update.finished_module = voice->rack->modules[i]->module_id();
+            }
+        }
+    }
+
+    voice->frame_count++;
+}
+
+// Run the callbacks requested by the workers, the level mutex must be held
+void run_callback_requests(UpdateLevel &level, std::unique_lock<std::mutex> &level_lock, std::unique_lock<std::recursive_mutex> &scheduler_lock) {
+    while (!level.callback_requests.empty()) {
+        CallbackRequest *request = level.callback_requests.back();
+        level.callback_requests.pop_back();
+
+        // same as when the voice is processed on the update thread, the scheduler is unlocked during the callback
+        begin_callback(level, level_lock);
+        level_lock.unlock();
+        scheduler_lock.unlock();
+        run_callback(*request->callback);
+        scheduler_lock.lock();
+        level_lock.lock();
+
+        request->done = true;
+        end_callback(level);
+    }
+}
+
+// Process the jobs of the level until there are none left
+void run_jobs(KernelState &kern, const MemState &mem, const SceUID thread_id, UpdateLevel &level, std::unique_lock<std::recursive_mutex> &scheduler_lock, const bool is_update_thread) {
+    for (size_t job = level.next_job++; job < level.job_count(); job = level.next_job++) {
+        {
+            std::unique_lock<std::mutex> level_lock(level.mutex);
+            level.condvar.wait(level_lock, [&]() { return !level.callback_running; });
+            level.processing++;
+        }
+
+        for (uint32_t i = level.job_starts[job]; i < level.job_starts[job + 1]; i++)
+            process_voice(kern, mem, thread_id, level.voices[level.job_voices[i]], scheduler_lock);
+
+        std::unique_lock<std::mutex> level_lock(level.mutex);
+        level.processing--;
+        level.done_jobs++;
+        if (is_update_thread)
+            run_callback_requests(level, level_lock, scheduler_lock);
+        else
+            level.condvar.notify_all();
+    }
+}
+
+} // namespace
+
+bool VoiceScheduler::run_on_update_thread(const std::function<void()> &callback) {
+    if (running_callback)
+        return false;
+
+    if (UpdateLevel *level = update_level) {
+        // a voice processed by the update thread, the callback can be run here once the workers are stopped
+        std::unique_lock<std::mutex> level_lock(level->mutex);
+        level->processing--;
+        begin_callback(*level, level_lock);
+        level_lock.unlock();
+        run_callback(callback);
+        level_lock.lock();
+        level->processing++;
+        end_callback(*level);
+        return true;
+    }
+
+    UpdateLevel *level = worker_level;
+    if (!level)
+        return false;
+
+    // this worker stops processing until the callback has been run
+    CallbackRequest request{ &callback, false };
+    std::unique_lock<std::mutex> level_lock(level->mutex);
+    level->processing--;
+    level->callback_requests.push_back(&request);
+    level->condvar.notify_all();
+    level->condvar.wait(level_lock, [&]() { return request.done && !level->callback_running; });
+    level->processing++;
+
+    return true;
+}
+
 bool VoiceScheduler::deque_voice(Voice *voice) {
     const std::lock_guard<std::recursive_mutex> guard(mutex);
 
@@ -122,36 +286,109 @@ void VoiceScheduler::update(KernelState &kern, const MemState &mem, const SceUID
     is_updating = true;
 
     // make a copy of the queue, this way we have no issue if it is modified in a callback
-    std::vector<ngs::Voice *> queue_copy = queue;
+    std::vector<UpdateVoice> voices(queue.size());
+    for (size_t i = 0; i < queue.size(); i++) {
+        voices[i] = { queue[i], 0, false, 0 };
+        queue[i]->update_index = static_cast<uint32_t>(i);
+    }
+
+    const auto is_scheduled = [&](const Voice *voice) {
+        return voice->update_index < voices.size() && voices[voice->update_index].voice == voice;
+    };
+
+    // The queue respects the dependencies, so the level of each voice can be computed in order.
+    // Voices patched to a voice before them in the queue get their data on the next update, as before.
+    uint32_t level_count = 0;
+    for (size_t i = 0; i < voices.size(); i++) {
+        Voice *voice = voices[i].voice;
 
-    // Do a first routine to clear inputs from previous update session
-    for (ngs::Voice *voice : queue_copy) {
+        // Do a first routine to clear inputs from previous update session
         voice->inputs.reset_inputs();
+
+        level_count = std::max(level_count, voices[i].level + 1);
+        for (const auto &patches : voice->patches) {
+            for (const auto &patch_ptr : patches) {
+                const Patch *patch = patch_ptr.get(mem);
+                if (!patch || patch->output_sub_index == -1 || !is_scheduled(patch->dest) || patch->dest->update_index <= i)
+                    continue;
+
+                uint32_t &dest_level = voices[patch->dest->update_index].level;
+                dest_level = std::max(dest_level, voices[i].level + 1);
+            }
+        }
     }
 
-    for (ngs::Voice *voice : queue_copy) {
-        // Modify the state, in peace....
-        std::unique_lock<std::mutex> voice_lock(*voice->voice_mutex);
-        memset(voice->products, 0, sizeof(voice->products));
+    ThreadPool &pool = get_shared_thread_pool();
+    std::vector<Voice *> level_sources;
+    for (uint32_t level_index = 0; level_index < level_count; level_index++) {
+        auto level = std::make_shared<UpdateLevel>(voices);
+
+        // Voices of racks with modules sharing data between voices go in a single job, the others get their own
+        std::vector<std::pair<Rack *, std::vector<uint32_t>>> jobs;
+        level_sources.clear();
+        for (uint32_t i = 0; i < voices.size(); i++) {
+            if (voices[i].level != level_index)
+                continue;
 
-        bool finished = false;
-        uint32_t finished_module = 0;
+            level_sources.push_back(voices[i].voice);
+            Rack *rack = voices[i].voice->rack;
+            const bool shares_state = std::any_of(rack->modules.begin(), rack->modules.end(), [](const std::unique_ptr<Module> &module) {
+                return module && module->shares_state_between_voices();
+            });
+            auto job = shares_state ? std::find_if(jobs.begin(), jobs.end(), [&](const auto &job) { return job.first == rack; }) : jobs.end();
+            if (job == jobs.end())
+                jobs.emplace_back(shares_state ? rack : nullptr, std::vector<uint32_t>{ i });
+            else
+                job->second.push_back(i);
+        }
 
-        for (size_t i = 0; i < voice->rack->modules.size(); i++) {
-            if (voice->rack->modules[i]) {
-                if (voice->rack->modules[i]->process(kern, mem, thread_id, voice->datas[i], scheduler_lock, voice_lock)) {
-                    finished = true;
-                    finished_module = voice->rack->modules[i]->module_id();
-                }
+        if (jobs.empty())
+            continue;
+
+        for (const auto &[rack, job_voices] : jobs) {
+            level->job_starts.push_back(static_cast<uint32_t>(level->job_voices.size()));
+            level->job_voices.insert(level->job_voices.end(), job_voices.begin(), job_voices.end());
+        }
+        level->job_starts.push_back(static_cast<uint32_t>(level->job_voices.size()));
+
+        const size_t helper_count = std::min<size_t>(pool.size(), level->job_count() - 1);
+        for (size_t i = 0; i < helper_count; i++) {
+            pool.push([level, &kern, &mem, thread_id]() {
+                // the update thread holds the scheduler mutex, the modules only release this one around their callbacks
+                std::recursive_mutex worker_mutex;
+                std::unique_lock<std::recursive_mutex> worker_lock(worker_mutex);
+
+                worker_level = level.get();
+                run_jobs(kern, mem, thread_id, *level, worker_lock, false);
+                worker_level = nullptr;
+            });
+        }
+
+        update_level = level.get();
+        run_jobs(kern, mem, thread_id, *level, scheduler_lock, true);
+        update_level = nullptr;
+        {
+            std::unique_lock<std::mutex> level_lock(level->mutex);
+            while (level->done_jobs < level->job_count() || !level->callback_requests.empty()) {
+                run_callback_requests(*level, level_lock, scheduler_lock);
+                if (level->done_jobs < level->job_count())
+                    level->condvar.wait(level_lock, [&]() { return level->done_jobs == level->job_count() || !level->callback_requests.empty(); });
             }
         }
-        if (finished) {
+
+        // Finish the voices in the queue order, their callbacks are run on this thread
+        for (const UpdateVoice &update : voices) {
+            if (update.level != level_index || !update.finished)
+                continue;
+
+            Voice *voice = update.voice;
+            std::unique_lock<std::mutex> voice_lock(*voice->voice_mutex);
             voice->is_keyed_off = true;
             voice->transition(mem, VOICE_STATE_FINALIZING);
             if (voice->finished_callback) {
                 voice_lock.unlock();
                 scheduler_lock.unlock();
-                voice->invoke_callback(kern, mem, thread_id, voice->finished_callback, voice->finished_callback_user_data, finished_module);
+                voice->invoke_callback(kern, mem, thread_id, voice->finished_callback, voice->finished_callback_user_data, update.finished_module);
                 scheduler_lock.lock();
                 voice_lock.lock();
             }
@@ -160,12 +397,7 @@ void VoiceScheduler::update(KernelState &kern, const MemState &mem, const SceUID
             stop(mem, voice);
         }
 
-        for (size_t i = 0; i < voice->rack->vdef->output_count; i++) {
-            if (voice->products[i].data)
-                deliver_data(mem, queue_copy, voice, static_cast<uint8_t>(i), voice->products[i]);
-        }
-
-        voice->frame_count++;
+        deliver_data(mem, level_sources, is_scheduled);
     }
 
     while (!operations_pending.empty()) {
@@ -0,0 +1,563 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <ngs/dsp.h>
+#include <ngs/modules/compressor.h>
+#include <ngs/modules/delay.h>
+#include <ngs/modules/distortion.h>
+#include <ngs/modules/envelope.h>
+#include <ngs/modules/equalizer.h>
+#include <ngs/modules/filter.h>
+#include <ngs/modules/pitchshift.h>
+#include <ngs/modules/reverb.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float SAMPLE_RATE = 48000.0f;
+constexpr uint32_t GRANULARITY = 512;
+
+std::vector<float> make_noise(uint32_t frames, uint32_t seed = 42) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<float> samples(frames * 2);
+    for (float &sample : samples)
+        sample = distribution(random);
+
+    return samples;
+}
+
+std::vector<float> make_sine(uint32_t frames, float frequency, float amplitude = 1.0f) {
+    std::vector<float> samples(frames * 2);
+    for (uint32_t i = 0; i < frames; i++) {
+        const float value = amplitude * std::sin(2.0f * std::numbers::pi_v<float> * frequency * i / SAMPLE_RATE);
+        samples[i * 2] = value;
+        samples[i * 2 + 1] = value;
+    }
+
+    return samples;
+}
+
+// Run the block function on the samples one granularity at a time, like the voices do
+void process_in_blocks(std::vector<float> &samples, uint32_t block_frames, const std::function<void(float *, uint32_t)> &process) {
+    const uint32_t frames = static_cast<uint32_t>(samples.size() / 2);
+    for (uint32_t offset = 0; offset < frames; offset += block_frames)
+        process(samples.data() + offset * 2, std::min(block_frames, frames - offset));
+}
+
+float get_peak(const std::vector<float> &samples, uint32_t first_frame, uint32_t end_frame) {
+    float peak = 0.0f;
+    for (uint32_t i = first_frame * 2; i < end_frame * 2; i++)
+        peak = std::max(peak, std::abs(samples[i]));
+
+    return peak;
+}
+
+double get_energy(const std::vector<float> &samples, uint32_t first_frame, uint32_t end_frame) {
+    double energy = 0.0;
+    for (uint32_t i = first_frame * 2; i < end_frame * 2; i++)
+        energy += samples[i] * samples[i];
+
+    return energy;
+}
+
+// Gain of the filter on a sine once the filter settled
+float get_filter_gain(const SceNgsParamFilter &filter, float frequency) {
+    const ngs::dsp::BiquadCoefficients coefficients = ngs::get_filter_coefficients(filter, SAMPLE_RATE);
+    ngs::dsp::BiquadState state{};
+    std::vector<float> samples = make_sine(static_cast<uint32_t>(SAMPLE_RATE), frequency);
+    ngs::dsp::process_biquads(&coefficients, &state, 1, samples.data(), samples.data(), static_cast<uint32_t>(SAMPLE_RATE));
+
+    return get_peak(samples, static_cast<uint32_t>(SAMPLE_RATE) / 2, static_cast<uint32_t>(SAMPLE_RATE));
+}
+
+SceNgsCompressorParams make_compressor_params() {
+    SceNgsCompressorParams params{};
+    params.desc.id = SCE_NGS_COMPRESSOR_PARAMS_STRUCT_ID_V2;
+    params.fRatio = 4.0f;
+    params.fThreshold = -20.0f;
+    params.fAttack = 1.0f;
+    params.fRelease = 50.0f;
+    params.fMakeupGain = 0.0f;
+    params.nStereoLink = SCE_NGS_COMPRESSOR_STEREO_LINK_ON;
+    params.nPeakMode = SCE_NGS_COMPRESSOR_PEAK_MODE;
+    params.fSoftKnee = 0.0f;
+    return params;
+}
+
+SceNgsReverbParams make_reverb_params() {
+    SceNgsReverbParams params{};
+    params.desc.id = SCE_NGS_REVERB_PARAMS_STRUCT_ID;
+    params.fRoom = 0.0f;
+    params.fRoomHF = -100.0f;
+    params.fDecayTime = 1.0f;
+    params.fDecayHFRatio = 0.8f;
+    params.fReflections = -1000.0f;
+    params.fReflectionsDelay = 0.01f;
+    params.fReverb = 0.0f;
+    params.fReverbDelay = 0.02f;
+    params.fDiffusion = 100.0f;
+    params.fDensity = 100.0f;
+    params.fHFReference = 5000.0f;
+    params.eEarlyReflectionPattern[0] = SCE_NGS_REVERB_ROOM1_LEFT;
+    params.eEarlyReflectionPattern[1] = SCE_NGS_REVERB_ROOM1_RIGHT;
+    params.fEarlyReflectionScalar = 1.0f;
+    params.fLFReference = 250.0f;
+    params.fRoomLF = 0.0f;
+    params.fDryMB = 0.0f;
+    return params;
+}
+
+} // namespace
+
+TEST(ngs_dsp, biquads_match_reference) {
+    constexpr uint32_t FRAMES = 4096;
+    const std::vector<float> input = make_noise(FRAMES);
+
+    for (uint32_t mode = SCE_NGS_FILTER_LOWPASS_RESONANT; mode <= SCE_NGS_FILTER_LOWPASS_RESONANT_NORMALIZED; mode++) {
+        const SceNgsParamFilter filter = { static_cast<SceNgsParamFilterMode>(mode), 1200.0f, 2.0f, 6.0f };
+        const ngs::dsp::BiquadCoefficients coefficients = ngs::get_filter_coefficients(filter, SAMPLE_RATE);
+
+        // direct form I in double precision, one channel after the other
+        std::vector<double> expected(FRAMES * 2);
+        for (uint32_t channel = 0; channel < 2; channel++) {
+            double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+            for (uint32_t i = 0; i < FRAMES; i++) {
+                const double x = input[i * 2 + channel];
+                const double y = coefficients.b0 * x + coefficients.b1 * x1 + coefficients.b2 * x2 - coefficients.a1 * y1 - coefficients.a2 * y2;
+                expected[i * 2 + channel] = y;
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+            }
+        }
+
+        std::vector<float> output = input;
+        ngs::dsp::BiquadState state{};
+        process_in_blocks(output, 333, [&](float *samples, uint32_t frames) {
+            ngs::dsp::process_biquads(&coefficients, &state, 1, samples, samples, frames);
+        });
+
+        for (uint32_t i = 0; i < FRAMES * 2; i++)
+            ASSERT_NEAR(output[i], expected[i], 1e-4) << "mode " << mode << " sample " << i;
+    }
+}
+
+TEST(ngs_dsp, filter_responses) {
+    // lowpass and highpass around their cutoff
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_LOWPASS_RESONANT, 1000.0f, 0.7071f, 0.0f }, 100.0f), 1.0f, 0.01f);
+    EXPECT_LT(get_filter_gain({ SCE_NGS_FILTER_LOWPASS_RESONANT, 1000.0f, 0.7071f, 0.0f }, 10000.0f), 0.02f);
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_HIGHPASS_RESONANT, 1000.0f, 0.7071f, 0.0f }, 10000.0f), 1.0f, 0.01f);
+    EXPECT_LT(get_filter_gain({ SCE_NGS_FILTER_HIGHPASS_RESONANT, 1000.0f, 0.7071f, 0.0f }, 100.0f), 0.02f);
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_LOWPASS_ONEPOLE, 1000.0f, 0.0f, 0.0f }, 1000.0f), std::sqrt(0.5f), 0.05f);
+
+    // the resonance is the gain at the cutoff, unless it is normalized
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_LOWPASS_RESONANT, 1000.0f, 4.0f, 0.0f }, 1000.0f), 4.0f, 0.05f);
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_LOWPASS_RESONANT_NORMALIZED, 1000.0f, 4.0f, 0.0f }, 1000.0f), 1.0f, 0.02f);
+
+    // +12 dB at the center of the peak, the shelves reach their gain away from the corner
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_PEAK, 2000.0f, 1.0f, 12.0f }, 2000.0f), ngs::dsp::decibels_to_gain(12.0f), 0.02f);
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_LOWSHELF, 500.0f, 0.7071f, -6.0f }, 50.0f), ngs::dsp::decibels_to_gain(-6.0f), 0.02f);
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_HIGHSHELF, 2000.0f, 0.7071f, -6.0f }, 15000.0f), ngs::dsp::decibels_to_gain(-6.0f), 0.02f);
+
+    EXPECT_LT(get_filter_gain({ SCE_NGS_FILTER_NOTCH, 1000.0f, 1.0f, 0.0f }, 1000.0f), 0.01f);
+    EXPECT_NEAR(get_filter_gain({ SCE_NGS_FILTER_ALLPASS, 1000.0f, 1.0f, 0.0f }, 3000.0f), 1.0f, 0.01f);
+}
+
+TEST(ngs_dsp, equalizer_matches_filters_in_series) {
+    constexpr uint32_t FRAMES = 2048;
+    const SceNgsParamFilter filters[SCE_NGS_MAX_EQ_FILTERS] = {
+        { SCE_NGS_FILTER_LOWSHELF, 200.0f, 0.7071f, 3.0f },
+        { SCE_NGS_FILTER_PEAK, 1000.0f, 2.0f, -4.0f },
+        { SCE_NGS_FILTER_MODE_OFF, 0.0f, 0.0f, 0.0f },
+        { SCE_NGS_FILTER_HIGHSHELF, 8000.0f, 0.7071f, 2.0f },
+    };
+
+    ngs::dsp::BiquadCoefficients coefficients[SCE_NGS_MAX_EQ_FILTERS];
+    for (uint32_t i = 0; i < SCE_NGS_MAX_EQ_FILTERS; i++)
+        coefficients[i] = ngs::get_filter_coefficients(filters[i], SAMPLE_RATE);
+
+    std::vector<float> cascaded = make_noise(FRAMES);
+    std::vector<float> separate = cascaded;
+
+    ngs::EqualizerState state{};
+    ngs::dsp::process_biquads(coefficients, state.filters, SCE_NGS_MAX_EQ_FILTERS, cascaded.data(), cascaded.data(), FRAMES);
+
+    for (uint32_t i = 0; i < SCE_NGS_MAX_EQ_FILTERS; i++) {
+        ngs::dsp::BiquadState filter_state{};
+        ngs::dsp::process_biquads(&coefficients[i], &filter_state, 1, separate.data(), separate.data(), FRAMES);
+    }
+
+    for (uint32_t i = 0; i < FRAMES * 2; i++)
+        ASSERT_FLOAT_EQ(cascaded[i], separate[i]);
+}
+
+TEST(ngs_dsp, gain_ramp) {
+    // odd number of frames to go through the scalar tail
+    constexpr uint32_t FRAMES = 37;
+    const std::vector<float> input = make_noise(FRAMES);
+    std::vector<float> output(FRAMES * 2);
+
+    const float start[2] = { 1.0f, 0.5f };
+    const float end[2] = { 0.0f, 2.0f };
+    ngs::dsp::apply_gain_ramp(input.data(), output.data(), FRAMES, start, end);
+
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        for (uint32_t channel = 0; channel < 2; channel++) {
+            const float gain = start[channel] + (end[channel] - start[channel]) * i / FRAMES;
+            ASSERT_NEAR(output[i * 2 + channel], input[i * 2 + channel] * gain, 1e-5f);
+        }
+    }
+}
+
+TEST(ngs_dsp, compressor_steady_state) {
+    const SceNgsCompressorParams params = make_compressor_params();
+
+    // 0 dB is 20 dB over the threshold, it comes out 15 dB over it with a ratio of 4
+    std::vector<float> samples(static_cast<uint32_t>(SAMPLE_RATE) * 2, 1.0f);
+    ngs::CompressorState state{};
+    process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t frames) {
+        ngs::process_compressor(params, state, block, frames, SAMPLE_RATE);
+    });
+
+    const uint32_t end = static_cast<uint32_t>(SAMPLE_RATE);
+    EXPECT_NEAR(get_peak(samples, end - 1000, end), ngs::dsp::decibels_to_gain(-15.0f), 0.002f);
+    EXPECT_NEAR(state.levels.fInputLevel[0], 1.0f, 1e-6f);
+    EXPECT_NEAR(state.levels.fOutputLevel[1], ngs::dsp::decibels_to_gain(-15.0f), 0.002f);
+
+    // below the threshold nothing changes
+    std::vector<float> quiet(static_cast<uint32_t>(SAMPLE_RATE) * 2, 0.05f);
+    ngs::CompressorState quiet_state{};
+    ngs::process_compressor(params, quiet_state, quiet.data(), static_cast<uint32_t>(SAMPLE_RATE), SAMPLE_RATE);
+    EXPECT_FLOAT_EQ(get_peak(quiet, 0, end), 0.05f);
+}
+
+TEST(ngs_dsp, compressor_soft_knee) {
+    SceNgsCompressorParams params = make_compressor_params();
+    params.fSoftKnee = 10.0f;
+
+    // the knee joins the two slopes without a jump
+    EXPECT_NEAR(ngs::get_compressor_gain(params, -25.0f), 0.0f, 1e-5f);
+    EXPECT_NEAR(ngs::get_compressor_gain(params, -15.0f), -3.75f, 1e-5f);
+    EXPECT_NEAR(ngs::get_compressor_gain(params, -20.0f), -0.9375f, 1e-5f);
+    EXPECT_NEAR(ngs::get_compressor_gain(params, 0.0f), -15.0f, 1e-5f);
+}
+
+TEST(ngs_dsp, delay_impulse_response) {
+    SceNgsDelayParams params{};
+    params.desc.id = SCE_NGS_DELAY_PARAMS_STRUCT_ID;
+    params.fDryVol = 1.0f;
+    params.taps[0].fDelayMillisecs = 10.0f;
+    params.taps[0].fVolume = 0.5f;
+    params.taps[0].fFeedback = 0.5f;
+
+    constexpr uint32_t FRAMES = 2048;
+    std::vector<float> samples(FRAMES * 2, 0.0f);
+    samples[0] = 1.0f;
+    samples[1] = -1.0f;
+
+    const uint32_t line_frames = ngs::get_delay_line_frames(SAMPLE_RATE);
+    std::vector<float> line(line_frames * 2);
+    ngs::DelayState state{};
+    process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t frames) {
+        ngs::process_delay(params, state, line.data(), line_frames, block, frames, SAMPLE_RATE);
+    });
+
+    // echoes every 480 frames, halved each time
+    std::vector<float> expected(FRAMES * 2, 0.0f);
+    float gain = 1.0f;
+    for (uint32_t frame = 0; frame < FRAMES; frame += 480) {
+        expected[frame * 2] = gain;
+        expected[frame * 2 + 1] = -gain;
+        gain *= 0.5f;
+    }
+
+    for (uint32_t i = 0; i < FRAMES * 2; i++)
+        ASSERT_NEAR(samples[i], expected[i], 1e-6f) << "sample " << i;
+}
+
+TEST(ngs_dsp, delay_lowpass_tap) {
+    SceNgsDelayParams params{};
+    params.desc.id = SCE_NGS_DELAY_PARAMS_STRUCT_ID;
+    params.fDryVol = 0.0f;
+    params.taps[0].fDelayMillisecs = 5.0f;
+    params.taps[0].fVolume = 1.0f;
+    params.taps[0].eFilterMode = SCE_NGS_DELAY_FILTER_MODE_LOWPASS_ONEPOLE;
+    params.taps[0].fCutoff = 500.0f;
+
+    const uint32_t line_frames = ngs::get_delay_line_frames(SAMPLE_RATE);
+    const auto run = [&](float frequency) {
+        std::vector<float> line(line_frames * 2);
+        std::vector<float> samples = make_sine(static_cast<uint32_t>(SAMPLE_RATE) / 4, frequency);
+        ngs::DelayState state{};
+        process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t frames) {
+            ngs::process_delay(params, state, line.data(), line_frames, block, frames, SAMPLE_RATE);
+        });
+        return get_peak(samples, static_cast<uint32_t>(SAMPLE_RATE) / 8, static_cast<uint32_t>(SAMPLE_RATE) / 4);
+    };
+
+    EXPECT_GT(run(50.0f), 0.95f);
+    EXPECT_LT(run(8000.0f), 0.1f);
+}
+
+TEST(ngs_dsp, distortion_curve) {
+    SceNgsDistortionParams params{};
+    params.desc.id = SCE_NGS_DISTORTION_PARAMS_STRUCT_ID;
+    params.fA = 1.5f;
+    params.fB = 0.5f;
+    params.fClip = 0.8f;
+    params.fGate = 0.1f;
+    params.fWetGain = 1.0f;
+    params.fDryGain = 0.25f;
+
+    // an odd number of frames, the last one goes through the single frame path
+    std::vector<float> samples = { 0.05f, -0.05f, 0.5f, -0.5f, 1.0f, -1.0f, 0.2f, 0.0f, 0.7f, -0.3f };
+    const std::vector<float> input = samples;
+    ngs::process_distortion(params, samples.data(), static_cast<uint32_t>(samples.size() / 2));
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        const float x = input[i];
+        float wet = std::clamp(1.5f * x - 0.5f * x * x * x, -0.8f, 0.8f);
+        if (std::abs(x) < 0.1f)
+            wet = 0.0f;
+        ASSERT_NEAR(samples[i], 0.25f * x + wet, 1e-6f) << "sample " << i;
+    }
+}
+
+TEST(ngs_dsp, envelope_points_and_release) {
+    SceNgsEnvelopeParams params{};
+    params.desc.id = SCE_NGS_ENVELOPE_PARAMS_STRUCT_ID;
+    params.envelopePoints[0] = { 100, 0.0f, SCE_NGS_ENVELOPE_LINEAR };
+    params.envelopePoints[1] = { 100, 1.0f, SCE_NGS_ENVELOPE_LINEAR };
+    params.envelopePoints[2] = { 0, 0.5f, SCE_NGS_ENVELOPE_LINEAR };
+    params.uNumPoints = 3;
+    params.uReleaseMsecs = 100;
+    params.nLoopEnd = -1;
+
+    const uint32_t frames_per_ms = static_cast<uint32_t>(SAMPLE_RATE) / 1000;
+    std::vector<float> samples(420 * frames_per_ms * 2, 1.0f);
+    SceNgsEnvelopeStates state{};
+    uint32_t processed = 0;
+    process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t frames) {
+        // key off after 300 ms
+        const bool releasing = processed >= 300 * frames_per_ms;
+        ngs::process_envelope(params, state, releasing, block, frames, SAMPLE_RATE);
+        processed += frames;
+    });
+
+    const auto height_at = [&](uint32_t ms) { return samples[ms * frames_per_ms * 2]; };
+    EXPECT_NEAR(height_at(0), 0.0f, 1e-4f);
+    EXPECT_NEAR(height_at(50), 0.5f, 1e-3f);
+    EXPECT_NEAR(height_at(100), 1.0f, 1e-3f);
+    EXPECT_NEAR(height_at(150), 0.75f, 1e-3f);
+    EXPECT_NEAR(height_at(250), 0.5f, 1e-3f);
+    // the release starts with the first block after 300 ms, at 309.3 ms
+    EXPECT_NEAR(height_at(359), 0.25f, 0.01f);
+    EXPECT_NEAR(height_at(415), 0.0f, 1e-4f);
+    EXPECT_EQ(state.nReleasing, 1);
+}
+
+TEST(ngs_dsp, envelope_loop) {
+    SceNgsEnvelopeParams params{};
+    params.desc.id = SCE_NGS_ENVELOPE_PARAMS_STRUCT_ID;
+    params.envelopePoints[0] = { 10, 1.0f, SCE_NGS_ENVELOPE_LINEAR };
+    params.envelopePoints[1] = { 10, 0.0f, SCE_NGS_ENVELOPE_LINEAR };
+    params.envelopePoints[2] = { 0, 1.0f, SCE_NGS_ENVELOPE_LINEAR };
+    params.uNumPoints = 3;
+    params.uLoopStart = 0;
+    params.nLoopEnd = 2;
+
+    // a triangle with a period of 20 ms
+    const uint32_t frames_per_ms = static_cast<uint32_t>(SAMPLE_RATE) / 1000;
+    std::vector<float> samples(100 * frames_per_ms * 2, 1.0f);
+    SceNgsEnvelopeStates state{};
+    process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t frames) {
+        ngs::process_envelope(params, state, false, block, frames, SAMPLE_RATE);
+    });
+
+    for (uint32_t ms = 0; ms < 100; ms += 20) {
+        EXPECT_NEAR(samples[ms * frames_per_ms * 2], 1.0f, 1e-3f) << ms;
+        EXPECT_NEAR(samples[(ms + 5) * frames_per_ms * 2], 0.5f, 1e-3f) << ms;
+        EXPECT_NEAR(samples[(ms + 10) * frames_per_ms * 2], 0.0f, 1e-3f) << ms;
+    }
+}
+
+TEST(ngs_dsp, pitch_shift_octave) {
+    SceNgsPitchShiftParams params{};
+    params.desc.id = SCE_NGS_PITCHSHIFT_PARAMS_STRUCT_ID;
+    params.fPitchOffsetInCents = 1200.0f;
+
+    const uint32_t frames = static_cast<uint32_t>(SAMPLE_RATE);
+    std::vector<float> samples = make_sine(frames, 300.0f);
+    const uint32_t line_frames = ngs::get_pitch_shift_line_frames(SAMPLE_RATE);
+    std::vector<float> line(line_frames * 2);
+    ngs::PitchShiftState state{};
+    process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t block_frames) {
+        ngs::process_pitch_shift(params, state, line.data(), line_frames, block, block_frames, SAMPLE_RATE);
+    });
+
+    // the strongest frequency of the output moved up an octave
+    const auto get_magnitude = [&](float frequency) {
+        double real = 0.0, imaginary = 0.0;
+        for (uint32_t i = frames / 2; i < frames; i++) {
+            const double angle = 2.0 * std::numbers::pi * frequency * i / SAMPLE_RATE;
+            real += samples[i * 2] * std::cos(angle);
+            imaginary += samples[i * 2] * std::sin(angle);
+        }
+        return std::sqrt(real * real + imaginary * imaginary);
+    };
+    EXPECT_GT(get_magnitude(600.0f), 5.0 * get_magnitude(300.0f));
+    EXPECT_EQ(samples[1], samples[0]);
+}
+
+TEST(ngs_dsp, reverb_decay) {
+    const SceNgsReverbParams params = make_reverb_params();
+    const uint32_t frames = static_cast<uint32_t>(SAMPLE_RATE);
+    std::vector<float> samples(frames * 2, 0.0f);
+    samples[0] = 1.0f;
+    samples[1] = 1.0f;
+
+    std::vector<float> memory(ngs::get_reverb_memory_size(SAMPLE_RATE));
+    ngs::ReverbState state{};
+    process_in_blocks(samples, GRANULARITY, [&](float *block, uint32_t block_frames) {
+        ngs::process_reverb(params, state, memory.data(), block, block_frames, SAMPLE_RATE);
+    });
+
+    // the dry impulse is kept, then the tail loses 60 dB per decay time: 30 dB over half a second
+    EXPECT_NEAR(samples[0], 1.0f, 0.01f);
+    const double early_tail = get_energy(samples, frames / 5, frames * 3 / 10);
+    const double late_tail = get_energy(samples, frames * 7 / 10, frames * 4 / 5);
+    ASSERT_GT(early_tail, 0.0);
+    const double drop = 10.0 * std::log10(early_tail / late_tail);
+    EXPECT_GT(drop, 20.0);
+    EXPECT_LT(drop, 40.0);
+
+    // both channels get a tail, different from each other
+    double difference = 0.0;
+    for (uint32_t i = frames / 10; i < frames / 5; i++)
+        difference += std::abs(samples[i * 2] - samples[i * 2 + 1]);
+    EXPECT_GT(difference, 0.0);
+}
+
+TEST(ngs_dsp, reverb_dry_only) {
+    SceNgsReverbParams params = make_reverb_params();
+    params.fRoom = -10000.0f;
+    params.fDryMB = -600.0f;
+
+    const uint32_t frames = 4096;
+    std::vector<float> samples = make_noise(frames);
+    const std::vector<float> input = samples;
+    std::vector<float> memory(ngs::get_reverb_memory_size(SAMPLE_RATE));
+    ngs::ReverbState state{};
+    ngs::process_reverb(params, state, memory.data(), samples.data(), frames, SAMPLE_RATE);
+
+    const float dry = ngs::dsp::millibels_to_gain(-600.0f);
+    for (uint32_t i = 0; i < frames * 2; i++)
+        ASSERT_NEAR(samples[i], input[i] * dry, 1e-4f);
+}
+
+// How many times faster than real time each module processes a stereo stream at 48 kHz
+TEST(ngs_dsp_benchmark, module_throughput) {
+    constexpr uint32_t SECONDS = 10;
+    const uint32_t frames = static_cast<uint32_t>(SAMPLE_RATE) * SECONDS;
+    const std::vector<float> input = make_noise(frames);
+    std::vector<float> samples;
+
+    const auto measure = [&](const char *name, const std::function<void(float *, uint32_t)> &process) {
+        samples = input;
+        const auto start = std::chrono::steady_clock::now();
+        process_in_blocks(samples, GRANULARITY, process);
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << name << ": " << SECONDS << " s of audio in " << ms << " ms (" << SECONDS * 1000.0 / ms << "x real time)" << std::endl;
+        for (float sample : samples)
+            ASSERT_TRUE(std::isfinite(sample)) << name;
+    };
+
+    const ngs::dsp::BiquadCoefficients filter = ngs::get_filter_coefficients({ SCE_NGS_FILTER_LOWPASS_RESONANT, 2000.0f, 1.0f, 0.0f }, SAMPLE_RATE);
+    ngs::dsp::BiquadState filter_state{};
+    measure("filter", [&](float *block, uint32_t block_frames) {
+        ngs::dsp::process_biquads(&filter, &filter_state, 1, block, block, block_frames);
+    });
+
+    ngs::dsp::BiquadCoefficients equalizer[SCE_NGS_MAX_EQ_FILTERS];
+    for (uint32_t i = 0; i < SCE_NGS_MAX_EQ_FILTERS; i++)
+        equalizer[i] = ngs::get_filter_coefficients({ SCE_NGS_FILTER_PEAK, 250.0f * (i + 1), 1.0f, 3.0f }, SAMPLE_RATE);
+    ngs::EqualizerState equalizer_state{};
+    measure("equalizer", [&](float *block, uint32_t block_frames) {
+        ngs::dsp::process_biquads(equalizer, equalizer_state.filters, SCE_NGS_MAX_EQ_FILTERS, block, block, block_frames);
+    });
+
+    const SceNgsCompressorParams compressor = make_compressor_params();
+    ngs::CompressorState compressor_state{};
+    measure("compressor", [&](float *block, uint32_t block_frames) {
+        ngs::process_compressor(compressor, compressor_state, block, block_frames, SAMPLE_RATE);
+    });
+
+    SceNgsDelayParams delay{};
+    delay.fDryVol = 1.0f;
+    delay.fModRate = 0.5f;
+    for (uint32_t i = 0; i < SCE_NGS_DELAY_MAX_TAPS; i++)
+        delay.taps[i] = { 50.0f * (i + 1), 0.3f, 0.2f, SCE_NGS_DELAY_FILTER_MODE_LOWPASS_ONEPOLE, 3000.0f, 90.0f * i, 2.0f };
+    const uint32_t delay_frames = ngs::get_delay_line_frames(SAMPLE_RATE);
+    std::vector<float> delay_line(delay_frames * 2);
+    ngs::DelayState delay_state{};
+    measure("delay (4 taps)", [&](float *block, uint32_t block_frames) {
+        ngs::process_delay(delay, delay_state, delay_line.data(), delay_frames, block, block_frames, SAMPLE_RATE);
+    });
+
+    const SceNgsDistortionParams distortion = { {}, 1.5f, 0.5f, 0.8f, 0.01f, 0.7f, 0.3f };
+    measure("distortion", [&](float *block, uint32_t block_frames) {
+        ngs::process_distortion(distortion, block, block_frames);
+    });
+
+    SceNgsEnvelopeParams envelope{};
+    envelope.envelopePoints[0] = { 50, 0.0f, SCE_NGS_ENVELOPE_LINEAR };
+    envelope.envelopePoints[1] = { 500, 1.0f, SCE_NGS_ENVELOPE_CURVED };
+    envelope.envelopePoints[2] = { 0, 0.5f, SCE_NGS_ENVELOPE_LINEAR };
+    envelope.uNumPoints = 3;
+    envelope.nLoopEnd = -1;
+    SceNgsEnvelopeStates envelope_state{};
+    measure("envelope", [&](float *block, uint32_t block_frames) {
+        ngs::process_envelope(envelope, envelope_state, false, block, block_frames, SAMPLE_RATE);
+    });
+
+    const SceNgsPitchShiftParams pitch_shift = { {}, 700.0f };
+    const uint32_t pitch_shift_frames = ngs::get_pitch_shift_line_frames(SAMPLE_RATE);
+    std::vector<float> pitch_shift_line(pitch_shift_frames * 2);
+    ngs::PitchShiftState pitch_shift_state{};
+    measure("pitch shift", [&](float *block, uint32_t block_frames) {
+        ngs::process_pitch_shift(pitch_shift, pitch_shift_state, pitch_shift_line.data(), pitch_shift_frames, block, block_frames, SAMPLE_RATE);
+    });
+
+    const SceNgsReverbParams reverb = make_reverb_params();
+    std::vector<float> reverb_memory(ngs::get_reverb_memory_size(SAMPLE_RATE));
+    ngs::ReverbState reverb_state{};
+    measure("reverb", [&](float *block, uint32_t block_frames) {
+        ngs::process_reverb(reverb, reverb_state, reverb_memory.data(), block, block_frames, SAMPLE_RATE);
+    });
+}
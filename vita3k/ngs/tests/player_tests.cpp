@@ -0,0 +1,214 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/state.h>
+#include <mem/functions.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+#include <ngs/modules/player.h>
+#include <ngs/ring.h>
+#include <ngs/system.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <numbers>
+#include <vector>
+
+// Count the heap allocations made while counting_allocations is set
+static std::atomic<bool> counting_allocations = false;
+static std::atomic<size_t> allocation_count = 0;
+
+void *operator new(size_t size) {
+    if (counting_allocations.load(std::memory_order_relaxed))
+        allocation_count++;
+
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+constexpr int32_t GRANULARITY = 512;
+constexpr int32_t SAMPLE_RATE = 48000;
+// not a multiple of the granularity so the loops happen in the middle of the updates
+constexpr uint32_t PCM_FRAMES = 4800;
+
+int16_t get_pcm_sample(uint32_t frame, uint32_t channel) {
+    const float value = 10000.0f * std::sin(2.0f * std::numbers::pi_v<float> * 440.0f * frame / SAMPLE_RATE);
+    return static_cast<int16_t>(channel == 0 ? value : -value);
+}
+
+// A voice with a single player looping over a stereo PCM buffer
+struct PlayerVoice {
+    MemState mem;
+    KernelState kernel;
+    ngs::System system{ Ptr<void>(0), 0 };
+    ngs::Rack rack{ &system, Ptr<void>(0), 0 };
+    ngs::Voice voice;
+    std::recursive_mutex scheduler_mutex;
+
+    explicit PlayerVoice(float playback_frequency) {
+        EXPECT_TRUE(init(mem, false));
+
+        system.granularity = GRANULARITY;
+        system.sample_rate = SAMPLE_RATE;
+        rack.patches_per_output = 0;
+        rack.modules.push_back(std::make_unique<ngs::PlayerModule>());
+        voice.init(&rack);
+
+        const Address pcm = alloc(mem, PCM_FRAMES * 2 * sizeof(int16_t), "player pcm");
+        int16_t *samples = Ptr<int16_t>(pcm).get(mem);
+        for (uint32_t frame = 0; frame < PCM_FRAMES; frame++) {
+            samples[frame * 2] = get_pcm_sample(frame, 0);
+            samples[frame * 2 + 1] = get_pcm_sample(frame, 1);
+        }
+
+        const Address params_address = alloc(mem, sizeof(SceNgsPlayerParams), "player params");
+        SceNgsPlayerParams *params = new (Ptr<SceNgsPlayerParams>(params_address).get(mem)) SceNgsPlayerParams{};
+        new (&params->buffer_params[0]) SceNgsPlayerBufferParams{ Ptr<void>(pcm), static_cast<SceInt32>(PCM_FRAMES * 2 * sizeof(int16_t)), -1, -1 };
+        params->playback_frequency = playback_frequency;
+        params->playback_scalar = 1.0f;
+        params->channels = 2;
+        params->type = ParameterAudioTypePCM;
+
+        ngs::ModuleData &data = voice.datas[0];
+        data.parent = &voice;
+        data.index = 0;
+        data.info.data = Ptr<void>(params_address);
+        data.info.size = sizeof(SceNgsPlayerParams);
+        voice.state = ngs::VOICE_STATE_ACTIVE;
+    }
+
+    // Run the player once, like the scheduler does, and return its output
+    const float *update() {
+        memset(voice.products, 0, sizeof(voice.products));
+
+        std::unique_lock<std::recursive_mutex> scheduler_lock(scheduler_mutex);
+        std::unique_lock<std::mutex> voice_lock(*voice.voice_mutex);
+        EXPECT_FALSE(rack.modules[0]->process(kernel, mem, 0, voice.datas[0], scheduler_lock, voice_lock));
+
+        return reinterpret_cast<const float *>(voice.products[0].data);
+    }
+
+    // Number of heap allocations made by count updates
+    size_t count_update_allocations(uint32_t count) {
+        allocation_count = 0;
+        counting_allocations = true;
+        for (uint32_t i = 0; i < count; i++)
+            update();
+        counting_allocations = false;
+
+        return allocation_count;
+    }
+};
+
+} // namespace
+
+TEST(ngs_ring, push_pop_wrap_around) {
+    std::vector<float> storage(8 * 2);
+    ngs::FrameRing ring;
+    ring.init(storage.data(), 8);
+
+    std::vector<float> frames(6 * 2);
+    for (size_t i = 0; i < frames.size(); i++)
+        frames[i] = static_cast<float>(i);
+
+    std::vector<float> popped(8 * 2);
+    for (int round = 0; round < 4; round++) {
+        // the second push only has room for 2 frames
+        ASSERT_EQ(ring.push(frames.data(), 6), 6);
+        ASSERT_EQ(ring.push(frames.data(), 6), 2);
+        ASSERT_EQ(ring.size(), 8);
+        ASSERT_EQ(ring.space(), 0);
+
+        ASSERT_EQ(ring.pop(popped.data(), 3), 3);
+        ASSERT_EQ(ring.pop(popped.data() + 3 * 2, 8), 5);
+        ASSERT_EQ(ring.size(), 0);
+
+        for (size_t i = 0; i < 6 * 2; i++)
+            ASSERT_EQ(popped[i], frames[i]);
+        for (size_t i = 0; i < 2 * 2; i++)
+            ASSERT_EQ(popped[6 * 2 + i], frames[i]);
+
+        // shift the next round so the frames wrap around the end of the storage
+        ASSERT_EQ(ring.push(frames.data(), 3), 3);
+        ASSERT_EQ(ring.pop(popped.data(), 3), 3);
+    }
+
+    ring.push(frames.data(), 4);
+    ring.clear();
+    ASSERT_EQ(ring.size(), 0);
+    ASSERT_EQ(ring.pop(popped.data(), 4), 0);
+}
+
+TEST(ngs_player, output_follows_looping_buffer) {
+    PlayerVoice player(SAMPLE_RATE);
+
+    // more than two loops over the buffer
+    for (uint32_t block = 0; block < 24; block++) {
+        const float *output = player.update();
+        ASSERT_NE(output, nullptr);
+
+        for (uint32_t i = 0; i < GRANULARITY; i++) {
+            const uint32_t frame = (block * GRANULARITY + i) % PCM_FRAMES;
+            ASSERT_EQ(output[i * 2], get_pcm_sample(frame, 0) / 32768.0f) << block << " " << i;
+            ASSERT_EQ(output[i * 2 + 1], get_pcm_sample(frame, 1) / 32768.0f) << block << " " << i;
+        }
+    }
+}
+
+TEST(ngs_player, no_allocations_in_steady_state) {
+    PlayerVoice player(SAMPLE_RATE);
+
+    // the first updates set up the ring and the scratch buffers
+    for (int i = 0; i < 32; i++)
+        player.update();
+
+    ASSERT_EQ(player.count_update_allocations(1000), 0);
+}
+
+TEST(ngs_player, no_allocations_in_steady_state_when_resampling) {
+    PlayerVoice player(32000.0f);
+
+    for (int i = 0; i < 32; i++)
+        player.update();
+
+    ASSERT_EQ(player.count_update_allocations(1000), 0);
+
+    // the resampled sine is still there
+    const float *output = player.update();
+    float peak = 0.0f;
+    for (uint32_t i = 0; i < GRANULARITY * 2; i++)
+        peak = std::max(peak, std::abs(output[i]));
+    ASSERT_GT(peak, 0.2f);
+}
@@ -0,0 +1,134 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/state.h>
+#include <mem/functions.h>
+#include <mem/ptr.h>
+#include <mem/state.h>
+#include <ngs/system.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int RACK_COUNT = 16;
+constexpr int VOICES_PER_RACK = 4;
+constexpr int UPDATE_COUNT = 100;
+
+// Counters shared by the voices, checked once the updates are done
+struct CallbackStats {
+    std::atomic<int> processing = 0;
+    std::atomic<int> callbacks = 0;
+    std::atomic<int> overlaps = 0;
+    std::atomic<int> off_update_thread = 0;
+    std::thread::id update_thread;
+};
+
+// Module asking for a callback on some updates, like the player at the end of a buffer.
+// The callback changes its voice like a guest callback could.
+class CallbackModule : public ngs::Module {
+    CallbackStats &stats;
+
+public:
+    explicit CallbackModule(CallbackStats &stats)
+        : stats(stats) {}
+
+    bool process(KernelState &kern, const MemState &mem, const SceUID thread_id, ngs::ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) override {
+        stats.processing++;
+        // leave the other threads time to process their voices
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        stats.processing--;
+
+        if (data.parent->frame_count % 3 != 0)
+            return false;
+
+        ngs::Voice *voice = data.parent;
+        voice_lock.unlock();
+        scheduler_lock.unlock();
+        const auto callback = [&]() {
+            if (stats.processing != 0)
+                stats.overlaps++;
+            if (std::this_thread::get_id() != stats.update_thread)
+                stats.off_update_thread++;
+
+            const std::lock_guard<std::mutex> guard(*voice->voice_mutex);
+            voice->is_keyed_off = !voice->is_keyed_off;
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            voice->is_keyed_off = !voice->is_keyed_off;
+
+            if (stats.processing != 0)
+                stats.overlaps++;
+            stats.callbacks++;
+        };
+        if (!ngs::VoiceScheduler::run_on_update_thread(callback))
+            callback();
+        scheduler_lock.lock();
+        voice_lock.lock();
+
+        return false;
+    }
+
+    uint32_t get_buffer_parameter_size() const override { return 0; }
+};
+
+} // namespace
+
+TEST(ngs_scheduler, callbacks_run_alone_on_update_thread) {
+    MemState mem;
+    EXPECT_TRUE(init(mem, false));
+    KernelState kernel;
+
+    ngs::System system{ Ptr<void>(0), 0 };
+    system.granularity = 512;
+    system.sample_rate = 48000;
+    ngs::VoiceDefinition definition{ ngs::BussType{}, 0 };
+
+    CallbackStats stats;
+    stats.update_thread = std::this_thread::get_id();
+
+    std::vector<std::unique_ptr<ngs::Rack>> racks;
+    std::vector<std::unique_ptr<ngs::Voice>> voices;
+    for (int i = 0; i < RACK_COUNT; i++) {
+        ngs::Rack &rack = *racks.emplace_back(std::make_unique<ngs::Rack>(&system, Ptr<void>(0), 0));
+        rack.vdef = &definition;
+        rack.patches_per_output = 0;
+        rack.modules.push_back(std::make_unique<CallbackModule>(stats));
+
+        for (int j = 0; j < VOICES_PER_RACK; j++) {
+            ngs::Voice &voice = *voices.emplace_back(std::make_unique<ngs::Voice>());
+            voice.init(&rack);
+            voice.datas[0].parent = &voice;
+            voice.frame_count = j;
+            ASSERT_TRUE(system.voice_scheduler.play(mem, &voice));
+        }
+    }
+
+    for (int i = 0; i < UPDATE_COUNT; i++)
+        system.voice_scheduler.update(kernel, mem, 0);
+
+    // a third of the voices ask for a callback on each update
+    EXPECT_GT(stats.callbacks, 0);
+    EXPECT_EQ(stats.overlaps, 0);
+    EXPECT_EQ(stats.off_update_thread, 0);
+}
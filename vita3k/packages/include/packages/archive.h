@@ -0,0 +1,39 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/**
+ * @file archive.h
+ * @brief Zip archive (`.vpk`, `.zip`) extraction
+ */
+
+#pragma once
+
+#include <util/fs.h>
+
+#include <functional>
+#include <string>
+
+/**
+ * \brief Extract the entries of a zip archive whose name starts with prefix, without it, to output_path.
+ *
+ * The entries are spread over thread_count threads (0 is one per core, up to 8), the biggest ones first.
+ * Their CRC is checked while they are written.
+ * \param progress_callback Called on the calling thread with the extracted percentage of bytes
+ * \return false if the archive cannot be read or an entry is damaged or cannot be written
+ */
+bool extract_archive(const fs::path &archive_path, const std::string &prefix, const fs::path &output_path, const std::function<void(float)> &progress_callback = nullptr, uint32_t thread_count = 0);
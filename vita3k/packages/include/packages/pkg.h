@@ -81,6 +81,16 @@ struct PkgEntry {
     uint32_t padding;
 };
 
+/**
+ * \brief Decrypt the entries of a pkg, found at items_offset in its data, to output_path.
+ *
+ * The entries are split in chunks decrypted on thread_count threads (0 is one per core, up to 8), in the pkg order.
+ * \param main_key AES-CTR key of the pkg data
+ * \param progress_callback Called on the calling thread with the decrypted percentage of bytes
+ * \return false if the pkg is damaged or an entry cannot be written
+ */
+bool extract_pkg_entries(const fs::path &pkg_path, const PkgHeader &pkg_header, const uint8_t *main_key, uint32_t items_offset, const fs::path &output_path, const std::function<void(float)> &progress_callback = nullptr, uint32_t thread_count = 0);
+
 bool install_pkg(const fs::path &pkg_path, EmuEnvState &emuenv, std::string &p_zRIF, const std::function<void(float)> &progress_callback = nullptr);
 
 bool decrypt_install_nonpdrm(EmuEnvState &emuenv, const fs::path &drmlicpath, const fs::path &title_path);
@@ -0,0 +1,223 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/**
+ * @file archive.cpp
+ * @brief Zip archive (`.vpk`, `.zip`) extraction
+ *
+ * Each thread has its own reader, since miniz reads the archive through a single FILE
+ */
+
+#include <packages/archive.h>
+
+#include <util/log.h>
+
+#include <miniz.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// the entries are given by miniz in chunks of 64 KiB at most, they are written to the disk in bigger ones
+static constexpr size_t WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+// past this the disk is the limit
+static constexpr uint32_t MAX_EXTRACT_THREADS = 8;
+
+namespace {
+
+struct ArchiveReader {
+    mz_zip_archive zip{};
+    FILE *file = nullptr;
+
+    ~ArchiveReader() {
+        if (file) {
+            mz_zip_reader_end(&zip);
+            fclose(file);
+        }
+    }
+
+    bool open(const fs::path &path) {
+        file = FOPEN(path.generic_path().c_str(), "rb");
+        if (!file) {
+            LOG_CRITICAL("Failed to open archive: {}", path);
+            return false;
+        }
+
+        if (!mz_zip_reader_init_cfile(&zip, file, 0, 0)) {
+            LOG_CRITICAL("miniz error reading archive: {}", get_error());
+            fclose(file);
+            file = nullptr;
+            return false;
+        }
+
+        return true;
+    }
+
+    const char *get_error() {
+        return mz_zip_get_error_string(mz_zip_get_last_error(&zip));
+    }
+};
+
+struct ArchiveEntry {
+    mz_uint index;
+    uint64_t size;
+    fs::path output;
+};
+
+struct EntryWriter {
+    FILE *file;
+    std::atomic<uint64_t> &extracted;
+};
+
+} // namespace
+
+static size_t write_to_file(void *opaque, mz_uint64, const void *data, size_t size) {
+    EntryWriter *const writer = static_cast<EntryWriter *>(opaque);
+    const size_t written = fwrite(data, 1, size, writer->file);
+    writer->extracted.fetch_add(written, std::memory_order_relaxed);
+
+    return written;
+}
+
+static bool extract_entry(ArchiveReader &reader, const ArchiveEntry &entry, std::vector<char> &buffer, std::atomic<uint64_t> &extracted) {
+    FILE *file = FOPEN(entry.output.generic_path().c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Failed to create file: {}", entry.output);
+        return false;
+    }
+    setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    LOG_INFO("Extracting {}", entry.output);
+    EntryWriter writer{ file, extracted };
+    // fails on a wrong CRC, computed while the entry is written
+    const bool extracted_entry = mz_zip_reader_extract_to_callback(&reader.zip, entry.index, &write_to_file, &writer, 0);
+    const bool closed = fclose(file) == 0;
+    if (!extracted_entry) {
+        LOG_ERROR("miniz error: {} extracting file: {}", reader.get_error(), entry.output);
+        return false;
+    }
+    if (!closed) {
+        LOG_ERROR("Failed to write file: {}", entry.output);
+        return false;
+    }
+
+    return true;
+}
+
+bool extract_archive(const fs::path &archive_path, const std::string &prefix, const fs::path &output_path, const std::function<void(float)> &progress_callback, uint32_t thread_count) {
+    ArchiveReader reader;
+    if (!reader.open(archive_path))
+        return false;
+
+    std::vector<ArchiveEntry> entries;
+    std::set<fs::path> directories;
+    uint64_t total_size = 0;
+    const mz_uint num_files = mz_zip_reader_get_num_files(&reader.zip);
+    for (mz_uint i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(&reader.zip, i, &file_stat))
+            continue;
+
+        const std::string filename = file_stat.m_filename;
+        if (!filename.starts_with(prefix))
+            continue;
+
+        const fs::path file_output = (output_path / fs_utils::utf8_to_path(filename.substr(prefix.size()))).generic_path();
+        if (file_stat.m_is_directory) {
+            directories.insert(file_output);
+        } else {
+            directories.insert(file_output.parent_path());
+            entries.push_back({ i, file_stat.m_uncomp_size, file_output });
+            total_size += file_stat.m_uncomp_size;
+        }
+    }
+
+    for (const auto &directory : directories)
+        fs::create_directories(directory);
+
+    // a big entry started last would run alone at the end
+    std::sort(entries.begin(), entries.end(), [](const ArchiveEntry &lhs, const ArchiveEntry &rhs) {
+        return lhs.size > rhs.size;
+    });
+
+    if (thread_count == 0)
+        thread_count = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_EXTRACT_THREADS);
+    thread_count = std::max<uint32_t>(std::min<size_t>(thread_count, entries.size()), 1);
+
+    std::atomic<size_t> next_entry = 0;
+    std::atomic<uint64_t> extracted = 0;
+    std::atomic<bool> failed = false;
+    std::mutex mutex;
+    std::condition_variable done_cond;
+    uint32_t done_threads = 0;
+
+    const auto extract_entries = [&](ArchiveReader &thread_reader) {
+        std::vector<char> buffer(WRITE_BUFFER_SIZE);
+        for (size_t i = next_entry++; i < entries.size(); i = next_entry++) {
+            if (!extract_entry(thread_reader, entries[i], buffer, extracted))
+                failed = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([&, i] {
+            if (i == 0) {
+                extract_entries(reader);
+            } else {
+                ArchiveReader thread_reader;
+                if (thread_reader.open(archive_path))
+                    extract_entries(thread_reader);
+                else
+                    failed = true;
+            }
+
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                done_threads++;
+            }
+            done_cond.notify_one();
+        });
+    }
+
+    // the progress is only reported by the calling thread
+    const auto update_progress = [&]() {
+        if (progress_callback)
+            progress_callback(total_size ? static_cast<float>(extracted.load(std::memory_order_relaxed)) / total_size * 100.f : 100.f);
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done_cond.wait_for(lock, std::chrono::milliseconds(100), [&] { return done_threads == thread_count; })) {
+            lock.unlock();
+            update_progress();
+            lock.lock();
+        }
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    update_progress();
+    return !failed;
+}
@@ -38,9 +38,17 @@
 #include <util/bytes.h>
 #include <util/log.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 // Credits to mmozeiko https://github.com/mmozeiko/pkg2zip
 
-static void ctr_init(uint8_t *counter, uint8_t *iv, uint64_t n) {
+static void ctr_init(uint8_t *counter, const uint8_t *iv, uint64_t n) {
     for (int i = 15; i >= 0; i--) {
         n = n + iv[i];
         counter[i] = (uint8_t)n;
@@ -48,6 +56,242 @@ static void ctr_init(uint8_t *counter, uint8_t *iv, uint64_t n) {
     }
 }
 
+// the counter of any block of the data is known, so the entries are split in chunks decrypted on their own
+static constexpr uint64_t DECRYPT_CHUNK_SIZE = 4 * 1024 * 1024;
+// past this the disk is the limit
+static constexpr uint32_t MAX_DECRYPT_THREADS = 8;
+
+static uint32_t get_thread_count(uint32_t thread_count, size_t work_count) {
+    if (thread_count == 0)
+        thread_count = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_DECRYPT_THREADS);
+    return std::max<uint32_t>(std::min<size_t>(thread_count, work_count), 1);
+}
+
+// Run work for every index below count on thread_count threads, the calling thread reports the progress
+static void run_on_threads(size_t count, uint32_t thread_count, const std::function<void(uint32_t thread_index, size_t index)> &work, const std::function<void()> &update_progress) {
+    std::atomic<size_t> next_index = 0;
+    std::mutex mutex;
+    std::condition_variable done_cond;
+    uint32_t done_threads = 0;
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([&, i] {
+            for (size_t index = next_index++; index < count; index = next_index++)
+                work(i, index);
+
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                done_threads++;
+            }
+            done_cond.notify_one();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done_cond.wait_for(lock, std::chrono::milliseconds(100), [&] { return done_threads == thread_count; })) {
+            lock.unlock();
+            update_progress();
+            lock.lock();
+        }
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    update_progress();
+}
+
+namespace {
+
+struct AesCtrDecryptor {
+    EVP_CIPHER_CTX *cipher_ctx = EVP_CIPHER_CTX_new();
+    EVP_CIPHER *cipher_CTR = EVP_CIPHER_fetch(nullptr, "AES-128-CTR", nullptr);
+    const uint8_t *key;
+    const uint8_t *iv;
+
+    AesCtrDecryptor(const uint8_t *key, const uint8_t *iv)
+        : key(key)
+        , iv(iv) {}
+
+    ~AesCtrDecryptor() {
+        EVP_CIPHER_CTX_free(cipher_ctx);
+        EVP_CIPHER_free(cipher_CTR);
+    }
+
+    AesCtrDecryptor(const AesCtrDecryptor &) = delete;
+    AesCtrDecryptor &operator=(const AesCtrDecryptor &) = delete;
+
+    // offset is the one of the data in the pkg data, it must be a multiple of the block size
+    void decrypt(uint64_t offset, unsigned char *data, size_t size) {
+        uint8_t counter[0x10];
+        int dec_len = 0;
+        ctr_init(counter, iv, offset / 16);
+        EVP_DecryptInit_ex(cipher_ctx, cipher_CTR, nullptr, key, counter);
+        EVP_CIPHER_CTX_set_padding(cipher_ctx, 0);
+        EVP_DecryptUpdate(cipher_ctx, data, &dec_len, data, static_cast<int>(size));
+        EVP_DecryptFinal_ex(cipher_ctx, data + dec_len, &dec_len);
+    }
+};
+
+struct PkgChunk {
+    fs::path output;
+    // in the pkg data
+    uint64_t offset;
+    // in the output file
+    uint64_t position;
+    uint64_t size;
+    // the only chunk of its file, which is created by it
+    bool whole_file;
+};
+
+// each thread reads the pkg and decrypts on its own
+struct ChunkExtractor {
+    fs::ifstream infile;
+    AesCtrDecryptor decryptor;
+    std::vector<uint8_t> buffer;
+
+    ChunkExtractor(const fs::path &pkg_path, const uint8_t *key, const uint8_t *iv)
+        : infile(pkg_path, std::ios::binary)
+        , decryptor(key, iv)
+        , buffer(DECRYPT_CHUNK_SIZE) {}
+};
+
+} // namespace
+
+bool extract_pkg_entries(const fs::path &pkg_path, const PkgHeader &pkg_header, const uint8_t *main_key, uint32_t items_offset, const fs::path &output_path, const std::function<void(float)> &progress_callback, uint32_t thread_count) {
+    fs::ifstream infile(pkg_path, std::ios::binary);
+    const uint64_t pkg_size = fs::file_size(pkg_path);
+    const uint64_t data_offset = byte_swap(pkg_header.data_offset);
+    const uint32_t file_count = byte_swap(pkg_header.file_count);
+    AesCtrDecryptor decryptor(main_key, pkg_header.pkg_data_iv);
+
+    // the header is not trusted, the table must fit in the pkg before it is allocated
+    if (pkg_size < data_offset + items_offset + static_cast<uint64_t>(file_count) * sizeof(PkgEntry)) {
+        LOG_ERROR("The pkg file size is too small, possibly corrupted");
+        return false;
+    }
+
+    // the whole entry table at once
+    std::vector<PkgEntry> entries(file_count);
+    infile.seekg(data_offset + items_offset);
+    infile.read(reinterpret_cast<char *>(entries.data()), file_count * sizeof(PkgEntry));
+    decryptor.decrypt(items_offset, reinterpret_cast<unsigned char *>(entries.data()), file_count * sizeof(PkgEntry));
+
+    std::vector<PkgChunk> chunks;
+    uint64_t total_size = 0;
+    for (const PkgEntry &entry : entries) {
+        const uint64_t name_offset = byte_swap(entry.name_offset);
+        const uint64_t name_size = byte_swap(entry.name_size);
+        const uint64_t offset = byte_swap(entry.data_offset);
+        const uint64_t data_size = byte_swap(entry.data_size);
+        if (pkg_size < data_offset + name_offset + name_size || pkg_size < data_offset + offset + data_size) {
+            LOG_ERROR("The pkg file size is too small, possibly corrupted");
+            return false;
+        }
+
+        std::vector<unsigned char> name(name_size);
+        infile.seekg(data_offset + name_offset);
+        infile.read(reinterpret_cast<char *>(name.data()), name_size);
+        decryptor.decrypt(name_offset, name.data(), name_size);
+
+        const auto string_name = std::string(name.begin(), name.end());
+        LOG_INFO(string_name);
+
+        const fs::path output = output_path / string_name;
+        if ((byte_swap(entry.type) & 0xFF) == 4 || (byte_swap(entry.type) & 0xFF) == 18) { // Directory
+            fs::create_directories(output);
+            continue;
+        }
+
+        // the chunks of a split file are written in place
+        const bool whole_file = data_size <= DECRYPT_CHUNK_SIZE;
+        if (!whole_file) {
+            fs::ofstream(output, std::ios::binary).close();
+            boost::system::error_code error_code;
+            fs::resize_file(output, data_size, error_code);
+            if (error_code) {
+                LOG_ERROR("Failed to create file: {}, {}", output, error_code.message());
+                return false;
+            }
+        }
+
+        uint64_t position = 0;
+        do {
+            const uint64_t size = std::min(data_size - position, DECRYPT_CHUNK_SIZE);
+            chunks.push_back({ output, offset + position, position, size, whole_file });
+            position += size;
+        } while (position < data_size);
+        total_size += data_size;
+    }
+    infile.close();
+
+    // in the pkg order, so the threads read it mostly sequentially
+    std::sort(chunks.begin(), chunks.end(), [](const PkgChunk &lhs, const PkgChunk &rhs) {
+        return lhs.offset < rhs.offset;
+    });
+
+    thread_count = get_thread_count(thread_count, chunks.size());
+
+    std::atomic<uint64_t> extracted = 0;
+    std::atomic<bool> failed = false;
+    // created by their thread
+    std::vector<std::unique_ptr<ChunkExtractor>> extractors(thread_count);
+
+    const auto extract_chunk = [&](uint32_t thread_index, size_t index) {
+        auto &extractor = extractors[thread_index];
+        if (!extractor)
+            extractor = std::make_unique<ChunkExtractor>(pkg_path, main_key, pkg_header.pkg_data_iv);
+
+        const PkgChunk &chunk = chunks[index];
+        extractor->infile.seekg(data_offset + chunk.offset);
+        extractor->infile.read(reinterpret_cast<char *>(extractor->buffer.data()), chunk.size);
+        extractor->decryptor.decrypt(chunk.offset, extractor->buffer.data(), chunk.size);
+
+        if (chunk.whole_file) {
+            fs::ofstream outfile(chunk.output, std::ios::binary);
+            outfile.write(reinterpret_cast<char *>(extractor->buffer.data()), chunk.size);
+            if (!outfile)
+                failed = true;
+        } else {
+            fs::fstream outfile(chunk.output, std::ios::in | std::ios::out | std::ios::binary);
+            outfile.seekp(chunk.position);
+            outfile.write(reinterpret_cast<char *>(extractor->buffer.data()), chunk.size);
+            if (!outfile)
+                failed = true;
+        }
+        if (!extractor->infile)
+            failed = true;
+
+        extracted.fetch_add(chunk.size, std::memory_order_relaxed);
+    };
+
+    run_on_threads(chunks.size(), thread_count, extract_chunk, [&]() {
+        if (progress_callback)
+            progress_callback(total_size ? static_cast<float>(extracted.load(std::memory_order_relaxed)) / total_size * 100.f : 100.f);
+    });
+
+    if (failed)
+        LOG_ERROR("Failed to extract the pkg file {} to {}", pkg_path, output_path);
+
+    return !failed;
+}
+
+// the SELF files are independent, they are decrypted at the same time
+static void decrypt_fselfs(const fs::path &path, KeyStore &SCE_KEYS, unsigned char *klicensee) {
+    std::vector<fs::path> selfs;
+    for (const auto &file : fs::recursive_directory_iterator(path)) {
+        if (is_self(file.path()))
+            selfs.push_back(file.path());
+    }
+
+    run_on_threads(selfs.size(), get_thread_count(0, selfs.size()), [&](uint32_t, size_t index) {
+        decrypt_fself(selfs[index], SCE_KEYS, klicensee);
+        LOG_INFO("Decrypted {} with klicensee {}", selfs[index], byte_array_to_string(klicensee, 16));
+    }, []() {});
+}
+
 int execute(std::string &zrif, fs::path &title_src, fs::path &title_dst, F00DEncryptorTypes type, std::string &f00d_arg) {
     std::string title_src_str = title_src.string();
     std::string title_dst_str = title_dst.string();
@@ -75,12 +319,7 @@ bool decrypt_install_nonpdrm(EmuEnvState &emuenv, const fs::path &drmlicpath, co
     register_keys(SCE_KEYS, 1);
     std::vector<uint8_t> temp_klicensee = get_temp_klicensee(zRIF);
 
-    for (const auto &file : fs::recursive_directory_iterator(title_id_src)) {
-        if (is_self(file.path())) {
-            decrypt_fself(file.path(), SCE_KEYS, temp_klicensee.data());
-            LOG_INFO("Decrypted {} with klicensee {}", file.path(), byte_array_to_string(temp_klicensee.data(), 16));
-        }
-    }
+    decrypt_fselfs(title_id_src, SCE_KEYS, temp_klicensee.data());
 
     return true;
 }
@@ -181,13 +420,11 @@ bool install_pkg(const fs::path &pkg_path, EmuEnvState &emuenv, std::string &p_z
     }
 
     EVP_CIPHER_CTX *cipher_ctx = EVP_CIPHER_CTX_new();
-    EVP_CIPHER *cipher_CTR = EVP_CIPHER_fetch(nullptr, "AES-128-CTR", nullptr);
     EVP_CIPHER *cipher_ECB = EVP_CIPHER_fetch(nullptr, "AES-128-ECB", nullptr);
     int dec_len = 0;
 
     auto evp_cleanup = [&]() {
         EVP_CIPHER_CTX_free(cipher_ctx);
-        EVP_CIPHER_free(cipher_CTR);
         EVP_CIPHER_free(cipher_ECB);
     };
 
@@ -235,73 +472,15 @@ bool install_pkg(const fs::path &pkg_path, EmuEnvState &emuenv, std::string &p_z
         break;
     }
 
-    auto decrypt_aes_ctr = [&](uint32_t offset, unsigned char *data, size_t size) {
-        uint8_t counter[0x10];
-        ctr_init(counter, pkg_header.pkg_data_iv, offset);
-        EVP_DecryptInit_ex(cipher_ctx, cipher_CTR, nullptr, main_key, counter);
-        EVP_CIPHER_CTX_set_padding(cipher_ctx, 0);
-        EVP_DecryptUpdate(cipher_ctx, data, &dec_len, data, size);
-        EVP_DecryptFinal_ex(cipher_ctx, data + dec_len, &dec_len);
-    };
-
-    for (uint32_t i = 0; i < byte_swap(pkg_header.file_count); i++) {
-        PkgEntry entry;
-        uint64_t file_offset = items_offset + i * 32;
-        infile.seekg(byte_swap(pkg_header.data_offset) + file_offset, std::ios_base::beg);
-        infile.read(reinterpret_cast<char *>(&entry), sizeof(PkgEntry));
-
-        decrypt_aes_ctr(file_offset / 16, reinterpret_cast<unsigned char *>(&entry), sizeof(PkgEntry));
-
-        if (fs::file_size(pkg_path) < byte_swap(pkg_header.data_offset) + byte_swap(entry.name_offset) + byte_swap(entry.name_size) || fs::file_size(pkg_path) < byte_swap(pkg_header.data_offset) + byte_swap(entry.data_offset) + byte_swap(entry.data_size)) {
-            LOG_ERROR("The pkg file size is too small, possibly corrupted");
-            evp_cleanup();
-            return false;
-        }
-        const auto file_count = (float)byte_swap(pkg_header.file_count);
-        progress_callback(i / file_count * 100.f * 0.6f);
-        std::vector<unsigned char> name(byte_swap(entry.name_size));
-        infile.seekg(byte_swap(pkg_header.data_offset) + byte_swap(entry.name_offset));
-        infile.read((char *)&name[0], byte_swap(entry.name_size));
-
-        decrypt_aes_ctr(byte_swap(entry.name_offset) / 16, name.data(), byte_swap(entry.name_size));
-
-        auto string_name = std::string(name.begin(), name.end());
-        LOG_INFO(string_name);
-
-        if ((byte_swap(entry.type) & 0xFF) == 4 || (byte_swap(entry.type) & 0xFF) == 18) { // Directory
-            fs::create_directories(path / string_name);
-        } else { // File
-            fs::ofstream outfile(path / string_name, std::ios::binary);
-
-            auto offset = byte_swap(entry.data_offset);
-            auto data_size = byte_swap(entry.data_size);
-
-            uint8_t counter[0x10];
-            ctr_init(counter, pkg_header.pkg_data_iv, offset / 16);
-            EVP_DecryptInit_ex(cipher_ctx, cipher_CTR, nullptr, main_key, counter);
-            EVP_CIPHER_CTX_set_padding(cipher_ctx, 0);
-
-            std::vector<uint8_t> buffer(0x10000);
-            while (data_size != 0) {
-                int size = data_size < buffer.size() ? data_size : buffer.size();
-                infile.seekg(byte_swap(pkg_header.data_offset) + offset);
-                infile.read(reinterpret_cast<char *>(buffer.data()), size);
-
-                EVP_DecryptUpdate(cipher_ctx, buffer.data(), &dec_len, buffer.data(), size);
-
-                outfile.write(reinterpret_cast<char *>(buffer.data()), dec_len);
-                offset += size;
-                data_size -= size;
-            }
-
-            EVP_DecryptFinal_ex(cipher_ctx, buffer.data(), &dec_len);
-            outfile.write(reinterpret_cast<char *>(buffer.data()), dec_len);
-            outfile.close();
-        }
-    }
     infile.close();
-
     evp_cleanup();
+
+    const auto extract_progress = [&](float progress) {
+        progress_callback(progress * 0.6f);
+    };
+    if (!extract_pkg_entries(pkg_path, pkg_header, main_key, items_offset, path, extract_progress))
+        return false;
+
     fs::path title_id_src = path;
     fs::path title_id_dst = fs_utils::path_concat(path, "_dec");
     std::string zRIF = p_zRIF;
@@ -323,12 +502,7 @@ bool install_pkg(const fs::path &pkg_path, EmuEnvState &emuenv, std::string &p_z
         fs::remove_all(title_id_src);
         fs::rename(title_id_dst, title_id_src);
 
-        for (const auto &file : fs::recursive_directory_iterator(title_id_src)) {
-            if (is_self(file.path())) {
-                decrypt_fself(file.path(), SCE_KEYS, temp_klicensee.data());
-                LOG_INFO("Decrypted {} with klicensee {}", file.path(), byte_array_to_string(temp_klicensee.data(), 16));
-            }
-        }
+        decrypt_fselfs(title_id_src, SCE_KEYS, temp_klicensee.data());
         break;
     case PkgType::PKG_TYPE_VITA_DLC:
 
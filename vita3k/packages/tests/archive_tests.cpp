@@ -0,0 +1,104 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <packages/archive.h>
+#include <testutil/files.h>
+
+#include <gtest/gtest.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using testutil::make_data;
+using testutil::read_file;
+
+namespace {
+
+struct packages_archive : public testutil::TempDirTest {
+    // Odd files are stored, even ones deflated
+    fs::path make_archive(const testutil::Files &files) {
+        const fs::path archive_path = path / "archive.vpk";
+        mz_zip_archive zip{};
+        EXPECT_TRUE(mz_zip_writer_init_file(&zip, archive_path.string().c_str(), 0));
+        int i = 0;
+        for (const auto &[name, data] : files) {
+            const mz_uint level = i++ % 2 ? MZ_NO_COMPRESSION : MZ_BEST_SPEED;
+            EXPECT_TRUE(mz_zip_writer_add_mem(&zip, name.c_str(), data.data(), data.size(), level));
+        }
+        EXPECT_TRUE(mz_zip_writer_add_mem(&zip, "app/sce_module/", nullptr, 0, 0));
+        EXPECT_TRUE(mz_zip_writer_finalize_archive(&zip));
+        EXPECT_TRUE(mz_zip_writer_end(&zip));
+
+        return archive_path;
+    }
+};
+
+} // namespace
+
+TEST_F(packages_archive, extracts_prefixed_entries) {
+    const testutil::Files files = {
+        { "app/eboot.bin", make_data(3 * 1024 * 1024 + 17, 1) },
+        { "app/sce_sys/param.sfo", make_data(1024, 2) },
+        { "app/data/empty.bin", {} },
+        { "app/data/sub/level.dat", make_data(200 * 1024, 3) },
+        { "other/eboot.bin", make_data(100, 4) },
+    };
+    const fs::path archive_path = make_archive(files);
+
+    std::vector<float> progress;
+    const fs::path output_path = path / "output";
+    ASSERT_TRUE(extract_archive(archive_path, "app/", output_path, [&](float value) { progress.push_back(value); }, 3));
+
+    for (const auto &[name, data] : files) {
+        if (name.starts_with("app/")) {
+            EXPECT_EQ(read_file(output_path / name.substr(4)), data) << name;
+        }
+    }
+    EXPECT_TRUE(fs::is_directory(output_path / "sce_module"));
+    EXPECT_FALSE(fs::exists(path / "output" / "other"));
+
+    ASSERT_FALSE(progress.empty());
+    EXPECT_FLOAT_EQ(progress.back(), 100.f);
+}
+
+TEST_F(packages_archive, fails_on_damaged_entry) {
+    const std::vector<uint8_t> data(64 * 1024, 0x5A);
+    const fs::path archive_path = make_archive({ { "app/eboot.bin", make_data(1024, 9) }, { "app/stored.bin", data } });
+
+    // change a byte of the stored entry, which does not match its CRC anymore
+    std::vector<uint8_t> archive = read_file(archive_path);
+    const auto stored = std::search(archive.begin(), archive.end(), data.begin(), data.begin() + 1024);
+    ASSERT_NE(stored, archive.end());
+    stored[100] ^= 0xFF;
+    fs::ofstream(archive_path, std::ios::binary).write(reinterpret_cast<const char *>(archive.data()), archive.size());
+
+    EXPECT_FALSE(extract_archive(archive_path, "app/", path / "output"));
+    EXPECT_FALSE(extract_archive(path / "missing.vpk", "app/", path / "output"));
+}
+
+TEST_F(packages_archive, benchmark_install) {
+    if (!std::getenv(testutil::INSTALL_BENCHMARK))
+        GTEST_SKIP() << testutil::INSTALL_BENCHMARK << " is not set";
+
+    const testutil::Files files = testutil::make_game_files("app/data/");
+    const fs::path archive_path = make_archive(files);
+    testutil::benchmark_install(path, files, [&](const fs::path &output_path, uint32_t thread_count) {
+        return extract_archive(archive_path, "app/", output_path, nullptr, thread_count);
+    });
+}
@@ -0,0 +1,144 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <packages/pkg.h>
+#include <testutil/files.h>
+#include <util/bytes.h>
+
+#include <gtest/gtest.h>
+#include <openssl/evp.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using testutil::make_data;
+using testutil::read_file;
+
+namespace {
+
+const uint8_t main_key[16] = { 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef };
+
+struct packages_pkg : public testutil::TempDirTest {
+    PkgHeader header{};
+
+    void SetUp() override {
+        TempDirTest::SetUp();
+        for (uint8_t i = 0; i < sizeof(header.pkg_data_iv); i++)
+            header.pkg_data_iv[i] = 0xF0 + i;
+    }
+
+    // The data has the entry table, then the names and the contents, aligned like in the real pkg files.
+    // It is encrypted with a single counter run, like the whole pkg data
+    fs::path make_pkg(const std::vector<std::string> &directories, const testutil::Files &files) {
+        const auto align = [](std::vector<uint8_t> &data) { data.resize((data.size() + 15) & ~15); };
+        const uint32_t entry_count = static_cast<uint32_t>(directories.size() + files.size());
+        std::vector<uint8_t> data(entry_count * sizeof(PkgEntry));
+        std::vector<PkgEntry> entries;
+
+        const auto add_entry = [&](const std::string &name, const std::vector<uint8_t> *contents) {
+            PkgEntry entry{};
+            entry.name_offset = byte_swap(static_cast<uint32_t>(data.size()));
+            entry.name_size = byte_swap(static_cast<uint32_t>(name.size()));
+            data.insert(data.end(), name.begin(), name.end());
+            align(data);
+
+            entry.type = byte_swap<uint32_t>(contents ? 3 : 4);
+            if (contents) {
+                entry.data_offset = byte_swap(static_cast<uint64_t>(data.size()));
+                entry.data_size = byte_swap(static_cast<uint64_t>(contents->size()));
+                data.insert(data.end(), contents->begin(), contents->end());
+                align(data);
+            }
+            entries.push_back(entry);
+        };
+        for (const auto &directory : directories)
+            add_entry(directory, nullptr);
+        for (const auto &[name, contents] : files)
+            add_entry(name, &contents);
+        std::memcpy(data.data(), entries.data(), entries.size() * sizeof(PkgEntry));
+
+        EVP_CIPHER_CTX *cipher_ctx = EVP_CIPHER_CTX_new();
+        int len = 0;
+        EVP_EncryptInit_ex(cipher_ctx, EVP_aes_128_ctr(), nullptr, main_key, header.pkg_data_iv);
+        EVP_EncryptUpdate(cipher_ctx, data.data(), &len, data.data(), static_cast<int>(data.size()));
+        EVP_CIPHER_CTX_free(cipher_ctx);
+
+        // only the fields used by the extraction
+        const uint64_t data_offset = 0x100;
+        header.data_offset = byte_swap(data_offset);
+        header.file_count = byte_swap(entry_count);
+
+        const fs::path pkg_path = path / "content.pkg";
+        fs::ofstream pkg(pkg_path, std::ios::binary);
+        pkg.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        pkg.seekp(data_offset);
+        pkg.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+        return pkg_path;
+    }
+};
+
+} // namespace
+
+TEST_F(packages_pkg, extracts_entries) {
+    const testutil::Files files = {
+        // split in several chunks, the last one not a whole block
+        { "eboot.bin", make_data(9 * 1024 * 1024 + 5, 1) },
+        { "sce_sys/param.sfo", make_data(1024, 2) },
+        { "data/empty.bin", {} },
+        { "data/sub/level.dat", make_data(4 * 1024 * 1024, 3) },
+    };
+    const fs::path pkg_path = make_pkg({ "sce_sys", "data", "data/sub", "sce_module" }, files);
+
+    std::vector<float> progress;
+    const fs::path output_path = path / "output";
+    ASSERT_TRUE(extract_pkg_entries(pkg_path, header, main_key, 0, output_path, [&](float value) { progress.push_back(value); }, 3));
+
+    for (const auto &[name, data] : files)
+        EXPECT_EQ(read_file(output_path / name), data) << name;
+    EXPECT_TRUE(fs::is_directory(output_path / "sce_module"));
+
+    ASSERT_FALSE(progress.empty());
+    EXPECT_FLOAT_EQ(progress.back(), 100.f);
+}
+
+TEST_F(packages_pkg, fails_on_truncated_pkg) {
+    const fs::path pkg_path = make_pkg({}, { { "eboot.bin", make_data(64 * 1024, 4) } });
+    fs::resize_file(pkg_path, fs::file_size(pkg_path) - 1024);
+
+    EXPECT_FALSE(extract_pkg_entries(pkg_path, header, main_key, 0, path / "output"));
+}
+
+TEST_F(packages_pkg, fails_on_bad_file_count) {
+    const fs::path pkg_path = make_pkg({}, { { "eboot.bin", make_data(64 * 1024, 5) } });
+    // a table bigger than the pkg must not be allocated
+    header.file_count = byte_swap(UINT32_MAX);
+
+    EXPECT_FALSE(extract_pkg_entries(pkg_path, header, main_key, 0, path / "output"));
+}
+
+TEST_F(packages_pkg, benchmark_install) {
+    if (!std::getenv(testutil::INSTALL_BENCHMARK))
+        GTEST_SKIP() << testutil::INSTALL_BENCHMARK << " is not set";
+
+    const testutil::Files files = testutil::make_game_files("");
+    const fs::path pkg_path = make_pkg({ "small" }, files);
+    testutil::benchmark_install(path, files, [&](const fs::path &output_path, uint32_t thread_count) {
+        return extract_pkg_entries(pkg_path, header, main_key, 0, output_path, nullptr, thread_count);
+    });
+}
@@ -17,9 +17,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <new>
 #include <vector>
 
 namespace renderer {
@@ -85,6 +88,8 @@ enum class CommandOpcode : std::uint8_t {
     DestroyContext
 };
 
+constexpr std::size_t COMMAND_OPCODE_COUNT = static_cast<std::size_t>(CommandOpcode::DestroyContext) + 1;
+
 enum CommandErrorCode {
     CommandErrorCodeNone = 0,
     CommandErrorCodePending = -1,
@@ -108,7 +113,52 @@ struct Command {
     Command *next = nullptr;
 };
 
-using CommandPool = std::vector<Command>;
+// Arena of host commands, allocated by chunks and never given back to the system.
+// Only one thread at a time may allocate from it (the one recording the commands), while any thread
+// (usually the renderer thread) can give commands back, ideally a whole list at once.
+class CommandPool {
+public:
+    CommandPool() = default;
+    CommandPool(const CommandPool &) = delete;
+    CommandPool &operator=(const CommandPool &) = delete;
+
+    Command *allocate() {
+        if (!free_list) {
+            // take everything released so far in one go, this can't suffer from ABA as we are the only consumer
+            free_list = released.exchange(nullptr, std::memory_order_acquire);
+            if (!free_list)
+                grow();
+        }
+
+        Command *cmd = free_list;
+        free_list = cmd->next;
+        return new (cmd) Command;
+    }
+
+    // give back the commands from first to last, which must already be linked together
+    void release(Command *first, Command *last) {
+        Command *head = released.load(std::memory_order_relaxed);
+        do {
+            last->next = head;
+        } while (!released.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+private:
+    static constexpr std::size_t CHUNK_SIZE = 256;
+
+    void grow() {
+        Command *chunk = chunks.emplace_back(std::make_unique<Command[]>(CHUNK_SIZE)).get();
+        for (std::size_t i = 0; i < CHUNK_SIZE - 1; i++)
+            chunk[i].next = &chunk[i + 1];
+        chunk[CHUNK_SIZE - 1].next = nullptr;
+        free_list = chunk;
+    }
+
+    std::atomic<Command *> released = nullptr;
+    // owned by the allocating thread
+    Command *free_list = nullptr;
+    std::vector<std::unique_ptr<Command[]>> chunks;
+};
 
 // It's to split a command list easier when ExecuteCommandList is used.
 struct CommandList {
@@ -116,6 +166,7 @@ struct CommandList {
     Command *last{ nullptr };
 
     Context *context; ///< The HLE context that try to execute this buffer.
+    CommandPool *pool{ nullptr }; ///< Where the commands go back once executed when there is no context.
 };
 
 struct CommandHelper {
@@ -95,6 +95,7 @@ void destroy_render_target(State &state, std::unique_ptr<RenderTarget> &rt);
 
 Command *generic_command_allocate();
 void generic_command_free(Command *cmd);
+CommandPool *get_generic_command_pool();
 
 template <typename... Args>
 bool add_command(Context *ctx, const CommandOpcode opcode, int *status, Args... arguments) {
@@ -138,6 +139,8 @@ int send_single_command(State &state, Context *ctx, const CommandOpcode opcode,
     CommandList list;
     list.first = cmd;
     list.last = cmd;
+    if (!ctx)
+        list.pool = get_generic_command_pool();
 
     // Submit it
     submit_command_list(state, ctx, list);
@@ -193,6 +196,8 @@ uint32_t decompress_compressed_texture(SceGxmTextureBaseFormat fmt, void *dest,
  * \param format_id         Id of the compressed format, in order: BC1 (DXT1), BC2 (DXT3), BC3 (DXT5), BC4U (RGTC1), BC4S (RGTC1), BC5U (RGTC2) or BC5S (RGTC2).
  */
 void decompress_bc_image(uint32_t width, uint32_t height, const uint8_t *block_storage, uint32_t *image, const uint8_t format_id);
+// Reference version of the function above, decoding one block at a time on the calling thread
+void decompress_bc_image_basic(uint32_t width, uint32_t height, const uint8_t *block_storage, uint32_t *image, const uint8_t format_id);
 
 /**
  * \brief Try to decompress texture to 16-bit RGB floating point color.
@@ -230,6 +235,9 @@ void convert_u2f10f10f10_to_f16f16f16f16(void *dest, const void *data, const uin
 
 void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel);
 void tiled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel);
+// Reference versions of the two functions above, converting one texel at a time
+void swizzled_texture_to_linear_texture_basic(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel);
+void tiled_texture_to_linear_texture_basic(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel);
 
 uint16_t get_upload_mip(const uint16_t true_mip, const uint16_t width, const uint16_t height);
 
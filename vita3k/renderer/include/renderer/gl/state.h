@@ -63,6 +63,10 @@ struct GLState : public renderer::State {
     std::string_view get_gpu_name() override;
 
     void precompile_shader(const ShadersHash &hash) override;
+    // the shaders can only be compiled on the thread owning the GL context
+    bool can_precompile_in_parallel() const override {
+        return false;
+    }
     void preclose_action() override;
 };
 
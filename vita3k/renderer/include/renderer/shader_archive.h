@@ -0,0 +1,100 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/containers.h>
+#include <util/fs.h>
+#include <util/hash.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+struct ShadersHash;
+
+// Single file cache of the shaders generated for a game and of the shader programs it uses.
+// The file starts with a header (shader version and GPU features the shaders were generated with) followed by
+// records which are only ever appended. The records already in the file are memory mapped and indexed when the
+// archive is opened, so a lookup is a single hash map access.
+// Each renderer backend uses its own archive (see get_shaders_cache_hashs).
+class ShaderArchive {
+public:
+    ShaderArchive() = default;
+    ~ShaderArchive();
+
+    ShaderArchive(const ShaderArchive &) = delete;
+    ShaderArchive &operator=(const ShaderArchive &) = delete;
+
+    // Open (or create) the archive, an archive made for another version or other features is discarded.
+    // Return false if the file could not be opened or created.
+    bool open(const fs::path &path, uint32_t version, uint32_t features_mask);
+    void close();
+    bool is_open() const;
+    // true if the last call to open had to throw away an archive made with another version or other features
+    bool was_outdated() const {
+        return outdated;
+    }
+
+    // Generated shaders are indexed by a key made of the shader version, hash and type.
+    // Return an empty container if the shader is not in the archive.
+    std::string get_shader_glsl(const std::string &key) const;
+    std::vector<uint32_t> get_shader_spirv(const std::string &key) const;
+    void add_shader(const std::string &key, const void *data, size_t size);
+
+    // Return the programs in the order they were added
+    std::vector<ShadersHash> get_programs() const;
+    // Return false if the program was already in the archive
+    bool add_program(const ShadersHash &hash);
+
+private:
+    struct Entry {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    typedef std::pair<Sha256Hash, Sha256Hash> ProgramKey;
+
+    bool load_records();
+    bool append_record(uint32_t type, const std::string &key, const void *data, size_t size);
+    const Entry *find_shader(const std::string &key) const;
+    void unmap();
+
+    mutable std::mutex mutex;
+    FILE *file = nullptr;
+    bool outdated = false;
+
+    // read-only mapping of the records which were in the file when it was opened
+    const uint8_t *mapping = nullptr;
+    size_t mapping_size = 0;
+    void *mapping_handle = nullptr;
+
+    unordered_map_fast<std::string, Entry> shaders;
+    // records appended since the archive was opened
+    std::vector<std::unique_ptr<uint8_t[]>> appended_data;
+
+    std::vector<ProgramKey> programs;
+    unordered_set_fast<ProgramKey> programs_set;
+};
+
+} // namespace renderer
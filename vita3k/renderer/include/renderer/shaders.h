@@ -20,6 +20,7 @@
 #include <util/fs.h>
 
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -32,15 +33,18 @@ struct FeatureState;
 
 namespace renderer {
 
+class ShaderArchive;
 struct ShadersHash;
 struct State;
 
 // Shaders.
+// Open the shader archive of the current app and fill shaders_cache_hashs with the programs it contains
 bool get_shaders_cache_hashs(State &renderer);
-void save_shaders_cache_hashs(State &renderer, std::vector<ShadersHash> &shaders_cache_hashs);
-std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const fs::path &shader_cache_path, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache);
-std::vector<uint32_t> load_spirv_shader(const SceGxmProgram &program, const FeatureState &features, bool is_vulkan, const shader::Hints &hints, bool maskupdate, const fs::path &shader_cache_path, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache);
-std::string pre_load_shader_glsl(const fs::path &shader_path);
-std::vector<uint32_t> pre_load_shader_spirv(const fs::path &shader_path);
+// Precompile the programs of shaders_cache_hashs, spread over the shared thread pool when the backend allows it.
+// on_progress is called regularly from the calling thread (to draw the progress), returning false stops the precompilation.
+void precompile_shaders(State &renderer, const std::function<bool()> &on_progress);
+std::string get_shader_archive_key(const std::string &shader_version, const std::string &hash_hex, const char *shader_type_str);
+std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, ShaderArchive &shader_archive, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache);
+std::vector<uint32_t> load_spirv_shader(const SceGxmProgram &program, const FeatureState &features, bool is_vulkan, const shader::Hints &hints, bool maskupdate, ShaderArchive &shader_archive, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache);
 
 } // namespace renderer
@@ -19,9 +19,12 @@
 
 #include <features/state.h>
 #include <renderer/commands.h>
+#include <renderer/shader_archive.h>
 #include <renderer/types.h>
 #include <threads/queue.h>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <string_view>
@@ -67,14 +70,18 @@ struct State {
     std::condition_variable notification_ready;
     std::mutex notification_mutex;
 
+    // programs found in the shader archive when the app was loaded, to be precompiled
     std::vector<ShadersHash> shaders_cache_hashs;
+    ShaderArchive shader_archive;
     std::string shader_version;
 
     int last_scene_id = 0;
 
     // on Vulkan, this is actually the number of pipelines compiled
     uint32_t shaders_count_compiled = 0;
-    volatile uint32_t programs_count_pre_compiled = 0;
+    std::atomic<uint32_t> programs_count_pre_compiled = 0;
+    // when the precompilation of the programs started, to estimate the remaining time
+    std::chrono::steady_clock::time_point programs_pre_compile_start;
 
     bool should_display;
 
@@ -118,6 +125,10 @@ struct State {
     virtual std::string_view get_gpu_name() = 0;
 
     virtual void precompile_shader(const ShadersHash &hash) = 0;
+    // false if precompile_shader must be called from the thread owning the renderer context
+    virtual bool can_precompile_in_parallel() const {
+        return true;
+    }
     virtual void preclose_action() = 0;
 
     virtual ~State() = default;
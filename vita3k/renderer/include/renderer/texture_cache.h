@@ -22,9 +22,12 @@
 #include <util/fs.h>
 
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string_view>
+#include <vector>
 
 namespace ddspp {
 struct Descriptor;
@@ -46,6 +49,8 @@ struct TextureCacheInfo {
     uint32_t texture_size = 0;
     bool use_hash = false;
     bool dirty = false;
+    // with software write tracking, generation of the memory when the texture was uploaded
+    uint32_t write_generation = 0;
     // used for texture importation
     bool is_imported = false;
     bool is_srgb = false;
@@ -61,6 +66,14 @@ struct SamplerCacheInfo {
     int index = 0;
 };
 
+// Textures converted on the CPU (decompression, unswizzling...) during the last second
+struct TextureDecodeStats {
+    uint32_t texture_count = 0;
+    uint64_t total_us = 0;
+    // slowest texture
+    uint64_t max_us = 0;
+};
+
 struct AvailableTexture {
     bool is_dds;
     std::shared_ptr<fs::path> folder_path;
@@ -94,6 +107,19 @@ protected:
     bool save_as_png = true;
     bool export_textures = false;
 
+    // staging buffers for the textures converted on the CPU, kept between uploads to avoid reallocating them
+    std::vector<uint8_t> texture_data_decompressed;
+    std::vector<uint8_t> texture_pixels_lineared;
+
+    // upload_texture runs on the renderer thread while the stats are read by the gui
+    std::mutex decode_stats_mutex;
+    TextureDecodeStats decode_stats_current;
+    TextureDecodeStats decode_stats_last;
+    std::chrono::steady_clock::time_point decode_stats_start;
+
+    void rotate_decode_stats(std::chrono::steady_clock::time_point now);
+    void add_decode_time(uint64_t decode_us);
+
 public:
     Backend backend;
     bool use_protect = false;
@@ -131,6 +157,7 @@ public:
     virtual void configure_sampler(size_t index, const SceGxmTexture &texture) {}
 
     void upload_texture(const SceGxmTexture &gxm_texture, MemState &mem);
+    TextureDecodeStats get_decode_stats();
     void cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemState &mem);
 
     // is called by cache_and_bind_texture if use_sampler_cache is set to true
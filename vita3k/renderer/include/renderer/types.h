@@ -161,6 +161,8 @@ struct Context {
     CommandList command_list;
     CommandAllocFunc alloc_func;
     CommandFreeFunc free_func;
+    // used for the commands which don't fit in the guest command buffer
+    CommandPool command_pool;
 
     int render_finish_status = 0;
     int notification_finish_status = 0;
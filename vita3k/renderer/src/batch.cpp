@@ -24,18 +24,54 @@
 #include <renderer/vulkan/types.h>
 
 #include <config/state.h>
-#include <functional>
 #include <util/log.h>
 
+#include <array>
+#include <mutex>
+
 struct FeatureState;
 
 namespace renderer {
+namespace {
+// Each thread sending commands without a context gets its own pool. Commands can still be in flight
+// when the thread exits, so pools are never destroyed, only handed over to the next thread.
+std::mutex generic_pools_mutex;
+std::vector<std::unique_ptr<CommandPool>> generic_pools;
+std::vector<CommandPool *> idle_generic_pools;
+
+struct ThreadCommandPool {
+    CommandPool *pool;
+
+    ThreadCommandPool() {
+        const std::lock_guard<std::mutex> guard(generic_pools_mutex);
+        if (idle_generic_pools.empty()) {
+            pool = generic_pools.emplace_back(std::make_unique<CommandPool>()).get();
+        } else {
+            pool = idle_generic_pools.back();
+            idle_generic_pools.pop_back();
+        }
+    }
+
+    ~ThreadCommandPool() {
+        const std::lock_guard<std::mutex> guard(generic_pools_mutex);
+        idle_generic_pools.push_back(pool);
+    }
+};
+
+thread_local ThreadCommandPool thread_command_pool;
+} // namespace
+
+CommandPool *get_generic_command_pool() {
+    return thread_command_pool.pool;
+}
+
 Command *generic_command_allocate() {
-    return new Command;
+    return thread_command_pool.pool->allocate();
 }
 
 void generic_command_free(Command *cmd) {
-    delete cmd;
+    // only called on the thread which allocated the command
+    thread_command_pool.pool->release(cmd, cmd);
 }
 
 void complete_command(State &state, CommandHelper &helper, const int code) {
@@ -68,53 +104,57 @@ bool wait_cmd(MemState &mem, CommandList &command_list) {
 void process_batch(renderer::State &state, const FeatureState &features, MemState &mem, Config &config, CommandList &command_list) {
     using CommandHandlerFunc = decltype(cmd_handle_set_context);
 
-    const static std::map<CommandOpcode, CommandHandlerFunc *> handlers = {
-        { CommandOpcode::SetContext, cmd_handle_set_context },
-        { CommandOpcode::SyncSurfaceData, cmd_handle_sync_surface_data },
-        { CommandOpcode::MidSceneFlush, cmd_handle_mid_scene_flush },
-        { CommandOpcode::CreateContext, cmd_handle_create_context },
-        { CommandOpcode::CreateRenderTarget, cmd_handle_create_render_target },
-        { CommandOpcode::MemoryMap, cmd_handle_memory_map },
-        { CommandOpcode::MemoryUnmap, cmd_handle_memory_unmap },
-        { CommandOpcode::Draw, cmd_handle_draw },
-        { CommandOpcode::TransferCopy, cmd_handle_transfer_copy },
-        { CommandOpcode::TransferDownscale, cmd_handle_transfer_downscale },
-        { CommandOpcode::TransferFill, cmd_handle_transfer_fill },
-        { CommandOpcode::Nop, cmd_handle_nop },
-        { CommandOpcode::SetState, cmd_handle_set_state },
-        { CommandOpcode::SignalSyncObject, cmd_handle_signal_sync_object },
-        { CommandOpcode::WaitSyncObject, cmd_handle_wait_sync_object },
-        { CommandOpcode::SignalNotification, cmd_handle_notification },
-        { CommandOpcode::NewFrame, cmd_new_frame },
-        { CommandOpcode::DestroyRenderTarget, cmd_handle_destroy_render_target },
-        { CommandOpcode::DestroyContext, cmd_handle_destroy_context }
-    };
+    static constexpr auto handlers = [] {
+        std::array<CommandHandlerFunc *, COMMAND_OPCODE_COUNT> handlers{};
+        const auto set = [&](CommandOpcode opcode, CommandHandlerFunc *handler) {
+            handlers[static_cast<std::size_t>(opcode)] = handler;
+        };
+        set(CommandOpcode::SetContext, cmd_handle_set_context);
+        set(CommandOpcode::SyncSurfaceData, cmd_handle_sync_surface_data);
+        set(CommandOpcode::MidSceneFlush, cmd_handle_mid_scene_flush);
+        set(CommandOpcode::CreateContext, cmd_handle_create_context);
+        set(CommandOpcode::CreateRenderTarget, cmd_handle_create_render_target);
+        set(CommandOpcode::MemoryMap, cmd_handle_memory_map);
+        set(CommandOpcode::MemoryUnmap, cmd_handle_memory_unmap);
+        set(CommandOpcode::Draw, cmd_handle_draw);
+        set(CommandOpcode::TransferCopy, cmd_handle_transfer_copy);
+        set(CommandOpcode::TransferDownscale, cmd_handle_transfer_downscale);
+        set(CommandOpcode::TransferFill, cmd_handle_transfer_fill);
+        set(CommandOpcode::Nop, cmd_handle_nop);
+        set(CommandOpcode::SetState, cmd_handle_set_state);
+        set(CommandOpcode::SignalSyncObject, cmd_handle_signal_sync_object);
+        set(CommandOpcode::WaitSyncObject, cmd_handle_wait_sync_object);
+        set(CommandOpcode::SignalNotification, cmd_handle_notification);
+        set(CommandOpcode::NewFrame, cmd_new_frame);
+        set(CommandOpcode::DestroyRenderTarget, cmd_handle_destroy_render_target);
+        set(CommandOpcode::DestroyContext, cmd_handle_destroy_context);
+        return handlers;
+    }();
 
     Command *cmd = command_list.first;
+    Command *last_cmd = nullptr;
 
     // Take a batch, and execute it. Hope it's not too large
-    do {
-        if (cmd == nullptr) {
-            break;
-        }
-
-        auto handler = handlers.find(cmd->opcode);
-        if (handler == handlers.end()) {
-            LOG_ERROR("Unimplemented command opcode {}", static_cast<int>(cmd->opcode));
+    while (cmd != nullptr) {
+        const auto opcode = static_cast<std::size_t>(cmd->opcode);
+        CommandHandlerFunc *handler = opcode < handlers.size() ? handlers[opcode] : nullptr;
+        if (!handler) {
+            LOG_ERROR("Unimplemented command opcode {}", opcode);
         } else {
             CommandHelper helper(cmd);
-            handler->second(state, mem, config, helper, features, command_list.context);
+            handler(state, mem, config, helper, features, command_list.context);
         }
 
-        Command *last_cmd = cmd;
+        last_cmd = cmd;
         cmd = cmd->next;
 
-        if (command_list.context) {
+        if (command_list.context)
             command_list.context->free_func(last_cmd);
-        } else {
-            generic_command_free(last_cmd);
-        }
-    } while (true);
+    }
+
+    // commands without a context all come from the same pool, give them back at once
+    if (!command_list.context && command_list.pool && last_cmd)
+        command_list.pool->release(command_list.first, last_cmd);
 }
 
 void process_batches(renderer::State &state, const FeatureState &features, MemState &mem, Config &config) {
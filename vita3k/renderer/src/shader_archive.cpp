@@ -0,0 +1,320 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/shader_archive.h>
+
+#include <renderer/types.h>
+
+#include <util/log.h>
+
+#include <cstring>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace renderer {
+
+namespace {
+
+constexpr uint32_t ARCHIVE_MAGIC = 0x43533356; // V3SC
+// to be increased when the layout of the file changes
+constexpr uint32_t ARCHIVE_FORMAT_VERSION = 1;
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t format_version;
+    uint32_t shader_version;
+    uint32_t features_mask;
+};
+
+enum RecordType : uint32_t {
+    RECORD_SHADER = 1,
+    RECORD_PROGRAM = 2,
+};
+
+// followed by the key and the data
+struct RecordHeader {
+    uint32_t type;
+    uint32_t key_size;
+    uint32_t data_size;
+};
+
+} // namespace
+
+ShaderArchive::~ShaderArchive() {
+    close();
+}
+
+bool ShaderArchive::open(const fs::path &path, uint32_t version, uint32_t features_mask) {
+    close();
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    outdated = false;
+
+    if (fs::exists(path)) {
+        size_t valid_size = 0;
+        while (true) {
+            const size_t file_size = fs::file_size(path);
+#ifdef WIN32
+            const HANDLE file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_handle != INVALID_HANDLE_VALUE && file_size > 0) {
+                const HANDLE mapping_object = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping_object) {
+                    mapping = static_cast<const uint8_t *>(MapViewOfFile(mapping_object, FILE_MAP_READ, 0, 0, 0));
+                    if (mapping)
+                        mapping_handle = mapping_object;
+                    else
+                        CloseHandle(mapping_object);
+                }
+            }
+            if (file_handle != INVALID_HANDLE_VALUE)
+                CloseHandle(file_handle);
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd >= 0 && file_size > 0) {
+                void *address = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (address != MAP_FAILED)
+                    mapping = static_cast<const uint8_t *>(address);
+            }
+            if (fd >= 0)
+                ::close(fd);
+#endif
+            if (!mapping && file_size > 0) {
+                // the archive can't be read, it must not be taken for an outdated one and deleted
+                LOG_ERROR("Failed to map shader cache archive {}, the shader cache is disabled for this session", path);
+                return false;
+            }
+            mapping_size = file_size;
+
+            ArchiveHeader header{};
+            if (mapping_size >= sizeof(ArchiveHeader))
+                memcpy(&header, mapping, sizeof(ArchiveHeader));
+            if (header.magic != ARCHIVE_MAGIC || header.format_version != ARCHIVE_FORMAT_VERSION
+                || header.shader_version != version || header.features_mask != features_mask) {
+                outdated = mapping_size > 0;
+                unmap();
+                fs::remove(path);
+                break;
+            }
+
+            valid_size = load_records() ? mapping_size : 0;
+            if (valid_size != 0)
+                break;
+
+            // the last record was not completely written (the emulator was closed while writing it), remove it
+            size_t records_end = sizeof(ArchiveHeader);
+            while (records_end + sizeof(RecordHeader) <= mapping_size) {
+                RecordHeader record;
+                memcpy(&record, mapping + records_end, sizeof(RecordHeader));
+                const size_t record_size = sizeof(RecordHeader) + record.key_size + record.data_size;
+                if (records_end + record_size > mapping_size)
+                    break;
+                records_end += record_size;
+            }
+            LOG_WARN("Shader cache archive {} is truncated, dropping its last record", path);
+            unmap();
+            fs::resize_file(path, records_end);
+        }
+    }
+
+    file = FOPEN(path.c_str(), "ab");
+    if (!file) {
+        LOG_ERROR("Failed to open shader cache archive {}", path);
+        unmap();
+        return false;
+    }
+
+    if (!mapping) {
+        const ArchiveHeader header{ ARCHIVE_MAGIC, ARCHIVE_FORMAT_VERSION, version, features_mask };
+        fwrite(&header, sizeof(header), 1, file);
+        fflush(file);
+    }
+
+    return true;
+}
+
+bool ShaderArchive::load_records() {
+    shaders.clear();
+    programs.clear();
+    programs_set.clear();
+
+    size_t offset = sizeof(ArchiveHeader);
+    while (offset < mapping_size) {
+        RecordHeader record;
+        if (offset + sizeof(RecordHeader) > mapping_size)
+            return false;
+        memcpy(&record, mapping + offset, sizeof(RecordHeader));
+        offset += sizeof(RecordHeader);
+
+        if (offset + record.key_size + record.data_size > mapping_size)
+            return false;
+
+        const uint8_t *key = mapping + offset;
+        const uint8_t *data = key + record.key_size;
+        offset += record.key_size + record.data_size;
+
+        switch (record.type) {
+        case RECORD_SHADER:
+            // a shader can be generated again when the cache is disabled, the last one wins
+            shaders[std::string(reinterpret_cast<const char *>(key), record.key_size)] = { data, record.data_size };
+            break;
+        case RECORD_PROGRAM: {
+            if (record.data_size != sizeof(Sha256Hash) * 2)
+                break;
+            ProgramKey program;
+            memcpy(program.first.data(), data, sizeof(Sha256Hash));
+            memcpy(program.second.data(), data + sizeof(Sha256Hash), sizeof(Sha256Hash));
+            if (programs_set.insert(program).second)
+                programs.push_back(program);
+            break;
+        }
+        default:
+            // record from a newer version, skip it
+            break;
+        }
+    }
+
+    return true;
+}
+
+void ShaderArchive::unmap() {
+    if (!mapping)
+        return;
+
+#ifdef WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(mapping_handle);
+#else
+    munmap(const_cast<uint8_t *>(mapping), mapping_size);
+#endif
+    mapping = nullptr;
+    mapping_size = 0;
+    mapping_handle = nullptr;
+    shaders.clear();
+}
+
+void ShaderArchive::close() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+
+    unmap();
+    shaders.clear();
+    appended_data.clear();
+    programs.clear();
+    programs_set.clear();
+}
+
+bool ShaderArchive::is_open() const {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return file != nullptr;
+}
+
+const ShaderArchive::Entry *ShaderArchive::find_shader(const std::string &key) const {
+    const auto it = shaders.find(key);
+    if (it == shaders.end() || it->second.size == 0)
+        return nullptr;
+
+    return &it->second;
+}
+
+std::string ShaderArchive::get_shader_glsl(const std::string &key) const {
+    const std::lock_guard<std::mutex> guard(mutex);
+    const Entry *entry = find_shader(key);
+    if (!entry)
+        return {};
+
+    return std::string(reinterpret_cast<const char *>(entry->data), entry->size);
+}
+
+std::vector<uint32_t> ShaderArchive::get_shader_spirv(const std::string &key) const {
+    const std::lock_guard<std::mutex> guard(mutex);
+    const Entry *entry = find_shader(key);
+    if (!entry)
+        return {};
+
+    std::vector<uint32_t> spirv((entry->size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    memcpy(spirv.data(), entry->data, entry->size);
+    return spirv;
+}
+
+bool ShaderArchive::append_record(uint32_t type, const std::string &key, const void *data, size_t size) {
+    if (!file)
+        return false;
+
+    const RecordHeader record{ type, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(size) };
+    const bool written = fwrite(&record, sizeof(record), 1, file) == 1
+        && fwrite(key.data(), 1, key.size(), file) == key.size()
+        && fwrite(data, 1, size, file) == size;
+    fflush(file);
+
+    if (!written)
+        LOG_ERROR("Failed to write to the shader cache archive");
+    return written;
+}
+
+void ShaderArchive::add_shader(const std::string &key, const void *data, size_t size) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    const Entry *existing = find_shader(key);
+    if (existing && existing->size == size && memcmp(existing->data, data, size) == 0)
+        return;
+
+    if (!append_record(RECORD_SHADER, key, data, size))
+        return;
+
+    auto copy = std::make_unique<uint8_t[]>(size);
+    memcpy(copy.get(), data, size);
+    shaders[key] = { copy.get(), size };
+    appended_data.push_back(std::move(copy));
+}
+
+std::vector<ShadersHash> ShaderArchive::get_programs() const {
+    const std::lock_guard<std::mutex> guard(mutex);
+    std::vector<ShadersHash> result;
+    result.reserve(programs.size());
+    for (const auto &[frag, vert] : programs)
+        result.push_back({ frag, vert });
+
+    return result;
+}
+
+bool ShaderArchive::add_program(const ShadersHash &hash) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    const ProgramKey program(hash.frag, hash.vert);
+    if (!programs_set.insert(program).second)
+        return false;
+
+    programs.push_back(program);
+
+    uint8_t data[sizeof(Sha256Hash) * 2];
+    memcpy(data, hash.frag.data(), sizeof(Sha256Hash));
+    memcpy(data + sizeof(Sha256Hash), hash.vert.data(), sizeof(Sha256Hash));
+    append_record(RECORD_PROGRAM, "", data, sizeof(data));
+
+    return true;
+}
+
+} // namespace renderer
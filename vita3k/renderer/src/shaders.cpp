@@ -23,118 +23,100 @@
 #include <renderer/state.h>
 #include <renderer/types.h>
 #include <shader/spirv_recompiler.h>
+#include <threads/thread_pool.h>
 #include <util/fs.h>
 #include <util/log.h>
 
+#include <atomic>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace renderer {
 
 bool get_shaders_cache_hashs(State &renderer) {
-    const std::string hash_file_name = fmt::format("hashs-{}.dat", (renderer.current_backend == Backend::OpenGL) ? "gl" : "vk");
+    const char *backend_name = (renderer.current_backend == Backend::OpenGL) ? "gl" : "vk";
+    renderer.shaders_cache_hashs.clear();
 
-    fs::ifstream shaders_hashs(renderer.shaders_path / hash_file_name, std::ios::in | std::ios::binary);
-    if (!shaders_hashs.is_open())
+    // caches made before the shader archive, with one file per shader
+    if (fs::exists(renderer.shaders_path / fmt::format("hashs-{}.dat", backend_name))) {
+        LOG_INFO("Removing shader cache from an older version, it will be recreated.");
+        fs::remove_all(renderer.shaders_path);
+        fs::remove_all(renderer.shaders_log_path);
+    }
+
+    fs::create_directories(renderer.shaders_path);
+    // Each backend has its own archive: the header holds the features of the backend the shaders were generated with
+    // (a shared archive would be thrown away on every backend switch), and a program record of a backend is not a
+    // program of the other one (Vulkan records single shaders, which the OpenGL backend can't link alone).
+    const fs::path archive_path = renderer.shaders_path / fmt::format("shader-cache-{}.bin", backend_name);
+    if (!renderer.shader_archive.open(archive_path, shader::CURRENT_VERSION, renderer.get_features_mask()))
         return false;
 
-    renderer.shaders_cache_hashs.clear();
-    // Read size of hashes list
-    size_t size;
-    shaders_hashs.read((char *)&size, sizeof(size));
-
-    // Check version of cache and device id
-    uint32_t versionInFile;
-    shaders_hashs.read((char *)&versionInFile, sizeof(uint32_t));
-    uint32_t features_mask;
-    shaders_hashs.read((char *)&features_mask, sizeof(uint32_t));
-    if (versionInFile != shader::CURRENT_VERSION || features_mask != renderer.get_features_mask()) {
-        shaders_hashs.close();
+    if (renderer.shader_archive.was_outdated()) {
+        // the pipeline cache and the logs are outdated too
+        renderer.shader_archive.close();
         fs::remove_all(renderer.shaders_path);
         fs::remove_all(renderer.shaders_log_path);
-        if (versionInFile != shader::CURRENT_VERSION)
-            LOG_WARN("Current version of cache: {}, is outdated, recreate it.", versionInFile);
-        else
-            LOG_WARN("Incompatible GPU features enabled, recreating shader cache");
+        LOG_WARN("Shader cache is outdated or was made with other GPU features, recreate it.");
+        fs::create_directories(renderer.shaders_path);
+        renderer.shader_archive.open(archive_path, shader::CURRENT_VERSION, renderer.get_features_mask());
         return false;
     }
 
+    renderer.shaders_cache_hashs = renderer.shader_archive.get_programs();
+    if (renderer.shaders_cache_hashs.empty())
+        return false;
+
     if (renderer.current_backend == Backend::Vulkan) {
         // Read the pipeline cache
         dynamic_cast<vulkan::VKState &>(renderer).pipeline_cache.read_pipeline_cache();
     }
 
-    // Read Hashs info value
-    for (size_t a = 0; a < size; a++) {
-        auto read = [&shaders_hashs]() {
-            Sha256Hash hash;
-
-            shaders_hashs.read(reinterpret_cast<char *>(hash.data()), sizeof(Sha256Hash));
-
-            return hash;
-        };
-
-        ShadersHash hash;
-        hash.frag = read();
-        hash.vert = read();
-
-        renderer.shaders_cache_hashs.push_back({ hash.frag, hash.vert });
-    }
-
-    shaders_hashs.close();
-
-    return !renderer.shaders_cache_hashs.empty();
+    return true;
 }
 
-void save_shaders_cache_hashs(State &renderer, std::vector<ShadersHash> &shaders_cache_hashs) {
-    fs::create_directories(renderer.shaders_path);
-    std::string hash_file_name = fmt::format("hashs-{}.dat", (renderer.current_backend == Backend::OpenGL) ? "gl" : "vk");
-    fs::ofstream shaders_hashs(renderer.shaders_path / hash_file_name, std::ios::out | std::ios::binary);
-
-    if (shaders_hashs.is_open()) {
-        // Write Size of shaders cache hashes list
-        const auto size = shaders_cache_hashs.size();
-        shaders_hashs.write((const char *)&size, sizeof(size));
-
-        // Write version of cache
-        const uint32_t versionInFile = shader::CURRENT_VERSION;
-        shaders_hashs.write((const char *)&versionInFile, sizeof(uint32_t));
-        const uint32_t features_mask = renderer.get_features_mask();
-        shaders_hashs.write((const char *)&features_mask, sizeof(uint32_t));
-
-        // Write shader hash list
-        for (const auto &hash : shaders_cache_hashs) {
-            auto write = [&shaders_hashs](const Sha256Hash &hash) {
-                shaders_hashs.write(reinterpret_cast<const char *>(hash.data()), sizeof(Sha256Hash));
-            };
-
-            write(hash.frag);
-            write(hash.vert);
+void precompile_shaders(State &renderer, const std::function<bool()> &on_progress) {
+    const std::vector<ShadersHash> &hashes = renderer.shaders_cache_hashs;
+    renderer.programs_count_pre_compiled = 0;
+    renderer.programs_pre_compile_start = std::chrono::steady_clock::now();
+
+    if (!renderer.can_precompile_in_parallel()) {
+        // compile the programs on this thread by slices, between two progress updates
+        constexpr auto SLICE_DURATION = std::chrono::milliseconds(16);
+        size_t next = 0;
+        while (next < hashes.size() && on_progress()) {
+            const auto slice_end = std::chrono::steady_clock::now() + SLICE_DURATION;
+            while (next < hashes.size() && std::chrono::steady_clock::now() < slice_end)
+                renderer.precompile_shader(hashes[next++]);
         }
-        shaders_hashs.close();
-    }
-}
-
-static bool load_shader(const fs::path &shader_name, char **destination, std::size_t &size_read) {
-    fs::ifstream is(shader_name, fs::ifstream::binary);
-    if (!is) {
-        return false;
-    }
-
-    is.seekg(0, fs::ifstream::end);
-    size_read = is.tellg();
-    is.seekg(0);
-
-    if (size_read == 0) {
-        return false;
-    }
-
-    if (destination == nullptr) {
-        return true;
+    } else {
+        // The programs are compiled on the workers of the pool while this thread reports the progress
+        std::atomic<bool> stop = false;
+        const auto finished = std::make_shared<std::promise<void>>();
+        const std::future<void> future = finished->get_future();
+        ThreadPool &pool = get_shared_thread_pool();
+        pool.push([&, finished] {
+            pool.parallel_for(hashes.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end && !stop; i++)
+                    renderer.precompile_shader(hashes[i]);
+            });
+            finished->set_value();
+        });
+
+        while (future.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+            if (!on_progress()) {
+                stop = true;
+                break;
+            }
+        }
+        // the pool uses the renderer, it must be done before returning
+        future.wait();
     }
 
-    is.read(*destination, size_read);
-    return true;
+    LOG_INFO("Precompiled {} programs in {} ms", renderer.programs_count_pre_compiled.load(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - renderer.programs_pre_compile_start).count());
 }
 
 static Sha256Hash get_shader_hash(const SceGxmProgram &program) {
@@ -142,42 +124,24 @@ static Sha256Hash get_shader_hash(const SceGxmProgram &program) {
     return hash_bytes;
 }
 
-template <typename R>
-R load_shader_generic(const fs::path &shader_path) {
-    std::size_t read_size = 0;
-    R source;
-
-    if (load_shader(shader_path, nullptr, read_size)) {
-        source.resize((read_size + sizeof(typename R::value_type) - 1) / sizeof(typename R::value_type));
-
-        char *dest_pointer = reinterpret_cast<char *>(source.data());
-        load_shader(shader_path, &dest_pointer, read_size);
-    }
-
-    return source;
+std::string get_shader_archive_key(const std::string &shader_version, const std::string &hash_hex, const char *shader_type_str) {
+    return fmt::format("{}-{}.{}", shader_version, hash_hex, shader_type_str);
 }
 
-shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const fs::path &shader_cache_path, const fs::path &shaderlog_path, const char *shader_type_str, const std::string &shader_version, bool shader_cache) {
+shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, ShaderArchive &shader_archive, const fs::path &shaderlog_path, const char *shader_type_str, const std::string &shader_version, bool shader_cache) {
     // TODO: no need to recompute the hash here
     const std::string hash_text = hex_string(get_shader_hash(program));
-    // Set Shader Hash with Version
-    const std::string hash_hex_ver = fmt::format("{}-{}", shader_version, hash_text);
-    const auto get_shader_path = [&](const char *ext) {
-        return shader_cache_path / fmt::format("{}.{}", hash_hex_ver, ext);
-    };
-    const auto get_shaderlog_path = [&](const char *ext) {
-        return shaderlog_path / fmt::format("{}.{}", hash_hex_ver, ext);
-    };
+    const bool is_glsl = target == shader::Target::GLSLOpenGL;
+    const std::string archive_key = get_shader_archive_key(shader_version, hash_text, is_glsl ? shader_type_str : "spv");
 
-    const auto shader_path = get_shader_path(shader_type_str);
     if (shader_cache) {
-        if (target == shader::Target::GLSLOpenGL) {
-            std::string source = load_shader_generic<std::string>(shader_path);
+        if (is_glsl) {
+            std::string source = shader_archive.get_shader_glsl(archive_key);
             if (!source.empty()) {
                 return { source, std::vector<uint32_t>() };
             }
         } else {
-            std::vector<uint32_t> source = load_shader_generic<std::vector<uint32_t>>(get_shader_path("spv"));
+            std::vector<uint32_t> source = shader_archive.get_shader_spirv(archive_key);
             if (!source.empty())
                 return { "", source };
         }
@@ -187,18 +151,14 @@ shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmP
 
     fs::create_directories(shaderlog_path);
 
-    auto shader_log_path = get_shaderlog_path("gxp");
+    // Set Shader Hash with Version
+    auto shader_log_path = shaderlog_path / fmt::format("{}-{}.gxp", shader_version, hash_text);
 
     // Dump gxp binary
     fs_utils::dump_data(shader_log_path, &program, program.size);
     const auto write_data_with_ext = [&](const std::string &ext, const std::string &data) {
-        fs::path out_path;
-        if (ext == shader_type_str) {
-            out_path = shader_path;
-        } else {
-            out_path = shader_log_path;
-            out_path.replace_extension(ext);
-        }
+        fs::path out_path = shader_log_path;
+        out_path.replace_extension(ext);
         fs_utils::dump_data(out_path, data.c_str(), data.size());
         return true;
     };
@@ -206,18 +166,15 @@ shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmP
     shader::GeneratedShader source = shader::convert_gxp(program, hash_text, features, target, hints, maskupdate, false, write_data_with_ext);
 
     // Copy shader generate to shaders cache
-    const auto shaders_cache_path = fs::path(shader_cache_path);
-    fs::create_directories(shaders_cache_path);
-
-    if (target != shader::Target::GLSLOpenGL) {
-        const auto shader_dst_path = get_shader_path("spv");
-        fs_utils::dump_data(shader_dst_path, source.spirv.data(), sizeof(uint32_t) * source.spirv.size());
-    }
+    if (is_glsl)
+        shader_archive.add_shader(archive_key, source.glsl.data(), source.glsl.size());
+    else
+        shader_archive.add_shader(archive_key, source.spirv.data(), sizeof(uint32_t) * source.spirv.size());
 
     return source;
 }
 
-std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const fs::path &shader_cache_path, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache) {
+std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, ShaderArchive &shader_archive, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache) {
     SceGxmProgramType program_type = program.get_type();
 
     auto shader_type_to_str = [](SceGxmProgramType type) {
@@ -226,25 +183,17 @@ std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &f
 
     const char *shader_type_str = shader_type_to_str(program_type);
 
-    return load_shader_generic(shader::Target::GLSLOpenGL, program, features, hints, maskupdate, shader_cache_path, shader_log_path, shader_type_str, shader_version, shader_cache).glsl;
+    return load_shader_generic(shader::Target::GLSLOpenGL, program, features, hints, maskupdate, shader_archive, shader_log_path, shader_type_str, shader_version, shader_cache).glsl;
 }
 
-std::vector<uint32_t> load_spirv_shader(const SceGxmProgram &program, const FeatureState &features, bool is_vulkan, const shader::Hints &hints, bool maskupdate, const fs::path &shader_cache_path, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache) {
+std::vector<uint32_t> load_spirv_shader(const SceGxmProgram &program, const FeatureState &features, bool is_vulkan, const shader::Hints &hints, bool maskupdate, ShaderArchive &shader_archive, const fs::path &shader_log_path, const std::string &shader_version, bool shader_cache) {
     const shader::Target target = is_vulkan ? shader::Target::SpirVVulkan : shader::Target::SpirVOpenGL;
     auto shader_type_to_str = [](SceGxmProgramType type) {
         return (type == SceGxmProgramType::Vertex) ? "vert.spv.txt" : ((type == SceGxmProgramType::Fragment) ? "frag.spv.txt" : "unknown.spv.txt");
     };
     const char *shader_type_str = shader_type_to_str(program.get_type());
 
-    return load_shader_generic(target, program, features, hints, maskupdate, shader_cache_path, shader_log_path, shader_type_str, shader_version, shader_cache).spirv;
-}
-
-std::string pre_load_shader_glsl(const fs::path &shader_path) {
-    return load_shader_generic<std::string>(shader_path);
-}
-
-std::vector<uint32_t> pre_load_shader_spirv(const fs::path &shader_path) {
-    return load_shader_generic<std::vector<uint32_t>>(shader_path);
+    return load_shader_generic(target, program, features, hints, maskupdate, shader_archive, shader_log_path, shader_type_str, shader_version, shader_cache).spirv;
 }
 
 } // namespace renderer
@@ -35,6 +35,8 @@
 
 #include <config/state.h>
 
+#include <array>
+
 namespace renderer {
 COMMAND_SET_STATE(region_clip) {
     TRACY_FUNC_COMMANDS_SET_STATE(region_clip);
@@ -537,32 +539,36 @@ COMMAND(handle_set_state) {
     renderer::GXMState gxm_state_to_set = helper.pop<renderer::GXMState>();
     using StateChangeHandlerFunc = decltype(cmd_set_state_region_clip);
 
-    static const std::map<renderer::GXMState, StateChangeHandlerFunc *> handlers = {
-        { GXMState::RegionClip, cmd_set_state_region_clip },
-        { GXMState::Program, cmd_set_state_program },
-        { GXMState::Viewport, cmd_set_state_viewport },
-        { GXMState::DepthBias, cmd_set_state_depth_bias },
-        { GXMState::DepthFunc, cmd_set_state_depth_func },
-        { GXMState::DepthWriteEnable, cmd_set_state_depth_write_enable },
-        { GXMState::PolygonMode, cmd_set_state_polygon_mode },
-        { GXMState::PointLineWidth, cmd_set_state_point_line_width },
-        { GXMState::StencilFunc, cmd_set_state_stencil_func },
-        { GXMState::Texture, cmd_set_state_texture },
-        { GXMState::StencilRef, cmd_set_state_stencil_ref },
-        { GXMState::TwoSided, cmd_set_state_two_sided },
-        { GXMState::CullMode, cmd_set_state_cull_mode },
-        { GXMState::VertexStream, cmd_set_state_vertex_stream },
-        { GXMState::UniformBuffer, cmd_set_state_uniform_buffer },
-        { GXMState::FragmentProgramEnable, cmd_set_state_fragment_program_enable },
-        { GXMState::VisibilityBuffer, cmd_set_state_visibility_buffer },
-        { GXMState::VisibilityIndex, cmd_set_state_visibility_index }
-    };
-
-    auto result = handlers.find(gxm_state_to_set);
-
-    if (result != handlers.end()) {
+    static constexpr auto handlers = [] {
+        std::array<StateChangeHandlerFunc *, static_cast<std::size_t>(GXMState::TotalState)> handlers{};
+        const auto set = [&](GXMState state, StateChangeHandlerFunc *handler) {
+            handlers[static_cast<std::size_t>(state)] = handler;
+        };
+        set(GXMState::RegionClip, cmd_set_state_region_clip);
+        set(GXMState::Program, cmd_set_state_program);
+        set(GXMState::Viewport, cmd_set_state_viewport);
+        set(GXMState::DepthBias, cmd_set_state_depth_bias);
+        set(GXMState::DepthFunc, cmd_set_state_depth_func);
+        set(GXMState::DepthWriteEnable, cmd_set_state_depth_write_enable);
+        set(GXMState::PolygonMode, cmd_set_state_polygon_mode);
+        set(GXMState::PointLineWidth, cmd_set_state_point_line_width);
+        set(GXMState::StencilFunc, cmd_set_state_stencil_func);
+        set(GXMState::Texture, cmd_set_state_texture);
+        set(GXMState::StencilRef, cmd_set_state_stencil_ref);
+        set(GXMState::TwoSided, cmd_set_state_two_sided);
+        set(GXMState::CullMode, cmd_set_state_cull_mode);
+        set(GXMState::VertexStream, cmd_set_state_vertex_stream);
+        set(GXMState::UniformBuffer, cmd_set_state_uniform_buffer);
+        set(GXMState::FragmentProgramEnable, cmd_set_state_fragment_program_enable);
+        set(GXMState::VisibilityBuffer, cmd_set_state_visibility_buffer);
+        set(GXMState::VisibilityIndex, cmd_set_state_visibility_index);
+        return handlers;
+    }();
+
+    const auto state_index = static_cast<std::size_t>(gxm_state_to_set);
+    if (state_index < handlers.size() && handlers[state_index]) {
         // LOG_TRACE("State set: {}", (int)gxm_state_to_set);
-        result->second(renderer, mem, config, helper, render_context);
+        handlers[state_index](renderer, mem, config, helper, render_context);
     } else {
         LOG_ERROR("Unknown state set command {}", static_cast<uint16_t>(gxm_state_to_set));
     }
@@ -0,0 +1,771 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/*
+BC1-BC5 decompression.
+decompress_bc_image splits the texture in rows of blocks decoded by the shared thread pool. Each block
+is decoded directly at its place in the destination image: the endpoints are expanded into a small
+palette on the CPU, then the 16 texels are picked from the palette with a byte shuffle (SSSE3 or NEON).
+The implementation is chosen on the first call. decompress_bc_image_basic is the reference decoder.
+*/
+
+#include <renderer/functions.h>
+
+#include <threads/thread_pool.h>
+#include <util/instrset_detect.h>
+#include <util/log.h>
+
+#include <array>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#else
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((__target__("ssse3")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_SSSE3
+#include <intrin.h>
+#else
+#error "Compiler is not supported"
+#endif
+#endif
+
+namespace renderer::texture {
+
+// This BC decompression code is based on code from AMD GPUOpen's Compressonator
+
+/**
+ * \brief Decompresses one block of a BC1 texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc1(const uint8_t *block_storage, uint32_t *image) {
+    std::uint16_t n0 = static_cast<std::uint16_t>((block_storage[1] << 8) | block_storage[0]);
+    std::uint16_t n1 = static_cast<std::uint16_t>((block_storage[3] << 8) | block_storage[2]);
+
+    block_storage += 4;
+
+    std::uint8_t r0 = (n0 & 0xF800) >> 8;
+    std::uint8_t g0 = (n0 & 0x07E0) >> 3;
+    std::uint8_t b0 = (n0 & 0x001F) << 3;
+
+    std::uint8_t r1 = (n1 & 0xF800) >> 8;
+    std::uint8_t g1 = (n1 & 0x07E0) >> 3;
+    std::uint8_t b1 = (n1 & 0x001F) << 3;
+
+    r0 |= r0 >> 5;
+    r1 |= r1 >> 5;
+    g0 |= g0 >> 6;
+    g1 |= g1 >> 6;
+    b0 |= b0 >> 5;
+    b1 |= b1 >> 5;
+
+    std::uint32_t c0 = 0xFF000000 | (b0 << 16) | (g0 << 8) | r0;
+    std::uint32_t c1 = 0xFF000000 | (b1 << 16) | (g1 << 8) | r1;
+
+    if (n0 > n1) {
+        std::uint8_t r2 = static_cast<uint8_t>((2 * r0 + r1 + 1) / 3);
+        std::uint8_t r3 = static_cast<uint8_t>((2 * r1 + r0 + 1) / 3);
+        std::uint8_t g2 = static_cast<uint8_t>((2 * g0 + g1 + 1) / 3);
+        std::uint8_t g3 = static_cast<uint8_t>((2 * g1 + g0 + 1) / 3);
+        std::uint8_t b2 = static_cast<uint8_t>((2 * b0 + b1 + 1) / 3);
+        std::uint8_t b3 = static_cast<uint8_t>((2 * b1 + b0 + 1) / 3);
+
+        std::uint32_t c2 = 0xFF000000 | (b2 << 16) | (g2 << 8) | r2;
+        std::uint32_t c3 = 0xFF000000 | (b3 << 16) | (g3 << 8) | r3;
+
+        for (int i = 0; i < 16; ++i) {
+            int index = (block_storage[i / 4] >> (i % 4 * 2)) & 0x03;
+            switch (index) {
+            case 0:
+                image[i] = c0;
+                break;
+            case 1:
+                image[i] = c1;
+                break;
+            case 2:
+                image[i] = c2;
+                break;
+            case 3:
+                image[i] = c3;
+                break;
+            }
+        }
+    } else {
+        // Transparent decode
+        std::uint8_t r2 = static_cast<uint8_t>((r0 + r1) / 2);
+        std::uint8_t g2 = static_cast<uint8_t>((g0 + g1) / 2);
+        std::uint8_t b2 = static_cast<uint8_t>((b0 + b1) / 2);
+
+        std::uint32_t c2 = 0xFF000000 | (b2 << 16) | (g2 << 8) | r2;
+
+        for (int i = 0; i < 16; ++i) {
+            int index = (block_storage[i / 4] >> (i % 4 * 2)) & 0x03;
+            switch (index) {
+            case 0:
+                image[i] = c0;
+                break;
+            case 1:
+                image[i] = c1;
+                break;
+            case 2:
+                image[i] = c2;
+                break;
+            case 3:
+                image[i] = 0x00000000;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Decompresses one block of a alpha texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ * \param offset            offset to where data should be written.
+ * \param stride            stride between bytes to where data should be written.
+ **/
+static void decompress_block_alpha(const uint8_t *block_storage, uint8_t *image, const uint32_t offset, const uint32_t stride) {
+    uint8_t alpha[8];
+
+    alpha[0] = block_storage[0];
+    alpha[1] = block_storage[1];
+
+    if (alpha[0] > alpha[1]) {
+        // 8-alpha block:  derive the other six alphas.
+        // Bit code 000 = alpha_0, 001 = alpha_1, others are interpolated.
+        alpha[2] = static_cast<uint8_t>((6 * alpha[0] + 1 * alpha[1] + 3) / 7); // bit code 010
+        alpha[3] = static_cast<uint8_t>((5 * alpha[0] + 2 * alpha[1] + 3) / 7); // bit code 011
+        alpha[4] = static_cast<uint8_t>((4 * alpha[0] + 3 * alpha[1] + 3) / 7); // bit code 100
+        alpha[5] = static_cast<uint8_t>((3 * alpha[0] + 4 * alpha[1] + 3) / 7); // bit code 101
+        alpha[6] = static_cast<uint8_t>((2 * alpha[0] + 5 * alpha[1] + 3) / 7); // bit code 110
+        alpha[7] = static_cast<uint8_t>((1 * alpha[0] + 6 * alpha[1] + 3) / 7); // bit code 111
+    } else {
+        // 6-alpha block.
+        // Bit code 000 = alpha_0, 001 = alpha_1, others are interpolated.
+        alpha[2] = static_cast<uint8_t>((4 * alpha[0] + 1 * alpha[1] + 2) / 5); // Bit code 010
+        alpha[3] = static_cast<uint8_t>((3 * alpha[0] + 2 * alpha[1] + 2) / 5); // Bit code 011
+        alpha[4] = static_cast<uint8_t>((2 * alpha[0] + 3 * alpha[1] + 2) / 5); // Bit code 100
+        alpha[5] = static_cast<uint8_t>((1 * alpha[0] + 4 * alpha[1] + 2) / 5); // Bit code 101
+        alpha[6] = 0; // Bit code 110
+        alpha[7] = 255; // Bit code 111
+    }
+
+    image += offset;
+
+    image[stride * 0] = alpha[block_storage[2] & 0x07];
+    image[stride * 1] = alpha[(block_storage[2] >> 3) & 0x07];
+    image[stride * 2] = alpha[((block_storage[3] << 2) & 0x04) | ((block_storage[2] >> 6) & 0x03)];
+    image[stride * 3] = alpha[(block_storage[3] >> 1) & 0x07];
+    image[stride * 4] = alpha[(block_storage[3] >> 4) & 0x07];
+    image[stride * 5] = alpha[((block_storage[4] << 1) & 0x06) | ((block_storage[3] >> 7) & 0x01)];
+    image[stride * 6] = alpha[(block_storage[4] >> 2) & 0x07];
+    image[stride * 7] = alpha[(block_storage[4] >> 5) & 0x07];
+    image[stride * 8] = alpha[block_storage[5] & 0x07];
+    image[stride * 9] = alpha[(block_storage[5] >> 3) & 0x07];
+    image[stride * 10] = alpha[((block_storage[6] << 2) & 0x04) | ((block_storage[5] >> 6) & 0x03)];
+    image[stride * 11] = alpha[(block_storage[6] >> 1) & 0x07];
+    image[stride * 12] = alpha[(block_storage[6] >> 4) & 0x07];
+    image[stride * 13] = alpha[((block_storage[7] << 1) & 0x06) | ((block_storage[6] >> 7) & 0x01)];
+    image[stride * 14] = alpha[(block_storage[7] >> 2) & 0x07];
+    image[stride * 15] = alpha[(block_storage[7] >> 5) & 0x07];
+}
+
+/**
+ * \brief Decompresses one block of a signed alpha texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ * \param offset            offset to where data should be written.
+ * \param stride            stride between bytes to where data should be written.
+ **/
+static void decompress_block_alpha_signed(const uint8_t *block_storage, uint8_t *image, const uint32_t offset, const uint32_t stride) {
+    int8_t alpha[8];
+
+    alpha[0] = static_cast<int8_t>(block_storage[0]);
+    alpha[1] = static_cast<int8_t>(block_storage[1]);
+
+    if (alpha[0] > alpha[1]) {
+        // 8-alpha block:  derive the other six alphas.
+        // Bit code 000 = alpha_0, 001 = alpha_1, others are interpolated.
+        alpha[2] = static_cast<int8_t>((6 * alpha[0] + 1 * alpha[1] + 3) / 7); // bit code 010
+        alpha[3] = static_cast<int8_t>((5 * alpha[0] + 2 * alpha[1] + 3) / 7); // bit code 011
+        alpha[4] = static_cast<int8_t>((4 * alpha[0] + 3 * alpha[1] + 3) / 7); // bit code 100
+        alpha[5] = static_cast<int8_t>((3 * alpha[0] + 4 * alpha[1] + 3) / 7); // bit code 101
+        alpha[6] = static_cast<int8_t>((2 * alpha[0] + 5 * alpha[1] + 3) / 7); // bit code 110
+        alpha[7] = static_cast<int8_t>((1 * alpha[0] + 6 * alpha[1] + 3) / 7); // bit code 111
+    } else {
+        // 6-alpha block.
+        // Bit code 000 = alpha_0, 001 = alpha_1, others are interpolated.
+        alpha[2] = static_cast<int8_t>((4 * alpha[0] + 1 * alpha[1] + 2) / 5); // Bit code 010
+        alpha[3] = static_cast<int8_t>((3 * alpha[0] + 2 * alpha[1] + 2) / 5); // Bit code 011
+        alpha[4] = static_cast<int8_t>((2 * alpha[0] + 3 * alpha[1] + 2) / 5); // Bit code 100
+        alpha[5] = static_cast<int8_t>((1 * alpha[0] + 4 * alpha[1] + 2) / 5); // Bit code 101
+        alpha[6] = -128; // Bit code 110
+        alpha[7] = 127; // Bit code 111
+    }
+
+    image += offset;
+
+    image[stride * 0] = static_cast<uint8_t>(alpha[block_storage[2] & 0x07]);
+    image[stride * 1] = static_cast<uint8_t>(alpha[(block_storage[2] >> 3) & 0x07]);
+    image[stride * 2] = static_cast<uint8_t>(alpha[((block_storage[3] << 2) & 0x04) | ((block_storage[2] >> 6) & 0x03)]);
+    image[stride * 3] = static_cast<uint8_t>(alpha[(block_storage[3] >> 1) & 0x07]);
+    image[stride * 4] = static_cast<uint8_t>(alpha[(block_storage[3] >> 4) & 0x07]);
+    image[stride * 5] = static_cast<uint8_t>(alpha[((block_storage[4] << 1) & 0x06) | ((block_storage[3] >> 7) & 0x01)]);
+    image[stride * 6] = static_cast<uint8_t>(alpha[(block_storage[4] >> 2) & 0x07]);
+    image[stride * 7] = static_cast<uint8_t>(alpha[(block_storage[4] >> 5) & 0x07]);
+    image[stride * 8] = static_cast<uint8_t>(alpha[block_storage[5] & 0x07]);
+    image[stride * 9] = static_cast<uint8_t>(alpha[(block_storage[5] >> 3) & 0x07]);
+    image[stride * 10] = static_cast<uint8_t>(alpha[((block_storage[6] << 2) & 0x04) | ((block_storage[5] >> 6) & 0x03)]);
+    image[stride * 11] = static_cast<uint8_t>(alpha[(block_storage[6] >> 1) & 0x07]);
+    image[stride * 12] = static_cast<uint8_t>(alpha[(block_storage[6] >> 4) & 0x07]);
+    image[stride * 13] = static_cast<uint8_t>(alpha[((block_storage[7] << 1) & 0x06) | ((block_storage[6] >> 7) & 0x01)]);
+    image[stride * 14] = static_cast<uint8_t>(alpha[(block_storage[7] >> 2) & 0x07]);
+    image[stride * 15] = static_cast<uint8_t>(alpha[(block_storage[7] >> 5) & 0x07]);
+}
+
+/**
+ * \brief Decompresses one block of a BC2 texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc2(const uint8_t *block_storage, uint32_t *image) {
+    decompress_block_bc1(block_storage + 8, image);
+
+    for (int i = 0; i < 8; i++) {
+        image[2 * i] = (((block_storage[i] & 0x0F) | ((block_storage[i] & 0x0F) << 4)) << 24) | (image[2 * i] & 0x00FFFFFF);
+        image[2 * i + 1] = (((block_storage[i] & 0xF0) | ((block_storage[i] & 0xF0) >> 4)) << 24) | (image[2 * i + 1] & 0x00FFFFFF);
+    }
+}
+
+/**
+ * \brief Decompresses one block of a BC3 texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc3(const uint8_t *block_storage, uint32_t *image) {
+    decompress_block_bc1(block_storage + 8, image);
+    decompress_block_alpha(block_storage, reinterpret_cast<std::uint8_t *>(image), 3, 4);
+}
+
+/**
+ * \brief Decompresses one block of a BC4U texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc4u(const uint8_t *block_storage, uint8_t *image) {
+    for (int i = 0; i < 16; i++)
+        image[i] = 0x00;
+    decompress_block_alpha(block_storage, image, 0, 1);
+}
+
+/**
+ * \brief Decompresses one block of a BC4S texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc4s(const uint8_t *block_storage, uint8_t *image) {
+    for (int i = 0; i < 16; i++)
+        image[i] = 0x00;
+    decompress_block_alpha_signed(block_storage, image, 0, 1);
+}
+
+/**
+ * \brief Decompresses one block of a BC5U texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc5u(const uint8_t *block_storage, uint16_t *image) {
+    for (int i = 0; i < 16; i++)
+        image[i] = 0x0000;
+    decompress_block_alpha(block_storage, reinterpret_cast<uint8_t *>(image), 0, 2);
+    decompress_block_alpha(block_storage + 8, reinterpret_cast<uint8_t *>(image), 1, 2);
+}
+
+/**
+ * \brief Decompresses one block of a BC5S texture and stores the resulting pixels at the appropriate offset in 'image'.
+ *
+ * \param block_storage     pointer to the block to decompress.
+ * \param image             pointer to image where the decompressed pixel data should be stored.
+ **/
+static void decompress_block_bc5s(const uint8_t *block_storage, uint16_t *image) {
+    for (int i = 0; i < 16; i++)
+        image[i] = 0x0000;
+    decompress_block_alpha_signed(block_storage, reinterpret_cast<uint8_t *>(image), 0, 2);
+    decompress_block_alpha_signed(block_storage + 8, reinterpret_cast<uint8_t *>(image), 1, 2);
+}
+
+void decompress_bc_image_basic(uint32_t width, uint32_t height, const uint8_t *block_storage, uint32_t *image, const uint8_t format_id) {
+    const uint32_t block_count_x = (width + 3) / 4;
+    const uint32_t block_count_y = (height + 3) / 4;
+    const uint32_t block_size = (format_id != 1 && format_id != 4 && format_id != 5) ? 16 : 8;
+    const uint32_t line_size = block_count_x * 4;
+
+    auto decompress_bcn = [=, &block_storage]<typename T, typename F>(T _, F decompress_func) {
+        T temp_block_result[16] = {};
+
+        for (uint32_t j = 0; j < block_count_y; j++) {
+            for (uint32_t i = 0; i < block_count_x; i++) {
+                decompress_func(block_storage, temp_block_result);
+
+                const uint32_t offset = j * 4 * line_size + i * 4;
+                for (uint32_t delta = 0; delta < 16; delta++) {
+                    image[offset + (delta % 4) + ((delta / 4) * line_size)] = temp_block_result[delta];
+                }
+
+                block_storage += block_size;
+            }
+        }
+    };
+
+    switch (format_id) {
+    case 1:
+        decompress_bcn(uint32_t(), decompress_block_bc1);
+        break;
+
+    case 2:
+        decompress_bcn(uint32_t(), decompress_block_bc2);
+        break;
+
+    case 3:
+        decompress_bcn(uint32_t(), decompress_block_bc3);
+        break;
+
+    case 4:
+        decompress_bcn(uint8_t(), decompress_block_bc4u);
+        break;
+
+    case 5:
+        decompress_bcn(uint8_t(), decompress_block_bc4s);
+        break;
+
+    case 6:
+        decompress_bcn(uint16_t(), decompress_block_bc5u);
+        break;
+
+    case 7:
+        decompress_bcn(uint16_t(), decompress_block_bc5s);
+        break;
+    }
+}
+
+namespace {
+
+/**
+ * \brief Expands the two BC1 endpoints into the 4 colors a texel can pick, with the same rounding as decompress_block_bc1.
+ */
+void get_bc1_palette(const uint8_t *block_storage, uint32_t palette[4]) {
+    const uint16_t n0 = static_cast<uint16_t>((block_storage[1] << 8) | block_storage[0]);
+    const uint16_t n1 = static_cast<uint16_t>((block_storage[3] << 8) | block_storage[2]);
+
+    uint8_t r0 = (n0 & 0xF800) >> 8;
+    uint8_t g0 = (n0 & 0x07E0) >> 3;
+    uint8_t b0 = (n0 & 0x001F) << 3;
+
+    uint8_t r1 = (n1 & 0xF800) >> 8;
+    uint8_t g1 = (n1 & 0x07E0) >> 3;
+    uint8_t b1 = (n1 & 0x001F) << 3;
+
+    r0 |= r0 >> 5;
+    r1 |= r1 >> 5;
+    g0 |= g0 >> 6;
+    g1 |= g1 >> 6;
+    b0 |= b0 >> 5;
+    b1 |= b1 >> 5;
+
+    palette[0] = 0xFF000000 | (b0 << 16) | (g0 << 8) | r0;
+    palette[1] = 0xFF000000 | (b1 << 16) | (g1 << 8) | r1;
+
+    if (n0 > n1) {
+        const uint8_t r2 = static_cast<uint8_t>((2 * r0 + r1 + 1) / 3);
+        const uint8_t r3 = static_cast<uint8_t>((2 * r1 + r0 + 1) / 3);
+        const uint8_t g2 = static_cast<uint8_t>((2 * g0 + g1 + 1) / 3);
+        const uint8_t g3 = static_cast<uint8_t>((2 * g1 + g0 + 1) / 3);
+        const uint8_t b2 = static_cast<uint8_t>((2 * b0 + b1 + 1) / 3);
+        const uint8_t b3 = static_cast<uint8_t>((2 * b1 + b0 + 1) / 3);
+
+        palette[2] = 0xFF000000 | (b2 << 16) | (g2 << 8) | r2;
+        palette[3] = 0xFF000000 | (b3 << 16) | (g3 << 8) | r3;
+    } else {
+        // Transparent decode
+        const uint8_t r2 = static_cast<uint8_t>((r0 + r1) / 2);
+        const uint8_t g2 = static_cast<uint8_t>((g0 + g1) / 2);
+        const uint8_t b2 = static_cast<uint8_t>((b0 + b1) / 2);
+
+        palette[2] = 0xFF000000 | (b2 << 16) | (g2 << 8) | r2;
+        palette[3] = 0x00000000;
+    }
+}
+
+/**
+ * \brief Expands the two alpha endpoints of a BC3/BC4/BC5 block into the 8 values a texel can pick.
+ */
+void get_alpha_palette(const uint8_t *block_storage, uint8_t palette[8]) {
+    const uint8_t a0 = block_storage[0];
+    const uint8_t a1 = block_storage[1];
+
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+    } else {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void get_alpha_palette_signed(const uint8_t *block_storage, uint8_t palette[8]) {
+    const int8_t a0 = static_cast<int8_t>(block_storage[0]);
+    const int8_t a1 = static_cast<int8_t>(block_storage[1]);
+
+    palette[0] = static_cast<uint8_t>(a0);
+    palette[1] = static_cast<uint8_t>(a1);
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = static_cast<uint8_t>(static_cast<int8_t>(((7 - i) * a0 + i * a1 + 3) / 7));
+    } else {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = static_cast<uint8_t>(static_cast<int8_t>(((5 - i) * a0 + i * a1 + 2) / 5));
+        palette[6] = static_cast<uint8_t>(-128);
+        palette[7] = 127;
+    }
+}
+
+// the 16 3-bit alpha indices of a block, stored in 48 bits after the two endpoints
+void get_alpha_indices(const uint8_t *block_storage, uint8_t indices[16]) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= static_cast<uint64_t>(block_storage[2 + i]) << (8 * i);
+
+    for (int i = 0; i < 16; i++)
+        indices[i] = (bits >> (3 * i)) & 0x07;
+}
+
+// BC2 explicit alpha: 4 bits per texel
+void get_explicit_alpha(const uint8_t *block_storage, uint8_t alpha[16]) {
+    for (int i = 0; i < 8; i++) {
+        alpha[2 * i] = (block_storage[i] & 0x0F) * 0x11;
+        alpha[2 * i + 1] = (block_storage[i] >> 4) * 0x11;
+    }
+}
+
+// For each possible row of 4 2-bit color indices, the byte shuffle picking the 4 texels from the 16-byte palette
+struct ColorShuffleMasks {
+    alignas(16) uint8_t masks[256][16];
+};
+
+constexpr ColorShuffleMasks make_color_shuffle_masks() {
+    ColorShuffleMasks result{};
+    for (int row = 0; row < 256; row++) {
+        for (int texel = 0; texel < 4; texel++) {
+            const int index = (row >> (texel * 2)) & 0x03;
+            for (int byte = 0; byte < 4; byte++)
+                result.masks[row][texel * 4 + byte] = static_cast<uint8_t>(index * 4 + byte);
+        }
+    }
+
+    return result;
+}
+
+constexpr ColorShuffleMasks COLOR_SHUFFLE_MASKS = make_color_shuffle_masks();
+
+// Writes a 4x4 block of texels, dest_pitch is in texels
+struct BlockWriterScalar {
+    static void color(uint32_t *dest, size_t dest_pitch, const uint32_t palette[4], const uint8_t *indices) {
+        for (int y = 0; y < 4; y++) {
+            const uint8_t row = indices[y];
+            for (int x = 0; x < 4; x++)
+                dest[y * dest_pitch + x] = palette[(row >> (x * 2)) & 0x03];
+        }
+    }
+
+    static void color_alpha(uint32_t *dest, size_t dest_pitch, const uint32_t palette[4], const uint8_t *indices, const uint8_t alpha[16]) {
+        for (int y = 0; y < 4; y++) {
+            const uint8_t row = indices[y];
+            for (int x = 0; x < 4; x++)
+                dest[y * dest_pitch + x] = (palette[(row >> (x * 2)) & 0x03] & 0x00FFFFFF) | (static_cast<uint32_t>(alpha[y * 4 + x]) << 24);
+        }
+    }
+
+    static void lookup(uint8_t values[16], const uint8_t palette[8], const uint8_t indices[16]) {
+        for (int i = 0; i < 16; i++)
+            values[i] = palette[indices[i]];
+    }
+
+    static void r8(uint32_t *dest, size_t dest_pitch, const uint8_t r[16]) {
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+                dest[y * dest_pitch + x] = r[y * 4 + x];
+    }
+
+    static void r8g8(uint32_t *dest, size_t dest_pitch, const uint8_t r[16], const uint8_t g[16]) {
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+                dest[y * dest_pitch + x] = r[y * 4 + x] | (g[y * 4 + x] << 8);
+    }
+};
+
+#if defined(__aarch64__)
+struct BlockWriterNeon {
+    static void color(uint32_t *dest, size_t dest_pitch, const uint32_t palette[4], const uint8_t *indices) {
+        const uint8x16_t colors = vreinterpretq_u8_u32(vld1q_u32(palette));
+        for (int y = 0; y < 4; y++)
+            vst1q_u8(reinterpret_cast<uint8_t *>(dest + y * dest_pitch), vqtbl1q_u8(colors, vld1q_u8(COLOR_SHUFFLE_MASKS.masks[indices[y]])));
+    }
+
+    static void color_alpha(uint32_t *dest, size_t dest_pitch, const uint32_t palette[4], const uint8_t *indices, const uint8_t alpha[16]) {
+        const uint8x16_t colors = vreinterpretq_u8_u32(vld1q_u32(palette));
+        const uint8x16_t alphas = vld1q_u8(alpha);
+        const uint16x8_t alphas_low = vmovl_u8(vget_low_u8(alphas));
+        const uint16x8_t alphas_high = vmovl_u8(vget_high_u8(alphas));
+        // texel alpha values of each row, moved to the top byte
+        const uint32x4_t row_alphas[4] = {
+            vshlq_n_u32(vmovl_u16(vget_low_u16(alphas_low)), 24),
+            vshlq_n_u32(vmovl_u16(vget_high_u16(alphas_low)), 24),
+            vshlq_n_u32(vmovl_u16(vget_low_u16(alphas_high)), 24),
+            vshlq_n_u32(vmovl_u16(vget_high_u16(alphas_high)), 24),
+        };
+        const uint32x4_t rgb_mask = vdupq_n_u32(0x00FFFFFF);
+        for (int y = 0; y < 4; y++) {
+            const uint32x4_t rgb = vreinterpretq_u32_u8(vqtbl1q_u8(colors, vld1q_u8(COLOR_SHUFFLE_MASKS.masks[indices[y]])));
+            vst1q_u32(dest + y * dest_pitch, vorrq_u32(vandq_u32(rgb, rgb_mask), row_alphas[y]));
+        }
+    }
+
+    static void lookup(uint8_t values[16], const uint8_t palette[8], const uint8_t indices[16]) {
+        const uint8x16_t table = vcombine_u8(vld1_u8(palette), vdup_n_u8(0));
+        vst1q_u8(values, vqtbl1q_u8(table, vld1q_u8(indices)));
+    }
+
+    static void r8(uint32_t *dest, size_t dest_pitch, const uint8_t r[16]) {
+        const uint8x16_t values = vld1q_u8(r);
+        const uint16x8_t low = vmovl_u8(vget_low_u8(values));
+        const uint16x8_t high = vmovl_u8(vget_high_u8(values));
+        vst1q_u32(dest, vmovl_u16(vget_low_u16(low)));
+        vst1q_u32(dest + dest_pitch, vmovl_u16(vget_high_u16(low)));
+        vst1q_u32(dest + 2 * dest_pitch, vmovl_u16(vget_low_u16(high)));
+        vst1q_u32(dest + 3 * dest_pitch, vmovl_u16(vget_high_u16(high)));
+    }
+
+    static void r8g8(uint32_t *dest, size_t dest_pitch, const uint8_t r[16], const uint8_t g[16]) {
+        const uint8x16_t red = vld1q_u8(r);
+        const uint8x16_t green = vld1q_u8(g);
+        const uint16x8_t low = vreinterpretq_u16_u8(vzip1q_u8(red, green));
+        const uint16x8_t high = vreinterpretq_u16_u8(vzip2q_u8(red, green));
+        vst1q_u32(dest, vmovl_u16(vget_low_u16(low)));
+        vst1q_u32(dest + dest_pitch, vmovl_u16(vget_high_u16(low)));
+        vst1q_u32(dest + 2 * dest_pitch, vmovl_u16(vget_low_u16(high)));
+        vst1q_u32(dest + 3 * dest_pitch, vmovl_u16(vget_high_u16(high)));
+    }
+};
+#else
+struct BlockWriterSsse3 {
+    static void TARGET_SSSE3 color(uint32_t *dest, size_t dest_pitch, const uint32_t palette[4], const uint8_t *indices) {
+        const __m128i colors = _mm_loadu_si128(reinterpret_cast<const __m128i *>(palette));
+        for (int y = 0; y < 4; y++) {
+            const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(COLOR_SHUFFLE_MASKS.masks[indices[y]]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + y * dest_pitch), _mm_shuffle_epi8(colors, mask));
+        }
+    }
+
+    static void TARGET_SSSE3 color_alpha(uint32_t *dest, size_t dest_pitch, const uint32_t palette[4], const uint8_t *indices, const uint8_t alpha[16]) {
+        const __m128i colors = _mm_loadu_si128(reinterpret_cast<const __m128i *>(palette));
+        const __m128i alphas = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha));
+        const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+        for (int y = 0; y < 4; y++) {
+            const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(COLOR_SHUFFLE_MASKS.masks[indices[y]]));
+            const __m128i rgb = _mm_and_si128(_mm_shuffle_epi8(colors, mask), rgb_mask);
+            // move the 4 alpha values of the row to the top byte of each texel
+            const char a = static_cast<char>(y * 4);
+            const __m128i alpha_mask = _mm_setr_epi8(-1, -1, -1, a, -1, -1, -1, a + 1, -1, -1, -1, a + 2, -1, -1, -1, a + 3);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + y * dest_pitch), _mm_or_si128(rgb, _mm_shuffle_epi8(alphas, alpha_mask)));
+        }
+    }
+
+    static void TARGET_SSSE3 lookup(uint8_t values[16], const uint8_t palette[8], const uint8_t indices[16]) {
+        const __m128i table = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(palette));
+        const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values), _mm_shuffle_epi8(table, shuffle));
+    }
+
+    static void r8(uint32_t *dest, size_t dest_pitch, const uint8_t r[16]) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r));
+        const __m128i low = _mm_unpacklo_epi8(values, zero);
+        const __m128i high = _mm_unpackhi_epi8(values, zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + dest_pitch), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 2 * dest_pitch), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 3 * dest_pitch), _mm_unpackhi_epi16(high, zero));
+    }
+
+    static void r8g8(uint32_t *dest, size_t dest_pitch, const uint8_t r[16], const uint8_t g[16]) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i red = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r));
+        const __m128i green = _mm_loadu_si128(reinterpret_cast<const __m128i *>(g));
+        const __m128i low = _mm_unpacklo_epi8(red, green);
+        const __m128i high = _mm_unpackhi_epi8(red, green);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + dest_pitch), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 2 * dest_pitch), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 3 * dest_pitch), _mm_unpackhi_epi16(high, zero));
+    }
+};
+#endif
+
+template <typename Writer>
+struct BlockDecoder {
+    static void bc1(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint32_t palette[4];
+        get_bc1_palette(block_storage, palette);
+        Writer::color(dest, dest_pitch, palette, block_storage + 4);
+    }
+
+    static void bc2(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint32_t palette[4];
+        uint8_t alpha[16];
+        get_bc1_palette(block_storage + 8, palette);
+        get_explicit_alpha(block_storage, alpha);
+        Writer::color_alpha(dest, dest_pitch, palette, block_storage + 12, alpha);
+    }
+
+    static void bc3(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint32_t palette[4];
+        uint8_t alpha[16];
+        get_bc1_palette(block_storage + 8, palette);
+        decode_alpha(block_storage, alpha, get_alpha_palette);
+        Writer::color_alpha(dest, dest_pitch, palette, block_storage + 12, alpha);
+    }
+
+    static void bc4u(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint8_t red[16];
+        decode_alpha(block_storage, red, get_alpha_palette);
+        Writer::r8(dest, dest_pitch, red);
+    }
+
+    static void bc4s(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint8_t red[16];
+        decode_alpha(block_storage, red, get_alpha_palette_signed);
+        Writer::r8(dest, dest_pitch, red);
+    }
+
+    static void bc5u(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint8_t red[16];
+        uint8_t green[16];
+        decode_alpha(block_storage, red, get_alpha_palette);
+        decode_alpha(block_storage + 8, green, get_alpha_palette);
+        Writer::r8g8(dest, dest_pitch, red, green);
+    }
+
+    static void bc5s(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch) {
+        uint8_t red[16];
+        uint8_t green[16];
+        decode_alpha(block_storage, red, get_alpha_palette_signed);
+        decode_alpha(block_storage + 8, green, get_alpha_palette_signed);
+        Writer::r8g8(dest, dest_pitch, red, green);
+    }
+
+private:
+    template <typename GetPalette>
+    static void decode_alpha(const uint8_t *block_storage, uint8_t values[16], GetPalette get_palette) {
+        uint8_t palette[8];
+        uint8_t indices[16];
+        get_palette(block_storage, palette);
+        get_alpha_indices(block_storage, indices);
+        Writer::lookup(values, palette, indices);
+    }
+};
+
+typedef void (*BlockDecodeFunc)(const uint8_t *block_storage, uint32_t *dest, size_t dest_pitch);
+
+// indexed by format id
+struct BlockDecodeFuncs {
+    BlockDecodeFunc funcs[8] = {};
+
+    template <typename Writer>
+    void set() {
+        funcs[1] = BlockDecoder<Writer>::bc1;
+        funcs[2] = BlockDecoder<Writer>::bc2;
+        funcs[3] = BlockDecoder<Writer>::bc3;
+        funcs[4] = BlockDecoder<Writer>::bc4u;
+        funcs[5] = BlockDecoder<Writer>::bc4s;
+        funcs[6] = BlockDecoder<Writer>::bc5u;
+        funcs[7] = BlockDecoder<Writer>::bc5s;
+    }
+
+    BlockDecodeFuncs() {
+#if defined(__aarch64__)
+        set<BlockWriterNeon>();
+        LOG_INFO("Using NEON BCn texture decoding");
+#else
+        if (util::instrset::instrset_detect() >= util::instrset::instrset_SSSE3) {
+            set<BlockWriterSsse3>();
+            LOG_INFO("Using SSSE3 BCn texture decoding");
+        } else {
+            set<BlockWriterScalar>();
+        }
+#endif
+    }
+};
+
+// minimum number of blocks decoded by a thread pool task
+constexpr uint32_t MIN_BLOCKS_PER_TASK = 1024;
+
+} // namespace
+
+void decompress_bc_image(uint32_t width, uint32_t height, const uint8_t *block_storage, uint32_t *image, const uint8_t format_id) {
+    static const BlockDecodeFuncs block_decode_funcs;
+
+    if (format_id == 0 || format_id > 7)
+        return;
+
+    const BlockDecodeFunc decode_block = block_decode_funcs.funcs[format_id];
+    const uint32_t block_count_x = (width + 3) / 4;
+    const uint32_t block_count_y = (height + 3) / 4;
+    const uint32_t block_size = (format_id != 1 && format_id != 4 && format_id != 5) ? 16 : 8;
+    const size_t line_size = block_count_x * 4;
+
+    const auto decode_rows = [=](size_t row_begin, size_t row_end) {
+        for (size_t j = row_begin; j < row_end; j++) {
+            const uint8_t *block = block_storage + j * block_count_x * block_size;
+            uint32_t *dest = image + j * 4 * line_size;
+            for (uint32_t i = 0; i < block_count_x; i++) {
+                decode_block(block, dest + i * 4, line_size);
+                block += block_size;
+            }
+        }
+    };
+
+    const size_t min_rows_per_task = std::max<size_t>(1, MIN_BLOCKS_PER_TASK / std::max<uint32_t>(block_count_x, 1));
+    get_shared_thread_pool().parallel_for(block_count_y, min_rows_per_task, decode_rows);
+}
+
+} // namespace renderer::texture
@@ -27,6 +27,7 @@
 #include <util/log.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <numeric>
 #if defined(__x86_64__) && !defined(__APPLE__)
@@ -344,10 +345,9 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
         return;
     }
 
-    std::vector<uint8_t> texture_data_decompressed;
-    std::vector<uint8_t> texture_pixels_lineared;
-
     const void *pixels = nullptr;
+    // time spent converting the texture on the CPU
+    std::chrono::steady_clock::duration decode_time{};
 
     uint32_t pixels_per_stride = 0;
     uint32_t bpp = gxm::bits_per_pixel(base_format);
@@ -440,6 +440,8 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
         pixels_per_stride = align(pixels_per_stride, align_width);
         memory_height = align(memory_height, align_height);
 
+        const auto decode_start = std::chrono::steady_clock::now();
+
         // perform all needed conversions (formats not supported by modern GPUs)
         switch (base_format) {
         case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
@@ -549,6 +551,9 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
             pixels = texture_pixels_lineared.data();
         }
 
+        if (pixels != texture_data)
+            decode_time += std::chrono::steady_clock::now() - decode_start;
+
         upload_texture_impl(upload_format, width, height, mip_index, pixels, upload_type, pixels_per_stride);
         if (export_textures)
             export_texture_impl(upload_format, width, height, mip_index, pixels, upload_type, pixels_per_stride);
@@ -593,6 +598,34 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
             texture_data += total_source_so_far - source_unaligned_size;
         }
     }
+
+    if (decode_time.count() > 0)
+        add_decode_time(std::chrono::duration_cast<std::chrono::microseconds>(decode_time).count());
+}
+
+void TextureCache::rotate_decode_stats(std::chrono::steady_clock::time_point now) {
+    const auto elapsed = now - decode_stats_start;
+    if (elapsed < std::chrono::seconds(1))
+        return;
+
+    // nothing was decoded during the last second if we haven't been called for a while
+    decode_stats_last = elapsed < std::chrono::seconds(2) ? decode_stats_current : TextureDecodeStats{};
+    decode_stats_current = {};
+    decode_stats_start = now;
+}
+
+void TextureCache::add_decode_time(uint64_t decode_us) {
+    const std::lock_guard<std::mutex> guard(decode_stats_mutex);
+    rotate_decode_stats(std::chrono::steady_clock::now());
+    decode_stats_current.texture_count++;
+    decode_stats_current.total_us += decode_us;
+    decode_stats_current.max_us = std::max(decode_stats_current.max_us, decode_us);
+}
+
+TextureDecodeStats TextureCache::get_decode_stats() {
+    const std::lock_guard<std::mutex> guard(decode_stats_mutex);
+    rotate_decode_stats(std::chrono::steady_clock::now());
+    return decode_stats_last;
 }
 
 // remove everything related to the sampler state
@@ -659,7 +692,10 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         // This works under the assumption that once this big enough texture decided to modify. It will have to modify either all of its data,
         // or replace with an entire new texture.
         bool should_use_hash = true;
-        if (use_protect && info->texture_size >= mem.page_size * 4) {
+        if (use_protect && mem.track_writes) {
+            // writes are tracked without any access violation, so this does not apply
+            should_use_hash = false;
+        } else if (use_protect && info->texture_size >= mem.page_size * 4) {
             range_protect_begin = align(gxm_texture.data_addr << 2, mem.page_size);
             range_protect_end = align_down((gxm_texture.data_addr << 2) + info->texture_size, mem.page_size);
 
@@ -689,6 +725,8 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
                 info->hash = hash_texture_data(gxm_texture, info->texture_size, mem) ^ 1;
 
             upload = previous_hash != info->hash;
+        } else if (mem.track_writes) {
+            upload = get_write_generation(mem, gxm_texture.data_addr << 2, info->texture_size) > info->write_generation;
         } else {
             upload = info->dirty;
         }
@@ -740,12 +778,16 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         if (export_textures && !importing_texture)
             export_select(gxm_texture);
 
+        // any write done from now on must cause the texture to be uploaded again
+        if (!info->use_hash && mem.track_writes)
+            info->write_generation = next_write_generation(mem);
+
         if (importing_texture)
             import_upload_texture();
         else
             upload_texture(gxm_texture, mem);
 
-        if (!info->use_hash) {
+        if (!info->use_hash && !mem.track_writes) {
             info->dirty = false;
             add_protect(mem, range_protect_begin, range_protect_end - range_protect_begin, MemPerm::ReadOnly, [info, gxm_texture](Address, bool) {
                 if (memcmp(&info->texture, &gxm_texture, sizeof(SceGxmTexture)) == 0) {
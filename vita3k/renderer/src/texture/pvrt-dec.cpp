@@ -39,6 +39,7 @@
 #include <vector>
 
 #include <renderer/pvrt-dec.h>
+#include <threads/thread_pool.h>
 
 namespace pvr {
 enum {
@@ -741,48 +742,56 @@ static int pvrtcDecompress(uint8_t *pCompressedData, Pixel32 *pDecompressedData,
     int i32NumXWords = static_cast<int>(ui32Width / ui32WordWidth);
     int i32NumYWords = static_cast<int>(ui32Height / ui32WordHeight);
 
-    // Structs used for decompression
-    PVRTCWordIndices indices;
-    std::vector<Pixel32> pPixels(ui32WordWidth * ui32WordHeight);
-
-    // For each row of words
-    for (int wordY = -1; wordY < i32NumYWords - 1; wordY++) {
-        // for each column of words
-        for (int wordX = -1; wordX < i32NumXWords - 1; wordX++) {
-            indices.P[0] = wrapWordIndex(i32NumXWords, wordX);
-            indices.P[1] = wrapWordIndex(i32NumYWords, wordY);
-            indices.Q[0] = wrapWordIndex(i32NumXWords, wordX + 1);
-            indices.Q[1] = wrapWordIndex(i32NumYWords, wordY);
-            indices.R[0] = wrapWordIndex(i32NumXWords, wordX);
-            indices.R[1] = wrapWordIndex(i32NumYWords, wordY + 1);
-            indices.S[0] = wrapWordIndex(i32NumXWords, wordX + 1);
-            indices.S[1] = wrapWordIndex(i32NumYWords, wordY + 1);
-
-            // Work out the offsets into the twiddle structs, multiply by two as there are two members per word.
-            uint32_t WordOffsets[4] = {
-                TwiddleUV(i32NumXWords, i32NumYWords, indices.P[0], indices.P[1]) * 2,
-                TwiddleUV(i32NumXWords, i32NumYWords, indices.Q[0], indices.Q[1]) * 2,
-                TwiddleUV(i32NumXWords, i32NumYWords, indices.R[0], indices.R[1]) * 2,
-                TwiddleUV(i32NumXWords, i32NumYWords, indices.S[0], indices.S[1]) * 2,
-            };
-
-            // Access individual elements to fill out PVRTCWord
-            PVRTCWord P, Q, R, S;
-            P.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[0] + 1]);
-            P.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[0]]);
-            Q.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[1] + 1]);
-            Q.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[1]]);
-            R.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[2] + 1]);
-            R.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[2]]);
-            S.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[3] + 1]);
-            S.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[3]]);
-
-            // assemble 4 words into struct to get decompressed pixels from
-            pvrtcGetDecompressedPixels(P, Q, R, S, pPixels.data(), ui8Bpp, uiII);
-            mapDecompressedData(pOutData, ui32Width, pPixels.data(), indices, ui8Bpp);
-
-        } // for each word
-    } // for each row of words
+    // Each row of words writes the bottom half of its own pixel row and the top half of the next one, so rows can be
+    // decompressed concurrently. Row -1 is the wrapped last row.
+    const auto decompress_word_rows = [&](size_t row_begin, size_t row_end) {
+        // Structs used for decompression
+        PVRTCWordIndices indices;
+        Pixel32 pPixels[8 * 4];
+
+        // For each row of words
+        for (int wordY = static_cast<int>(row_begin) - 1; wordY < static_cast<int>(row_end) - 1; wordY++) {
+            // for each column of words
+            for (int wordX = -1; wordX < i32NumXWords - 1; wordX++) {
+                indices.P[0] = wrapWordIndex(i32NumXWords, wordX);
+                indices.P[1] = wrapWordIndex(i32NumYWords, wordY);
+                indices.Q[0] = wrapWordIndex(i32NumXWords, wordX + 1);
+                indices.Q[1] = wrapWordIndex(i32NumYWords, wordY);
+                indices.R[0] = wrapWordIndex(i32NumXWords, wordX);
+                indices.R[1] = wrapWordIndex(i32NumYWords, wordY + 1);
+                indices.S[0] = wrapWordIndex(i32NumXWords, wordX + 1);
+                indices.S[1] = wrapWordIndex(i32NumYWords, wordY + 1);
+
+                // Work out the offsets into the twiddle structs, multiply by two as there are two members per word.
+                uint32_t WordOffsets[4] = {
+                    TwiddleUV(i32NumXWords, i32NumYWords, indices.P[0], indices.P[1]) * 2,
+                    TwiddleUV(i32NumXWords, i32NumYWords, indices.Q[0], indices.Q[1]) * 2,
+                    TwiddleUV(i32NumXWords, i32NumYWords, indices.R[0], indices.R[1]) * 2,
+                    TwiddleUV(i32NumXWords, i32NumYWords, indices.S[0], indices.S[1]) * 2,
+                };
+
+                // Access individual elements to fill out PVRTCWord
+                PVRTCWord P, Q, R, S;
+                P.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[0] + 1]);
+                P.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[0]]);
+                Q.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[1] + 1]);
+                Q.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[1]]);
+                R.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[2] + 1]);
+                R.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[2]]);
+                S.u32ColorData = static_cast<uint32_t>(pWordMembers[WordOffsets[3] + 1]);
+                S.u32ModulationData = static_cast<uint32_t>(pWordMembers[WordOffsets[3]]);
+
+                // assemble 4 words into struct to get decompressed pixels from
+                pvrtcGetDecompressedPixels(P, Q, R, S, pPixels, ui8Bpp, uiII);
+                mapDecompressedData(pOutData, ui32Width, pPixels, indices, ui8Bpp);
+
+            } // for each word
+        } // for each row of words
+    };
+
+    // a task should decompress at least 256 words
+    const size_t min_rows_per_task = std::max(1, 256 / std::max(i32NumXWords, 1));
+    get_shared_thread_pool().parallel_for(i32NumYWords, min_rows_per_task, decompress_word_rows);
 
     // Return the data size
     return ui32Width * ui32Height / static_cast<uint32_t>(ui32WordWidth / 2);
@@ -0,0 +1,332 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/*
+Swizzled (Morton order) and tiled (32x32 texel tiles) to linear texture conversion.
+A swizzled texture is made of min(width, height) sized squares put one after the other, each square being
+in Morton order. Instead of decoding the position of each texel, we work on 4x4 blocks (16 consecutive texels
+in the source) and only decode the position of the blocks.
+The block kernels are specialized for each texel size, with SSE2/SSSE3 or NEON versions
+when it is worth it. The implementation is chosen on the first call.
+*/
+
+#include <renderer/functions.h>
+
+#include <util/instrset_detect.h>
+#include <util/log.h>
+
+#include <bit>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#else
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((__target__("ssse3")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_SSSE3
+#include <intrin.h>
+#else
+#error "Compiler is not supported"
+#endif
+#endif
+
+namespace renderer::texture {
+
+void swizzled_texture_to_linear_texture_basic(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    if (bits_per_pixel % 8 != 0) {
+        // Don't support yet
+        return;
+    }
+
+    uint8_t bytes_per_pixel = (bits_per_pixel + 7) >> 3;
+    uint32_t min = std::min(width, height);
+    uint32_t k = std::bit_width(min) - 1;
+
+    for (uint32_t i = 0; i < width * static_cast<uint32_t>(height); i++) {
+        uint32_t x = decode_morton2_x(i) & (min - 1);
+        uint32_t y = decode_morton2_y(i) & (min - 1);
+        uint32_t upper_bits = (i >> (2 * k)) << k;
+        if (width >= height) {
+            x |= upper_bits;
+        } else {
+            y |= upper_bits;
+        }
+
+        memcpy(dest + (y * width + x) * bytes_per_pixel, src + i * bytes_per_pixel, bytes_per_pixel);
+    }
+}
+
+void tiled_texture_to_linear_texture_basic(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    // 32x32 block is assembled to tiled.
+    if (bits_per_pixel % 8 != 0) {
+        // Don't support yet
+        return;
+    }
+
+    const uint32_t bpp = bits_per_pixel >> 3;
+    const uint32_t width_in_tiles = (width + 31) >> 5;
+
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            // Calculate texel address in tile
+            const uint32_t texel_offset_in_tile = (x & 0b11111) | ((y & 0b11111) << 5);
+            const uint32_t tile_address = (x >> 5) + width_in_tiles * (y >> 5);
+
+            const uint32_t offset = ((tile_address << 10) | (texel_offset_in_tile)) * bpp;
+
+            // Make scanline
+            memcpy(dest + ((y * width) + x) * bpp, src + offset, bpp);
+        }
+    }
+}
+
+namespace {
+
+// Position in a 4x4 block of the i-th texel in Morton order (y is the lowest bit)
+constexpr uint32_t block_texel_x(uint32_t i) {
+    return ((i >> 1) & 1) | ((i >> 2) & 2);
+}
+
+constexpr uint32_t block_texel_y(uint32_t i) {
+    return (i & 1) | ((i >> 1) & 2);
+}
+
+// Used for the texel sizes without a vectorized version, the copies have a constant size so they are still cheap
+template <uint32_t bpp>
+struct BlockGeneric {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        for (uint32_t i = 0; i < 16; i++)
+            memcpy(dest + block_texel_y(i) * dest_stride + block_texel_x(i) * bpp, src + i * bpp, bpp);
+    }
+};
+
+#if defined(__aarch64__)
+// NEON: unzipping the 2x2 blocks puts texels of the same row next to each other
+
+struct Block16Neon {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        const uint16x8_t ab = vld1q_u16(reinterpret_cast<const uint16_t *>(src));
+        const uint16x8_t cd = vld1q_u16(reinterpret_cast<const uint16_t *>(src + 16));
+        // even: a00 a10 b00 b10 c00 c10 d00 d10, odd: a01 a11 b01 b11 c01 c11 d01 d11
+        const uint16x8x2_t texels = vuzpq_u16(ab, cd);
+        // rows 0 and 1, then rows 2 and 3
+        const uint32x4x2_t rows = vuzpq_u32(vreinterpretq_u32_u16(texels.val[0]), vreinterpretq_u32_u16(texels.val[1]));
+        vst1_u32(reinterpret_cast<uint32_t *>(dest), vget_low_u32(rows.val[0]));
+        vst1_u32(reinterpret_cast<uint32_t *>(dest + dest_stride), vget_high_u32(rows.val[0]));
+        vst1_u32(reinterpret_cast<uint32_t *>(dest + 2 * dest_stride), vget_low_u32(rows.val[1]));
+        vst1_u32(reinterpret_cast<uint32_t *>(dest + 3 * dest_stride), vget_high_u32(rows.val[1]));
+    }
+};
+
+struct Block32Neon {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        const uint32_t *src32 = reinterpret_cast<const uint32_t *>(src);
+        const uint32x4x2_t top = vuzpq_u32(vld1q_u32(src32), vld1q_u32(src32 + 8));
+        const uint32x4x2_t bottom = vuzpq_u32(vld1q_u32(src32 + 4), vld1q_u32(src32 + 12));
+        vst1q_u32(reinterpret_cast<uint32_t *>(dest), top.val[0]);
+        vst1q_u32(reinterpret_cast<uint32_t *>(dest + dest_stride), top.val[1]);
+        vst1q_u32(reinterpret_cast<uint32_t *>(dest + 2 * dest_stride), bottom.val[0]);
+        vst1q_u32(reinterpret_cast<uint32_t *>(dest + 3 * dest_stride), bottom.val[1]);
+    }
+};
+
+struct Block64Neon {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        const uint64_t *src64 = reinterpret_cast<const uint64_t *>(src);
+        for (uint32_t block = 0; block < 4; block++) {
+            // each 2x2 block is x0y0 x0y1 x1y0 x1y1
+            const uint64x2_t left = vld1q_u64(src64 + 4 * block);
+            const uint64x2_t right = vld1q_u64(src64 + 4 * block + 2);
+            uint8_t *block_dest = dest + (block >> 1) * 16 + (block & 1) * 2 * dest_stride;
+            vst1q_u64(reinterpret_cast<uint64_t *>(block_dest), vcombine_u64(vget_low_u64(left), vget_low_u64(right)));
+            vst1q_u64(reinterpret_cast<uint64_t *>(block_dest + dest_stride), vcombine_u64(vget_high_u64(left), vget_high_u64(right)));
+        }
+    }
+};
+#else
+// SSE2 is part of x86-64, only the SSSE3 byte shuffle must be checked at runtime
+
+struct Block8Ssse3 {
+    static void TARGET_SSSE3 copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        const __m128i rows_mask = _mm_setr_epi8(0, 2, 8, 10, 1, 3, 9, 11, 4, 6, 12, 14, 5, 7, 13, 15);
+        const __m128i rows = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), rows_mask);
+        const uint32_t row0 = _mm_cvtsi128_si32(rows);
+        const uint32_t row1 = _mm_cvtsi128_si32(_mm_srli_si128(rows, 4));
+        const uint32_t row2 = _mm_cvtsi128_si32(_mm_srli_si128(rows, 8));
+        const uint32_t row3 = _mm_cvtsi128_si32(_mm_srli_si128(rows, 12));
+        memcpy(dest, &row0, 4);
+        memcpy(dest + dest_stride, &row1, 4);
+        memcpy(dest + 2 * dest_stride, &row2, 4);
+        memcpy(dest + 3 * dest_stride, &row3, 4);
+    }
+};
+
+struct Block16Sse2 {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        // a00 a01 a10 a11 b00 b01 b10 b11 -> a00 a10 a01 a11 b00 b10 b01 b11
+        const auto shuffle = [](__m128i v) {
+            return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+        };
+        const __m128i ab = shuffle(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+        const __m128i cd = shuffle(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16)));
+        const __m128i rows01 = _mm_unpacklo_epi32(ab, cd);
+        const __m128i rows23 = _mm_unpackhi_epi32(ab, cd);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dest), rows01);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + dest_stride), _mm_srli_si128(rows01, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + 2 * dest_stride), rows23);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + 3 * dest_stride), _mm_srli_si128(rows23, 8));
+    }
+};
+
+struct Block32Sse2 {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        // x0y0 x0y1 x1y0 x1y1 -> x0y0 x1y0 x0y1 x1y1
+        const auto load = [&](int block) {
+            return _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src) + block), _MM_SHUFFLE(3, 1, 2, 0));
+        };
+        const __m128i a = load(0);
+        const __m128i b = load(1);
+        const __m128i c = load(2);
+        const __m128i d = load(3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_unpacklo_epi64(a, c));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + dest_stride), _mm_unpackhi_epi64(a, c));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 2 * dest_stride), _mm_unpacklo_epi64(b, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 3 * dest_stride), _mm_unpackhi_epi64(b, d));
+    }
+};
+
+struct Block64Sse2 {
+    static void copy(uint8_t *dest, size_t dest_stride, const uint8_t *src) {
+        const __m128i *src128 = reinterpret_cast<const __m128i *>(src);
+        for (uint32_t block = 0; block < 4; block++) {
+            // each 2x2 block is x0y0 x0y1 x1y0 x1y1
+            const __m128i left = _mm_loadu_si128(src128 + 2 * block);
+            const __m128i right = _mm_loadu_si128(src128 + 2 * block + 1);
+            uint8_t *block_dest = dest + (block >> 1) * 16 + (block & 1) * 2 * dest_stride;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block_dest), _mm_unpacklo_epi64(left, right));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block_dest + dest_stride), _mm_unpackhi_epi64(left, right));
+        }
+    }
+};
+#endif
+
+template <typename Block, uint32_t bpp>
+void swizzled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height) {
+    const uint32_t min = std::min(width, height);
+    const uint32_t square_count = std::max(width, height) / min;
+    const uint32_t blocks_per_square = (min * min) / 16;
+    const size_t dest_stride = static_cast<size_t>(width) * bpp;
+
+    for (uint32_t square = 0; square < square_count; square++) {
+        const uint32_t square_x = width >= height ? square * min : 0;
+        const uint32_t square_y = width >= height ? 0 : square * min;
+
+        for (uint32_t block = 0; block < blocks_per_square; block++) {
+            // texels of a 4x4 block share all the bits of their Morton code but the lowest 4
+            const uint32_t x = square_x + (decode_morton2_x(block) << 2);
+            const uint32_t y = square_y + (decode_morton2_y(block) << 2);
+            Block::copy(dest + y * dest_stride + x * bpp, dest_stride, src);
+            src += 16 * bpp;
+        }
+    }
+}
+
+#if !defined(__aarch64__)
+// the block kernel is only inlined if the loop has the same target
+void TARGET_SSSE3 swizzled_to_linear_8_ssse3(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height) {
+    swizzled_to_linear<Block8Ssse3, 1>(dest, src, width, height);
+}
+#endif
+
+typedef void (*SwizzledToLinearFunc)(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height);
+
+struct SwizzledToLinearFuncs {
+    SwizzledToLinearFunc funcs[17] = {};
+
+    SwizzledToLinearFuncs() {
+        funcs[1] = swizzled_to_linear<BlockGeneric<1>, 1>;
+        funcs[3] = swizzled_to_linear<BlockGeneric<3>, 3>;
+        funcs[6] = swizzled_to_linear<BlockGeneric<6>, 6>;
+        funcs[12] = swizzled_to_linear<BlockGeneric<12>, 12>;
+        funcs[16] = swizzled_to_linear<BlockGeneric<16>, 16>;
+#if defined(__aarch64__)
+        funcs[2] = swizzled_to_linear<Block16Neon, 2>;
+        funcs[4] = swizzled_to_linear<Block32Neon, 4>;
+        funcs[8] = swizzled_to_linear<Block64Neon, 8>;
+        LOG_INFO("Using NEON texture unswizzling");
+#else
+        funcs[2] = swizzled_to_linear<Block16Sse2, 2>;
+        funcs[4] = swizzled_to_linear<Block32Sse2, 4>;
+        funcs[8] = swizzled_to_linear<Block64Sse2, 8>;
+        if (util::instrset::instrset_detect() >= util::instrset::instrset_SSSE3) {
+            funcs[1] = swizzled_to_linear_8_ssse3;
+            LOG_INFO("Using SSSE3 texture unswizzling");
+        } else {
+            LOG_INFO("Using SSE2 texture unswizzling");
+        }
+#endif
+    }
+};
+
+} // namespace
+
+void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    static const SwizzledToLinearFuncs swizzled_to_linear_funcs;
+
+    const uint32_t bytes_per_pixel = bits_per_pixel >> 3;
+    // the block version needs power of two sizes with at least one 4x4 block
+    const bool can_use_blocks = bits_per_pixel % 8 == 0 && bytes_per_pixel <= 16
+        && std::has_single_bit(width) && std::has_single_bit(height) && std::min(width, height) >= 4;
+    const SwizzledToLinearFunc func = can_use_blocks ? swizzled_to_linear_funcs.funcs[bytes_per_pixel] : nullptr;
+    if (!func) {
+        swizzled_texture_to_linear_texture_basic(dest, src, width, height, bits_per_pixel);
+        return;
+    }
+
+    func(dest, src, width, height);
+}
+
+void tiled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    // 32x32 block is assembled to tiled.
+    if (bits_per_pixel % 8 != 0) {
+        // Don't support yet
+        return;
+    }
+
+    // each row of a tile is contiguous in the source, copy it at once
+    const uint32_t bpp = bits_per_pixel >> 3;
+    const uint32_t width_in_tiles = (width + 31) >> 5;
+    const size_t tile_row_size = 32 * bpp;
+    const size_t last_tile_row_size = (width - ((width_in_tiles - 1) << 5)) * bpp;
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t *dest_row = dest + static_cast<size_t>(y) * width * bpp;
+        const uint8_t *src_row = src + (((width_in_tiles * (y >> 5)) << 10) | ((y & 0b11111) << 5)) * bpp;
+        for (uint32_t tile = 0; tile + 1 < width_in_tiles; tile++) {
+            memcpy(dest_row, src_row, tile_row_size);
+            dest_row += tile_row_size;
+            src_row += 1024 * bpp;
+        }
+
+        if (width_in_tiles > 0)
+            memcpy(dest_row, src_row, last_tile_row_size);
+    }
+}
+
+} // namespace renderer::texture
@@ -17,6 +17,7 @@
 
 #include <gxm/functions.h>
 #include <gxm/types.h>
+#include <mem/functions.h>
 #include <renderer/commands.h>
 #include <renderer/driver_functions.h>
 #include <renderer/functions.h>
@@ -30,12 +31,29 @@
 // keywords.h must be after tracy.h for msvc compiler
 #include <util/keywords.h>
 
+#include <algorithm>
+#include <cstdlib>
+
 extern "C" {
 #include <libswscale/swscale.h>
 }
 
 namespace renderer {
 
+// The caches relying on the write tracking only see the writes done by the guest code, mark the lines of the image
+static void mark_image_written(MemState &mem, const SceGxmTransferImage &image) {
+    const uint32_t bytes_per_pixel = (gxm::get_bits_per_pixel(image.format) + 7) >> 3;
+    const uint32_t line_size = std::max<uint32_t>(std::abs(image.stride), (image.x + image.width) * bytes_per_pixel);
+    const uint32_t line_count = image.y + image.height;
+    if (line_count == 0)
+        return;
+
+    Address start = image.address.address();
+    if (image.stride < 0)
+        start -= (line_count - 1) * line_size;
+    mark_written(mem, start, line_count * line_size);
+}
+
 template <typename T, SceGxmTransferColorKeyMode mode, SceGxmTransferType src_type, SceGxmTransferType dst_type>
 static void perform_transfer_copy_impl(MemState &mem, const SceGxmTransferImage &src, const SceGxmTransferImage &dst, uint32_t key_value, uint32_t key_mask) {
     T *__restrict__ src_ptr = src.address.cast<T>().get(mem);
@@ -180,6 +198,7 @@ COMMAND(handle_transfer_copy) {
             perform_transfer_copy_src_type<std::array<uint64_t, 2>, SCE_GXM_TRANSFER_COLORKEY_NONE>(mem, src, dst, src_type, dst_type, colorKeyValue, colorKeyMask);
             break;
         }
+        mark_image_written(mem, dst);
 
         delete[] images;
     };
@@ -272,6 +291,8 @@ COMMAND(handle_transfer_downscale) {
                 break;
             }
         }
+        // the address already points to the first pixel
+        mark_written(mem, dst->address.address(), dst->height * std::abs(dst->stride));
 
         delete src;
         delete dst;
@@ -307,6 +328,8 @@ COMMAND(handle_transfer_fill) {
         }
     }
 
+    mark_image_written(mem, *dest);
+
     // TODO: handle case where dest is a cached surface
 
     delete dest;
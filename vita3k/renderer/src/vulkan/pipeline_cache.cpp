@@ -313,15 +313,7 @@ void PipelineCache::read_pipeline_cache() {
 }
 
 void PipelineCache::save_pipeline_cache() {
-    // first save the shader hashes
-    // do a copy for thread safety
-    std::vector<ShadersHash> shader_cache_copy;
-    {
-        std::lock_guard<std::mutex> guard(shaders_mutex);
-        shader_cache_copy = state.shaders_cache_hashs;
-    }
-    renderer::save_shaders_cache_hashs(state, shader_cache_copy);
-
+    // the shader hashes are already in the shader archive
     const std::vector<uint8_t> pipeline_data = state.device.getPipelineCacheData(pipeline_cache);
     if (pipeline_data.empty())
         // No pipeline was created
@@ -428,7 +420,7 @@ vk::PipelineShaderStageCreateInfo PipelineCache::retrieve_shader(const SceGxmPro
     LOG_INFO("Generating vulkan spv shader {}", hash_text);
     const std::string shader_version = fmt::format("vk{}", shader::CURRENT_VERSION);
 
-    shader::usse::SpirvCode source = load_spirv_shader(*program, state.features, true, hints, maskupdate, state.shaders_path, state.shaders_log_path, shader_version, true);
+    shader::usse::SpirvCode source = load_spirv_shader(*program, state.features, true, hints, maskupdate, state.shader_archive, state.shaders_log_path, shader_version, true);
 
     vk::ShaderModuleCreateInfo shader_info{
         .codeSize = sizeof(uint32_t) * source.size(),
@@ -436,16 +428,14 @@ vk::PipelineShaderStageCreateInfo PipelineCache::retrieve_shader(const SceGxmPro
     };
 
     *shader_module = state.device.createShaderModule(shader_info);
-    {
-        std::lock_guard<std::mutex> guard(shaders_mutex);
-        // Save shader cache hashes
-        // vertex and fragment shaders are not linked together so no need to associate them
-        Sha256Hash empty_hash{};
-        if (is_vertex) {
-            state.shaders_cache_hashs.push_back({ hash, empty_hash });
-        } else {
-            state.shaders_cache_hashs.push_back({ empty_hash, hash });
-        }
+
+    // Save shader cache hashes
+    // vertex and fragment shaders are not linked together so no need to associate them
+    const Sha256Hash empty_hash{};
+    if (is_vertex) {
+        state.shader_archive.add_program({ hash, empty_hash });
+    } else {
+        state.shader_archive.add_program({ empty_hash, hash });
     }
 
     vk::PipelineShaderStageCreateInfo shader_stage_info{
@@ -925,19 +915,20 @@ vk::Pipeline PipelineCache::retrieve_pipeline(VKContext &context, SceGxmPrimitiv
 
 vk::ShaderModule PipelineCache::precompile_shader(const Sha256Hash &hash, bool search_first) {
     if (search_first) {
-        // happens while loading the thread, no parallel access so no need for a mutex
+        // the programs are precompiled in parallel, the same shader can be shared by multiple of them
+        std::lock_guard<std::mutex> guard(shaders_mutex);
         auto it = shaders.find(hash);
         if (it != shaders.end())
             return it->second;
     }
 
-    if (!fs::exists(state.shaders_path) || fs::is_empty(state.shaders_path))
+    if (!state.shader_archive.is_open())
         return nullptr;
 
     Sha256Hash shader_hash;
     memcpy(shader_hash.data(), hash.data(), sizeof(Sha256Hash));
-    const std::string shader_file_name = fmt::format("vk{}-{}.spv", shader::CURRENT_VERSION, hex_string(shader_hash));
-    const std::vector<uint32_t> source = renderer::pre_load_shader_spirv(state.shaders_path / shader_file_name);
+    const std::string shader_key = renderer::get_shader_archive_key(fmt::format("vk{}", shader::CURRENT_VERSION), hex_string(shader_hash), "spv");
+    const std::vector<uint32_t> source = state.shader_archive.get_shader_spirv(shader_key);
 
     if (source.empty())
         return nullptr;
@@ -950,7 +941,17 @@ vk::ShaderModule PipelineCache::precompile_shader(const Sha256Hash &hash, bool s
     vk::ShaderModule shader = state.device.createShaderModule(shader_info);
     {
         std::lock_guard<std::mutex> guard(shaders_mutex);
-        shaders[hash] = shader;
+        if (search_first) {
+            const auto [it, inserted] = shaders.emplace(hash, shader);
+            if (!inserted) {
+                // another thread created it in the meantime
+                state.device.destroyShaderModule(shader);
+                return it->second;
+            }
+        } else {
+            // retrieve_shader already put a placeholder for this shader
+            shaders[hash] = shader;
+        }
     }
 
     return shader;
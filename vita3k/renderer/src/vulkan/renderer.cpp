@@ -969,8 +969,8 @@ void VKState::precompile_shader(const ShadersHash &hash) {
         pipeline_cache.precompile_shader(hash.frag);
     }
 
-    programs_count_pre_compiled++;
-    LOG_INFO("Program Compiled {}/{}", programs_count_pre_compiled, shaders_cache_hashs.size());
+    const uint32_t programs_count = ++programs_count_pre_compiled;
+    LOG_INFO("Program Compiled {}/{}", programs_count, shaders_cache_hashs.size());
 }
 
 void VKState::preclose_action() {
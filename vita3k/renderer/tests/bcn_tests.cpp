@@ -0,0 +1,88 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/functions.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace renderer::texture;
+
+namespace {
+
+constexpr const char *FORMAT_NAMES[] = { "", "BC1", "BC2", "BC3", "BC4U", "BC4S", "BC5U", "BC5S" };
+
+uint32_t block_size(uint8_t format_id) {
+    return (format_id != 1 && format_id != 4 && format_id != 5) ? 16 : 8;
+}
+
+std::vector<uint8_t> random_blocks(uint32_t width, uint32_t height, uint8_t format_id) {
+    const size_t block_count = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    std::vector<uint8_t> blocks(block_count * block_size(format_id));
+    std::mt19937 rng(width * 65536 + height * 16 + format_id);
+    for (auto &byte : blocks)
+        byte = static_cast<uint8_t>(rng());
+
+    return blocks;
+}
+
+size_t image_size(uint32_t width, uint32_t height) {
+    return static_cast<size_t>((width + 3) / 4) * 4 * ((height + 3) / 4) * 4;
+}
+
+} // namespace
+
+TEST(bcn, matches_reference) {
+    constexpr uint32_t SIZES[][2] = { { 4, 4 }, { 8, 4 }, { 16, 64 }, { 64, 16 }, { 12, 20 }, { 256, 256 }, { 960, 544 }, { 1024, 512 } };
+    for (uint8_t format_id = 1; format_id <= 7; format_id++) {
+        for (const auto &[width, height] : SIZES) {
+            const std::vector<uint8_t> blocks = random_blocks(width, height, format_id);
+            std::vector<uint32_t> image(image_size(width, height), 0xCDCDCDCD);
+            std::vector<uint32_t> expected(image.size(), 0xCDCDCDCD);
+
+            decompress_bc_image(width, height, blocks.data(), image.data(), format_id);
+            decompress_bc_image_basic(width, height, blocks.data(), expected.data(), format_id);
+            EXPECT_EQ(image, expected) << FORMAT_NAMES[format_id] << " " << width << "x" << height;
+        }
+    }
+}
+
+TEST(bcn_benchmark, against_basic) {
+    constexpr uint32_t SIZE = 1024;
+    constexpr int ITERATIONS = 10;
+    std::vector<uint32_t> image(image_size(SIZE, SIZE));
+    for (uint8_t format_id = 1; format_id <= 7; format_id++) {
+        const std::vector<uint8_t> blocks = random_blocks(SIZE, SIZE, format_id);
+
+        const auto basic_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            decompress_bc_image_basic(SIZE, SIZE, blocks.data(), image.data(), format_id);
+        const auto basic_end = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < ITERATIONS; i++)
+            decompress_bc_image(SIZE, SIZE, blocks.data(), image.data(), format_id);
+        const auto end = std::chrono::steady_clock::now();
+
+        std::cout << FORMAT_NAMES[format_id] << " " << SIZE << "x" << SIZE << ": "
+                  << std::chrono::duration<double, std::milli>(basic_end - basic_start).count() / ITERATIONS << " ms -> "
+                  << std::chrono::duration<double, std::milli>(end - basic_end).count() / ITERATIONS << " ms" << std::endl;
+    }
+}
@@ -0,0 +1,160 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Replays a synthetic command stream (mostly state sets and draws, like a real frame) without any backend.
+// The former pipeline (new/delete per command and std::map opcode lookup) is measured against
+// the current one (command pool released in bulk and opcode jump table).
+
+#include <renderer/commands.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <map>
+
+using namespace renderer;
+
+namespace {
+
+struct FakeRenderer {
+    uint64_t draws = 0;
+    uint64_t others = 0;
+    uint64_t data_sum = 0;
+};
+
+using FakeHandlerFunc = void(FakeRenderer &renderer, CommandHelper &helper);
+
+void fake_handle_draw(FakeRenderer &renderer, CommandHelper &helper) {
+    renderer.draws++;
+    renderer.data_sum += helper.pop<uint32_t>();
+}
+
+void fake_handle_other(FakeRenderer &renderer, CommandHelper &helper) {
+    renderer.others++;
+    renderer.data_sum += helper.pop<uint32_t>();
+}
+
+constexpr CommandOpcode FRAME_PATTERN[] = {
+    CommandOpcode::SetState, CommandOpcode::SetState, CommandOpcode::SetState, CommandOpcode::Draw,
+    CommandOpcode::SetState, CommandOpcode::Draw, CommandOpcode::SetState, CommandOpcode::SetState,
+    CommandOpcode::Draw, CommandOpcode::SignalNotification, CommandOpcode::Nop, CommandOpcode::Draw
+};
+
+constexpr int BATCH_SIZE = 512;
+constexpr int BATCH_COUNT = 4000;
+
+CommandList record_batch(const CommandAllocFunc &alloc_func, const CommandFreeFunc &free_func) {
+    CommandList list{};
+    for (uint32_t i = 0; i < BATCH_SIZE; i++) {
+        Command *cmd = make_command(alloc_func, free_func, FRAME_PATTERN[i % std::size(FRAME_PATTERN)], nullptr, i);
+        if (!list.first)
+            list.first = cmd;
+        else
+            list.last->next = cmd;
+        list.last = cmd;
+    }
+
+    return list;
+}
+
+template <typename Dispatch, typename Free>
+void replay_batch(FakeRenderer &renderer, CommandList &list, Dispatch dispatch, Free free_batch) {
+    Command *cmd = list.first;
+    Command *last_cmd = nullptr;
+    while (cmd) {
+        CommandHelper helper(cmd);
+        dispatch(cmd->opcode)(renderer, helper);
+        last_cmd = cmd;
+        cmd = cmd->next;
+        free_batch(last_cmd, false);
+    }
+    free_batch(list.first, true);
+}
+
+} // namespace
+
+TEST(command_benchmark, replay_stream) {
+    const std::map<CommandOpcode, FakeHandlerFunc *> map_handlers = {
+        { CommandOpcode::SetState, fake_handle_other },
+        { CommandOpcode::Draw, fake_handle_draw },
+        { CommandOpcode::SignalNotification, fake_handle_other },
+        { CommandOpcode::Nop, fake_handle_other },
+    };
+    std::array<FakeHandlerFunc *, COMMAND_OPCODE_COUNT> table_handlers{};
+    for (const auto &[opcode, handler] : map_handlers)
+        table_handlers[static_cast<size_t>(opcode)] = handler;
+
+    FakeRenderer old_renderer;
+    const CommandAllocFunc new_alloc = [] { return new Command; };
+    const CommandFreeFunc new_free = [](Command *cmd) { delete cmd; };
+    const auto old_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        CommandList list = record_batch(new_alloc, new_free);
+        replay_batch(
+            old_renderer, list, [&](CommandOpcode opcode) { return map_handlers.find(opcode)->second; },
+            [&](Command *cmd, bool end_of_batch) {
+                if (!end_of_batch)
+                    new_free(cmd);
+            });
+    }
+    const auto old_end = std::chrono::steady_clock::now();
+
+    FakeRenderer new_renderer;
+    CommandPool pool;
+    const CommandAllocFunc pool_alloc = [&] { return pool.allocate(); };
+    const CommandFreeFunc pool_free = [&](Command *cmd) { pool.release(cmd, cmd); };
+    const auto new_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        CommandList list = record_batch(pool_alloc, pool_free);
+        Command *last = list.last;
+        replay_batch(
+            new_renderer, list, [&](CommandOpcode opcode) { return table_handlers[static_cast<size_t>(opcode)]; },
+            [&](Command *first, bool end_of_batch) {
+                if (end_of_batch)
+                    pool.release(first, last);
+            });
+    }
+    const auto new_end = std::chrono::steady_clock::now();
+
+    const double command_count = static_cast<double>(BATCH_SIZE) * BATCH_COUNT;
+    std::cout << "new/delete + std::map: " << std::chrono::duration<double, std::nano>(old_end - old_start).count() / command_count << " ns/command" << std::endl;
+    std::cout << "pool + jump table: " << std::chrono::duration<double, std::nano>(new_end - new_start).count() / command_count << " ns/command" << std::endl;
+
+    ASSERT_EQ(old_renderer.draws, new_renderer.draws);
+    ASSERT_EQ(old_renderer.others, new_renderer.others);
+    ASSERT_EQ(old_renderer.data_sum, new_renderer.data_sum);
+    ASSERT_EQ(old_renderer.draws + old_renderer.others, static_cast<uint64_t>(command_count));
+}
+
+TEST(command_pool, recycles_released_commands) {
+    CommandPool pool;
+    Command *first = pool.allocate();
+    Command *second = pool.allocate();
+    first->next = second;
+    pool.release(first, second);
+
+    // the local free list is used up before released commands are picked up again
+    bool recycled = false;
+    for (int i = 0; i < 1024 && !recycled; i++) {
+        Command *cmd = pool.allocate();
+        recycled = cmd == first || cmd == second;
+        ASSERT_EQ(cmd->next, nullptr);
+    }
+    ASSERT_TRUE(recycled);
+}
@@ -0,0 +1,163 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/shader_archive.h>
+#include <renderer/types.h>
+
+#include <gtest/gtest.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+using namespace renderer;
+
+namespace {
+
+constexpr uint32_t VERSION = 42;
+constexpr uint32_t FEATURES = 0x5;
+
+struct shader_archive : public testing::Test {
+    fs::path path;
+
+    void SetUp() override {
+        path = fs::temp_directory_path() / fs::unique_path("vita3k-shader-archive-%%%%%%%%.bin");
+    }
+
+    void TearDown() override {
+        fs::remove(path);
+    }
+};
+
+Sha256Hash make_hash(uint8_t value) {
+    Sha256Hash hash{};
+    hash.fill(value);
+    return hash;
+}
+
+} // namespace
+
+TEST_F(shader_archive, shaders_and_programs_persist) {
+    const std::string glsl = "void main() {}";
+    const std::vector<uint32_t> spirv = { 0x07230203, 0x10000, 1, 2, 3 };
+    {
+        ShaderArchive archive;
+        ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+        archive.add_shader("v1-aa.frag", glsl.data(), glsl.size());
+        archive.add_shader("v1-bb.spv", spirv.data(), spirv.size() * sizeof(uint32_t));
+        ASSERT_TRUE(archive.add_program({ make_hash(1), make_hash(2) }));
+        ASSERT_FALSE(archive.add_program({ make_hash(1), make_hash(2) }));
+        ASSERT_TRUE(archive.add_program({ make_hash(3), make_hash(4) }));
+
+        // available without reopening the archive
+        ASSERT_EQ(archive.get_shader_glsl("v1-aa.frag"), glsl);
+    }
+
+    ShaderArchive archive;
+    ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+    ASSERT_FALSE(archive.was_outdated());
+    ASSERT_EQ(archive.get_shader_glsl("v1-aa.frag"), glsl);
+    ASSERT_EQ(archive.get_shader_spirv("v1-bb.spv"), spirv);
+    ASSERT_TRUE(archive.get_shader_glsl("v1-cc.frag").empty());
+
+    const std::vector<ShadersHash> programs = archive.get_programs();
+    ASSERT_EQ(programs.size(), 2);
+    ASSERT_EQ(programs[0].frag, make_hash(1));
+    ASSERT_EQ(programs[0].vert, make_hash(2));
+    ASSERT_EQ(programs[1].frag, make_hash(3));
+}
+
+TEST_F(shader_archive, regenerated_shader_replaces_previous_one) {
+    const std::string first = "first";
+    const std::string second = "second version";
+    {
+        ShaderArchive archive;
+        ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+        archive.add_shader("key", first.data(), first.size());
+        archive.add_shader("key", second.data(), second.size());
+        ASSERT_EQ(archive.get_shader_glsl("key"), second);
+    }
+
+    ShaderArchive archive;
+    ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+    ASSERT_EQ(archive.get_shader_glsl("key"), second);
+}
+
+TEST_F(shader_archive, outdated_archive_is_discarded) {
+    const std::string glsl = "void main() {}";
+    {
+        ShaderArchive archive;
+        ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+        archive.add_shader("key", glsl.data(), glsl.size());
+    }
+
+    ShaderArchive archive;
+    ASSERT_TRUE(archive.open(path, VERSION + 1, FEATURES));
+    ASSERT_TRUE(archive.was_outdated());
+    ASSERT_TRUE(archive.get_shader_glsl("key").empty());
+    archive.close();
+
+    ASSERT_TRUE(archive.open(path, VERSION + 1, FEATURES));
+    ASSERT_FALSE(archive.was_outdated());
+}
+
+TEST_F(shader_archive, truncated_record_is_dropped) {
+    const std::string glsl = "void main() {}";
+    {
+        ShaderArchive archive;
+        ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+        archive.add_shader("complete", glsl.data(), glsl.size());
+        archive.add_shader("truncated", glsl.data(), glsl.size());
+    }
+    fs::resize_file(path, fs::file_size(path) - 3);
+
+    {
+        ShaderArchive archive;
+        ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+        ASSERT_EQ(archive.get_shader_glsl("complete"), glsl);
+        ASSERT_TRUE(archive.get_shader_glsl("truncated").empty());
+        archive.add_shader("after", glsl.data(), glsl.size());
+    }
+
+    ShaderArchive archive;
+    ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+    ASSERT_EQ(archive.get_shader_glsl("complete"), glsl);
+    ASSERT_EQ(archive.get_shader_glsl("after"), glsl);
+}
+
+#ifndef WIN32
+TEST_F(shader_archive, unreadable_archive_is_kept) {
+    const std::string glsl = "void main() {}";
+    {
+        ShaderArchive archive;
+        ASSERT_TRUE(archive.open(path, VERSION, FEATURES));
+        archive.add_shader("key", glsl.data(), glsl.size());
+    }
+    const auto size = fs::file_size(path);
+
+    // the archive can't be mapped, it must not be deleted as if it was outdated
+    fs::permissions(path, fs::no_perms);
+    if (access(path.c_str(), R_OK) == 0)
+        GTEST_SKIP() << "the archive is still readable, the test is running with elevated privileges";
+
+    ShaderArchive archive;
+    ASSERT_FALSE(archive.open(path, VERSION, FEATURES));
+    ASSERT_FALSE(archive.is_open());
+    ASSERT_FALSE(archive.was_outdated());
+    ASSERT_EQ(fs::file_size(path), size);
+}
+#endif
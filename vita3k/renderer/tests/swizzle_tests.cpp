@@ -0,0 +1,97 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/functions.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace renderer::texture;
+
+namespace {
+
+typedef void (*ToLinearFunc)(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel);
+
+constexpr uint8_t BITS_PER_PIXEL[] = { 8, 16, 24, 32, 48, 64, 96, 128 };
+
+std::vector<uint8_t> random_texture(uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    // tiled textures are made of whole 32x32 tiles
+    const size_t size = static_cast<size_t>((width + 31) & ~31) * ((height + 31) & ~31) * (bits_per_pixel / 8);
+    std::vector<uint8_t> texture(size);
+    std::mt19937 rng(width * 65536 + height * 256 + bits_per_pixel);
+    for (auto &byte : texture)
+        byte = static_cast<uint8_t>(rng());
+
+    return texture;
+}
+
+void expect_same_result(ToLinearFunc func, ToLinearFunc reference, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const std::vector<uint8_t> src = random_texture(width, height, bits_per_pixel);
+    std::vector<uint8_t> dest(static_cast<size_t>(width) * height * (bits_per_pixel / 8), 0xCD);
+    std::vector<uint8_t> expected(dest.size(), 0xCD);
+
+    func(dest.data(), src.data(), width, height, bits_per_pixel);
+    reference(expected.data(), src.data(), width, height, bits_per_pixel);
+    EXPECT_EQ(dest, expected) << width << "x" << height << " " << static_cast<int>(bits_per_pixel) << "bpp";
+}
+
+template <typename Func>
+double measure_mtexels_per_s(Func func, const std::vector<uint8_t> &src, std::vector<uint8_t> &dest, uint16_t size, uint8_t bits_per_pixel) {
+    constexpr int ITERATIONS = 50;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+        func(dest.data(), src.data(), size, size, bits_per_pixel);
+    const auto end = std::chrono::steady_clock::now();
+
+    return static_cast<double>(size) * size * ITERATIONS / std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+} // namespace
+
+TEST(swizzle, swizzled_matches_reference) {
+    constexpr uint16_t SIZES[][2] = { { 4, 4 }, { 8, 8 }, { 16, 4 }, { 4, 64 }, { 32, 128 }, { 256, 64 }, { 512, 512 }, { 2, 8 }, { 1, 1 }, { 24, 24 } };
+    for (const uint8_t bits_per_pixel : BITS_PER_PIXEL)
+        for (const auto &[width, height] : SIZES)
+            expect_same_result(swizzled_texture_to_linear_texture, swizzled_texture_to_linear_texture_basic, width, height, bits_per_pixel);
+}
+
+TEST(swizzle, tiled_matches_reference) {
+    constexpr uint16_t SIZES[][2] = { { 32, 32 }, { 64, 96 }, { 40, 70 }, { 1, 1 }, { 17, 33 }, { 256, 256 }, { 960, 544 } };
+    for (const uint8_t bits_per_pixel : BITS_PER_PIXEL)
+        for (const auto &[width, height] : SIZES)
+            expect_same_result(tiled_texture_to_linear_texture, tiled_texture_to_linear_texture_basic, width, height, bits_per_pixel);
+}
+
+TEST(swizzle_benchmark, against_basic) {
+    constexpr uint16_t SIZE = 512;
+    for (const uint8_t bits_per_pixel : { 8, 16, 32, 64 }) {
+        const std::vector<uint8_t> src = random_texture(SIZE, SIZE, bits_per_pixel);
+        std::vector<uint8_t> dest(static_cast<size_t>(SIZE) * SIZE * (bits_per_pixel / 8));
+
+        const double swizzled_basic = measure_mtexels_per_s(swizzled_texture_to_linear_texture_basic, src, dest, SIZE, bits_per_pixel);
+        const double swizzled = measure_mtexels_per_s(swizzled_texture_to_linear_texture, src, dest, SIZE, bits_per_pixel);
+        const double tiled_basic = measure_mtexels_per_s(tiled_texture_to_linear_texture_basic, src, dest, SIZE, bits_per_pixel);
+        const double tiled = measure_mtexels_per_s(tiled_texture_to_linear_texture, src, dest, SIZE, bits_per_pixel);
+
+        std::cout << static_cast<int>(bits_per_pixel) << "bpp swizzled: " << swizzled_basic << " -> " << swizzled << " Mtexel/s, "
+                  << "tiled: " << tiled_basic << " -> " << tiled << " Mtexel/s" << std::endl;
+    }
+}
@@ -0,0 +1,93 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/fs.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace testutil {
+
+typedef std::map<std::string, std::vector<uint8_t>> Files;
+
+// Half random bytes, half repeated ones, so compressed data is made of several blocks and still has to be inflated
+inline std::vector<uint8_t> make_data(size_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (i / 4096) % 2 ? static_cast<uint8_t>(random()) : static_cast<uint8_t>(seed);
+
+    return data;
+}
+
+inline std::vector<uint8_t> read_file(const fs::path &file_path) {
+    fs::ifstream file(file_path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+// Fixture giving each test its own temporary directory
+struct TempDirTest : public ::testing::Test {
+    fs::path path;
+
+    void SetUp() override {
+        path = fs::temp_directory_path() / fs::unique_path("vita3k-test-%%%%%%%%");
+        fs::create_directories(path);
+    }
+
+    void TearDown() override {
+        fs::remove_all(path);
+    }
+};
+
+// The install benchmarks write 512 MiB to the temporary directory, so they only run when this variable is set
+constexpr const char *INSTALL_BENCHMARK = "VITA3K_INSTALL_BENCHMARK";
+
+// A game of 256 MiB, with a few big files and a lot of small ones
+inline Files make_game_files(const std::string &prefix) {
+    Files files;
+    for (uint32_t i = 0; i < 12; i++)
+        files[fmt::format("{}big{}.psarc", prefix, i)] = make_data(16 * 1024 * 1024, i);
+    for (uint32_t i = 0; i < 1024; i++)
+        files[fmt::format("{}small/{}.dat", prefix, i)] = make_data(64 * 1024, i);
+
+    return files;
+}
+
+// Time the install of the files on one thread, then on all of them
+inline void benchmark_install(const fs::path &path, const Files &files, const std::function<bool(const fs::path &output_path, uint32_t thread_count)> &install) {
+    for (const uint32_t thread_count : { 1u, 0u }) {
+        const fs::path output_path = path / fmt::format("output{}", thread_count);
+        const auto start = std::chrono::steady_clock::now();
+        ASSERT_TRUE(install(output_path, thread_count));
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << (thread_count ? "1 thread" : "all threads") << ": " << files.size() << " files in " << ms << " ms" << std::endl;
+        fs::remove_all(output_path);
+    }
+}
+
+} // namespace testutil
@@ -0,0 +1,154 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of host worker threads for CPU heavy work that can be split (texture decoding, installs...).
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t thread_count) {
+        for (uint32_t i = 0; i < thread_count; i++)
+            workers.emplace_back([this] { worker_loop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(workers.size());
+    }
+
+    // Run task on one of the workers
+    void push(std::function<void()> task) {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        cond.notify_one();
+    }
+
+    // Call func(begin, end) on chunks of at least min_chunk items covering [0, count), then return once they are all done.
+    // The calling thread processes chunks too, so this can safely be called from a worker or while the pool is busy.
+    void parallel_for(size_t count, size_t min_chunk, const std::function<void(size_t, size_t)> &func) {
+        if (count == 0)
+            return;
+
+        const size_t max_chunks = static_cast<size_t>(workers.size()) * 4 + 1;
+        const size_t chunk_size = std::max(std::max<size_t>(min_chunk, 1), (count + max_chunks - 1) / max_chunks);
+        const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        if (chunk_count == 1) {
+            func(0, count);
+            return;
+        }
+
+        auto job = std::make_shared<ParallelJob>(func, count, chunk_size, chunk_count);
+        const size_t helper_count = std::min<size_t>(workers.size(), chunk_count - 1);
+        for (size_t i = 0; i < helper_count; i++)
+            push([job] { job->run(); });
+
+        job->run();
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->cond.wait(lock, [&] { return job->done_chunks == job->chunk_count; });
+    }
+
+private:
+    struct ParallelJob {
+        const std::function<void(size_t, size_t)> &func;
+        const size_t count;
+        const size_t chunk_size;
+        const size_t chunk_count;
+        std::atomic<size_t> next_chunk = 0;
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t done_chunks = 0;
+
+        ParallelJob(const std::function<void(size_t, size_t)> &func, size_t count, size_t chunk_size, size_t chunk_count)
+            : func(func)
+            , count(count)
+            , chunk_size(chunk_size)
+            , chunk_count(chunk_count) {}
+
+        void run() {
+            size_t processed = 0;
+            for (size_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) {
+                const size_t begin = chunk * chunk_size;
+                func(begin, std::min(begin + chunk_size, count));
+                processed++;
+            }
+
+            if (processed == 0)
+                return;
+
+            const std::lock_guard<std::mutex> lock(mutex);
+            done_chunks += processed;
+            if (done_chunks == chunk_count)
+                cond.notify_all();
+        }
+    };
+
+    void worker_loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::queue<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+// Pool shared by the whole emulator, one worker per host core besides the calling thread
+inline ThreadPool &get_shared_thread_pool() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return pool;
+}
@@ -0,0 +1,44 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <cstdint>
+
+// Mixing of interleaved stereo frames, used by the NGS patches and the host audio output.
+// The source channels go through a volume matrix before being added to the destination:
+//   dest[left] += src[left] * matrix[0][0] + src[right] * matrix[1][0]
+//   dest[right] += src[left] * matrix[0][1] + src[right] * matrix[1][1]
+// The result saturates to [-1, 1] for float samples and to the int16_t range for S16 samples.
+// AVX2 or NEON is used when the cpu supports it.
+namespace util {
+
+void mix_stereo_f32(float *dest, const float *src, uint32_t frames, const float matrix[2][2]);
+void mix_stereo_s16(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]);
+
+// Mix with the same gain on both channels
+inline void mix_stereo_f32(float *dest, const float *src, uint32_t frames, float gain) {
+    const float matrix[2][2] = { { gain, 0.0f }, { 0.0f, gain } };
+    mix_stereo_f32(dest, src, frames, matrix);
+}
+
+inline void mix_stereo_s16(int16_t *dest, const int16_t *src, uint32_t frames, float gain) {
+    const float matrix[2][2] = { { gain, 0.0f }, { 0.0f, gain } };
+    mix_stereo_s16(dest, src, frames, matrix);
+}
+
+} // namespace util
@@ -0,0 +1,231 @@
+// Vita3K emulator project
+// Copyright (C) 2024 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/*
+stereo mixing
+we can have 2 cases
+1 program compiled for aarch64: NEON is always available
+2 autodetect and use the AVX2 or the basic mixing depending on the runtime cpu
+the sums are done in the same order everywhere so all the versions give the same results
+*/
+
+#include <util/audio_mix.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace util {
+
+// mix a single frame, also used for the frames left by the vector versions
+static inline void mix_frame_f32(float *dest, const float *src, const float matrix[2][2]) {
+    dest[0] = std::clamp(dest[0] + (src[0] * matrix[0][0] + src[1] * matrix[1][0]), -1.0f, 1.0f);
+    dest[1] = std::clamp(dest[1] + (src[0] * matrix[0][1] + src[1] * matrix[1][1]), -1.0f, 1.0f);
+}
+
+static inline int16_t saturate_s16(float value) {
+    return static_cast<int16_t>(std::clamp<long>(std::lrint(value), INT16_MIN, INT16_MAX));
+}
+
+static inline void mix_frame_s16(int16_t *dest, const int16_t *src, const float matrix[2][2]) {
+    const float left = src[0];
+    const float right = src[1];
+    dest[0] = saturate_s16(dest[0] + (left * matrix[0][0] + right * matrix[1][0]));
+    dest[1] = saturate_s16(dest[1] + (left * matrix[0][1] + right * matrix[1][1]));
+}
+
+} // namespace util
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+
+namespace util {
+
+void mix_stereo_f32(float *dest, const float *src, uint32_t frames, const float matrix[2][2]) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t minus_one = vdupq_n_f32(-1.0f);
+
+    uint32_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const float32x4x2_t in = vld2q_f32(src + frame * 2);
+        float32x4x2_t out = vld2q_f32(dest + frame * 2);
+
+        const float32x4_t left = vaddq_f32(vmulq_n_f32(in.val[0], matrix[0][0]), vmulq_n_f32(in.val[1], matrix[1][0]));
+        const float32x4_t right = vaddq_f32(vmulq_n_f32(in.val[0], matrix[0][1]), vmulq_n_f32(in.val[1], matrix[1][1]));
+        out.val[0] = vminq_f32(vmaxq_f32(vaddq_f32(out.val[0], left), minus_one), one);
+        out.val[1] = vminq_f32(vmaxq_f32(vaddq_f32(out.val[1], right), minus_one), one);
+        vst2q_f32(dest + frame * 2, out);
+    }
+
+    for (; frame < frames; frame++)
+        mix_frame_f32(dest + frame * 2, src + frame * 2, matrix);
+}
+
+// mix the 4 frames of src into the 4 frames of dest, the channels being split
+static inline int32x4x2_t mix_s16_frames(const int32x4_t dest[2], const int32x4_t src[2], const float matrix[2][2]) {
+    const float32x4_t in_left = vcvtq_f32_s32(src[0]);
+    const float32x4_t in_right = vcvtq_f32_s32(src[1]);
+    const float32x4_t left = vaddq_f32(vmulq_n_f32(in_left, matrix[0][0]), vmulq_n_f32(in_right, matrix[1][0]));
+    const float32x4_t right = vaddq_f32(vmulq_n_f32(in_left, matrix[0][1]), vmulq_n_f32(in_right, matrix[1][1]));
+
+    // round to nearest even like lrint
+    return { { vcvtnq_s32_f32(vaddq_f32(vcvtq_f32_s32(dest[0]), left)),
+        vcvtnq_s32_f32(vaddq_f32(vcvtq_f32_s32(dest[1]), right)) } };
+}
+
+void mix_stereo_s16(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]) {
+    uint32_t frame = 0;
+    for (; frame + 8 <= frames; frame += 8) {
+        const int16x8x2_t in = vld2q_s16(src + frame * 2);
+        int16x8x2_t out = vld2q_s16(dest + frame * 2);
+
+        const int32x4_t in_low[2] = { vmovl_s16(vget_low_s16(in.val[0])), vmovl_s16(vget_low_s16(in.val[1])) };
+        const int32x4_t in_high[2] = { vmovl_s16(vget_high_s16(in.val[0])), vmovl_s16(vget_high_s16(in.val[1])) };
+        const int32x4_t out_low[2] = { vmovl_s16(vget_low_s16(out.val[0])), vmovl_s16(vget_low_s16(out.val[1])) };
+        const int32x4_t out_high[2] = { vmovl_s16(vget_high_s16(out.val[0])), vmovl_s16(vget_high_s16(out.val[1])) };
+
+        const int32x4x2_t low = mix_s16_frames(out_low, in_low, matrix);
+        const int32x4x2_t high = mix_s16_frames(out_high, in_high, matrix);
+
+        // saturating narrow back to 16 bits
+        out.val[0] = vcombine_s16(vqmovn_s32(low.val[0]), vqmovn_s32(high.val[0]));
+        out.val[1] = vcombine_s16(vqmovn_s32(low.val[1]), vqmovn_s32(high.val[1]));
+        vst2q_s16(dest + frame * 2, out);
+    }
+
+    for (; frame < frames; frame++)
+        mix_frame_s16(dest + frame * 2, src + frame * 2, matrix);
+}
+
+} // namespace util
+#else
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#else
+#error "Compiler is not supported"
+#endif
+
+#include <util/instrset_detect.h>
+
+namespace util {
+
+static void mix_stereo_f32_basic(float *dest, const float *src, uint32_t frames, const float matrix[2][2]) {
+    for (uint32_t frame = 0; frame < frames; frame++)
+        mix_frame_f32(dest + frame * 2, src + frame * 2, matrix);
+}
+
+static void mix_stereo_s16_basic(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]) {
+    for (uint32_t frame = 0; frame < frames; frame++)
+        mix_frame_s16(dest + frame * 2, src + frame * 2, matrix);
+}
+
+// Each register holds 4 interleaved frames. The output of a channel is the sum of the sample of the same
+// channel times a coefficient and of the sample of the other channel, swapped in place, times another one
+struct MatrixAVX2 {
+    __m256 same;
+    __m256 other;
+};
+
+static TARGET_AVX2 MatrixAVX2 load_matrix_AVX2(const float matrix[2][2]) {
+    return {
+        _mm256_setr_ps(matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1]),
+        _mm256_setr_ps(matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1])
+    };
+}
+
+static TARGET_AVX2 __m256 apply_matrix_AVX2(__m256 frames, const MatrixAVX2 &matrix) {
+    const __m256 swapped = _mm256_permute_ps(frames, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_add_ps(_mm256_mul_ps(frames, matrix.same), _mm256_mul_ps(swapped, matrix.other));
+}
+
+static TARGET_AVX2 void mix_stereo_f32_AVX2(float *dest, const float *src, uint32_t frames, const float matrix[2][2]) {
+    const MatrixAVX2 coefficients = load_matrix_AVX2(matrix);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minus_one = _mm256_set1_ps(-1.0f);
+
+    uint32_t frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        const __m256 mixed = apply_matrix_AVX2(_mm256_loadu_ps(src + frame * 2), coefficients);
+        const __m256 sum = _mm256_add_ps(_mm256_loadu_ps(dest + frame * 2), mixed);
+        _mm256_storeu_ps(dest + frame * 2, _mm256_min_ps(_mm256_max_ps(sum, minus_one), one));
+    }
+
+    for (; frame < frames; frame++)
+        mix_frame_f32(dest + frame * 2, src + frame * 2, matrix);
+}
+
+// mix 4 frames of 16-bit samples widened to 32 bits
+static TARGET_AVX2 __m256i mix_s16_frames_AVX2(__m128i dest, __m128i src, const MatrixAVX2 &matrix) {
+    const __m256 mixed = apply_matrix_AVX2(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(src)), matrix);
+    // rounds to nearest even like lrint
+    return _mm256_cvtps_epi32(_mm256_add_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(dest)), mixed));
+}
+
+static TARGET_AVX2 void mix_stereo_s16_AVX2(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]) {
+    const MatrixAVX2 coefficients = load_matrix_AVX2(matrix);
+
+    uint32_t frame = 0;
+    for (; frame + 8 <= frames; frame += 8) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + frame * 2));
+        const __m256i out = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dest + frame * 2));
+
+        const __m256i low = mix_s16_frames_AVX2(_mm256_castsi256_si128(out), _mm256_castsi256_si128(in), coefficients);
+        const __m256i high = mix_s16_frames_AVX2(_mm256_extracti128_si256(out, 1), _mm256_extracti128_si256(in, 1), coefficients);
+
+        // the saturating pack works on each 128-bit lane, put the 64-bit blocks back in order
+        const __m256i packed = _mm256_packs_epi32(low, high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + frame * 2), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    for (; frame < frames; frame++)
+        mix_frame_s16(dest + frame * 2, src + frame * 2, matrix);
+}
+
+struct MixFunctions {
+    void (*f32)(float *dest, const float *src, uint32_t frames, const float matrix[2][2]);
+    void (*s16)(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]);
+};
+
+// check on first use if the AVX2 instruction set can be used
+static const MixFunctions &get_mix_functions() {
+    static const MixFunctions functions = []() -> MixFunctions {
+        if (instrset::instrset_detect() >= instrset::instrset_AVX2) {
+            LOG_INFO("AVX2 instruction set is supported. Using fast audio mixing");
+            return { mix_stereo_f32_AVX2, mix_stereo_s16_AVX2 };
+        }
+
+        LOG_INFO("AVX2 instruction set is not supported. Using basic audio mixing");
+        return { mix_stereo_f32_basic, mix_stereo_s16_basic };
+    }();
+
+    return functions;
+}
+
+void mix_stereo_f32(float *dest, const float *src, uint32_t frames, const float matrix[2][2]) {
+    get_mix_functions().f32(dest, src, frames, matrix);
+}
+
+void mix_stereo_s16(int16_t *dest, const int16_t *src, uint32_t frames, const float matrix[2][2]) {
+    get_mix_functions().s16(dest, src, frames, matrix);
+}
+
+} // namespace util
+#endif